@@ -740,6 +740,11 @@ struct cl_page {
          * creation.
          */
         enum cl_page_type        cp_type;
+	/**
+	 * Index of the slab cache this page was allocated from, or -1 if it
+	 * was allocated with kmalloc. Immutable after creation.
+	 */
+	short			 cp_kmem_index;
 
         /**
          * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
@@ -1646,10 +1651,16 @@ enum cl_enq_flags {
 	 * is known to exist.
 	 */
 	CEF_LOCK_MATCH  = 0x00000080,
+	/**
+	 * do not wait for a conflicting lock of this client either, return
+	 * -EWOULDBLOCK instead. Used with CEF_NONBLOCK by the parallel
+	 * sub-lock enqueue of lov.
+	 */
+	CEF_NOWAIT_LOCAL = 0x00000100,
 	/**
 	 * mask of enq_flags.
 	 */
-	CEF_MASK         = 0x000000ff,
+	CEF_MASK         = 0x000001ff,
 };
 
 /**
@@ -2095,6 +2106,11 @@ struct cl_page *cl_page_top         (struct cl_page *page);
 const struct cl_page_slice *cl_page_at(const struct cl_page *page,
                                        const struct lu_device_type *dtype);
 
+/**
+ * Maximal number of pages handed to the cl_page_*_vec() functions at once.
+ */
+#define CL_PAGE_VEC_MAX 16
+
 /**
  * \name ownership
  *
@@ -2106,6 +2122,8 @@ int  cl_page_own        (const struct lu_env *env,
                          struct cl_io *io, struct cl_page *page);
 int  cl_page_own_try    (const struct lu_env *env,
                          struct cl_io *io, struct cl_page *page);
+void cl_page_own_vec    (const struct lu_env *env, struct cl_io *io,
+			 struct cl_page **pvec, int *rcs, int nr);
 void cl_page_assume     (const struct lu_env *env,
                          struct cl_io *io, struct cl_page *page);
 void cl_page_unassume   (const struct lu_env *env,
@@ -2125,6 +2143,9 @@ int  cl_page_is_owned   (const struct cl_page *pg, const struct cl_io *io);
 /** @{ */
 int  cl_page_prep       (const struct lu_env *env, struct cl_io *io,
                          struct cl_page *pg, enum cl_req_type crt);
+void cl_page_prep_vec   (const struct lu_env *env, struct cl_io *io,
+			 struct cl_page **pvec, int *rcs, int nr,
+			 enum cl_req_type crt);
 void cl_page_completion (const struct lu_env *env,
                          struct cl_page *pg, enum cl_req_type crt, int ioret);
 int  cl_page_make_ready (const struct lu_env *env, struct cl_page *pg,
@@ -2367,6 +2388,8 @@ void cl_page_list_discard(const struct lu_env *env,
 void cl_page_list_fini   (const struct lu_env *env, struct cl_page_list *plist);
 
 void cl_2queue_init     (struct cl_2queue *queue);
+void cl_2queue_release  (struct cl_2queue *queue);
+void cl_2queue_adopt    (struct cl_2queue *queue);
 void cl_2queue_add      (struct cl_2queue *queue, struct cl_page *page);
 void cl_2queue_disown   (const struct lu_env *env,
                          struct cl_io *io, struct cl_2queue *queue);
@@ -79,6 +79,19 @@ struct distribute_txn_replay_req_sub {
 	struct list_head	dtrqs_list;
 };
 
+/* Counters in target_distribute_txn_data::tdtd_stats, one per phase of a
+ * cross-MDT transaction, see top_trans_start() and top_trans_stop() */
+enum {
+	DTX_STATS_START = 0,	/* prepare and start all sub transactions */
+	DTX_STATS_MASTER_WRITE,	/* write update log on the master MDT */
+	DTX_STATS_MASTER_STOP,	/* stop the master sub transaction */
+	DTX_STATS_REMOTE_WRITE,	/* write update logs to other MDTs */
+	DTX_STATS_REMOTE_STOP,	/* stop other sub transactions and wait */
+	DTX_STATS_COMMIT,	/* top stop until update logs are cancelled */
+	DTX_STATS_CANCEL_BATCH,	/* records cancelled per llog transaction */
+	DTX_STATS_LAST,
+};
+
 struct target_distribute_txn_data;
 typedef int (*distribute_txn_replay_handler_t)(struct lu_env *env,
 				       struct target_distribute_txn_data *tdtd,
@@ -113,6 +126,9 @@ struct target_distribute_txn_data {
 	/* Manage the llog recovery threads */
 	atomic_t		tdtd_recovery_threads_count;
 	wait_queue_head_t	tdtd_recovery_threads_waitq;
+
+	/* Latency of each phase of distributed transactions */
+	struct lprocfs_stats	*tdtd_stats;
 };
 
 struct lu_target {
@@ -159,6 +175,14 @@ struct lu_target {
 	struct dt_object	*lut_reply_data;
 	/** Bitmap of used slots in the reply data file */
 	unsigned long		**lut_reply_bitmap;
+	/** per-CPT reply slot allocation state */
+	struct tgt_reply_slot_cpt **lut_reply_slot_cpt;
+	/** number of reply slots in use */
+	atomic_t		 lut_reply_slots_used;
+	/** highest reply slot used + 1, i.e. reply_data file records */
+	int			 lut_reply_slots_high;
+	/** reply slot allocation and lookup statistics */
+	struct lprocfs_stats	*lut_reply_stats;
 	/** target sync count, used for debug & test */
 	atomic_t		 lut_sync_count;
 };
@@ -167,6 +191,29 @@ struct lu_target {
 #define LUT_REPLY_SLOTS_PER_CHUNK (1<<20)
 #define LUT_REPLY_SLOTS_MAX_CHUNKS 16
 
+/* Reply slots are handed out by groups, group i being searched first by
+ * the threads of CPT (i % number of CPTs). A group spans a few cache lines
+ * of the bitmap, so CPTs do not bounce the same words while the used slots
+ * stay packed at the start of the reply_data file. */
+#define LUT_REPLY_SLOTS_PER_GROUP 512
+#define LUT_REPLY_GROUPS_PER_CHUNK \
+	(LUT_REPLY_SLOTS_PER_CHUNK / LUT_REPLY_SLOTS_PER_GROUP)
+#define LUT_REPLY_GROUPS_MAX \
+	(LUT_REPLY_GROUPS_PER_CHUNK * LUT_REPLY_SLOTS_MAX_CHUNKS)
+
+struct tgt_reply_slot_cpt {
+	spinlock_t		 rsc_lock;
+	/* lowest group of this CPT which may have a free slot */
+	int			 rsc_group;
+};
+
+/* Counters of lu_target::lut_reply_stats */
+enum {
+	LUT_REPLY_STATS_SLOT_SCAN = 0,	/* groups scanned to get a slot */
+	LUT_REPLY_STATS_LOOKUP,		/* replies scanned by xid lookup */
+	LUT_REPLY_STATS_LAST,
+};
+
 /**
  * Target reply data
  */
@@ -454,6 +501,8 @@ int tgt_server_data_update(const struct lu_env *env, struct lu_target *tg,
 int tgt_truncate_last_rcvd(const struct lu_env *env, struct lu_target *tg,
 			   loff_t off);
 int tgt_reply_data_init(const struct lu_env *env, struct lu_target *tgt);
+int tgt_reply_slot_init(struct lu_target *lut);
+void tgt_reply_slot_fini(struct lu_target *lut);
 bool tgt_lookup_reply(struct ptlrpc_request *req, struct tg_reply_data *trd);
 int tgt_add_reply_data(const struct lu_env *env, struct lu_target *tgt,
 		       struct tg_export_data *ted, struct tg_reply_data *trd,
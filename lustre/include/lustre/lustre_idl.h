@@ -1249,6 +1249,22 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT_BULK_MBITS	 0x2000000000000000ULL
 #define OBD_CONNECT_OBDOPACK	 0x4000000000000000ULL /* compact OUT obdo */
 #define OBD_CONNECT_FLAGS2	 0x8000000000000000ULL /* second flags word */
+
+/* ocd_connect_flags2, only valid when OBD_CONNECT_FLAGS2 is set.
+ * Other branches assign the flags2 bits from the bottom of the word and
+ * also use some at its top. These flags take bits 48-52, clear of both,
+ * and must be reserved on every branch as the README below asks before
+ * they are used by a release. */
+/** several objects per write BRW */
+#define OBD_CONNECT2_MULTIOBJ_BRW	0x0001000000000000ULL
+/** extent lock downgrade from PW to PR */
+#define OBD_CONNECT2_LOCK_CONVERT	0x0002000000000000ULL
+/** several locks per blocking AST */
+#define OBD_CONNECT2_BL_AST_BATCH	0x0004000000000000ULL
+/** several objects per OSP destroy */
+#define OBD_CONNECT2_DESTROY_BATCH	0x0008000000000000ULL
+/** a non-blocking extent enqueue fails on conflict without blocking ASTs */
+#define OBD_CONNECT2_EXTENT_NOWAIT	0x0010000000000000ULL
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -1295,7 +1311,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_OPEN_BY_FID | \
 				OBD_CONNECT_DIR_STRIPE | \
 				OBD_CONNECT_BULK_MBITS | \
-				OBD_CONNECT_MULTIMODRPCS)
+				OBD_CONNECT_MULTIMODRPCS | OBD_CONNECT_FLAGS2)
+#define MDT_CONNECT_SUPPORTED2 (OBD_CONNECT2_BL_AST_BATCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
                                 OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -1314,7 +1331,12 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_LIGHTWEIGHT | OBD_CONNECT_LVB_TYPE|\
 				OBD_CONNECT_LAYOUTLOCK | OBD_CONNECT_FID | \
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK | \
-				OBD_CONNECT_BULK_MBITS)
+				OBD_CONNECT_BULK_MBITS | OBD_CONNECT_FLAGS2)
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_MULTIOBJ_BRW | \
+				OBD_CONNECT2_LOCK_CONVERT | \
+				OBD_CONNECT2_BL_AST_BATCH | \
+				OBD_CONNECT2_DESTROY_BATCH | \
+				OBD_CONNECT2_EXTENT_NOWAIT)
 #define ECHO_CONNECT_SUPPORTED (0)
 #define MGS_CONNECT_SUPPORTED  (OBD_CONNECT_VERSION | OBD_CONNECT_AT | \
 				OBD_CONNECT_FULL20 | OBD_CONNECT_IMP_RECOV | \
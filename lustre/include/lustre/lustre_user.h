@@ -1006,6 +1006,18 @@ static inline void changelog_remap_rec(struct changelog_rec *rec,
 	rec->cr_flags = (rec->cr_flags & CLF_FLAGMASK) | crf_wanted;
 }
 
+/* Only changelog records matching all of the set fields are sent to the
+ * reader, see llapi_changelog_start_filter(). */
+struct changelog_filter {
+	/* bitmask of (1 << CL_*) record types, 0 for all types */
+	__u32		cf_mask;
+	__u32		cf_padding;
+	/* records for this FID or for entries of this directory */
+	struct lu_fid	cf_fid;
+	/* records with this jobid */
+	char		cf_jobid[LUSTRE_JOBID_SIZE];
+};
+
 struct ioc_changelog {
         __u64 icc_recno;
         __u32 icc_mdtindex;
@@ -1013,6 +1025,13 @@ struct ioc_changelog {
         __u32 icc_flags;
 };
 
+/* argument of OBD_IOC_CHANGELOG_SEND_FILTER, struct ioc_changelog is kept
+ * as is for OBD_IOC_CHANGELOG_SEND so that older tools still work */
+struct ioc_changelog_filter {
+	struct ioc_changelog	icf_icc;
+	struct changelog_filter	icf_filter;
+};
+
 enum changelog_message_type {
         CL_RECORD = 10, /* message is a changelog_rec */
         CL_EOF    = 11, /* at end of current changelog */
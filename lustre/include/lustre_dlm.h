@@ -64,6 +64,7 @@ struct obd_device;
 
 #define LDLM_DEFAULT_LRU_SIZE (100 * num_online_cpus())
 #define LDLM_DEFAULT_MAX_ALIVE (cfs_time_seconds(3900)) /* 65 min */
+#define LDLM_DEFAULT_LRU_COST_PAGES 256 /* cached pages per idle second */
 #define LDLM_CTIME_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
 
@@ -272,6 +273,16 @@ typedef int (*ldlm_res_policy)(struct ldlm_namespace *, struct ldlm_lock **,
 
 typedef int (*ldlm_cancel_cbt)(struct ldlm_lock *lock);
 
+/** LRU of unused locks created on one CPT of a client namespace */
+struct ldlm_lru {
+	/** Lock for ll_list and ll_nr */
+	spinlock_t		ll_lock;
+	/** Unused locks, least recently used first */
+	struct list_head	ll_list;
+	/** Number of locks in ll_list */
+	int			ll_nr;
+};
+
 /**
  * LVB operations.
  * LVB is Lock Value Block. This is a special opaque (to LDLM) value that could
@@ -401,18 +412,28 @@ struct ldlm_namespace {
 	struct list_head	ns_list_chain;
 
 	/**
-	 * List of unused locks for this namespace. This list is also called
-	 * LRU lock list.
+	 * Per-CPT lists of unused locks for this namespace. These lists are
+	 * also called LRU lock lists.
 	 * Unused locks are locks with zero reader/writer reference counts.
-	 * This list is only used on clients for lock caching purposes.
+	 * These lists are only used on clients for lock caching purposes.
 	 * When we want to release some locks voluntarily or if server wants
 	 * us to release some locks due to e.g. memory pressure, we take locks
-	 * to release from the head of this list.
-	 * Locks are linked via l_lru field in \see struct ldlm_lock.
+	 * to release from the heads of these lists.
+	 * Locks are linked via l_lru field in \see struct ldlm_lock, each on
+	 * the list of the CPT it was created on, see ldlm_ns_nr_unused() for
+	 * the total number of unused locks.
+	 */
+	struct ldlm_lru		**ns_lru;
+	/** Number of locks examined per LRU scan */
+	struct obd_histogram	ns_lru_scan_hist;
+	/** Time spent canceling locks from the LRU per call, in usec */
+	struct obd_histogram	ns_lru_cancel_hist;
+	/**
+	 * Number of cached pages a lock may keep for each second it has been
+	 * unused before the memory pressure policy cancels it, see
+	 * ldlm_cancel_cost_policy().
 	 */
-	struct list_head	ns_unused_list;
-	/** Number of locks in the LRU list above */
-	int			ns_nr_unused;
+	unsigned int		ns_lru_cost_pages;
 
 	/**
 	 * Maximum number of locks permitted in the LRU. If 0, means locks
@@ -427,6 +448,8 @@ struct ldlm_namespace {
 	 * to ASTs.
 	 */
 	unsigned int		ns_timeouts;
+	/** Server only: number of batched blocking ASTs sent. */
+	unsigned int		ns_bl_ast_batches;
 	/**
 	 * Number of seconds since the file change time after which the
 	 * MDT will return an UPDATE lock along with a LOOKUP lock.
@@ -493,7 +516,9 @@ struct ldlm_namespace {
 
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
-	 * during recovery.
+	 * during recovery. Returns 0 if canceling the lock would have to
+	 * wait for IO, otherwise 1 plus the number of cached pages canceling
+	 * the lock would drop.
 	 */
 	ldlm_cancel_cbt		ns_cancel;
 
@@ -563,6 +588,18 @@ static inline void ns_register_cancel(struct ldlm_namespace *ns,
 	ns->ns_cancel = arg;
 }
 
+/** Number of locks in the LRU lists of \a ns */
+static inline int ldlm_ns_nr_unused(struct ldlm_namespace *ns)
+{
+	struct ldlm_lru *lru;
+	int nr = 0;
+	int i;
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru)
+		nr += lru->ll_nr;
+	return nr;
+}
+
 struct ldlm_lock;
 
 /** Type for blocking callback function of a lock. */
@@ -694,9 +731,12 @@ struct ldlm_lock {
 	struct ldlm_resource	*l_resource;
 	/**
 	 * List item for client side LRU list.
-	 * Protected by ns_lock in struct ldlm_namespace.
+	 * Protected by ll_lock of the LRU of CPT l_lru_cpt, see struct
+	 * ldlm_lru.
 	 */
 	struct list_head	l_lru;
+	/** CPT the lock was created on, whose LRU the lock goes to */
+	int			l_lru_cpt;
 	/**
 	 * Linkage to resource's lock queues according to current lock state.
 	 * (could be granted, waiting or converting)
@@ -1494,6 +1534,9 @@ int ldlm_cli_enqueue_local(struct ldlm_namespace *ns,
 int ldlm_server_ast(struct lustre_handle *lockh, struct ldlm_lock_desc *new,
 		    void *data, __u32 data_len);
 int ldlm_cli_convert(struct lustre_handle *, int new_mode, __u32 *flags);
+int ldlm_cli_extent_downgrade(const struct lustre_handle *lockh,
+			      enum ldlm_mode new_mode,
+			      const struct ldlm_extent *new_ext);
 int ldlm_cli_update_pool(struct ptlrpc_request *req);
 int ldlm_cli_cancel(struct lustre_handle *lockh,
 		    enum ldlm_cancel_flags cancel_flags);
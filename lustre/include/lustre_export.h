@@ -306,6 +306,13 @@ static inline __u64 exp_connect_flags(struct obd_export *exp)
 	return *exp_connect_flags_ptr(exp);
 }
 
+static inline __u64 exp_connect_flags2(struct obd_export *exp)
+{
+	if (exp_connect_flags(exp) & OBD_CONNECT_FLAGS2)
+		return exp->exp_connect_data.ocd_connect_flags2;
+	return 0;
+}
+
 static inline int exp_max_brw_size(struct obd_export *exp)
 {
 	LASSERT(exp != NULL);
@@ -327,6 +334,26 @@ static inline int exp_expired(struct obd_export *exp, cfs_duration_t age)
                                cfs_time_current_sec());
 }
 
+static inline bool exp_connect_multiobj_brw(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_MULTIOBJ_BRW);
+}
+
+static inline bool exp_connect_lock_convert(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_LOCK_CONVERT);
+}
+
+static inline bool exp_connect_extent_nowait(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_EXTENT_NOWAIT);
+}
+
+static inline bool exp_connect_bl_ast_batch(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_BL_AST_BATCH);
+}
+
 static inline int exp_connect_cancelset(struct obd_export *exp)
 {
 	LASSERT(exp != NULL);
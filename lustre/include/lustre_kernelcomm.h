@@ -45,6 +45,7 @@ typedef int (*libcfs_kkuc_cb_t)(void *data, void *cb_arg);
 
 /* Kernel methods */
 int libcfs_kkuc_msg_put(struct file *fp, void *payload);
+int libcfs_kkuc_batch_put(struct file *fp, void *payload, size_t len);
 int libcfs_kkuc_group_put(int group, void *payload);
 int libcfs_kkuc_group_add(struct file *fp, int uid, int group,
 			  void *data, size_t data_len);
@@ -464,20 +464,26 @@
 #define OSS_CR_NTHRS_BASE	8
 #define OSS_CR_NTHRS_MAX	64
 
+/**
+ * Maximum number of objects packed in one multi-object write BRW, see
+ * OBD_CONNECT2_MULTIOBJ_BRW.
+ */
+#define OST_MAX_BRW_OBJS	16
+
 /**
  * OST_IO_MAXREQSIZE ~=
- * 	lustre_msg + ptlrpc_body + obdo + obd_ioobj +
+ * 	lustre_msg + ptlrpc_body + OST_MAX_BRW_OBJS * (obdo + obd_ioobj) +
  * 	DT_MAX_BRW_PAGES * niobuf_remote
  *
  * - single object with 16 pages is 512 bytes
  * - OST_IO_MAXREQSIZE must be at least 1 page of cookies plus some spillover
  * - Must be a multiple of 1024
- * - actual size is about 18K
+ * - actual size is about 22K
  */
 #define _OST_MAXREQSIZE_SUM (sizeof(struct lustre_msg) + \
 			     sizeof(struct ptlrpc_body) + \
-			     sizeof(struct obdo) + \
-			     sizeof(struct obd_ioobj) + \
+			     (sizeof(struct obdo) + \
+			      sizeof(struct obd_ioobj)) * OST_MAX_BRW_OBJS + \
 			     sizeof(struct niobuf_remote) * DT_MAX_BRW_PAGES)
 /**
  * FIEMAP request can be 4K+ for now
@@ -493,7 +499,7 @@
 /** OST_BUFSIZE = max_reqsize + max sptlrpc payload size */
 #define OST_BUFSIZE		max_t(int, OST_MAXREQSIZE + 1024, 16 * 1024)
 /**
- * OST_IO_MAXREQSIZE is 18K, giving extra 46K can increase buffer utilization
+ * OST_IO_MAXREQSIZE is 22K, giving extra 42K can increase buffer utilization
  * rate of request buffer, please check comment of MDS_LOV_BUFSIZE for details.
  */
 #define OST_IO_BUFSIZE		max_t(int, OST_IO_MAXREQSIZE + 1024, 64 * 1024)
@@ -1913,6 +1919,17 @@ struct ptlrpcd_ctl {
 	 * Error code if the thread failed to fully start.
 	 */
 	int				pc_error;
+	/**
+	 * Number of times this thread took queued RPCs from another
+	 * thread, and how many of those steals crossed a CPT boundary.
+	 * Only updated by the thread itself.
+	 */
+	unsigned long			pc_steals;
+	unsigned long			pc_remote_steals;
+	/**
+	 * Total number of RPCs taken from other threads' queues.
+	 */
+	unsigned long			pc_stolen_rpcs;
 };
 
 /* Bits for pc_flags */
@@ -2177,6 +2194,7 @@ void *ptlrpcd_alloc_work(struct obd_import *imp,
                          int (*cb)(const struct lu_env *, void *), void *data);
 void ptlrpcd_destroy_work(void *handler);
 int ptlrpcd_queue_work(void *handler);
+int ptlrpcd_queue_work_cpt(void *handler, int cpt);
 
 /** @} */
 struct ptlrpc_service_buf_conf {
@@ -2639,6 +2657,7 @@ void ptlrpcd_stop(struct ptlrpcd_ctl *pc, int force);
 void ptlrpcd_free(struct ptlrpcd_ctl *pc);
 void ptlrpcd_wake(struct ptlrpc_request *req);
 void ptlrpcd_add_req(struct ptlrpc_request *req);
+void ptlrpcd_add_req_cpt(struct ptlrpc_request *req, int cpt);
 void ptlrpcd_add_rqset(struct ptlrpc_request_set *set);
 int ptlrpcd_addref(void);
 void ptlrpcd_decref(void);
@@ -297,6 +297,8 @@ struct top_multiple_thandle {
 	__u32			tmt_magic;
 	size_t			tmt_record_size;
 	__u32			tmt_committed:1;
+	/* when top_trans_stop() finished, for DTX_STATS_COMMIT */
+	struct timeval		tmt_stop_time;
 };
 
 /* {top,sub}_thandle are used to manage distributed transactions which
@@ -156,6 +156,14 @@ enum {
 
 struct mdc_rpc_lock;
 struct obd_import;
+/** Per-CPT segment of the LRU page list of a client_obd */
+struct cl_lru_segment {
+	/** Lock for cls_list */
+	spinlock_t		cls_lock;
+	/** LRU pages allocated by threads running on this CPT */
+	struct list_head	cls_list;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -267,11 +275,11 @@ struct client_obd {
 	 * reclaim and shrink - shrink is async, voluntarily rebalancing;
 	 * reclaim is sync, initiated by IO thread when the LRU slots are
 	 * in shortage. */
-	__u64                    cl_lru_reclaim;
-	/** List of LRU pages for this client_obd */
-	struct list_head         cl_lru_list;
-	/** Lock for LRU page list */
-	spinlock_t		 cl_lru_list_lock;
+	atomic_long_t		 cl_lru_reclaim;
+	/** Per-CPT segments of the LRU page list for this client_obd */
+	struct cl_lru_segment	**cl_lru_segs;
+	/** reclaim latency and allocation stalls, see osc_lru_alloc() */
+	struct lprocfs_stats	*cl_lru_stats;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
@@ -295,6 +303,20 @@ struct client_obd {
 	unsigned long		*cl_mod_tag_bitmap;
 	struct obd_histogram	 cl_mod_rpcs_hist;
 
+	/* readdir readahead, currently used for metadata only */
+	int			 cl_readdir_ahead;
+	atomic_t		 cl_readdir_ra_rpcs;
+	atomic_t		 cl_readdir_ra_hits;
+	/* MDS_READPAGE RPCs in flight, readahead and the lock enqueues
+	 * of striped directory prefetch included */
+	atomic_t		 cl_readdir_in_flight;
+
+	/* catalog index of the plain llog holding changelog record
+	 * cl_chlg_recno, so readers starting after that record can skip
+	 * the llogs before it, protected by cl_loi_list_lock */
+	__u64			 cl_chlg_recno;
+	int			 cl_chlg_catidx;
+
         /* mgc datastruct */
 	struct mutex		  cl_mgc_mutex;
 	struct local_oid_storage *cl_mgc_los;
@@ -336,6 +358,8 @@ struct echo_client_obd {
 	struct list_head	ec_objects;
 	struct list_head	ec_locks;
 	__u64			ec_unique;
+	/* cost of the cl_page setup and teardown of bulk IO */
+	struct lprocfs_stats	*ec_page_stats;
 };
 
 /* Generic subset of OSTs */
@@ -384,6 +408,13 @@ struct lov_obd {
 	struct cl_client_cache *lov_cache;
 
 	struct rw_semaphore	lov_notify_lock;
+	/* minimal number of stripes an IO has to touch for its sub-IOs to
+	 * be run in parallel by the lov_io workers, 0 to disable */
+	__u32			lov_io_fanout;
+	/* lock acquisition latency, see lov_lock_enqueue() */
+	struct lprocfs_stats	*lov_lock_stats;
+	/* page submissions run by the lov_io workers, see lov_io_submit() */
+	struct lprocfs_stats	*lov_io_stats;
 };
 
 struct lmv_tgt_desc {
@@ -728,6 +759,7 @@ struct obd_device {
 
 /* get/set_info keys */
 #define KEY_ASYNC               "async"
+#define KEY_BRW_SIZE		"brw_size"
 #define KEY_CHANGELOG_CLEAR     "changelog_clear"
 #define KEY_FID2PATH            "fid2path"
 #define KEY_CHECKSUM            "checksum"
@@ -791,6 +823,8 @@ enum md_cli_flags {
 	CLI_HASH64      = 1 << 2,
 	CLI_API32       = 1 << 3,
 	CLI_MIGRATE     = 1 << 4,
+	/* only start reading the directory page, see mdc_read_page() */
+	CLI_PREFETCH	= 1 << 5,
 };
 
 struct md_op_data {
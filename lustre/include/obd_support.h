@@ -323,6 +323,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_OST_SET_INFO_NET        0x232
 #define OBD_FAIL_OST_NODESTROY		 0x233
 #define OBD_FAIL_OST_READ_SIZE		 0x234
+#define OBD_FAIL_OST_DESTROY_ENOENT	 0x235
+#define OBD_FAIL_OST_DESTROY_PARTIAL	 0x236
 
 #define OBD_FAIL_LDLM                    0x300
 #define OBD_FAIL_LDLM_NAMESPACE_NEW      0x301
@@ -365,6 +367,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_LDLM_SRV_GL_AST	 0x326
 #define OBD_FAIL_LDLM_WATERMARK_LOW	 0x327
 #define OBD_FAIL_LDLM_WATERMARK_HIGH	 0x328
+#define OBD_FAIL_LDLM_BL_BATCH_RACE	 0x329
+#define OBD_FAIL_LDLM_LRU_CANCEL_PAUSE	 0x32a
 
 /* LOCKLESS IO */
 #define OBD_FAIL_LDLM_SET_CONTENTION     0x385
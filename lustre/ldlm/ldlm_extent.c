@@ -730,6 +730,18 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
         if (rc2 < 0)
                 GOTO(out, rc = rc2); /* lock was destroyed */
 
+	/* A client which negotiated OBD_CONNECT2_EXTENT_NOWAIT does not want
+	 * to wait for a conflicting lock, nor to have it called back: it
+	 * takes its locks in order again, see lov_lock_enqueue_fanout(). */
+	if (rc + rc2 != 2 && (*flags & LDLM_FL_BLOCK_NOWAIT) &&
+	    !ldlm_is_ast_discard_data(lock) && lock->l_export != NULL &&
+	    exp_connect_extent_nowait(lock->l_export)) {
+		list_del_init(&lock->l_res_link);
+		ldlm_lock_destroy_nolock(lock);
+		*err = -EWOULDBLOCK;
+		GOTO(out, rc = -EWOULDBLOCK);
+	}
+
         if (rc + rc2 == 2) {
         grant:
                 ldlm_extent_policy(res, lock, flags);
@@ -957,6 +969,116 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 	}
 }
 
+/**
+ * Downgrade a granted extent lock in place instead of cancelling it.
+ *
+ * A PW lock drops to PR, and its extent may shrink to \a new_ext, which
+ * has to lie within the granted extent.  The server calls this for an
+ * LDLM_CONVERT request from a client which negotiated
+ * OBD_CONNECT2_LOCK_CONVERT; the client calls it to update its own copy
+ * once the server has agreed.
+ *
+ * The server refuses the downgrade while a waiting lock still conflicts
+ * with the result: reprocessing does not send blocking ASTs, so such a
+ * waiter would be left waiting for a lock nobody is going to cancel.
+ *
+ * \param lock		granted PW extent lock
+ * \param new_mode	LCK_PR
+ * \param new_ext	new extent of \a lock
+ *
+ * \retval 0		lock downgraded
+ * \retval -EINVAL	the change is not a downgrade of a granted lock
+ * \retval -EBUSY	a waiting lock conflicts with the downgraded lock
+ * \retval -ENOMEM	no memory for the interval tree node
+ */
+int ldlm_extent_downgrade(struct ldlm_lock *lock, enum ldlm_mode new_mode,
+			  const struct ldlm_extent *new_ext)
+{
+	struct ldlm_extent *ext = &lock->l_policy_data.l_extent;
+	struct ldlm_resource *res;
+	struct ldlm_namespace *ns;
+	struct ldlm_interval *node;
+	struct ldlm_lock *wlock;
+	int rc = 0;
+	ENTRY;
+
+	/* the lock loses its interval node when it is unlinked below */
+	OBD_SLAB_ALLOC_PTR_GFP(node, ldlm_interval_slab, GFP_NOFS);
+	if (node == NULL)
+		RETURN(-ENOMEM);
+	INIT_LIST_HEAD(&node->li_group);
+
+	lock_res_and_lock(lock);
+	res = lock->l_resource;
+	ns = ldlm_res_to_ns(res);
+
+	if (res->lr_type != LDLM_EXTENT || ldlm_is_destroyed(lock) ||
+	    ldlm_is_canceling(lock) ||
+	    lock->l_granted_mode != lock->l_req_mode ||
+	    lock->l_granted_mode != LCK_PW || new_mode != LCK_PR ||
+	    new_ext->start > new_ext->end ||
+	    new_ext->start < ext->start || new_ext->end > ext->end)
+		GOTO(out, rc = -EINVAL);
+
+	if (!ns_is_client(ns)) {
+		/* the blocking AST has not even been sent yet */
+		if (!list_empty(&lock->l_bl_ast))
+			GOTO(out, rc = -EBUSY);
+
+		list_for_each_entry(wlock, &res->lr_waiting, l_res_link) {
+			struct ldlm_extent *wext = &wlock->l_policy_data.l_extent;
+
+			if (lockmode_compat(wlock->l_req_mode, new_mode) ||
+			    wext->end < new_ext->start ||
+			    wext->start > new_ext->end)
+				continue;
+
+			LDLM_DEBUG(wlock, "conflicts with downgrade to %s ["
+				   LPU64"->"LPU64"]", ldlm_lockname[new_mode],
+				   new_ext->start, new_ext->end);
+			GOTO(out, rc = -EBUSY);
+		}
+	}
+
+	ldlm_resource_unlink_lock(lock);
+	/* ldlm_grant_lock() adds the lock back with its new mode */
+	ldlm_pool_del(&ns->ns_pool, lock);
+	ldlm_interval_attach(node, lock);
+	node = NULL;
+
+	lock->l_req_mode = new_mode;
+	ext->start = new_ext->start;
+	ext->end = new_ext->end;
+	if (lock->l_req_extent.start < ext->start)
+		lock->l_req_extent.start = ext->start;
+	if (lock->l_req_extent.end > ext->end)
+		lock->l_req_extent.end = ext->end;
+	if (lock->l_req_extent.start > lock->l_req_extent.end)
+		lock->l_req_extent = *ext;
+	ldlm_grant_lock(lock, NULL);
+
+	if (ns_is_client(ns)) {
+		/* The lock is no longer being called back, so it can be
+		 * matched again and go back to the LRU when unused. */
+		ldlm_clear_cbpending(lock);
+		ldlm_clear_bl_ast(lock);
+		if (lock->l_readers == 0 && lock->l_writers == 0 &&
+		    list_empty(&lock->l_lru) && !ldlm_is_no_lru(lock))
+			ldlm_lock_add_to_lru(lock);
+	} else if (ldlm_is_ast_sent(lock)) {
+		/* let the next conflicting lock send a new blocking AST */
+		ldlm_clear_ast_sent(lock);
+		lock->l_bl_ast_run = 0;
+	}
+	LDLM_DEBUG(lock, "downgraded");
+	EXIT;
+out:
+	unlock_res_and_lock(lock);
+	if (node != NULL)
+		OBD_SLAB_FREE(node, ldlm_interval_slab, sizeof(*node));
+	return rc;
+}
+
 void ldlm_extent_policy_wire_to_local(const union ldlm_wire_policy_data *wpolicy,
 				      union ldlm_policy_data *lpolicy)
 {
@@ -167,6 +167,12 @@ int ldlm_reprocess_queue(struct ldlm_resource *res, struct list_head *queue,
 int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
                       ldlm_desc_ast_t ast_type);
 int ldlm_work_gl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq);
+/** LRU list \a lock goes to when it becomes unused */
+static inline struct ldlm_lru *ldlm_lock_lru(struct ldlm_lock *lock)
+{
+	return ldlm_lock_to_ns(lock)->ns_lru[lock->l_lru_cpt];
+}
+
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock,
 				    cfs_time_t last_use);
 #define ldlm_lock_remove_from_lru(lock) ldlm_lock_remove_from_lru_check(lock, 0)
@@ -191,6 +197,14 @@ int ldlm_bl_thread_wakeup(void);
 void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
                              struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
 
+/* Max locks revoked by one blocking AST RPC, see OBD_CONNECT2_BL_AST_BATCH */
+#define LDLM_BL_AST_BATCH_MAX	256
+
+#ifdef HAVE_SERVER_SUPPORT
+int ldlm_server_blocking_ast_batch(struct ldlm_lock **locks, int count,
+				   struct ldlm_cb_set_arg *arg);
+#endif
+
 #ifdef HAVE_SERVER_SUPPORT
 /* ldlm_plain.c */
 int ldlm_process_plain_lock(struct ldlm_lock *lock, __u64 *flags,
@@ -211,6 +225,8 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 #endif
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
+int ldlm_extent_downgrade(struct ldlm_lock *lock, enum ldlm_mode new_mode,
+			  const struct ldlm_extent *new_ext);
 
 /* ldlm_flock.c */
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
@@ -349,6 +365,7 @@ extern __u64 ldlm_reclaim_threshold;
 extern __u64 ldlm_lock_limit;
 extern __u64 ldlm_reclaim_threshold_mb;
 extern __u64 ldlm_lock_limit_mb;
+extern unsigned int ldlm_export_lock_limit;
 extern struct percpu_counter ldlm_granted_total;
 #endif
 int ldlm_reclaim_setup(void);
@@ -356,3 +373,4 @@ void ldlm_reclaim_cleanup(void);
 void ldlm_reclaim_add(struct ldlm_lock *lock);
 void ldlm_reclaim_del(struct ldlm_lock *lock);
 bool ldlm_reclaim_full(void);
+bool ldlm_reclaim_export(struct obd_export *exp);
@@ -378,8 +378,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	atomic_set(&cli->cl_lru_shrinkers, 0);
 	atomic_long_set(&cli->cl_lru_busy, 0);
 	atomic_long_set(&cli->cl_lru_in_list, 0);
-	INIT_LIST_HEAD(&cli->cl_lru_list);
-	spin_lock_init(&cli->cl_lru_list_lock);
+	atomic_long_set(&cli->cl_lru_reclaim, 0);
 	atomic_long_set(&cli->cl_unstable_count, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 
@@ -431,8 +430,14 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	init_waitqueue_head(&cli->cl_mod_rpcs_waitq);
 	cli->cl_mod_tag_bitmap = NULL;
 
+	cli->cl_readdir_ahead = 0;
+	atomic_set(&cli->cl_readdir_ra_rpcs, 0);
+	atomic_set(&cli->cl_readdir_ra_hits, 0);
+	atomic_set(&cli->cl_readdir_in_flight, 0);
+
 	if (connect_op == MDS_CONNECT) {
 		cli->cl_max_mod_rpcs_in_flight = cli->cl_max_rpcs_in_flight - 1;
+		cli->cl_readdir_ahead = 1;
 		OBD_ALLOC(cli->cl_mod_tag_bitmap,
 			  BITS_TO_LONGS(OBD_MAX_RIF_MAX) * sizeof(long));
 		if (cli->cl_mod_tag_bitmap == NULL)
@@ -567,6 +572,7 @@ int client_connect_import(const struct lu_env *env,
 		if (is_mdc)
 			data->ocd_connect_flags |= OBD_CONNECT_MULTIMODRPCS;
                 imp->imp_connect_flags_orig = data->ocd_connect_flags;
+		imp->imp_connect_flags2_orig = data->ocd_connect_flags2;
         }
 
         rc = ptlrpc_connect_import(imp);
@@ -234,12 +234,12 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 {
 	int rc = 0;
 	if (!list_empty(&lock->l_lru)) {
-		struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+		struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 		LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
 		list_del_init(&lock->l_lru);
-		LASSERT(ns->ns_nr_unused > 0);
-		ns->ns_nr_unused--;
+		LASSERT(lru->ll_nr > 0);
+		lru->ll_nr--;
 		rc = 1;
 	}
 	return rc;
@@ -258,7 +258,7 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
  */
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, cfs_time_t last_use)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 	int rc = 0;
 
 	ENTRY;
@@ -267,10 +267,10 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, cfs_time_t last_use)
 		RETURN(0);
 	}
 
-	spin_lock(&ns->ns_lock);
+	spin_lock(&lru->ll_lock);
 	if (last_use == 0 || last_use == lock->l_last_used)
 		rc = ldlm_lock_remove_from_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 
 	RETURN(rc);
 }
@@ -280,29 +280,32 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, cfs_time_t last_use)
  */
 void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 	lock->l_last_used = cfs_time_current();
 	LASSERT(list_empty(&lock->l_lru));
 	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
+	list_add_tail(&lock->l_lru, &lru->ll_list);
 	ldlm_clear_skipped(lock);
-	LASSERT(ns->ns_nr_unused >= 0);
-	ns->ns_nr_unused++;
+	LASSERT(lru->ll_nr >= 0);
+	lru->ll_nr++;
 }
 
 /**
  * Adds LDLM lock \a lock to namespace LRU. Obtains necessary LRU locks
  * first.
+ *
+ * Only the LRU of the CPT the lock was created on is locked, so threads
+ * releasing locks on different CPTs do not contend here.
  */
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 	ENTRY;
-	spin_lock(&ns->ns_lock);
+	spin_lock(&lru->ll_lock);
 	ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 	EXIT;
 }
 
@@ -312,7 +315,7 @@ void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
  */
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 	ENTRY;
 	if (ldlm_is_ns_srv(lock)) {
@@ -321,12 +324,12 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 		return;
 	}
 
-	spin_lock(&ns->ns_lock);
+	spin_lock(&lru->ll_lock);
 	if (!list_empty(&lock->l_lru)) {
 		ldlm_lock_remove_from_lru_nolock(lock);
 		ldlm_lock_add_to_lru_nolock(lock);
 	}
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 	EXIT;
 }
 
@@ -471,6 +474,7 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 
 	spin_lock_init(&lock->l_lock);
 	lock->l_resource = resource;
+	lock->l_lru_cpt = cfs_cpt_current(cfs_cpt_table, 0);
 	lu_ref_add(&resource->lr_reference, "lock", lock);
 
 	atomic_set(&lock->l_refc, 2);
@@ -1977,6 +1981,70 @@ ldlm_work_cp_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	RETURN(rc);
 }
 
+#ifdef HAVE_SERVER_SUPPORT
+/**
+ * Whether the revocation AST of \a lock may share one RPC with the other
+ * locks of its client, see ldlm_server_blocking_ast_batch(). Only locks
+ * revoked by ldlm_server_blocking_ast() are batched, so that the blocking
+ * callbacks of other lock users (e.g. the COS handling of the MDT) still
+ * run for each of their locks.
+ */
+static inline bool ldlm_revoke_ast_batchable(struct ldlm_lock *lock)
+{
+	return lock->l_export != NULL &&
+	       lock->l_blocking_ast == ldlm_server_blocking_ast &&
+	       exp_connect_bl_ast_batch(lock->l_export) &&
+	       !ldlm_is_cancel_on_block(lock) &&
+	       !(lock->l_flags & LDLM_FL_AST_MASK);
+}
+
+/**
+ * Take \a first and the other locks of the same client off the ast_work
+ * list and revoke them all with one blocking AST RPC.
+ *
+ * \retval 0		RPC is added to the set
+ * \retval 1		\a first is the only lock of its client on the list,
+ *			it is left on the list
+ * \retval negative	error
+ */
+static int ldlm_work_revoke_ast_batch(struct ldlm_cb_set_arg *arg,
+				      struct ldlm_lock *first)
+{
+	struct obd_export	 *exp = first->l_export;
+	struct ldlm_lock	**locks;
+	struct ldlm_lock	 *lock;
+	struct ldlm_lock	 *next;
+	int			  count = 0;
+	ENTRY;
+
+	lock = list_entry(first->l_rk_ast.next, struct ldlm_lock, l_rk_ast);
+	list_for_each_entry_from(lock, arg->list, l_rk_ast) {
+		if (lock->l_export == exp && ldlm_revoke_ast_batchable(lock))
+			break;
+	}
+	if (&lock->l_rk_ast == arg->list)
+		RETURN(1);
+
+	OBD_ALLOC(locks, LDLM_BL_AST_BATCH_MAX * sizeof(*locks));
+	if (locks == NULL)
+		RETURN(1);
+
+	/* the references are passed from the list to the RPC */
+	lock = first;
+	list_for_each_entry_safe_from(lock, next, arg->list, l_rk_ast) {
+		if (lock != first &&
+		    (lock->l_export != exp || !ldlm_revoke_ast_batchable(lock)))
+			continue;
+		list_del_init(&lock->l_rk_ast);
+		locks[count++] = lock;
+		if (count == LDLM_BL_AST_BATCH_MAX)
+			break;
+	}
+
+	RETURN(ldlm_server_blocking_ast_batch(locks, count, arg));
+}
+#endif /* HAVE_SERVER_SUPPORT */
+
 /**
  * Process a call to revocation AST callback for a lock in ast_work list
  */
@@ -1993,6 +2061,14 @@ ldlm_work_revoke_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 		RETURN(-ENOENT);
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_rk_ast);
+#ifdef HAVE_SERVER_SUPPORT
+	/* revoke all the locks of a client with one RPC if it can take it */
+	if (ldlm_revoke_ast_batchable(lock)) {
+		rc = ldlm_work_revoke_ast_batch(arg, lock);
+		if (rc <= 0)
+			RETURN(rc);
+	}
+#endif
 	list_del_init(&lock->l_rk_ast);
 
 	/* the desc just pretend to exclusive */
@@ -64,6 +64,12 @@ struct ldlm_cb_async_args {
         struct ldlm_lock       *ca_lock;
 };
 
+struct ldlm_cb_batch_args {
+	struct ldlm_cb_set_arg	 *cba_set_arg;
+	struct ldlm_lock	**cba_locks;
+	int			  cba_count;
+};
+
 /* LDLM state */
 
 static struct ldlm_state *ldlm_state;
@@ -936,6 +942,195 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
         RETURN(rc);
 }
 
+static int ldlm_cb_batch_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req, void *data,
+				   int rc)
+{
+	struct ldlm_cb_batch_args	*cba = data;
+	struct ldlm_lock		*lock;
+	__u8				*stale = NULL;
+	int				 lrc;
+	int				 i;
+	ENTRY;
+
+	/* a batch left with one lock is handled as a single blocking AST
+	 * by the client, see ldlm_callback_handler() */
+	if (rc == 0 && cba->cba_count > 1) {
+		stale = req_capsule_server_sized_get(&req->rq_pill,
+						     &RMF_DLM_BL_STALE,
+						     (cba->cba_count + 7) / 8);
+		if (stale == NULL) {
+			CERROR("%s: no stale lock bitmap in batched "
+			       "blocking AST reply\n",
+			       req->rq_import->imp_obd->obd_name);
+			rc = -EPROTO;
+		}
+	}
+
+	for (i = 0; i < cba->cba_count; i++) {
+		lock = cba->cba_locks[i];
+		/* a lock the client does not know any more is handled as
+		 * the -EINVAL reply to a single blocking AST */
+		lrc = rc;
+		if (stale != NULL && stale[i / 8] & (1 << (i % 8)))
+			lrc = -EINVAL;
+		if (lrc != 0 &&
+		    ldlm_handle_ast_error(lock, req, lrc, "blocking") ==
+		    -ERESTART)
+			atomic_inc(&cba->cba_set_arg->restart);
+		LDLM_LOCK_RELEASE(lock);
+	}
+	OBD_FREE(cba->cba_locks, LDLM_BL_AST_BATCH_MAX *
+				 sizeof(*cba->cba_locks));
+
+	RETURN(0);
+}
+
+static void ldlm_update_resend_batch(struct ptlrpc_request *req, void *data)
+{
+	struct ldlm_cb_batch_args	*cba = data;
+	int				 i;
+
+	for (i = 0; i < cba->cba_count; i++)
+		ldlm_refresh_waiting_lock(cba->cba_locks[i],
+					  ldlm_bl_timeout(cba->cba_locks[i]));
+}
+
+/**
+ * Revoke several locks granted to one client with a single blocking AST
+ * RPC, for a client export with OBD_CONNECT2_BL_AST_BATCH.
+ *
+ * Each lock is prepared as ldlm_server_blocking_ast() does it, the RPC
+ * carries the handles of all of them and the descriptor of the first one
+ * only: the client revokes the locks whatever the conflict, it cancels
+ * the unused ones together and the others as they become unused.
+ * The client replies with a bitmap of the locks it does not know any more,
+ * these are cancelled as on the -EINVAL reply to a single blocking AST.
+ *
+ * \param[in] locks	array of LDLM_BL_AST_BATCH_MAX locks, the array
+ *			and the lock references are consumed
+ * \param[in] count	number of locks in \a locks
+ * \param[in] arg	ast work set the RPC is added to
+ *
+ * \retval 0		success
+ * \retval negative	error
+ */
+int ldlm_server_blocking_ast_batch(struct ldlm_lock **locks, int count,
+				   struct ldlm_cb_set_arg *arg)
+{
+	struct obd_export		*exp = locks[0]->l_export;
+	struct ldlm_cb_batch_args	*cba;
+	struct ldlm_request		*body;
+	struct ptlrpc_request		*req;
+	struct ldlm_lock		*lock;
+	int				 timeout = 0;
+	int				 nr = 0;
+	int				 i;
+	int				 rc;
+	ENTRY;
+
+	req = ptlrpc_request_alloc(exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (req == NULL)
+		GOTO(out_put, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(count, LDLM_BL_CALLBACK));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc != 0) {
+		ptlrpc_request_free(req);
+		GOTO(out_put, rc);
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	for (i = 0; i < count; i++) {
+		lock = locks[i];
+		if (exp->exp_obd->obd_recovering != 0)
+			LDLM_ERROR(lock, "BUG 6063: lock collide during "
+				   "recovery");
+
+		ldlm_lock_reorder_req(lock);
+
+		lock_res_and_lock(lock);
+		if (ldlm_is_destroyed(lock)) {
+			unlock_res_and_lock(lock);
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+
+		if (lock->l_granted_mode != lock->l_req_mode) {
+			/* this blocking AST will be communicated as part
+			 * of the completion AST instead */
+			ldlm_add_blocked_lock(lock);
+			ldlm_set_waited(lock);
+			unlock_res_and_lock(lock);
+			LDLM_DEBUG(lock, "lock not granted, not sending "
+				   "blocking AST");
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+
+		if (nr == 0) {
+			/* the desc just pretend to exclusive */
+			ldlm_lock2desc(lock, &body->lock_desc);
+			body->lock_desc.l_req_mode = LCK_EX;
+			body->lock_desc.l_granted_mode = 0;
+		}
+		body->lock_handle[nr] = lock->l_remote_handle;
+
+		LDLM_DEBUG(lock, "server preparing batched blocking AST");
+		ldlm_set_cbpending(lock);
+		ldlm_add_waiting_lock(lock);
+		unlock_res_and_lock(lock);
+
+		timeout = max(timeout, ldlm_bl_timeout(lock));
+		lock->l_last_activity = cfs_time_current_sec();
+		if (exp->exp_nid_stats && exp->exp_nid_stats->nid_ldlm_stats)
+			lprocfs_counter_incr(exp->exp_nid_stats->nid_ldlm_stats,
+					     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+		locks[nr++] = lock;
+	}
+
+	if (nr == 0) {
+		ptlrpc_req_finished(req);
+		GOTO(out_free, rc = 0);
+	}
+	body->lock_count = nr;
+
+	if (nr > 1)
+		req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_STALE,
+				     RCL_SERVER, (nr + 7) / 8);
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*cba) <= sizeof(req->rq_async_args));
+	cba = ptlrpc_req_async_args(req);
+	cba->cba_set_arg = arg;
+	cba->cba_locks = locks;
+	cba->cba_count = nr;
+
+	req->rq_interpret_reply = ldlm_cb_batch_interpret;
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = timeout;
+	req->rq_resend_cb = ldlm_update_resend_batch;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_pack already set timeout */
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: %d locks revoked by one blocking AST to %s\n",
+	       exp->exp_obd->obd_name, nr, obd_export_nid2str(exp));
+	ldlm_lock_to_ns(locks[0])->ns_bl_ast_batches++;
+
+	ptlrpc_set_add_req(arg->set, req);
+	RETURN(0);
+out_put:
+	for (i = 0; i < count; i++)
+		LDLM_LOCK_RELEASE(locks[i]);
+out_free:
+	OBD_FREE(locks, LDLM_BL_AST_BATCH_MAX * sizeof(*locks));
+	RETURN(rc);
+}
+
 /**
  * ->l_completion_ast callback for a remote lock in server namespace.
  *
@@ -1304,6 +1499,12 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
 				  "client retry later.\n");
 			GOTO(out, rc = -EINPROGRESS);
 		}
+		if (ldlm_reclaim_export(req->rq_export)) {
+			DEBUG_REQ(D_DLMTRACE, req, "Client holds too many "
+				  "locks, reject current enqueue request and "
+				  "let the client retry later.\n");
+			GOTO(out, rc = -EINPROGRESS);
+		}
 	}
 
 	/* The lock's callback data might be set in the policy function */
@@ -1597,6 +1798,28 @@ int ldlm_handle_convert0(struct ptlrpc_request *req,
 
                 LDLM_DEBUG(lock, "server-side convert handler START");
 
+		/* A client downgrading a granted PW extent lock to PR, see
+		 * ldlm_cli_extent_downgrade().  Only clients which negotiated
+		 * OBD_CONNECT2_LOCK_CONVERT send it. */
+		if (exp_connect_lock_convert(req->rq_export) &&
+		    lock->l_resource->lr_type == LDLM_EXTENT &&
+		    lock->l_granted_mode == LCK_PW &&
+		    dlm_req->lock_desc.l_req_mode == LCK_PR) {
+			union ldlm_policy_data policy;
+
+			ldlm_convert_policy_to_local(req->rq_export,
+					LDLM_EXTENT,
+					&dlm_req->lock_desc.l_policy_data,
+					&policy);
+			rc = ldlm_extent_downgrade(lock,
+					dlm_req->lock_desc.l_req_mode,
+					&policy.l_extent);
+			if (rc == 0 && ldlm_del_waiting_lock(lock))
+				LDLM_DEBUG(lock, "downgraded waiting lock");
+			req->rq_status = rc;
+			goto out;
+		}
+
                 res = ldlm_lock_convert(lock, dlm_req->lock_desc.l_req_mode,
                                         &dlm_rep->lock_flags);
                 if (res) {
@@ -1608,6 +1831,7 @@ int ldlm_handle_convert0(struct ptlrpc_request *req,
                 }
         }
 
+out:
         if (lock) {
                 if (!req->rq_status)
                         ldlm_reprocess_all(lock->l_resource);
@@ -2149,6 +2373,136 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
                 CWARN("Send reply failed, maybe cause bug 21636.\n");
 }
 
+/**
+ * Handle a blocking AST revoking several locks at once, see
+ * ldlm_server_blocking_ast_batch().
+ *
+ * The unused locks are marked for cancel and queued all together to a
+ * blocking thread, which cancels them with as few RPCs as possible. Locks
+ * still in use or being cancelled already are handed to a blocking thread
+ * one by one as for a single blocking AST: l_bl_ast of a canceling lock
+ * belongs to the thread which marked it, see ldlm_prepare_lru_list(). The
+ * locks already gone are flagged in the stale bitmap of the reply, the
+ * server cancels them as if each got -EINVAL to a single blocking AST.
+ */
+static void ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					  struct ldlm_namespace *ns,
+					  struct ldlm_request *dlm_req)
+{
+	struct list_head	 cancels = LIST_HEAD_INIT(cancels);
+	struct lustre_handle	*lockh;
+	struct ldlm_lock_desc	 desc;
+	struct ldlm_lock	*lock;
+	__u8			*stale;
+	int			 max;
+	int			 count = 0;
+	int			 rc;
+	int			 i;
+	ENTRY;
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+
+	max = req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT) -
+	      sizeof(struct ldlm_request);
+	max /= sizeof(struct lustre_handle);
+	max += LDLM_LOCKREQ_HANDLES;
+	if (dlm_req->lock_count > max) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with invalid lock count",
+				     rc, &dlm_req->lock_handle[0]);
+		RETURN_EXIT;
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_STALE, RCL_SERVER,
+			     (dlm_req->lock_count + 7) / 8);
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc != 0) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Cannot pack batched reply", rc,
+				     &dlm_req->lock_handle[0]);
+		RETURN_EXIT;
+	}
+	stale = req_capsule_server_get(&req->rq_pill, &RMF_DLM_BL_STALE);
+	memset(stale, 0, (dlm_req->lock_count + 7) / 8);
+
+	/* the client cancels a lock of the batch just before the AST */
+	if (OBD_FAIL_CHECK(OBD_FAIL_LDLM_BL_BATCH_RACE)) {
+		lock = ldlm_handle2lock(&dlm_req->lock_handle[0]);
+		if (lock != NULL) {
+			if (lock->l_readers == 0 && lock->l_writers == 0)
+				ldlm_cli_cancel(&dlm_req->lock_handle[0],
+						LCF_ASYNC);
+			LDLM_LOCK_PUT(lock);
+		}
+	}
+
+	CDEBUG(D_INODE, "blocking ast for %u locks\n", dlm_req->lock_count);
+	for (i = 0; i < dlm_req->lock_count; i++) {
+		lockh = &dlm_req->lock_handle[i];
+		lock = ldlm_handle2lock_long(lockh, 0);
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE, "callback on lock "LPX64" - lock "
+			       "disappeared\n", lockh->cookie);
+			stale[i / 8] |= 1 << (i % 8);
+			continue;
+		}
+
+		lock_res_and_lock(lock);
+		lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+						      LDLM_FL_AST_MASK);
+		if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+		    ldlm_is_failed(lock)) {
+			LDLM_DEBUG(lock, "callback on lock "LPX64" - lock "
+				   "disappeared", lockh->cookie);
+			unlock_res_and_lock(lock);
+			LDLM_LOCK_RELEASE(lock);
+			stale[i / 8] |= 1 << (i % 8);
+			continue;
+		}
+
+		/* BL_AST locks are not needed in LRU.
+		 * Let ldlm_cancel_lru() be fast. */
+		ldlm_lock_remove_from_lru(lock);
+		ldlm_set_bl_ast(lock);
+
+		if (lock->l_readers == 0 && lock->l_writers == 0 &&
+		    !ldlm_is_canceling(lock)) {
+			/* cancel it as ldlm_prepare_lru_list() does, the
+			 * reference goes with the lock to the cancel list */
+			LASSERT(list_empty(&lock->l_bl_ast));
+			ldlm_clear_cancel_on_block(lock);
+			lock->l_flags |= LDLM_FL_CBPENDING | LDLM_FL_CANCELING;
+			list_add(&lock->l_bl_ast, &cancels);
+			unlock_res_and_lock(lock);
+			count++;
+			continue;
+		}
+		unlock_res_and_lock(lock);
+
+		/* a canceling lock may sit on the cancel list of another
+		 * thread, so leave l_bl_ast alone; the desc of a revoke just
+		 * pretends to be exclusive */
+		ldlm_lock2desc(lock, &desc);
+		desc.l_req_mode = LCK_EX;
+		desc.l_granted_mode = 0;
+		if (ldlm_bl_to_thread_lock(ns, &desc, lock))
+			ldlm_handle_bl_callback(ns, &desc, lock);
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Batched process", rc,
+				     &dlm_req->lock_handle[0]);
+
+	if (count > 0 &&
+	    ldlm_bl_to_thread_list(ns, NULL, &cancels, count, LCF_ASYNC)) {
+		count = ldlm_cli_cancel_list_local(&cancels, count,
+						   LCF_BL_AST);
+		ldlm_cli_cancel_list(&cancels, count, NULL, 0);
+	}
+	EXIT;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2257,6 +2611,12 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
                         CERROR("ldlm_cli_cancel: %d\n", rc);
         }
 
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 1) {
+		ldlm_handle_bl_callback_batch(req, ns, dlm_req);
+		RETURN(0);
+	}
+
         lock = ldlm_handle2lock_long(&dlm_req->lock_handle[0], 0);
         if (!lock) {
                 CDEBUG(D_DLMTRACE, "callback on lock "LPX64" - lock "
@@ -48,6 +48,14 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * ldlm_export_lock_limit: When a single export holds more locks than this,
+ * server revokes its coldest locks on its next enqueue, and rejects the
+ * enqueue with -EINPROGRESS while it holds more than 1/4 above the limit.
+ * The limit is halved while the low watermark is exceeded, and the lock
+ * reclaim of the low watermark goes after the heaviest lock holder of each
+ * namespace first. It is 1/4 of ldlm_lock_limit by default and tunable
+ * via proc entry, 0 disables it.
  */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -61,8 +69,12 @@ __u64 ldlm_lock_limit;
 __u64 ldlm_reclaim_threshold_mb;
 __u64 ldlm_lock_limit_mb;
 
+/* Lock count a single export may hold */
+unsigned int ldlm_export_lock_limit;
+
 struct percpu_counter		ldlm_granted_total;
 static atomic_t			ldlm_nr_reclaimer;
+static atomic_t			ldlm_nr_exp_reclaimer;
 static cfs_duration_t		ldlm_last_reclaim_age;
 static cfs_time_t		ldlm_last_reclaim_time;
 
@@ -77,6 +89,20 @@ struct ldlm_reclaim_cb_data {
 	struct cfs_hash_bd	*rcd_prev_bd;
 };
 
+/* Number of lock ages ldlm_reclaim_export_locks() tells apart */
+#define LDLM_RECLAIM_AGE_CLASSES	8
+
+struct ldlm_export_reclaim_data {
+	/* erd_total slots for each age class */
+	struct ldlm_lock	**erd_locks;
+	int			  erd_nr[LDLM_RECLAIM_AGE_CLASSES];
+	cfs_duration_t		  erd_age[LDLM_RECLAIM_AGE_CLASSES];
+	int			  erd_classes;
+	/* classes older than this still hold less than erd_total locks */
+	int			  erd_needed;
+	int			  erd_total;
+};
+
 static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
@@ -238,6 +264,205 @@ static inline cfs_duration_t ldlm_reclaim_age(void)
 	return age;
 }
 
+static inline __u64 ldlm_export_lock_count(struct obd_export *exp)
+{
+	return exp->exp_lock_hash != NULL ?
+	       cfs_hash_size_get(exp->exp_lock_hash) : 0;
+}
+
+/**
+ * Callback function for picking revoke candidates from the locks of an
+ * export. It's called with the bucket lock of exp_lock_hash held, which
+ * nests inside the resource lock, so the candidates are only referenced
+ * here and checked again under the resource lock by the caller.
+ *
+ * Each candidate goes to the oldest age class it belongs to. Younger
+ * classes are not filled any more once the older ones hold enough locks,
+ * and the scan stops once the oldest class does.
+ *
+ * \param [in] hs	exp_lock_hash
+ * \param [in] bd	current bucket of exp_lock_hash
+ * \param [in] hnode	hnode of the lock
+ * \param [in] arg	opaque data
+ *
+ * \retval 0		continue the scan
+ * \retval 1		stop the iteration
+ */
+static int ldlm_reclaim_export_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				  struct hlist_node *hnode, void *arg)
+{
+	struct ldlm_export_reclaim_data	*data = arg;
+	struct ldlm_lock		*lock = cfs_hash_object(hs, hnode);
+	cfs_time_t			 now = cfs_time_current();
+	int				 i;
+	int				 nr;
+
+	if (!ldlm_lock_reclaimable(lock) || ldlm_is_ast_sent(lock) ||
+	    lock->l_granted_mode != lock->l_req_mode)
+		return 0;
+
+	for (i = 0; i < data->erd_needed; i++) {
+		if (!cfs_time_before(now, cfs_time_add(lock->l_last_used,
+						       data->erd_age[i])))
+			break;
+	}
+	if (i == data->erd_needed || data->erd_nr[i] == data->erd_total)
+		return 0;
+
+	data->erd_locks[i * data->erd_total + data->erd_nr[i]++] =
+		LDLM_LOCK_GET(lock);
+
+	for (i = 0, nr = 0; i < data->erd_needed; i++) {
+		nr += data->erd_nr[i];
+		if (nr >= data->erd_total) {
+			data->erd_needed = i + 1;
+			break;
+		}
+	}
+
+	return data->erd_nr[0] == data->erd_total;
+}
+
+/**
+ * Revoke the coldest granted locks of an export. Locks older than \a age
+ * are revoked first, then locks older than half of it and so on down to
+ * \a min_age. This is called from the enqueue path, so the candidates of
+ * all ages are collected by a single scan of exp_lock_hash.
+ *
+ * \param[in] exp	export to revoke locks from
+ * \param[in] count	count of locks to be revoked
+ * \param[in] age	age of the locks revoked by the first scan
+ * \param[in] min_age	only revoke locks older than the 'min_age'
+ *
+ * \retval		count of locks revoked
+ */
+static int ldlm_reclaim_export_locks(struct obd_export *exp, int count,
+				     cfs_duration_t age, cfs_duration_t min_age)
+{
+	struct ldlm_namespace		*ns = exp->exp_obd->obd_namespace;
+	struct ldlm_export_reclaim_data	 data;
+	struct list_head		 rpc_list;
+	struct ldlm_lock		*lock;
+	int				 added = 0;
+	int				 n;
+	int				 i;
+	int				 j;
+	ENTRY;
+
+	if (ns == NULL || exp->exp_lock_hash == NULL || count <= 0)
+		RETURN(0);
+
+	for (n = 0; n < LDLM_RECLAIM_AGE_CLASSES - 1 && age > min_age; n++) {
+		data.erd_age[n] = age;
+		age >>= 1;
+		if (age < LDLM_RECLAIM_AGE_MIN || age < min_age)
+			age = min_age;
+	}
+	data.erd_age[n++] = min_age;
+	data.erd_classes = n;
+	data.erd_needed = n;
+	data.erd_total = count;
+	memset(data.erd_nr, 0, sizeof(data.erd_nr));
+
+	OBD_ALLOC_LARGE(data.erd_locks, n * count * sizeof(*data.erd_locks));
+	if (data.erd_locks == NULL)
+		RETURN(0);
+
+	cfs_hash_for_each(exp->exp_lock_hash, ldlm_reclaim_export_cb, &data);
+
+	INIT_LIST_HEAD(&rpc_list);
+	for (i = 0; i < data.erd_classes; i++) {
+		for (j = 0; j < data.erd_nr[i]; j++) {
+			lock = data.erd_locks[i * count + j];
+
+			if (added < count) {
+				lock_res_and_lock(lock);
+				if (lock->l_granted_mode == lock->l_req_mode &&
+				    !ldlm_is_destroyed(lock) &&
+				    !ldlm_is_ast_sent(lock)) {
+					ldlm_set_ast_sent(lock);
+					LASSERT(list_empty(&lock->l_rk_ast));
+					/* the reference is passed to
+					 * rpc_list */
+					list_add(&lock->l_rk_ast, &rpc_list);
+					added++;
+					unlock_res_and_lock(lock);
+					continue;
+				}
+				unlock_res_and_lock(lock);
+			}
+			LDLM_LOCK_RELEASE(lock);
+		}
+	}
+	OBD_FREE_LARGE(data.erd_locks, n * count * sizeof(*data.erd_locks));
+
+	CDEBUG(D_DLMTRACE, "%s: %d/%d locks of %s to be reclaimed.\n",
+	       ldlm_ns_name(ns), added, count,
+	       obd_uuid2str(&exp->exp_client_uuid));
+
+	ldlm_run_ast_work(ns, &rpc_list, LDLM_WORK_REVOKE_AST);
+	RETURN(added);
+}
+
+/**
+ * Revoke up to half of \a count locks from the heaviest lock holder of a
+ * namespace, if it holds more than twice the average of its exports. The
+ * exports of other MDTs are left out. The rest is left to the roundrobin
+ * reclaim over the resources.
+ *
+ * \param[in] ns	namespace to do the lock revoke on
+ * \param[in] count	count of lock to be revoked
+ * \param[in] age	only revoke locks older than the 'age'
+ * \param[out] count	count of lock still to be revoked
+ */
+static void ldlm_reclaim_heavy(struct ldlm_namespace *ns, int *count,
+			       cfs_duration_t age)
+{
+	struct obd_device	*obd = ns->ns_obd;
+	struct obd_export	*exp;
+	struct obd_export	*heavy = NULL;
+	__u64			 total = 0;
+	__u64			 max = 0;
+	__u64			 nr;
+	int			 nr_exp = 0;
+	ENTRY;
+
+	if (obd == NULL || *count < 2) {
+		EXIT;
+		return;
+	}
+
+	spin_lock(&obd->obd_dev_lock);
+	list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+		/* cross-MDT locks are not revoked, as in
+		 * ldlm_reclaim_export() */
+		if (exp_connect_flags(exp) & OBD_CONNECT_MDS_MDS)
+			continue;
+
+		nr = ldlm_export_lock_count(exp);
+		total += nr;
+		nr_exp++;
+		if (nr > max) {
+			max = nr;
+			heavy = exp;
+		}
+	}
+	if (heavy != NULL)
+		class_export_get(heavy);
+	spin_unlock(&obd->obd_dev_lock);
+
+	if (heavy == NULL) {
+		EXIT;
+		return;
+	}
+
+	if (max * nr_exp > total * 2)
+		*count -= ldlm_reclaim_export_locks(heavy, *count / 2, age,
+						    age);
+	class_export_put(heavy);
+	EXIT;
+}
+
 /**
  * Revoke certain amount of locks from all the server namespaces
  * in a roundrobin manner. Lock age is used to avoid reclaim on
@@ -274,7 +499,9 @@ again:
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age, skip);
+		ldlm_reclaim_heavy(ns, &count, age);
+		if (count > 0)
+			ldlm_reclaim_res(ns, &count, age, skip);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
@@ -340,6 +567,46 @@ bool ldlm_reclaim_full(void)
 	return false;
 }
 
+/**
+ * Check on the locks held by an export: revoke the coldest of them if
+ * it holds more than ldlm_export_lock_limit, return true if it still
+ * holds 1/4 more than the limit, so that the enqueue is rejected.
+ *
+ * \retval true		export lock limit exceeded.
+ * \retval false	export lock limit not exceeded.
+ */
+bool ldlm_reclaim_export(struct obd_export *exp)
+{
+	__u64 limit = ldlm_export_lock_limit;
+	__u64 low = ldlm_reclaim_threshold;
+	__u64 nr;
+	int count;
+
+	if (limit == 0 || exp == NULL ||
+	    (exp_connect_flags(exp) & OBD_CONNECT_MDS_MDS))
+		return false;
+
+	/* tighten the limit under lock memory pressure */
+	if (low != 0 &&
+	    percpu_counter_sum_positive(&ldlm_granted_total) > low)
+		limit >>= 1;
+
+	nr = ldlm_export_lock_count(exp);
+	if (nr <= limit)
+		return false;
+
+	if (atomic_add_unless(&ldlm_nr_exp_reclaimer, 1, 1)) {
+		/* revoke down to 7/8 of the limit to not do it on
+		 * every enqueue */
+		count = min_t(__u64, nr - limit + (limit >> 3),
+			      LDLM_RECLAIM_BATCH);
+		ldlm_reclaim_export_locks(exp, count, ldlm_reclaim_age(), 0);
+		atomic_add_unless(&ldlm_nr_exp_reclaimer, -1, 0);
+	}
+
+	return ldlm_export_lock_count(exp) > limit + (limit >> 2);
+}
+
 static inline __u64 ldlm_ratio2locknr(int ratio)
 {
 	__u64 locknr;
@@ -357,15 +624,22 @@ static inline __u64 ldlm_locknr2mb(__u64 locknr)
 
 #define LDLM_WM_RATIO_LOW_DEFAULT	20
 #define LDLM_WM_RATIO_HIGH_DEFAULT	30
+#define LDLM_EXPORT_LIMIT_RATIO		4
 
 int ldlm_reclaim_setup(void)
 {
+	__u64 limit;
+
 	atomic_set(&ldlm_nr_reclaimer, 0);
+	atomic_set(&ldlm_nr_exp_reclaimer, 0);
 
 	ldlm_reclaim_threshold = ldlm_ratio2locknr(LDLM_WM_RATIO_LOW_DEFAULT);
 	ldlm_reclaim_threshold_mb = ldlm_locknr2mb(ldlm_reclaim_threshold);
 	ldlm_lock_limit = ldlm_ratio2locknr(LDLM_WM_RATIO_HIGH_DEFAULT);
 	ldlm_lock_limit_mb = ldlm_locknr2mb(ldlm_lock_limit);
+	limit = ldlm_lock_limit;
+	do_div(limit, LDLM_EXPORT_LIMIT_RATIO);
+	ldlm_export_lock_limit = min_t(__u64, limit, UINT_MAX);
 
 	ldlm_last_reclaim_age = LDLM_RECLAIM_AGE_MAX;
 	ldlm_last_reclaim_time = cfs_time_current();
@@ -389,6 +663,11 @@ bool ldlm_reclaim_full(void)
 	return false;
 }
 
+bool ldlm_reclaim_export(struct obd_export *exp)
+{
+	return false;
+}
+
 void ldlm_reclaim_add(struct ldlm_lock *lock)
 {
 }
@@ -1095,6 +1095,67 @@ int ldlm_cli_convert(struct lustre_handle *lockh, int new_mode, __u32 *flags)
         return rc;
 }
 
+/**
+ * Downgrade a granted PW extent lock to PR instead of cancelling it.
+ *
+ * Asks the server to turn \a lockh into a \a new_mode (LCK_PR) lock on
+ * \a new_ext and applies the same change to the local lock once the server
+ * agreed, see ldlm_extent_downgrade().  The caller must already have
+ * written back whatever the lock gives up.  On failure the lock is
+ * unchanged and the caller is expected to cancel it as usual.
+ *
+ * Only to be used when the server advertises OBD_CONNECT2_LOCK_CONVERT.
+ */
+int ldlm_cli_extent_downgrade(const struct lustre_handle *lockh,
+			      enum ldlm_mode new_mode,
+			      const struct ldlm_extent *new_ext)
+{
+	struct ldlm_request	*body;
+	struct ldlm_lock	*lock;
+	struct ptlrpc_request	*req;
+	union ldlm_policy_data	 policy;
+	int			 rc;
+	ENTRY;
+
+	lock = ldlm_handle2lock(lockh);
+	if (lock == NULL)
+		RETURN(-EINVAL);
+
+	if (lock->l_conn_export == NULL)
+		GOTO(out_lock, rc = -EINVAL);
+
+	LDLM_DEBUG(lock, "client-side downgrade to %s ["LPU64"->"LPU64"]",
+		   ldlm_lockname[new_mode], new_ext->start, new_ext->end);
+
+	req = ptlrpc_request_alloc_pack(class_exp2cliimp(lock->l_conn_export),
+					&RQF_LDLM_CONVERT, LUSTRE_DLM_VERSION,
+					LDLM_CONVERT);
+	if (req == NULL)
+		GOTO(out_lock, rc = -ENOMEM);
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_handle[0] = lock->l_remote_handle;
+	body->lock_desc.l_req_mode = new_mode;
+	policy.l_extent = *new_ext;
+	ldlm_convert_policy_to_wire(LDLM_EXTENT, &policy,
+				    &body->lock_desc.l_policy_data);
+
+	ptlrpc_request_set_replen(req);
+	/* the blocking AST falls back to cancel, no point in retrying */
+	req->rq_no_resend = req->rq_no_delay = 1;
+	rc = ptlrpc_queue_wait(req);
+	ptlrpc_req_finished(req);
+	if (rc == 0)
+		rc = ldlm_extent_downgrade(lock, new_mode, new_ext);
+
+	LDLM_DEBUG(lock, "client-side downgrade END: rc = %d", rc);
+	EXIT;
+out_lock:
+	LDLM_LOCK_PUT(lock);
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_cli_extent_downgrade);
+
 /**
  * Cancel locks locally.
  * Returns:
@@ -1582,6 +1643,60 @@ static enum ldlm_policy_res ldlm_cancel_aged_policy(struct ldlm_namespace *ns,
 	return LDLM_POLICY_CANCEL_LOCK;
 }
 
+/**
+ * Callback function for memory pressure policy. Makes decision whether to
+ * keep \a lock in LRU for current LRU size \a unused, added in current scan
+ * \a added and number of locks to be preferably canceled \a count.
+ *
+ * Like the passed policy it cancels old locks first, but it weighs each one
+ * with ns_cancel: a lock may keep ns_lru_cost_pages cached pages for each
+ * second it has been unused, locks caching more than that are skipped, and
+ * so are locks whose pages are under IO. Locks unused for longer than
+ * ns_max_age are canceled regardless.
+ *
+ * ns_cancel walks the pages cached under the lock, ldlm_prepare_lru_list_cpt()
+ * bounds how many locks are skipped and thus weighed in one scan.
+ *
+ * \retval LDLM_POLICY_KEEP_LOCK keep lock in LRU in stop scanning
+ *
+ * \retval LDLM_POLICY_SKIP_LOCK keep lock in LRU and go on scanning
+ *
+ * \retval LDLM_POLICY_CANCEL_LOCK cancel lock from LRU
+ */
+static enum ldlm_policy_res ldlm_cancel_cost_policy(struct ldlm_namespace *ns,
+						    struct ldlm_lock *lock,
+						    int unused, int added,
+						    int count)
+{
+	cfs_duration_t idle;
+	int weight;
+
+	if (added >= count)
+		return LDLM_POLICY_KEEP_LOCK;
+
+	if (cfs_time_after(cfs_time_current(),
+			   cfs_time_add(lock->l_last_used, ns->ns_max_age)))
+		return LDLM_POLICY_CANCEL_LOCK;
+
+	/* It's fine to not take lock to access lock->l_resource since
+	 * the lock has already been granted so it won't change. */
+	if (ns->ns_cancel == NULL ||
+	    (lock->l_resource->lr_type != LDLM_EXTENT &&
+	     lock->l_resource->lr_type != LDLM_IBITS))
+		return LDLM_POLICY_CANCEL_LOCK;
+
+	weight = ns->ns_cancel(lock);
+	if (weight == 0)
+		return LDLM_POLICY_SKIP_LOCK;
+
+	idle = cfs_time_sub(cfs_time_current(), lock->l_last_used);
+	if ((__u64)(weight - 1) >
+	    (__u64)cfs_duration_sec(idle) * ns->ns_lru_cost_pages)
+		return LDLM_POLICY_SKIP_LOCK;
+
+	return LDLM_POLICY_CANCEL_LOCK;
+}
+
 /**
  * Callback function for default policy. Makes decision whether to keep \a lock
  * in LRU for current LRU size \a unused, added in current scan \a added and
@@ -1615,8 +1730,8 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 
 	if (ns_connect_lru_resize(ns)) {
 		if (lru_flags & LDLM_LRU_FLAG_SHRINK)
-			/* We kill passed number of old locks. */
-			return ldlm_cancel_passed_policy;
+			/* We kill passed number of old, cheap locks. */
+			return ldlm_cancel_cost_policy;
 		if (lru_flags & LDLM_LRU_FLAG_LRUR)
 			return ldlm_cancel_lrur_policy;
 		if (lru_flags & LDLM_LRU_FLAG_PASSED)
@@ -1632,60 +1747,36 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 }
 
 /**
- * - Free space in LRU for \a count new locks,
- *   redundant unused locks are canceled locally;
- * - also cancel locally unused aged locks;
- * - do not cancel more than \a max locks;
- * - GET the found locks and add them into the \a cancels list.
+ * Scan the LRU of one CPT for ldlm_prepare_lru_list(): pass its locks
+ * through \a pf in LRU order and move those to be canceled to \a cancels.
  *
- * A client lock can be added to the l_bl_ast list only when it is
- * marked LDLM_FL_CANCELING. Otherwise, somebody is already doing
- * CANCEL.  There are the following use cases:
- * ldlm_cancel_resource_local(), ldlm_cancel_lru_local() and
- * ldlm_cli_cancel(), which check and set this flag properly. As any
- * attempt to cancel a lock rely on this flag, l_bl_ast list is accessed
- * later without any special locking.
+ * \a count and \a max are the share of this CPT, \a unused is the number of
+ * unused locks left in the whole namespace and is updated for the locks
+ * added here, \a scanned is increased by the number of locks examined.
  *
- * Calling policies for enabled LRU resize:
- * ----------------------------------------
- * flags & LDLM_LRU_FLAG_LRUR - use LRU resize policy (SLV from server) to
- *				cancel not more than \a count locks;
- *
- * flags & LDLM_LRU_FLAG_PASSED - cancel \a count number of old locks (located
- *				at the beginning of LRU list);
- *
- * flags & LDLM_LRU_FLAG_SHRINK - cancel not more than \a count locks according
- *				to memory pressre policy function;
- *
- * flags & LDLM_LRU_FLAG_AGED - cancel \a count locks according to "aged policy"
+ * Locks the policy skips stay where they are, so that the LRU stays in age
+ * order for the policies which stop at the first young lock; the scan goes
+ * on after the last skipped lock instead.  Unless \a no_wait is set, it
+ * also stops after skipping \a count locks, which bounds the ns_cancel calls
+ * the memory pressure policy makes for one shrinker call.
  *
- * flags & LDLM_LRU_FLAG_NO_WAIT - cancel as many unused locks as possible
- *				(typically before replaying locks) w/o
- *				sending any RPCs or waiting for any
- *				outstanding RPC to complete.
+ * \retval number of locks added to \a cancels
  */
-static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
-				 struct list_head *cancels, int count, int max,
-				 enum ldlm_lru_flags lru_flags)
+static int ldlm_prepare_lru_list_cpt(struct ldlm_namespace *ns,
+				     struct ldlm_lru *lru,
+				     struct list_head *cancels, int count,
+				     int max, int *unused, int *scanned,
+				     ldlm_cancel_lru_policy_t pf, int no_wait)
 {
-	ldlm_cancel_lru_policy_t pf;
 	struct ldlm_lock *lock, *next;
-	int added = 0, unused, remained;
-	int no_wait = lru_flags & (LDLM_LRU_FLAG_NO_WAIT |
-				   LDLM_LRU_FLAG_LRUR_NO_WAIT);
+	struct ldlm_lock *skipped = NULL;
+	int added = 0, remained, nr_skipped = 0;
 	ENTRY;
 
-	spin_lock(&ns->ns_lock);
-	unused = ns->ns_nr_unused;
-	remained = unused;
-
-	if (!ns_connect_lru_resize(ns))
-		count += unused - ns->ns_max_unused;
-
-	pf = ldlm_cancel_lru_policy(ns, lru_flags);
-	LASSERT(pf != NULL);
+	spin_lock(&lru->ll_lock);
+	remained = lru->ll_nr;
 
-	while (!list_empty(&ns->ns_unused_list)) {
+	while (!list_empty(&lru->ll_list)) {
 		enum ldlm_policy_res result;
 		cfs_time_t last_use = 0;
 
@@ -1697,8 +1788,16 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		if (max && added >= max)
 			break;
 
-		list_for_each_entry_safe(lock, next, &ns->ns_unused_list,
-					 l_lru) {
+		/* Go on after the last skipped lock, or start over if it has
+		 * left the LRU meanwhile. */
+		if (skipped != NULL && !list_empty(&skipped->l_lru))
+			lock = skipped;
+		else
+			lock = list_entry(&lru->ll_list, struct ldlm_lock,
+					  l_lru);
+
+		list_for_each_entry_safe_continue(lock, next, &lru->ll_list,
+						  l_lru) {
 			/* No locks which got blocking requests. */
 			LASSERT(!ldlm_is_bl_ast(lock));
 
@@ -1717,12 +1816,13 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 
 			ldlm_lock_remove_from_lru_nolock(lock);
 		}
-		if (&lock->l_lru == &ns->ns_unused_list)
+		if (&lock->l_lru == &lru->ll_list)
 			break;
 
 		LDLM_LOCK_GET(lock);
-		spin_unlock(&ns->ns_lock);
+		spin_unlock(&lru->ll_lock);
 		lu_ref_add(&lock->l_reference, __FUNCTION__, current);
+		(*scanned)++;
 
 		/* Pass the lock through the policy filter and see if it
 		 * should stay in LRU.
@@ -1737,19 +1837,25 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		 * old locks, but additionally choose them by
 		 * their weight. Big extent locks will stay in
 		 * the cache. */
-		result = pf(ns, lock, unused, added, count);
+		result = pf(ns, lock, *unused, added, count);
 		if (result == LDLM_POLICY_KEEP_LOCK) {
 			lu_ref_del(&lock->l_reference,
 				   __FUNCTION__, current);
 			LDLM_LOCK_RELEASE(lock);
-			spin_lock(&ns->ns_lock);
+			spin_lock(&lru->ll_lock);
 			break;
 		}
 		if (result == LDLM_POLICY_SKIP_LOCK) {
 			lu_ref_del(&lock->l_reference,
 				   __func__, current);
-			LDLM_LOCK_RELEASE(lock);
-			spin_lock(&ns->ns_lock);
+			/* keep the reference, the lock is where the scan
+			 * goes on */
+			if (skipped != NULL)
+				LDLM_LOCK_RELEASE(skipped);
+			skipped = lock;
+			spin_lock(&lru->ll_lock);
+			if (!no_wait && ++nr_skipped >= count)
+				break;
 			continue;
 		}
 
@@ -1766,7 +1872,7 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			unlock_res_and_lock(lock);
 			lu_ref_del(&lock->l_reference, __FUNCTION__, current);
 			LDLM_LOCK_RELEASE(lock);
-			spin_lock(&ns->ns_lock);
+			spin_lock(&lru->ll_lock);
 			continue;
 		}
 		LASSERT(!lock->l_readers && !lock->l_writers);
@@ -1796,11 +1902,112 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		list_add(&lock->l_bl_ast, cancels);
 		unlock_res_and_lock(lock);
 		lu_ref_del(&lock->l_reference, __FUNCTION__, current);
-		spin_lock(&ns->ns_lock);
+		spin_lock(&lru->ll_lock);
 		added++;
-		unused--;
+		(*unused)--;
+	}
+	spin_unlock(&lru->ll_lock);
+	if (skipped != NULL)
+		LDLM_LOCK_RELEASE(skipped);
+	RETURN(added);
+}
+
+/** Share of \a total for an LRU holding \a nr of \a unused locks */
+static inline int ldlm_lru_share(int total, int nr, int unused)
+{
+	__u64 share;
+
+	if (total <= 0 || nr >= unused)
+		return total;
+
+	share = (__u64)total * nr + unused - 1;
+	do_div(share, unused);
+	return (int)share;
+}
+
+/**
+ * - Free space in LRU for \a count new locks,
+ *   redundant unused locks are canceled locally;
+ * - also cancel locally unused aged locks;
+ * - do not cancel more than \a max locks;
+ * - GET the found locks and add them into the \a cancels list.
+ *
+ * A client lock can be added to the l_bl_ast list only when it is
+ * marked LDLM_FL_CANCELING. Otherwise, somebody is already doing
+ * CANCEL.  There are the following use cases:
+ * ldlm_cancel_resource_local(), ldlm_cancel_lru_local() and
+ * ldlm_cli_cancel(), which check and set this flag properly. As any
+ * attempt to cancel a lock rely on this flag, l_bl_ast list is accessed
+ * later without any special locking.
+ *
+ * The LRU is kept per CPT, each CPT gives up its share of \a count and
+ * \a max in proportion to the number of unused locks it holds, so that
+ * the scan never holds more than one CPT's LRU lock.
+ *
+ * Calling policies for enabled LRU resize:
+ * ----------------------------------------
+ * flags & LDLM_LRU_FLAG_LRUR - use LRU resize policy (SLV from server) to
+ *				cancel not more than \a count locks;
+ *
+ * flags & LDLM_LRU_FLAG_PASSED - cancel \a count number of old locks (located
+ *				at the beginning of LRU list);
+ *
+ * flags & LDLM_LRU_FLAG_SHRINK - cancel not more than \a count locks according
+ *				to memory pressre policy function, which
+ *				prefers locks caching few pages for their
+ *				age;
+ *
+ * flags & LDLM_LRU_FLAG_AGED - cancel \a count locks according to "aged policy"
+ *
+ * flags & LDLM_LRU_FLAG_NO_WAIT - cancel as many unused locks as possible
+ *				(typically before replaying locks) w/o
+ *				sending any RPCs or waiting for any
+ *				outstanding RPC to complete.
+ */
+static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
+				 struct list_head *cancels, int count, int max,
+				 enum ldlm_lru_flags lru_flags)
+{
+	ldlm_cancel_lru_policy_t pf;
+	struct ldlm_lru *lru;
+	int added = 0, unused, scanned = 0;
+	int no_wait = lru_flags & (LDLM_LRU_FLAG_NO_WAIT |
+				   LDLM_LRU_FLAG_LRUR_NO_WAIT);
+	int total;
+	int i;
+	ENTRY;
+
+	unused = ldlm_ns_nr_unused(ns);
+	total = unused;
+
+	if (!ns_connect_lru_resize(ns))
+		count += unused - ns->ns_max_unused;
+
+	pf = ldlm_cancel_lru_policy(ns, lru_flags);
+	LASSERT(pf != NULL);
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru) {
+		int nr = lru->ll_nr;
+		int cpt_max = 0;
+
+		if (nr == 0)
+			continue;
+
+		/* For any flags, stop scanning if @max is reached. */
+		if (max) {
+			if (added >= max)
+				break;
+			cpt_max = min(ldlm_lru_share(max, nr, total),
+				      max - added);
+		}
+
+		added += ldlm_prepare_lru_list_cpt(ns, lru, cancels,
+					ldlm_lru_share(count, nr, total),
+					cpt_max, &unused, &scanned, pf,
+					no_wait);
 	}
-	spin_unlock(&ns->ns_lock);
+
+	lprocfs_oh_tally_log2(&ns->ns_lru_scan_hist, scanned);
 	RETURN(added);
 }
 
@@ -1809,13 +2016,23 @@ int ldlm_cancel_lru_local(struct ldlm_namespace *ns, struct list_head *cancels,
 			  enum ldlm_cancel_flags cancel_flags,
 			  enum ldlm_lru_flags lru_flags)
 {
+	struct timeval start;
+	struct timeval end;
 	int added;
 
+	do_gettimeofday(&start);
 	added = ldlm_prepare_lru_list(ns, cancels, count, max, lru_flags);
-	if (added <= 0)
-		return added;
+	if (added > 0) {
+		/* keep the marked locks on the list across blocking ASTs */
+		OBD_FAIL_TIMEOUT_MS(OBD_FAIL_LDLM_LRU_CANCEL_PAUSE, 100);
+		added = ldlm_cli_cancel_list_local(cancels, added,
+						   cancel_flags);
+	}
+	do_gettimeofday(&end);
+	lprocfs_oh_tally_log2(&ns->ns_lru_cancel_hist,
+			      cfs_timeval_sub(&end, &start, NULL));
 
-	return ldlm_cli_cancel_list_local(cancels, added, cancel_flags);
+	return added;
 }
 
 /**
@@ -2317,16 +2534,17 @@ static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
 static void ldlm_cancel_unused_locks_for_replay(struct ldlm_namespace *ns)
 {
 	int canceled;
+	int unused = ldlm_ns_nr_unused(ns);
 	struct list_head cancels = LIST_HEAD_INIT(cancels);
 
 	CDEBUG(D_DLMTRACE, "Dropping as many unused locks as possible before"
 			   "replay for namespace %s (%d)\n",
-			   ldlm_ns_name(ns), ns->ns_nr_unused);
+			   ldlm_ns_name(ns), unused);
 
 	/* We don't need to care whether or not LRU resize is enabled
 	 * because the LDLM_LRU_FLAG_NO_WAIT policy doesn't use the
 	 * count parameter */
-	canceled = ldlm_cancel_lru_local(ns, &cancels, ns->ns_nr_unused, 0,
+	canceled = ldlm_cancel_lru_local(ns, &cancels, unused, 0,
 					 LCF_LOCAL, LDLM_LRU_FLAG_NO_WAIT);
 
 	CDEBUG(D_DLMTRACE, "Canceled %d unused locks from namespace %s\n",
@@ -203,6 +203,9 @@ int ldlm_proc_setup(void)
 		{ .name =	"lock_granted_count",
 		  .fops =	&ldlm_granted_fops,
 		  .data =	&ldlm_granted_total },
+		{ .name =	"lock_limit_per_export",
+		  .fops =	&ldlm_rw_uint_fops,
+		  .data =	&ldlm_export_lock_limit },
 #endif
 		{ NULL }};
 	ENTRY;
@@ -291,14 +294,23 @@ static int lprocfs_ns_locks_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_ns_locks);
 
+static int lprocfs_ns_unused_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+	__u32 nr = ldlm_ns_nr_unused(ns);
+
+	return lprocfs_uint_seq_show(m, &nr);
+}
+LPROC_SEQ_FOPS_RO(lprocfs_ns_unused);
+
 static int lprocfs_lru_size_seq_show(struct seq_file *m, void *v)
 {
 	struct ldlm_namespace *ns = m->private;
-	__u32 *nr = &ns->ns_max_unused;
+	__u32 nr = ns->ns_max_unused;
 
 	if (ns_connect_lru_resize(ns))
-		nr = &ns->ns_nr_unused;
-	return lprocfs_uint_seq_show(m, nr);
+		nr = ldlm_ns_nr_unused(ns);
+	return lprocfs_uint_seq_show(m, &nr);
 }
 
 static ssize_t lprocfs_lru_size_seq_write(struct file *file,
@@ -319,9 +331,9 @@ static ssize_t lprocfs_lru_size_seq_write(struct file *file,
                        "dropping all unused locks from namespace %s\n",
                        ldlm_ns_name(ns));
                 if (ns_connect_lru_resize(ns)) {
-                        int canceled, unused  = ns->ns_nr_unused;
+			int canceled, unused = ldlm_ns_nr_unused(ns);
 
-			/* Try to cancel all @ns_nr_unused locks. */
+			/* Try to cancel all @unused locks. */
 			canceled = ldlm_cancel_lru(ns, unused, 0,
 						   LDLM_LRU_FLAG_PASSED);
 			if (canceled < unused) {
@@ -348,17 +360,18 @@ static ssize_t lprocfs_lru_size_seq_write(struct file *file,
         lru_resize = (tmp == 0);
 
 	if (ns_connect_lru_resize(ns)) {
+		unsigned int unused = ldlm_ns_nr_unused(ns);
+
 		if (!lru_resize)
 			ns->ns_max_unused = tmp;
 
-		if (tmp > ns->ns_nr_unused)
-			tmp = ns->ns_nr_unused;
-		tmp = ns->ns_nr_unused - tmp;
+		if (tmp > unused)
+			tmp = unused;
+		tmp = unused - tmp;
 
 		CDEBUG(D_DLMTRACE,
 		       "changing namespace %s unused locks from %u to %u\n",
-		       ldlm_ns_name(ns), ns->ns_nr_unused,
-		       (unsigned int)tmp);
+		       ldlm_ns_name(ns), unused, (unsigned int)tmp);
 		ldlm_cancel_lru(ns, tmp, LCF_ASYNC, LDLM_LRU_FLAG_PASSED);
 
 		if (!lru_resize) {
@@ -390,6 +403,56 @@ static ssize_t lprocfs_lru_size_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(lprocfs_lru_size);
 
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+static void lprocfs_lru_hist_show(struct seq_file *m, const char *name,
+				  struct obd_histogram *hist)
+{
+	unsigned long tot = lprocfs_oh_sum(hist);
+	unsigned long cum = 0;
+	int i;
+
+	seq_printf(m, "\n%-22s calls   %% cum %%\n", name);
+	for (i = 0; i < OBD_HIST_MAX && cum < tot; i++) {
+		unsigned long n = hist->oh_buckets[i];
+
+		cum += n;
+		seq_printf(m, "%u:\t\t%10lu %3lu %3lu\n",
+			   1U << i, n, pct(n, tot), pct(cum, tot));
+	}
+}
+
+static int lprocfs_lru_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+	struct ldlm_lru *lru;
+	struct timeval now;
+	int i;
+
+	do_gettimeofday(&now);
+	seq_printf(m, "snapshot_time:         %lu.%lu (secs.usecs)\n",
+		   now.tv_sec, now.tv_usec);
+	cfs_percpt_for_each(lru, i, ns->ns_lru)
+		seq_printf(m, "cpt %d unused locks:  %d\n", i, lru->ll_nr);
+
+	lprocfs_lru_hist_show(m, "locks scanned", &ns->ns_lru_scan_hist);
+	lprocfs_lru_hist_show(m, "cancel time (usec)",
+			      &ns->ns_lru_cancel_hist);
+	return 0;
+}
+
+static ssize_t lprocfs_lru_stats_seq_write(struct file *file,
+					   const char __user *buffer,
+					   size_t count, loff_t *off)
+{
+	struct ldlm_namespace *ns = ((struct seq_file *)file->private_data)->private;
+
+	lprocfs_oh_clear(&ns->ns_lru_scan_hist);
+	lprocfs_oh_clear(&ns->ns_lru_cancel_hist);
+	return count;
+}
+LPROC_SEQ_FOPS(lprocfs_lru_stats);
+
 static int lprocfs_elc_seq_show(struct seq_file *m, void *v)
 {
 	struct ldlm_namespace *ns = m->private;
@@ -467,11 +530,15 @@ static int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 
 	if (ns_is_client(ns)) {
 		ldlm_add_var(&lock_vars[0], ns_pde, "lock_unused_count",
-			     &ns->ns_nr_unused, &ldlm_uint_fops);
+			     ns, &lprocfs_ns_unused_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "lru_size", ns,
 			     &lprocfs_lru_size_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "lru_max_age",
 			     &ns->ns_max_age, &ldlm_rw_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lru_cost_pages",
+			     &ns->ns_lru_cost_pages, &ldlm_rw_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "lru_stats",
+			     ns, &lprocfs_lru_stats_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "early_lock_cancel",
 			     ns, &lprocfs_elc_fops);
 	} else {
@@ -479,6 +546,8 @@ static int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 			     &ns->ns_ctime_age_limit, &ldlm_rw_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "lock_timeouts",
 			     &ns->ns_timeouts, &ldlm_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "bl_ast_batches",
+			     &ns->ns_bl_ast_batches, &ldlm_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "max_nolock_bytes",
 			     &ns->ns_max_nolock_size, &ldlm_rw_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "contention_seconds",
@@ -675,6 +744,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	struct ldlm_namespace *ns = NULL;
 	struct ldlm_ns_bucket *nsb;
 	struct ldlm_ns_hash_def *nsd;
+	struct ldlm_lru *lru;
 	struct cfs_hash_bd bd;
 	int idx;
 	int rc;
@@ -727,8 +797,19 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         ns->ns_appetite = apt;
         ns->ns_client   = client;
 
+	ns->ns_lru = cfs_percpt_alloc(cfs_cpt_table, sizeof(*lru));
+	if (ns->ns_lru == NULL)
+		GOTO(out_hash, NULL);
+
+	cfs_percpt_for_each(lru, idx, ns->ns_lru) {
+		spin_lock_init(&lru->ll_lock);
+		INIT_LIST_HEAD(&lru->ll_list);
+		lru->ll_nr = 0;
+	}
+	spin_lock_init(&ns->ns_lru_scan_hist.oh_lock);
+	spin_lock_init(&ns->ns_lru_cancel_hist.oh_lock);
+
 	INIT_LIST_HEAD(&ns->ns_list_chain);
-	INIT_LIST_HEAD(&ns->ns_unused_list);
 	spin_lock_init(&ns->ns_lock);
 	atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
@@ -738,11 +819,12 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
 
         ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
-        ns->ns_nr_unused          = 0;
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
         ns->ns_max_age            = LDLM_DEFAULT_MAX_ALIVE;
+	ns->ns_lru_cost_pages	  = LDLM_DEFAULT_LRU_COST_PAGES;
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
         ns->ns_timeouts           = 0;
+	ns->ns_bl_ast_batches	  = 0;
         ns->ns_orig_connect_flags = 0;
         ns->ns_connect_flags      = 0;
         ns->ns_stopping           = 0;
@@ -750,7 +832,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         rc = ldlm_namespace_proc_register(ns);
         if (rc != 0) {
                 CERROR("Can't initialize ns proc, rc %d\n", rc);
-                GOTO(out_hash, rc);
+		GOTO(out_lru, rc);
         }
 
         idx = ldlm_namespace_nr_read(client);
@@ -765,6 +847,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 out_proc:
         ldlm_namespace_proc_unregister(ns);
         ldlm_namespace_cleanup(ns, 0);
+out_lru:
+	cfs_percpt_free(ns->ns_lru);
 out_hash:
         cfs_hash_putref(ns->ns_rs_hash);
 out_ns:
@@ -1030,6 +1114,7 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 
 	ldlm_namespace_proc_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
+	cfs_percpt_free(ns->ns_lru);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
 	 * thread. */
@@ -1541,6 +1541,13 @@ out_rmdir:
 		rc = copy_and_ioctl(cmd, sbi->ll_md_exp, (void __user *)arg,
                                     sizeof(struct ioc_changelog));
                 RETURN(rc);
+	case OBD_IOC_CHANGELOG_SEND_FILTER:
+		if (!cfs_capable(CFS_CAP_SYS_ADMIN))
+			RETURN(-EPERM);
+
+		rc = copy_and_ioctl(cmd, sbi->ll_md_exp, (void __user *)arg,
+				    sizeof(struct ioc_changelog_filter));
+		RETURN(rc);
 	case OBD_IOC_FID2PATH:
 		RETURN(ll_fid2path(inode, (void __user *)arg));
 	case LL_IOC_GETPARENT:
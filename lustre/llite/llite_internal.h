@@ -734,6 +734,9 @@ enum {
 	LPROC_LL_WRITE_BYTES,
 	LPROC_LL_BRW_READ,
 	LPROC_LL_BRW_WRITE,
+	LPROC_LL_DIO_READ,
+	LPROC_LL_DIO_WRITE,
+	LPROC_LL_DIO_INFLIGHT,
 	LPROC_LL_IOCTL,
 	LPROC_LL_OPEN,
 	LPROC_LL_RELEASE,
@@ -1049,6 +1049,12 @@ static const struct llite_file_opcode {
                                    "brw_read" },
         { LPROC_LL_BRW_WRITE,      LPROCFS_CNTR_AVGMINMAX|LPROCFS_TYPE_PAGES,
                                    "brw_write" },
+	{ LPROC_LL_DIO_READ,	   LPROCFS_CNTR_AVGMINMAX|LPROCFS_TYPE_USEC,
+				   "dio_read" },
+	{ LPROC_LL_DIO_WRITE,	   LPROCFS_CNTR_AVGMINMAX|LPROCFS_TYPE_USEC,
+				   "dio_write" },
+	{ LPROC_LL_DIO_INFLIGHT,   LPROCFS_CNTR_AVGMINMAX|LPROCFS_TYPE_REGS,
+				   "dio_inflight" },
         { LPROC_LL_IOCTL,          LPROCFS_TYPE_REGS, "ioctl" },
         { LPROC_LL_OPEN,           LPROCFS_TYPE_REGS, "open" },
         { LPROC_LL_RELEASE,        LPROCFS_TYPE_REGS, "close" },
@@ -1192,6 +1198,8 @@ int lprocfs_register_mountpoint(struct proc_dir_entry *parent,
                         ptr = "bytes";
                 else if (type & LPROCFS_TYPE_PAGES)
                         ptr = "pages";
+		else if (type & LPROCFS_TYPE_USEC)
+			ptr = "usec";
                 lprocfs_counter_init(sbi->ll_stats,
                                      llite_opcode_table[id].opcode,
                                      (type & LPROCFS_CNTR_AVGMINMAX),
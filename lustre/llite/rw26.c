@@ -186,25 +186,25 @@ static int ll_releasepage(struct page *vmpage, RELEASEPAGE_ARG_TYPE gfp_mask)
 
 #define MAX_DIRECTIO_SIZE 2*1024*1024*1024UL
 
-ssize_t ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io,
-                           int rw, struct inode *inode,
-                           struct ll_dio_pages *pv)
+/*
+ * Own the pages of \a pv and add those which need a transfer to the
+ * incoming list of \a queue.
+ */
+static int ll_dio_pages_prep(const struct lu_env *env, struct cl_io *io,
+			     int rw, struct ll_dio_pages *pv,
+			     struct cl_2queue *queue)
 {
 	struct cl_page    *clp;
-	struct cl_2queue  *queue;
 	struct cl_object  *obj = io->ci_obj;
 	int i;
-	ssize_t rc = 0;
+	int rc = 0;
 	loff_t file_offset  = pv->ldp_start_offset;
 	size_t size         = pv->ldp_size;
 	int page_count      = pv->ldp_nr;
 	struct page **pages = pv->ldp_pages;
 	size_t page_size    = cl_page_size(obj);
 	bool do_io;
-	int  io_pages       = 0;
-	ENTRY;
 
-        queue = &io->ci_queue;
         cl_2queue_init(queue);
         for (i = 0; i < page_count; i++) {
                 if (pv->ldp_offsets)
@@ -267,8 +267,6 @@ ssize_t ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io,
                          * that page has to be sent even if it is beyond KMS.
                          */
                         cl_page_clip(env, clp, 0, min(size, page_size));
-
-                        ++io_pages;
                 }
 
                 /* drop the reference count for cl_page_find */
@@ -277,35 +275,38 @@ ssize_t ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io,
                 file_offset += page_size;
         }
 
-        if (rc == 0 && io_pages) {
-                rc = cl_io_submit_sync(env, io,
-                                       rw == READ ? CRT_READ : CRT_WRITE,
-				       queue, 0);
-        }
-        if (rc == 0)
-                rc = pv->ldp_size;
+	return rc;
+}
 
-        cl_2queue_discard(env, io, queue);
-        cl_2queue_disown(env, io, queue);
-        cl_2queue_fini(env, queue);
-        RETURN(rc);
+static void ll_dio_pages_fini(const struct lu_env *env, struct cl_io *io,
+			      struct cl_2queue *queue)
+{
+	cl_2queue_discard(env, io, queue);
+	cl_2queue_disown(env, io, queue);
+	cl_2queue_fini(env, queue);
 }
-EXPORT_SYMBOL(ll_direct_rw_pages);
 
-static ssize_t
-ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
-		 struct inode *inode, size_t size, loff_t file_offset,
-		 struct page **pages, int page_count)
+ssize_t ll_direct_rw_pages(const struct lu_env *env, struct cl_io *io,
+                           int rw, struct inode *inode,
+                           struct ll_dio_pages *pv)
 {
-	struct ll_dio_pages pvec = { .ldp_pages		= pages,
-				     .ldp_nr		= page_count,
-				     .ldp_size		= size,
-				     .ldp_offsets	= NULL,
-				     .ldp_start_offset	= file_offset
-				   };
+	struct cl_2queue  *queue = &io->ci_queue;
+	ssize_t rc;
+	ENTRY;
+
+	rc = ll_dio_pages_prep(env, io, rw, pv, queue);
+	if (rc == 0 && queue->c2_qin.pl_nr > 0) {
+		rc = cl_io_submit_sync(env, io,
+				       rw == READ ? CRT_READ : CRT_WRITE,
+				       queue, 0);
+	}
+	if (rc == 0)
+		rc = pv->ldp_size;
 
-	return ll_direct_rw_pages(env, io, rw, inode, &pvec);
+	ll_dio_pages_fini(env, io, queue);
+	RETURN(rc);
 }
+EXPORT_SYMBOL(ll_direct_rw_pages);
 
 /*  ll_free_user_pages - tear down page struct array
  *  @pages: array of page struct pointers underlying target buffer */
@@ -321,11 +322,203 @@ static void ll_free_user_pages(struct page **pages, int npages, int do_dirty)
 		page_cache_release(pages[i]);
 	}
 
-#if defined(HAVE_DIRECTIO_ITER) || defined(HAVE_IOV_ITER_RW)
-	kvfree(pages);
-#else
 	OBD_FREE_LARGE(pages, npages * sizeof(*pages));
-#endif
+}
+
+/**
+ * A contiguous range of user pages under direct IO.
+ *
+ * Chunks are submitted without waiting for the previous ones to complete,
+ * so that the transfers of up to LL_DIO_MAX_INFLIGHT chunks overlap. Each
+ * chunk keeps its user pages pinned until its transfer is finished.
+ */
+struct ll_dio_chunk {
+	struct list_head	 ldc_list;
+	struct cl_2queue	 ldc_queue;
+	struct cl_sync_io	 ldc_anchor;
+	/** pinned user pages, ldc_npages entries */
+	struct page		**ldc_pages;
+	int			 ldc_npages;
+	/** number of pages actually pinned */
+	int			 ldc_nr;
+	size_t			 ldc_size;
+	loff_t			 ldc_offset;
+	/** error of the submission, if any */
+	int			 ldc_rc;
+	bool			 ldc_submitted;
+	struct timeval		 ldc_start;
+};
+
+#define LL_DIO_MAX_INFLIGHT	4
+
+struct ll_dio_pipe {
+	struct list_head	 ldi_chunks;
+	int			 ldi_inflight;
+	/** bytes transferred by the completed chunks */
+	ssize_t			 ldi_bytes;
+	/** first error, chunks completed after it are not accounted */
+	int			 ldi_rc;
+};
+
+static void ll_dio_pipe_init(struct ll_dio_pipe *pipe)
+{
+	INIT_LIST_HEAD(&pipe->ldi_chunks);
+	pipe->ldi_inflight = 0;
+	pipe->ldi_bytes = 0;
+	pipe->ldi_rc = 0;
+}
+
+static struct ll_dio_chunk *ll_dio_chunk_alloc(size_t size, loff_t offset,
+					       int npages)
+{
+	struct ll_dio_chunk *chunk;
+
+	OBD_ALLOC_PTR(chunk);
+	if (chunk == NULL)
+		return NULL;
+
+	OBD_ALLOC_LARGE(chunk->ldc_pages, npages * sizeof(*chunk->ldc_pages));
+	if (chunk->ldc_pages == NULL) {
+		OBD_FREE_PTR(chunk);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&chunk->ldc_list);
+	chunk->ldc_npages = npages;
+	chunk->ldc_size = size;
+	chunk->ldc_offset = offset;
+	return chunk;
+}
+
+static void ll_dio_chunk_free(struct ll_dio_chunk *chunk, int rw)
+{
+	ll_free_user_pages(chunk->ldc_pages, chunk->ldc_npages, rw == READ);
+	OBD_FREE_PTR(chunk);
+}
+
+/* Queue the pages of \a chunk for transfer without waiting for it. */
+static void ll_dio_chunk_submit(const struct lu_env *env, struct cl_io *io,
+				int rw, struct ll_dio_chunk *chunk)
+{
+	struct cl_2queue *queue = &chunk->ldc_queue;
+	struct ll_dio_pages pvec = { .ldp_pages		= chunk->ldc_pages,
+				     .ldp_nr		= chunk->ldc_nr,
+				     .ldp_size		= chunk->ldc_size,
+				     .ldp_offsets	= NULL,
+				     .ldp_start_offset	= chunk->ldc_offset
+				   };
+	struct cl_page *pg;
+	int rc;
+
+	do_gettimeofday(&chunk->ldc_start);
+	rc = ll_dio_pages_prep(env, io, rw, &pvec, queue);
+	if (rc != 0 || queue->c2_qin.pl_nr == 0)
+		GOTO(out, rc);
+
+	cl_page_list_for_each(pg, &queue->c2_qin) {
+		LASSERT(pg->cp_sync_io == NULL);
+		pg->cp_sync_io = &chunk->ldc_anchor;
+	}
+	cl_sync_io_init(&chunk->ldc_anchor, queue->c2_qin.pl_nr,
+			&cl_sync_io_end);
+	rc = cl_io_submit_rw(env, io, rw == READ ? CRT_READ : CRT_WRITE,
+			     queue);
+	if (rc == 0) {
+		/* pages which were not sent are completed already, as in
+		 * cl_io_submit_sync() */
+		cl_page_list_for_each(pg, &queue->c2_qin) {
+			pg->cp_sync_io = NULL;
+			cl_sync_io_note(env, &chunk->ldc_anchor, 1);
+		}
+		chunk->ldc_submitted = true;
+	} else {
+		LASSERT(list_empty(&queue->c2_qout.pl_pages));
+		cl_page_list_for_each(pg, &queue->c2_qin)
+			pg->cp_sync_io = NULL;
+	}
+out:
+	chunk->ldc_rc = rc;
+}
+
+/* Wait for the transfer of \a chunk and release it. */
+static ssize_t ll_dio_chunk_wait(const struct lu_env *env, struct cl_io *io,
+				 struct inode *inode, int rw,
+				 struct ll_dio_chunk *chunk)
+{
+	struct cl_2queue *queue = &chunk->ldc_queue;
+	struct timeval end;
+	ssize_t rc = chunk->ldc_rc;
+
+	if (chunk->ldc_submitted) {
+		rc = cl_sync_io_wait(env, &chunk->ldc_anchor, 0);
+		cl_page_list_assume(env, io, &queue->c2_qout);
+	}
+	ll_dio_pages_fini(env, io, queue);
+
+	do_gettimeofday(&end);
+	ll_stats_ops_tally(ll_i2sbi(inode),
+			   rw == READ ? LPROC_LL_DIO_READ : LPROC_LL_DIO_WRITE,
+			   cfs_timeval_sub(&end, &chunk->ldc_start, NULL));
+
+	if (rc == 0)
+		rc = chunk->ldc_size;
+	ll_dio_chunk_free(chunk, rw);
+	return rc;
+}
+
+static void ll_dio_pipe_reap(const struct lu_env *env, struct cl_io *io,
+			     struct inode *inode, int rw,
+			     struct ll_dio_pipe *pipe)
+{
+	struct ll_dio_chunk *chunk;
+	ssize_t rc;
+
+	chunk = list_entry(pipe->ldi_chunks.next, struct ll_dio_chunk,
+			   ldc_list);
+	list_del(&chunk->ldc_list);
+	pipe->ldi_inflight--;
+
+	rc = ll_dio_chunk_wait(env, io, inode, rw, chunk);
+	if (pipe->ldi_rc != 0)
+		return;
+	if (rc < 0)
+		pipe->ldi_rc = rc;
+	else
+		pipe->ldi_bytes += rc;
+}
+
+/*
+ * Submit \a chunk and keep at most LL_DIO_MAX_INFLIGHT chunks in flight,
+ * waiting for the oldest ones first.
+ */
+static void ll_dio_pipe_add(const struct lu_env *env, struct cl_io *io,
+			    struct inode *inode, int rw,
+			    struct ll_dio_pipe *pipe,
+			    struct ll_dio_chunk *chunk)
+{
+	if (pipe->ldi_rc != 0) {
+		ll_dio_chunk_free(chunk, rw);
+		return;
+	}
+
+	ll_dio_chunk_submit(env, io, rw, chunk);
+	list_add_tail(&chunk->ldc_list, &pipe->ldi_chunks);
+	pipe->ldi_inflight++;
+	ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_DIO_INFLIGHT,
+			   pipe->ldi_inflight);
+
+	while (pipe->ldi_inflight > LL_DIO_MAX_INFLIGHT)
+		ll_dio_pipe_reap(env, io, inode, rw, pipe);
+}
+
+/* Wait for all chunks and return the bytes transferred or the error. */
+static ssize_t ll_dio_pipe_fini(const struct lu_env *env, struct cl_io *io,
+				struct inode *inode, int rw,
+				struct ll_dio_pipe *pipe)
+{
+	while (!list_empty(&pipe->ldi_chunks))
+		ll_dio_pipe_reap(env, io, inode, rw, pipe);
+
+	return pipe->ldi_bytes ? : pipe->ldi_rc;
 }
 
 #ifdef KMALLOC_MAX_SIZE
@@ -342,11 +535,62 @@ static void ll_free_user_pages(struct page **pages, int npages, int do_dirty)
 #define MAX_DIO_SIZE ((MAX_MALLOC / sizeof(struct brw_page) * PAGE_CACHE_SIZE) & \
 		      ~(DT_MAX_BRW_SIZE - 1))
 
+/*
+ * Direct IO is called for one stripe at a time, so chunks are cut at the
+ * RPC size of the data targets rather than MAX_DIO_SIZE: the first RPCs of
+ * a stripe are in flight while the pages of the next ones are pinned.
+ */
+static size_t ll_dio_chunk_size(struct inode *inode)
+{
+	__u32 brw_size = 0;
+	__u32 vallen = sizeof(brw_size);
+	int rc;
+
+	rc = obd_get_info(NULL, ll_i2dtexp(inode), sizeof(KEY_BRW_SIZE),
+			  KEY_BRW_SIZE, &vallen, &brw_size);
+	if (rc != 0 || brw_size < PAGE_CACHE_SIZE)
+		return MAX_DIO_SIZE;
+
+	return min_t(size_t, brw_size & PAGE_CACHE_MASK, MAX_DIO_SIZE);
+}
+
 #ifndef HAVE_IOV_ITER_RW
 # define iov_iter_rw(iter)	rw
 #endif
 
 #if defined(HAVE_DIRECTIO_ITER) || defined(HAVE_IOV_ITER_RW)
+/*
+ * Pin the user pages of the next \a count bytes of \a iter into \a chunk.
+ * The pages of consecutive iovec segments are gathered in the same chunk,
+ * so that small user buffers still produce full-sized RPCs.
+ */
+static ssize_t ll_dio_chunk_fill(struct ll_dio_chunk *chunk,
+				 struct iov_iter *iter, size_t count)
+{
+	size_t bytes = 0;
+	ssize_t result = 0;
+	size_t offs;
+
+	while (bytes < count && chunk->ldc_nr < chunk->ldc_npages) {
+		result = iov_iter_get_pages(iter,
+					    chunk->ldc_pages + chunk->ldc_nr,
+					    count - bytes,
+					    chunk->ldc_npages - chunk->ldc_nr,
+					    &offs);
+		if (result <= 0)
+			break;
+
+		/* user buffers are page aligned, see ll_direct_IO() */
+		LASSERT(offs == 0);
+		chunk->ldc_nr += DIV_ROUND_UP(result, PAGE_SIZE);
+		iov_iter_advance(iter, result);
+		bytes += result;
+	}
+	chunk->ldc_size = bytes;
+
+	return bytes ? : result;
+}
+
 static ssize_t
 ll_direct_IO(
 # ifndef HAVE_IOV_ITER_RW
@@ -359,9 +603,10 @@ ll_direct_IO(
 	struct cl_io *io;
 	struct file *file = iocb->ki_filp;
 	struct inode *inode = file->f_mapping->host;
+	struct ll_dio_pipe pipe;
 	ssize_t count = iov_iter_count(iter);
 	ssize_t tot_bytes = 0, result = 0;
-	size_t size = MAX_DIO_SIZE;
+	size_t size = ll_dio_chunk_size(inode);
 	__u16 refcheck;
 
 	/* FIXME: io smaller than PAGE_SIZE is broken on ia64 ??? */
@@ -382,6 +627,7 @@ ll_direct_IO(
 	LASSERT(!IS_ERR(env));
 	io = vvp_env_io(env)->vui_cl.cis_io;
 	LASSERT(io != NULL);
+	ll_dio_pipe_init(&pipe);
 
 	/* 0. Need locking between buffered and direct access. and race with
 	 *    size changing by concurrent truncates and writes.
@@ -391,8 +637,11 @@ ll_direct_IO(
 		mutex_lock(&inode->i_mutex);
 
 	while (iov_iter_count(iter)) {
-		struct page **pages;
-		size_t offs;
+		struct ll_dio_chunk *chunk;
+
+		/* an earlier chunk failed, the rest would not be reported */
+		if (pipe.ldi_rc != 0)
+			break;
 
 		count = min_t(size_t, iov_iter_count(iter), size);
 		if (iov_iter_rw(iter) == READ) {
@@ -403,25 +652,15 @@ ll_direct_IO(
 				count = i_size_read(inode) - file_offset;
 		}
 
-		result = iov_iter_get_pages_alloc(iter, &pages, count, &offs);
-		if (likely(result > 0)) {
-			int n = DIV_ROUND_UP(result + offs, PAGE_SIZE);
-
-			result = ll_direct_IO_seg(env, io, iov_iter_rw(iter),
-						  inode, result, file_offset,
-						  pages, n);
-			ll_free_user_pages(pages, n,
-					   iov_iter_rw(iter) == READ);
-
-		}
-		if (unlikely(result <= 0)) {
+		chunk = ll_dio_chunk_alloc(count, file_offset,
+					   DIV_ROUND_UP(count, PAGE_SIZE));
+		if (unlikely(chunk == NULL)) {
 			/* If we can't allocate a large enough buffer
 			 * for the request, shrink it to a smaller
 			 * PAGE_SIZE multiple and try again.
 			 * We should always be able to kmalloc for a
 			 * page worth of page pointers = 4MB on i386. */
-			if (result == -ENOMEM &&
-			    size > (PAGE_CACHE_SIZE / sizeof(*pages)) *
+			if (size > (PAGE_CACHE_SIZE / sizeof(struct page *)) *
 				    PAGE_CACHE_SIZE) {
 				size = ((((size / 2) - 1) |
 					~PAGE_MASK) + 1) & PAGE_MASK;
@@ -430,14 +669,26 @@ ll_direct_IO(
 				continue;
 			}
 
+			GOTO(out, result = -ENOMEM);
+		}
+
+		result = ll_dio_chunk_fill(chunk, iter, count);
+		if (unlikely(result <= 0)) {
+			ll_dio_chunk_free(chunk, iov_iter_rw(iter));
 			GOTO(out, result);
 		}
 
-		iov_iter_advance(iter, result);
-		tot_bytes += result;
+		ll_dio_pipe_add(env, io, inode, iov_iter_rw(iter), &pipe,
+				chunk);
 		file_offset += result;
 	}
 out:
+	tot_bytes = ll_dio_pipe_fini(env, io, inode, iov_iter_rw(iter), &pipe);
+	if (tot_bytes < 0) {
+		result = tot_bytes;
+		tot_bytes = 0;
+	}
+
 	if (iov_iter_rw(iter) == READ)
 		mutex_unlock(&inode->i_mutex);
 
@@ -491,10 +742,11 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
 	struct cl_io *io;
 	struct file *file = iocb->ki_filp;
 	struct inode *inode = file->f_mapping->host;
+	struct ll_dio_pipe pipe;
 	ssize_t count = iov_length(iov, nr_segs);
 	ssize_t tot_bytes = 0, result = 0;
 	unsigned long seg = 0;
-	size_t size = MAX_DIO_SIZE;
+	size_t size = ll_dio_chunk_size(inode);
 	__u16 refcheck;
 	ENTRY;
 
@@ -519,6 +771,7 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
         LASSERT(!IS_ERR(env));
 	io = vvp_env_io(env)->vui_cl.cis_io;
         LASSERT(io != NULL);
+	ll_dio_pipe_init(&pipe);
 
         for (seg = 0; seg < nr_segs; seg++) {
 		size_t iov_left = iov[seg].iov_len;
@@ -532,20 +785,35 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
                 }
 
                 while (iov_left > 0) {
+			struct ll_dio_chunk *chunk;
                         struct page **pages;
                         int page_count, max_pages = 0;
 			size_t bytes;
 
+			if (pipe.ldi_rc != 0)
+				GOTO(out, result = pipe.ldi_rc);
+
                         bytes = min(size, iov_left);
                         page_count = ll_get_user_pages(rw, user_addr, bytes,
                                                        &pages, &max_pages);
                         if (likely(page_count > 0)) {
                                 if (unlikely(page_count <  max_pages))
 					bytes = page_count << PAGE_CACHE_SHIFT;
-				result = ll_direct_IO_seg(env, io, rw, inode,
-							  bytes, file_offset,
-							  pages, page_count);
-                                ll_free_user_pages(pages, max_pages, rw==READ);
+				OBD_ALLOC_PTR(chunk);
+				if (chunk == NULL) {
+					ll_free_user_pages(pages, max_pages,
+							   0);
+					GOTO(out, result = -ENOMEM);
+				}
+				INIT_LIST_HEAD(&chunk->ldc_list);
+				chunk->ldc_pages = pages;
+				chunk->ldc_npages = max_pages;
+				chunk->ldc_nr = page_count;
+				chunk->ldc_size = bytes;
+				chunk->ldc_offset = file_offset;
+				ll_dio_pipe_add(env, io, inode, rw, &pipe,
+						chunk);
+				result = bytes;
                         } else if (page_count == 0) {
                                 GOTO(out, result = -EFAULT);
                         } else {
@@ -571,13 +839,18 @@ ll_direct_IO(int rw, struct kiocb *iocb, const struct iovec *iov,
                                 GOTO(out, result);
                         }
 
-                        tot_bytes += result;
                         file_offset += result;
                         iov_left -= result;
                         user_addr += result;
                 }
         }
 out:
+	tot_bytes = ll_dio_pipe_fini(env, io, inode, rw, &pipe);
+	if (tot_bytes < 0) {
+		result = tot_bytes;
+		tot_bytes = 0;
+	}
+
         if (tot_bytes > 0) {
 		struct vvp_io *vio = vvp_env_io(env);
 
@@ -1005,7 +1005,9 @@ static int lmv_iocontrol(unsigned int cmd, struct obd_export *exp,
                 break;
         }
         case OBD_IOC_CHANGELOG_SEND:
+	case OBD_IOC_CHANGELOG_SEND_FILTER:
         case OBD_IOC_CHANGELOG_CLEAR: {
+		/* struct ioc_changelog_filter starts with a ioc_changelog */
                 struct ioc_changelog *icc = karg;
 
                 if (icc->icc_mdtindex >= count)
@@ -1014,7 +1016,7 @@ static int lmv_iocontrol(unsigned int cmd, struct obd_export *exp,
 		tgt = lmv->tgts[icc->icc_mdtindex];
 		if (tgt == NULL || tgt->ltd_exp == NULL || !tgt->ltd_active)
 			RETURN(-ENODEV);
-		rc = obd_iocontrol(cmd, tgt->ltd_exp, sizeof(*icc), icc, NULL);
+		rc = obd_iocontrol(cmd, tgt->ltd_exp, len, icc, NULL);
 		break;
 	}
 	case LL_IOC_GET_CONNECT_FLAGS: {
@@ -2383,6 +2385,45 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Start reading the pages of all stripes at \a hash_offset
+ *
+ * lmv_get_min_striped_entry() reads the stripes one after the other, so
+ * without this every stripe page not yet cached costs a full round trip.
+ * Start the reads for all of the stripes first, MDC neither waits for the
+ * replies nor for the stripe locks not cached yet, so the pages are then
+ * served from the page cache once the replies are back.
+ *
+ * \param[in] exp		obd export refer to LMV
+ * \param[in] op_data		hold those MD parameters of read_entry
+ * \param[in] cb_op		ldlm callback being used in enqueue
+ * \param[in] hash_offset	hash offset to read from
+ */
+static void lmv_prefetch_striped_pages(struct obd_export *exp,
+				       struct md_op_data *op_data,
+				       struct md_callback *cb_op,
+				       __u64 hash_offset)
+{
+	struct lmv_obd		*lmv = &exp->exp_obd->u.lmv;
+	struct lmv_stripe_md	*lsm = op_data->op_mea1;
+	struct lmv_tgt_desc	*tgt;
+	struct page		*page;
+	int			i;
+
+	op_data->op_cli_flags |= CLI_PREFETCH;
+	for (i = 0; i < lsm->lsm_md_stripe_count; i++) {
+		tgt = lmv_get_target(lmv, lsm->lsm_md_oinfo[i].lmo_mds, NULL);
+		if (IS_ERR(tgt))
+			break;
+
+		op_data->op_fid1 = lsm->lsm_md_oinfo[i].lmo_fid;
+		op_data->op_fid2 = lsm->lsm_md_oinfo[i].lmo_fid;
+		op_data->op_data = lsm->lsm_md_oinfo[i].lmo_root;
+		md_read_page(tgt->ltd_exp, op_data, cb_op, hash_offset, &page);
+	}
+	op_data->op_cli_flags &= ~CLI_PREFETCH;
+}
+
 /**
  * Build dir entry page from a striped directory
  *
@@ -2438,6 +2479,8 @@ static int lmv_read_striped_page(struct obd_export *exp,
 	if (ent_page == NULL)
 		RETURN(-ENOMEM);
 
+	lmv_prefetch_striped_pages(exp, op_data, cb_op, offset);
+
 	/* Initialize the entry page */
 	dp = kmap(ent_page);
 	memset(dp, 0, sizeof(*dp));
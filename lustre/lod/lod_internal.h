@@ -81,6 +81,32 @@ struct pool_desc {
 #define pool_tgt_array(p)  ((p)->pool_obds.op_array)
 #define pool_tgt_rw_sem(p) ((p)->pool_obds.op_rw_sem)
 
+/* Sum tree used by lod_alloc_qos() to pick OSTs by weight in O(log n).
+ * Node i holds the sum of its children 2i and 2i + 1, the leaves start at
+ * lqt_size and hold the weight of each candidate OST. */
+struct lod_qos_tree {
+	__u64			*lqt_sum;	/* 2 * lqt_size nodes */
+	__u32			*lqt_idx;	/* OST index of each leaf */
+	int			*lqt_next;	/* next leaf on the same OSS */
+	unsigned int		 lqt_size;	/* leaves, a power of two */
+	unsigned int		 lqt_alloc;	/* leaves allocated */
+};
+
+/* Limits of the QoS allocation benchmark, see lod_qos_bench() */
+#define LOD_QOS_BENCH_MAX_OSTS	65536
+#define LOD_QOS_BENCH_MAX_LOOPS	100000
+/* linear selection steps (loops * stripes * osts) done by one run */
+#define LOD_QOS_BENCH_MAX_STEPS	(1ULL << 30)
+
+/* Result of the last run of the QoS allocation benchmark */
+struct lod_qos_bench {
+	unsigned int		 lqb_osts;
+	unsigned int		 lqb_stripes;
+	unsigned int		 lqb_loops;
+	__u64			 lqb_linear_usec;
+	__u64			 lqb_tree_usec;
+};
+
 struct lod_qos {
 	struct list_head	 lq_oss_list;
 	struct rw_semaphore	 lq_rw_sem;
@@ -88,6 +114,9 @@ struct lod_qos {
 	unsigned int		 lq_prio_free;   /* priority for free space */
 	unsigned int		 lq_threshold_rr;/* priority for rr */
 	struct lod_qos_rr	 lq_rr;          /* round robin qos data */
+	struct lod_qos_tree	 lq_tree;	 /* weighted selection tree,
+						    under lq_rw_sem */
+	struct lod_qos_bench	 lq_bench;	 /* last benchmark result */
 	bool			 lq_dirty:1,     /* recalc qos data */
 				 lq_same_space:1,/* the ost's all have approx.
 						    the same space avail */
@@ -103,6 +132,8 @@ struct lod_qos_oss {
 							 every obj*/
 	time_t			 lqo_used;	/* last used time, seconds */
 	__u32			 lqo_ost_count;	/* number of osts on this oss */
+	int			 lqo_tree_head;	/* first lq_tree leaf on this
+						   oss, during lod_alloc_qos */
 };
 
 struct ltd_qos {
@@ -479,6 +510,9 @@ int lod_qos_prep_create(const struct lu_env *env, struct lod_object *lo,
 int qos_add_tgt(struct lod_device*, struct lod_tgt_desc *);
 int qos_del_tgt(struct lod_device *, struct lod_tgt_desc *);
 void lod_qos_rr_init(struct lod_qos_rr *lqr);
+void lod_qos_tree_fini(struct lod_qos_tree *tree);
+int lod_qos_bench(struct lod_device *lod, unsigned int osts,
+		  unsigned int stripes, unsigned int loops);
 
 /* lproc_lod.c */
 int lod_procfs_init(struct lod_device *lod);
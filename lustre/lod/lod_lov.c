@@ -269,7 +269,9 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_VERSION |
 					   OBD_CONNECT_PINGLESS |
 					   OBD_CONNECT_LFSCK |
-					   OBD_CONNECT_BULK_MBITS;
+					   OBD_CONNECT_BULK_MBITS |
+					   OBD_CONNECT_FLAGS2;
+		data->ocd_connect_flags2 = OBD_CONNECT2_DESTROY_BATCH;
 
 		data->ocd_group = tgt_index;
 		ltd = &lod->lod_ost_descs;
@@ -1386,6 +1388,7 @@ int lod_pools_fini(struct lod_device *lod)
 
 	cfs_hash_putref(lod->lod_pools_hash_body);
 	lod_ost_pool_free(&(lod->lod_qos.lq_rr.lqr_pool));
+	lod_qos_tree_fini(&lod->lod_qos.lq_tree);
 	lod_ost_pool_free(&lod->lod_pool_info);
 
 	RETURN(0);
@@ -440,26 +440,178 @@ static int lod_qos_calc_weight(struct lod_device *lod, int i)
 	return 0;
 }
 
+#define LOV_QOS_EMPTY ((__u32)-1)
+
+/**
+ * Release the weighted selection tree.
+ *
+ * \param[in] tree	tree to release
+ */
+void lod_qos_tree_fini(struct lod_qos_tree *tree)
+{
+	if (tree->lqt_sum != NULL)
+		OBD_FREE_LARGE(tree->lqt_sum,
+			       2 * tree->lqt_alloc * sizeof(*tree->lqt_sum));
+	if (tree->lqt_idx != NULL)
+		OBD_FREE_LARGE(tree->lqt_idx,
+			       tree->lqt_alloc * sizeof(*tree->lqt_idx));
+	if (tree->lqt_next != NULL)
+		OBD_FREE_LARGE(tree->lqt_next,
+			       tree->lqt_alloc * sizeof(*tree->lqt_next));
+	memset(tree, 0, sizeof(*tree));
+}
+
+/**
+ * Prepare the weighted selection tree for \a count candidates.
+ *
+ * The buffers are kept between allocations and only grow when the number
+ * of OSTs grows. All the leaves are emptied.
+ *
+ * \param[in] tree	tree to prepare
+ * \param[in] count	number of candidate OSTs
+ *
+ * \retval 0		on success
+ * \retval -ENOMEM	fails to allocate the tree
+ */
+static int lod_qos_tree_reserve(struct lod_qos_tree *tree, unsigned int count)
+{
+	unsigned int size = 1;
+	unsigned int i;
+
+	while (size < count)
+		size <<= 1;
+
+	if (size > tree->lqt_alloc) {
+		lod_qos_tree_fini(tree);
+		OBD_ALLOC_LARGE(tree->lqt_sum, 2 * size * sizeof(*tree->lqt_sum));
+		OBD_ALLOC_LARGE(tree->lqt_idx, size * sizeof(*tree->lqt_idx));
+		OBD_ALLOC_LARGE(tree->lqt_next, size * sizeof(*tree->lqt_next));
+		tree->lqt_alloc = size;
+		if (tree->lqt_sum == NULL || tree->lqt_idx == NULL ||
+		    tree->lqt_next == NULL) {
+			lod_qos_tree_fini(tree);
+			return -ENOMEM;
+		}
+	}
+
+	tree->lqt_size = size;
+	for (i = 0; i < size; i++) {
+		tree->lqt_sum[size + i] = 0;
+		tree->lqt_idx[i] = LOV_QOS_EMPTY;
+		tree->lqt_next[i] = -1;
+	}
+
+	return 0;
+}
+
+/* Calculate the inner nodes once all the leaves are filled */
+static void lod_qos_tree_build(struct lod_qos_tree *tree)
+{
+	unsigned int i;
+
+	for (i = tree->lqt_size - 1; i > 0; i--)
+		tree->lqt_sum[i] = tree->lqt_sum[2 * i] +
+				   tree->lqt_sum[2 * i + 1];
+}
+
+/* Change the weight of one leaf and update the sums above it */
+static void lod_qos_tree_set(struct lod_qos_tree *tree, unsigned int leaf,
+			     __u64 weight)
+{
+	unsigned int i = tree->lqt_size + leaf;
+
+	tree->lqt_sum[i] = weight;
+	for (i >>= 1; i > 0; i >>= 1)
+		tree->lqt_sum[i] = tree->lqt_sum[2 * i] +
+				   tree->lqt_sum[2 * i + 1];
+}
+
+/**
+ * Find the leaf where the running sum of weights passes \a rand.
+ *
+ * This is the tree equivalent of walking the candidates and adding up
+ * their weights, as the original weighted selection does.
+ *
+ * \param[in] tree	tree to search
+ * \param[in] rand	random value less than the total weight
+ *
+ * \retval		leaf number
+ */
+static unsigned int lod_qos_tree_find(struct lod_qos_tree *tree, __u64 rand)
+{
+	unsigned int i = 1;
+
+	LASSERT(tree->lqt_sum[1] != 0);
+	if (unlikely(rand >= tree->lqt_sum[1]))
+		rand = tree->lqt_sum[1] - 1;
+
+	while (i < tree->lqt_size) {
+		i <<= 1;
+		if (rand >= tree->lqt_sum[i]) {
+			rand -= tree->lqt_sum[i];
+			i++;
+		}
+	}
+
+	return i - tree->lqt_size;
+}
+
+/**
+ * Generate a random value for the weighted selection.
+ *
+ * \param[in] total_weight	upper bound (exclusive), may be above 32 bits
+ *
+ * \retval			random value in [0, total_weight), or 0
+ */
+static __u64 lod_qos_rand(__u64 total_weight)
+{
+	__u64 rand;
+
+	if (total_weight == 0)
+		return 0;
+
+#if BITS_PER_LONG == 32
+	rand = cfs_rand() % (unsigned)total_weight;
+	/* If total_weight > 32-bit, first generate the high
+	 * 32 bits of the random number, then add in the low
+	 * 32 bits (truncated to the upper limit, if needed) */
+	if (total_weight > 0xffffffffULL)
+		rand = (__u64)(cfs_rand() %
+			(unsigned)(total_weight >> 32)) << 32;
+	else
+		rand = 0;
+
+	if (rand == (total_weight & 0xffffffff00000000ULL))
+		rand |= cfs_rand() % (unsigned)total_weight;
+	else
+		rand |= cfs_rand();
+
+#else
+	rand = ((__u64)cfs_rand() << 32 | cfs_rand()) % total_weight;
+#endif
+	return rand;
+}
+
 /**
- * Re-calculate weights.
+ * Account a new object placed on an OST.
  *
- * The function is called when some OST target was used for a new object. In
- * this case we should re-calculate all the weights to keep new allocations
- * balanced well.
+ * The function is called when some OST target was used for a new object.
+ * The OST can't be used anymore until the next allocation and gets the
+ * maximum penalty, as does its OSS. The other OSTs of that OSS are then
+ * reweighted in \a tree. Decreasing the penalties of all the targets is
+ * left to lod_qos_decay(), once per allocation, so a stripe costs
+ * O(log n) instead of a pass over the whole pool.
  *
  * \param[in] lod	LOD device
- * \param[in] osts	OST pool where a new object was placed
+ * \param[in] tree	selection tree of the current allocation
  * \param[in] index	OST target where a new object was placed
- * \param[out] total_wt	new total weight for the pool
- *
- * \retval		0
  */
-static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
-			__u32 index, __u64 *total_wt)
+static void lod_qos_used(struct lod_device *lod, struct lod_qos_tree *tree,
+			 __u32 index)
 {
 	struct lod_tgt_desc *ost;
 	struct lod_qos_oss  *oss;
-	unsigned int j;
+	int		     leaf;
 	ENTRY;
 
 	ost = OST_TGT(lod,index);
@@ -484,15 +636,52 @@ static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
 	oss->lqo_penalty += oss->lqo_penalty_per_obj *
 		lod->lod_qos.lq_active_oss_count;
 
+	/* The OSS penalty is part of the weight of all its OSTs */
+	for (leaf = oss->lqo_tree_head; leaf >= 0;
+	     leaf = tree->lqt_next[leaf]) {
+		__u32 i = tree->lqt_idx[leaf];
+
+		if (i == LOV_QOS_EMPTY)
+			continue;
+
+		lod_qos_calc_weight(lod, i);
+		lod_qos_tree_set(tree, leaf, OST_TGT(lod,i)->ltd_qos.ltq_weight);
+	}
+
+	EXIT;
+}
+
+/**
+ * Decrease the penalties after an allocation.
+ *
+ * Every object placed decreases the penalty of all OSTs and OSSs by their
+ * per-object penalty. This is done once for the \a count objects of the
+ * allocation and the weights are re-calculated.
+ *
+ * \param[in] lod	LOD device
+ * \param[in] osts	OST pool where the new objects were placed
+ * \param[in] count	number of objects placed
+ */
+static void lod_qos_decay(struct lod_device *lod, struct ost_pool *osts,
+			  __u32 count)
+{
+	struct lod_tgt_desc *ost;
+	struct lod_qos_oss  *oss;
+	__u64		     dec;
+	unsigned int	     j;
+
+	if (count == 0)
+		return;
+
 	/* Decrease all OSS penalties */
 	list_for_each_entry(oss, &lod->lod_qos.lq_oss_list, lqo_oss_list) {
-		if (oss->lqo_penalty < oss->lqo_penalty_per_obj)
+		dec = oss->lqo_penalty_per_obj * count;
+		if (oss->lqo_penalty < dec)
 			oss->lqo_penalty = 0;
 		else
-			oss->lqo_penalty -= oss->lqo_penalty_per_obj;
+			oss->lqo_penalty -= dec;
 	}
 
-	*total_wt = 0;
 	/* Decrease all OST penalties */
 	for (j = 0; j < osts->op_count; j++) {
 		int i;
@@ -504,19 +693,14 @@ static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
 		ost = OST_TGT(lod,i);
 		LASSERT(ost);
 
-		if (ost->ltd_qos.ltq_penalty <
-				ost->ltd_qos.ltq_penalty_per_obj)
+		dec = ost->ltd_qos.ltq_penalty_per_obj * count;
+		if (ost->ltd_qos.ltq_penalty < dec)
 			ost->ltd_qos.ltq_penalty = 0;
 		else
-			ost->ltd_qos.ltq_penalty -=
-				ost->ltd_qos.ltq_penalty_per_obj;
+			ost->ltd_qos.ltq_penalty -= dec;
 
 		lod_qos_calc_weight(lod, i);
 
-		/* Recalc the total weight of usable osts */
-		if (ost->ltd_qos.ltq_usable)
-			*total_wt += ost->ltd_qos.ltq_weight;
-
 		QOS_DEBUG("recalc tgt %d usable=%d avail="LPU64
 			  " ostppo="LPU64" ostp="LPU64" ossppo="LPU64
 			  " ossp="LPU64" wt="LPU64"\n",
@@ -527,8 +711,113 @@ static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
 			  ost->ltd_qos.ltq_oss->lqo_penalty >> 10,
 			  ost->ltd_qos.ltq_weight >> 10);
 	}
+}
 
-	RETURN(0);
+/**
+ * Benchmark the weighted OST selection.
+ *
+ * Simulate \a loops allocations of \a stripes objects over \a osts
+ * targets with random weights. Each allocation is done twice: by the
+ * linear walk over all the targets that lod_alloc_qos() used to do for
+ * every stripe, and with the selection tree. The time spent by each is
+ * saved in lod_qos::lq_bench. No real target is touched.
+ *
+ * \param[in] lod	LOD device
+ * \param[in] osts	number of simulated OSTs
+ * \param[in] stripes	stripes per allocation
+ * \param[in] loops	number of allocations
+ *
+ * \retval 0		on success
+ * \retval negative	errno on failure
+ */
+int lod_qos_bench(struct lod_device *lod, unsigned int osts,
+		  unsigned int stripes, unsigned int loops)
+{
+	struct lod_qos_bench	*lqb = &lod->lod_qos.lq_bench;
+	struct lod_qos_tree	 tree = { NULL };
+	struct timeval		 start;
+	struct timeval		 end;
+	__u64			*weight;
+	__u64			*cur;
+	__u64			 linear = 0;
+	__u64			 total;
+	__u64			 rand;
+	__u64			 sum;
+	unsigned int		 i;
+	unsigned int		 j;
+	unsigned int		 n;
+	int			 rc;
+	ENTRY;
+
+	if (osts == 0 || stripes == 0 || stripes > osts)
+		RETURN(-EINVAL);
+
+	OBD_ALLOC_LARGE(weight, osts * sizeof(*weight));
+	if (weight == NULL)
+		RETURN(-ENOMEM);
+	OBD_ALLOC_LARGE(cur, osts * sizeof(*cur));
+	if (cur == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	rc = lod_qos_tree_reserve(&tree, osts);
+	if (rc)
+		GOTO(out, rc);
+
+	/* weights in [1, 2^32), as bytes available scaled down */
+	for (i = 0; i < osts; i++)
+		weight[i] = cfs_rand() | 1;
+
+	do_gettimeofday(&start);
+	for (n = 0; n < loops; n++) {
+		memcpy(cur, weight, osts * sizeof(*cur));
+		for (j = 0; j < stripes; j++) {
+			/* the weights of all targets were recalculated
+			 * after each stripe */
+			for (total = 0, i = 0; i < osts; i++)
+				total += cur[i];
+			rand = lod_qos_rand(total);
+			for (sum = 0, i = 0; i < osts; i++) {
+				sum += cur[i];
+				if (cur[i] != 0 && sum > rand)
+					break;
+			}
+			LASSERT(i < osts);
+			cur[i] = 0;
+			cond_resched();
+		}
+	}
+	do_gettimeofday(&end);
+	linear = cfs_timeval_sub(&end, &start, NULL);
+
+	do_gettimeofday(&start);
+	for (n = 0; n < loops; n++) {
+		for (i = 0; i < osts; i++)
+			tree.lqt_sum[tree.lqt_size + i] = weight[i];
+		lod_qos_tree_build(&tree);
+		for (j = 0; j < stripes; j++) {
+			i = lod_qos_tree_find(&tree,
+					      lod_qos_rand(tree.lqt_sum[1]));
+			LASSERT(i < osts);
+			lod_qos_tree_set(&tree, i, 0);
+		}
+		cond_resched();
+	}
+	do_gettimeofday(&end);
+
+	lqb->lqb_osts = osts;
+	lqb->lqb_stripes = stripes;
+	lqb->lqb_loops = loops;
+	lqb->lqb_linear_usec = linear;
+	lqb->lqb_tree_usec = cfs_timeval_sub(&end, &start, NULL);
+	CDEBUG(D_QOS, "%s: %u OSTs, %u stripes, %u loops: linear "LPU64
+	       " usec, tree "LPU64" usec\n", lod2obd(lod)->obd_name, osts,
+	       stripes, loops, lqb->lqb_linear_usec, lqb->lqb_tree_usec);
+out:
+	lod_qos_tree_fini(&tree);
+	if (cur != NULL)
+		OBD_FREE_LARGE(cur, osts * sizeof(*cur));
+	OBD_FREE_LARGE(weight, osts * sizeof(*weight));
+	RETURN(rc);
 }
 
 void lod_qos_rr_init(struct lod_qos_rr *lqr)
@@ -538,8 +827,6 @@ void lod_qos_rr_init(struct lod_qos_rr *lqr)
 }
 
 
-#define LOV_QOS_EMPTY ((__u32)-1)
-
 /**
  * Calculate optimal round-robin order with regard to OSSes.
  *
@@ -1359,7 +1646,10 @@ static inline int lod_qos_is_usable(struct lod_device *lod)
  * The algorithm has two steps: find available OSTs and calculate their
  * weights, then select the OSTs with their weights used as the probability.
  * An OST with a higher weight is proportionately more likely to be selected
- * than one with a lower weight.
+ * than one with a lower weight. The candidates are kept in a sum tree, see
+ * struct lod_qos_tree, so every stripe is selected in O(log n) and only the
+ * OSTs sharing an OSS with the selected one are reweighted. The penalties
+ * of all the targets are decreased once at the end, see lod_qos_decay().
  *
  * \param[in] env	execution environment for this thread
  * \param[in] lo	LOD object
@@ -1379,11 +1669,12 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	struct lod_device   *m = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
 	struct obd_statfs   *sfs = &lod_env_info(env)->lti_osfs;
 	struct lod_tgt_desc *ost;
+	struct lod_qos_oss  *oss;
+	struct lod_qos_tree *tree;
 	struct dt_object    *o;
-	__u64		     total_weight = 0;
 	unsigned int	     i;
 	int		     rc = 0;
-	__u32		     nfound, good_osts;
+	__u32		     nfound, good_osts, left;
 	__u32		     stripe_cnt = lo->ldo_stripenr;
 	__u32		     stripe_cnt_min;
 	struct pool_desc    *pool = NULL;
@@ -1426,6 +1717,14 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (rc)
 		GOTO(out, rc);
 
+	tree = &m->lod_qos.lq_tree;
+	rc = lod_qos_tree_reserve(tree, osts->op_count);
+	if (rc)
+		GOTO(out, rc);
+
+	list_for_each_entry(oss, &m->lod_qos.lq_oss_list, lqo_oss_list)
+		oss->lqo_tree_head = -1;
+
 	good_osts = 0;
 	/* Find all the OSTs that are valid stripe candidates */
 	for (i = 0; i < osts->op_count; i++) {
@@ -1453,7 +1752,14 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		ost = OST_TGT(m,osts->op_array[i]);
 		ost->ltd_qos.ltq_usable = 1;
 		lod_qos_calc_weight(m, osts->op_array[i]);
-		total_weight += ost->ltd_qos.ltq_weight;
+
+		/* Add it as a leaf of the selection tree, and chain it
+		 * with the other leaves of the same OSS */
+		tree->lqt_sum[tree->lqt_size + good_osts] =
+			ost->ltd_qos.ltq_weight;
+		tree->lqt_idx[good_osts] = osts->op_array[i];
+		tree->lqt_next[good_osts] = ost->ltd_qos.ltq_oss->lqo_tree_head;
+		ost->ltd_qos.ltq_oss->lqo_tree_head = good_osts;
 
 		good_osts++;
 	}
@@ -1467,88 +1773,60 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (good_osts < stripe_cnt)
 		stripe_cnt = good_osts;
 
+	lod_qos_tree_build(tree);
+	left = good_osts;
+	rc = 0;
+
 	/* Find enough OSTs with weighted random allocation. */
 	nfound = 0;
-	while (nfound < stripe_cnt) {
-		__u64 rand, cur_weight;
+	while (nfound < stripe_cnt && left > 0) {
+		__u64	     total_weight = tree->lqt_sum[1];
+		unsigned int leaf;
+		__u32	     idx;
 
-		cur_weight = 0;
-		rc = -ENOSPC;
-
-		if (total_weight) {
-#if BITS_PER_LONG == 32
-			rand = cfs_rand() % (unsigned)total_weight;
-			/* If total_weight > 32-bit, first generate the high
-			 * 32 bits of the random number, then add in the low
-			 * 32 bits (truncated to the upper limit, if needed) */
-			if (total_weight > 0xffffffffULL)
-				rand = (__u64)(cfs_rand() %
-					(unsigned)(total_weight >> 32)) << 32;
-			else
-				rand = 0;
-
-			if (rand == (total_weight & 0xffffffff00000000ULL))
-				rand |= cfs_rand() % (unsigned)total_weight;
-			else
-				rand |= cfs_rand();
-
-#else
-			rand = ((__u64)cfs_rand() << 32 | cfs_rand()) %
-				total_weight;
-#endif
+		/* On average, this will hit larger-weighted OSTs more often.
+		 * 0-weight OSTs will always get used last */
+		if (total_weight != 0) {
+			leaf = lod_qos_tree_find(tree,
+						 lod_qos_rand(total_weight));
 		} else {
-			rand = 0;
+			for (leaf = 0; leaf < good_osts; leaf++)
+				if (tree->lqt_idx[leaf] != LOV_QOS_EMPTY)
+					break;
 		}
+		LASSERT(leaf < good_osts);
 
-		/* On average, this will hit larger-weighted OSTs more often.
-		 * 0-weight OSTs will always get used last (only when rand=0) */
-		for (i = 0; i < osts->op_count; i++) {
-			__u32 idx = osts->op_array[i];
+		idx = tree->lqt_idx[leaf];
+		QOS_DEBUG("stripe_cnt=%d nfound=%d total_weight="LPU64
+			  " leaf=%u idx=%u\n", stripe_cnt, nfound,
+			  total_weight, leaf, idx);
 
-			if (!cfs_bitmap_check(m->lod_ost_bitmap, idx))
-				continue;
-
-			ost = OST_TGT(m,idx);
-
-			if (!ost->ltd_qos.ltq_usable)
-				continue;
+		/* Whatever happens below, the OST is not tried again */
+		tree->lqt_idx[leaf] = LOV_QOS_EMPTY;
+		lod_qos_tree_set(tree, leaf, 0);
+		left--;
 
-			cur_weight += ost->ltd_qos.ltq_weight;
-			QOS_DEBUG("stripe_cnt=%d nfound=%d cur_weight="LPU64
-				  " rand="LPU64" total_weight="LPU64"\n",
-				  stripe_cnt, nfound, cur_weight, rand,
-				  total_weight);
-
-			if (cur_weight < rand)
-				continue;
-
-			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
-
-			/*
-			 * do not put >1 objects on a single OST
-			 */
-			if (lod_qos_is_ost_used(env, idx, nfound))
-				continue;
-			lod_qos_ost_in_use(env, nfound, idx);
+		/*
+		 * do not put >1 objects on a single OST
+		 */
+		if (lod_qos_is_ost_used(env, idx, nfound))
+			continue;
+		lod_qos_ost_in_use(env, nfound, idx);
 
-			o = lod_qos_declare_object_on(env, m, idx, th);
-			if (IS_ERR(o)) {
-				QOS_DEBUG("can't declare object on #%u: %d\n",
-					  idx, (int) PTR_ERR(o));
-				continue;
-			}
-			stripe[nfound++] = o;
-			lod_qos_used(m, osts, idx, &total_weight);
-			rc = 0;
-			break;
+		o = lod_qos_declare_object_on(env, m, idx, th);
+		if (IS_ERR(o)) {
+			QOS_DEBUG("can't declare object on #%u: %d\n",
+				  idx, (int) PTR_ERR(o));
+			continue;
 		}
 
-		if (rc) {
-			/* no OST found on this iteration, give up */
-			break;
-		}
+		QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
+		stripe[nfound++] = o;
+		lod_qos_used(m, tree, idx);
 	}
 
+	lod_qos_decay(m, osts, nfound);
+
 	if (unlikely(nfound != stripe_cnt)) {
 		/*
 		 * when the decision to use weighted algorithm was made
@@ -708,6 +708,78 @@ lod_lmv_failout_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(lod_lmv_failout);
 
+/**
+ * Show the result of the last QoS allocation benchmark.
+ *
+ * \param[in] m		seq file
+ * \param[in] v		unused for single entry
+ *
+ * \retval 0		on success
+ * \retval negative	error code if failed
+ */
+static int lod_qos_bench_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device	*dev = m->private;
+	struct lod_qos_bench	*lqb;
+
+	LASSERT(dev != NULL);
+	lqb = &lu2lod_dev(dev->obd_lu_dev)->lod_qos.lq_bench;
+
+	return seq_printf(m, "osts: %u\nstripes: %u\nloops: %u\n"
+			  "linear_usec: "LPU64"\ntree_usec: "LPU64"\n",
+			  lqb->lqb_osts, lqb->lqb_stripes, lqb->lqb_loops,
+			  lqb->lqb_linear_usec, lqb->lqb_tree_usec);
+}
+
+/**
+ * Run the QoS allocation benchmark.
+ *
+ * Simulate weighted stripe allocation over a number of OSTs which does not
+ * need to match the real configuration, see lod_qos_bench(). The run is
+ * bounded by LOD_QOS_BENCH_MAX_STEPS, as it is done in the writer context.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	string "osts stripes loops"
+ * \param[in] count	@buffer length
+ * \param[in] off	unused for single entry
+ *
+ * \retval @count	on success
+ * \retval negative	error code if failed
+ */
+static ssize_t
+lod_qos_bench_seq_write(struct file *file, const char __user *buffer,
+			size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct obd_device	*dev = m->private;
+	char			 kernbuf[64];
+	unsigned int		 osts;
+	unsigned int		 stripes;
+	unsigned int		 loops;
+	int			 rc;
+
+	LASSERT(dev != NULL);
+
+	if (count >= sizeof(kernbuf))
+		return -EINVAL;
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+	kernbuf[count] = '\0';
+
+	if (sscanf(kernbuf, "%u %u %u", &osts, &stripes, &loops) != 3)
+		return -EINVAL;
+
+	if (osts > LOD_QOS_BENCH_MAX_OSTS || loops > LOD_QOS_BENCH_MAX_LOOPS ||
+	    stripes > LOV_MAX_STRIPE_COUNT ||
+	    (__u64)loops * stripes * osts > LOD_QOS_BENCH_MAX_STEPS)
+		return -ERANGE;
+
+	rc = lod_qos_bench(lu2lod_dev(dev->obd_lu_dev), osts, stripes, loops);
+
+	return rc < 0 ? rc : count;
+}
+LPROC_SEQ_FOPS(lod_qos_bench);
+
 static struct lprocfs_vars lprocfs_lod_obd_vars[] = {
 	{ .name	=	"uuid",
 	  .fops	=	&lod_uuid_fops		},
@@ -733,6 +805,8 @@ static struct lprocfs_vars lprocfs_lod_obd_vars[] = {
 	  .fops	=	&lod_qos_maxage_fops	},
 	{ .name	=	"lmv_failout",
 	  .fops	=	&lod_lmv_failout_fops	},
+	{ .name	=	"qos_bench",
+	  .fops	=	&lod_qos_bench_fops	},
 	{ NULL }
 };
 
@@ -288,6 +288,8 @@ struct lov_lock {
 	struct cl_lock_slice	lls_cl;
 	/** Number of sub-locks in this lock */
 	int			lls_nr;
+	/** Sub-locks are enqueued in parallel, see lov_lock_enqueue() */
+	unsigned int		lls_fanout:1;
 	/** sublock array */
 	struct lov_lock_sub	lls_sub[0];
 };
@@ -520,6 +522,23 @@ void  lov_lock_unlink     (const struct lu_env *env, struct lov_lock_link *link,
 struct lov_io_sub *lov_sub_get(const struct lu_env *env, struct lov_io *lio,
                                int stripe);
 void  lov_sub_put             (struct lov_io_sub *sub);
+
+/**
+ * Work on one sub-io, run either by the thread doing the IO or by one of the
+ * lov_io workers, see lov_io_fanout().
+ */
+struct lov_fanout_item {
+	cfs_workitem_t		 lfi_wi;
+	struct list_head	 lfi_linkage;
+	struct lov_io_sub	*lfi_sub;
+	int			(*lfi_func)(const struct lu_env *env,
+					    struct lov_fanout_item *item);
+	int			 lfi_rc;
+	struct cfs_wi_sched	*lfi_sched;
+	struct lov_fanout	*lfi_fanout;
+};
+
+int   lov_io_fanout       (struct list_head *items, __u32 threshold);
 int   lov_sublock_modify  (const struct lu_env *env, struct lov_lock *lov,
                            struct lovsub_lock *sublock,
                            const struct cl_lock_descr *d, int idx);
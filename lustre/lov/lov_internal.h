@@ -259,14 +259,32 @@ void lsm_free_plain(struct lov_stripe_md *lsm);
 void dump_lsm(unsigned int level, const struct lov_stripe_md *lsm);
 
 /* lproc_lov.c */
+enum {
+	LOV_LOCK_STATS_ENQUEUE = 0,
+	LOV_LOCK_STATS_FANOUT,
+	LOV_LOCK_STATS_ORDERED,
+	LOV_LOCK_STATS_LAST
+};
+
+enum {
+	LOV_IO_STATS_SUBMIT_FANOUT = 0,
+	LOV_IO_STATS_LAST
+};
+
 extern struct file_operations lov_proc_target_fops;
 #ifdef CONFIG_PROC_FS
 extern struct lprocfs_vars lprocfs_lov_obd_vars[];
+void lov_lock_stats_init(struct obd_device *obd);
+void lov_io_stats_init(struct obd_device *obd);
 #endif
 
 /* lov_cl.c */
 extern struct lu_device_type lov_device_type;
 
+/* lov_io.c */
+int lov_io_fanout_start(void);
+void lov_io_fanout_fini(void);
+
 /* pools */
 extern struct cfs_hash_ops pool_hash_operations;
 /* ost_pool methods */
@@ -252,6 +252,194 @@ void lov_sub_put(struct lov_io_sub *sub)
         lov_sub_exit(sub);
 }
 
+/*****************************************************************************
+ *
+ * Parallel execution of sub-ios.
+ *
+ */
+
+/** Per-CPT schedulers of the lov_io workers, started on first use. */
+static struct cfs_wi_sched **lov_io_scheds;
+static int lov_io_nscheds;
+static DEFINE_MUTEX(lov_io_scheds_mutex);
+
+#define LOV_IO_FANOUT_THREADS_MAX	4
+
+struct lov_fanout {
+	atomic_t		lf_pending;
+	struct completion	lf_done;
+};
+
+static void lov_io_scheds_free(struct cfs_wi_sched **scheds, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (scheds[i] != NULL)
+			cfs_wi_sched_destroy(scheds[i]);
+	}
+	OBD_FREE(scheds, nr * sizeof(scheds[0]));
+}
+
+/**
+ * Start the lov_io workers, if they are not running yet.
+ *
+ * They are only needed once parallel sub-ios are enabled by the io_fanout
+ * tunable of a lov device, so they are not started at module load.
+ *
+ * \retval 0 on success
+ * \retval negative error if the workers could not be started
+ */
+int lov_io_fanout_start(void)
+{
+	struct cfs_wi_sched	**scheds;
+	int			  nr;
+	int			  nthrs;
+	int			  rc = 0;
+	int			  i;
+
+	mutex_lock(&lov_io_scheds_mutex);
+	if (lov_io_scheds != NULL)
+		GOTO(out, rc = 0);
+
+	nr = cfs_cpt_number(cfs_cpt_table);
+	OBD_ALLOC(scheds, nr * sizeof(scheds[0]));
+	if (scheds == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < nr; i++) {
+		nthrs = cfs_cpt_weight(cfs_cpt_table, i) / 2;
+		nthrs = min(max(nthrs, 1), LOV_IO_FANOUT_THREADS_MAX);
+		rc = cfs_wi_sched_create("lov_io", cfs_cpt_table, i, nthrs,
+					 &scheds[i]);
+		if (rc != 0) {
+			CERROR("cannot create lov_io scheduler for CPT %d: "
+			       "rc = %d\n", i, rc);
+			lov_io_scheds_free(scheds, nr);
+			GOTO(out, rc);
+		}
+	}
+
+	lov_io_nscheds = nr;
+	/* lov_io_fanout() reads the array without the mutex */
+	smp_wmb();
+	lov_io_scheds = scheds;
+out:
+	mutex_unlock(&lov_io_scheds_mutex);
+	return rc;
+}
+
+void lov_io_fanout_fini(void)
+{
+	if (lov_io_scheds == NULL)
+		return;
+
+	lov_io_scheds_free(lov_io_scheds, lov_io_nscheds);
+	lov_io_scheds = NULL;
+}
+
+static int lov_fanout_action(cfs_workitem_t *wi)
+{
+	struct lov_fanout_item	*item;
+	struct lov_fanout	*fanout;
+	struct lu_context	*ses;
+	struct lu_env		*env;
+	int			 refcheck;
+
+	item = container_of(wi, struct lov_fanout_item, lfi_wi);
+	fanout = item->lfi_fanout;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env)) {
+		item->lfi_rc = PTR_ERR(env);
+	} else {
+		/* the worker has an env of its own, it only shares the
+		 * session, where the sub-io layers keep their state, with
+		 * the sub-io */
+		ses = env->le_ses;
+		env->le_ses = item->lfi_sub->sub_env->le_ses;
+		item->lfi_rc = item->lfi_func(env, item);
+		env->le_ses = ses;
+		cl_env_put(env, &refcheck);
+	}
+	cfs_wi_exit(item->lfi_sched, wi);
+
+	/* \a item can be freed by the waiter from now on */
+	if (atomic_dec_and_test(&fanout->lf_pending))
+		complete(&fanout->lf_done);
+	return 1;
+}
+
+/**
+ * Runs lov_fanout_item::lfi_func() for all \a items.
+ *
+ * When there are at least \a threshold items, all of them but the first one
+ * are handed to the lov_io workers, spread over the CPTs, while the calling
+ * thread runs the first one, and this waits for all of them. Otherwise they
+ * are run in order by the calling thread, stopping at the first error.
+ * The calling thread runs an item with the env of its sub-io, a worker with
+ * an env of its own.
+ *
+ * \retval 0 on success, or the first error returned by an item
+ */
+int lov_io_fanout(struct list_head *items, __u32 threshold)
+{
+	struct cfs_wi_sched	**scheds = lov_io_scheds;
+	struct lov_fanout	  fanout;
+	struct lov_fanout_item	 *item;
+	struct lov_fanout_item	 *first = NULL;
+	int			  cpt;
+	int			  nr = 0;
+	int			  rc = 0;
+	ENTRY;
+
+	list_for_each_entry(item, items, lfi_linkage)
+		nr++;
+
+	if (nr < 2 || threshold == 0 || nr < threshold || scheds == NULL) {
+		list_for_each_entry(item, items, lfi_linkage) {
+			item->lfi_rc = item->lfi_func(item->lfi_sub->sub_env,
+						      item);
+			if (item->lfi_rc != 0)
+				RETURN(item->lfi_rc);
+		}
+		RETURN(0);
+	}
+	smp_rmb();
+
+	atomic_set(&fanout.lf_pending, nr - 1);
+	init_completion(&fanout.lf_done);
+	cpt = cfs_cpt_current(cfs_cpt_table, 0);
+	list_for_each_entry(item, items, lfi_linkage) {
+		if (first == NULL) {
+			first = item;
+			continue;
+		}
+		cpt = (cpt + 1) % lov_io_nscheds;
+		item->lfi_fanout = &fanout;
+		item->lfi_sched = scheds[cpt];
+		cfs_wi_init(&item->lfi_wi, NULL, lov_fanout_action);
+		cfs_wi_schedule(item->lfi_sched, &item->lfi_wi);
+	}
+
+	first->lfi_rc = first->lfi_func(first->lfi_sub->sub_env, first);
+	wait_for_completion(&fanout.lf_done);
+
+	list_for_each_entry(item, items, lfi_linkage) {
+		if (item->lfi_rc != 0) {
+			rc = item->lfi_rc;
+			break;
+		}
+	}
+	RETURN(rc);
+}
+
+static inline __u32 lov_io_fanout_threshold(const struct lov_io *lio)
+{
+	return lu2lov_dev(lio->lis_object->lo_cl.co_lu.lo_dev)->ld_lov->
+		lov_io_fanout;
+}
+
 /*****************************************************************************
  *
  * Lov io operations.
@@ -673,6 +861,110 @@ static int lov_io_read_ahead(const struct lu_env *env,
 	RETURN(0);
 }
 
+struct lov_submit_item {
+	struct lov_fanout_item	lsi_item;
+	struct cl_2queue	lsi_queue;
+	enum cl_req_type	lsi_crt;
+};
+
+static int lov_submit_item_run(const struct lu_env *env,
+			       struct lov_fanout_item *item)
+{
+	struct lov_submit_item	*lsi;
+	int			 rc;
+
+	lsi = container_of(item, struct lov_submit_item, lsi_item);
+	/* the queue is handed over by lov_io_submit_fanout() */
+	cl_2queue_adopt(&lsi->lsi_queue);
+	rc = cl_io_submit_rw(env, item->lfi_sub->sub_io, lsi->lsi_crt,
+			     &lsi->lsi_queue);
+	cl_2queue_release(&lsi->lsi_queue);
+	return rc;
+}
+
+/**
+ * Splits \a queue per stripe and submits the per-stripe queues in parallel
+ * through lov_io_fanout().
+ *
+ * \retval -EAGAIN if the fan-out could not be set up, in which case \a queue
+ *		   is left untouched
+ */
+static int lov_io_submit_fanout(const struct lu_env *env, struct lov_io *lio,
+				enum cl_req_type crt, struct cl_2queue *queue)
+{
+	struct cl_page_list	*qin = &queue->c2_qin;
+	struct lov_submit_item	*items;
+	struct lov_submit_item	*lsi;
+	struct cl_page		*page;
+	struct list_head	 list;
+	struct lov_obd		*lov;
+	int			 nr = lio->lis_stripe_count;
+	int			 stripes;
+	int			 rc = 0;
+	int			 i;
+	ENTRY;
+
+	lov = lu2lov_dev(lio->lis_object->lo_cl.co_lu.lo_dev)->ld_lov;
+	OBD_ALLOC_LARGE(items, nr * sizeof(items[0]));
+	if (items == NULL)
+		RETURN(-EAGAIN);
+
+	for (i = 0; i < nr; i++) {
+		cl_2queue_init(&items[i].lsi_queue);
+		items[i].lsi_crt = crt;
+		items[i].lsi_item.lfi_func = lov_submit_item_run;
+	}
+
+	while (qin->pl_nr > 0) {
+		page = cl_page_list_first(qin);
+		lsi = &items[lov_page_stripe(page)];
+		cl_page_list_move(&lsi->lsi_queue.c2_qin, qin, page);
+	}
+
+	INIT_LIST_HEAD(&list);
+	stripes = 0;
+	for (i = 0; i < nr; i++) {
+		struct lov_io_sub *sub;
+
+		lsi = &items[i];
+		if (lsi->lsi_queue.c2_qin.pl_nr == 0)
+			continue;
+
+		sub = lov_sub_get(env, lio, i);
+		if (IS_ERR(sub)) {
+			rc = PTR_ERR(sub);
+			break;
+		}
+		lsi->lsi_item.lfi_sub = sub;
+		list_add_tail(&lsi->lsi_item.lfi_linkage, &list);
+		stripes++;
+	}
+
+	if (rc == 0) {
+		for (i = 0; i < nr; i++)
+			cl_2queue_release(&items[i].lsi_queue);
+		rc = lov_io_fanout(&list, lov_io_fanout_threshold(lio));
+		for (i = 0; i < nr; i++)
+			cl_2queue_adopt(&items[i].lsi_queue);
+		if (lov->lov_io_stats != NULL)
+			lprocfs_counter_add(lov->lov_io_stats,
+					    LOV_IO_STATS_SUBMIT_FANOUT,
+					    stripes);
+	}
+
+	for (i = 0; i < nr; i++) {
+		lsi = &items[i];
+		if (lsi->lsi_item.lfi_sub != NULL)
+			lov_sub_put(lsi->lsi_item.lfi_sub);
+		cl_page_list_splice(&lsi->lsi_queue.c2_qin, qin);
+		cl_page_list_splice(&lsi->lsi_queue.c2_qout, &queue->c2_qout);
+		cl_2queue_fini(env, &lsi->lsi_queue);
+	}
+	OBD_FREE_LARGE(items, nr * sizeof(items[0]));
+
+	RETURN(rc);
+}
+
 /**
  * lov implementation of cl_operations::cio_submit() method. It takes a list
  * of pages in \a queue, splits it into per-stripe sub-lists, invokes
@@ -716,6 +1008,14 @@ static int lov_io_submit(const struct lu_env *env,
 
         LASSERT(lio->lis_subs != NULL);
 
+	if (lov_io_fanout_threshold(lio) > 0 &&
+	    lio->lis_active_subios >= lov_io_fanout_threshold(lio)) {
+		rc = lov_io_submit_fanout(env, lio, crt, queue);
+		if (rc != -EAGAIN)
+			RETURN(rc);
+		rc = 0;
+	}
+
 	cl_page_list_init(plist);
 	while (qin->pl_nr > 0) {
 		struct cl_2queue  *cl2q = &lov_env_info(env)->lti_cl2q;
@@ -115,6 +115,56 @@ static int lov_sublock_init(const struct lu_env *env,
 	RETURN(result);
 }
 
+static inline struct lov_obd *lov_lock_obd(const struct cl_object *obj)
+{
+	return lu2lov_dev(obj->co_lu.lo_dev)->ld_lov;
+}
+
+/**
+ * Checks whether the OST of \a stripe fails a conflicting non-blocking
+ * enqueue at once instead of calling back the conflicting lock and making
+ * the enqueue wait for it, see OBD_CONNECT2_EXTENT_NOWAIT.
+ */
+static bool lov_stripe_nowait_ok(struct lov_object *loo, int stripe)
+{
+	struct lov_obd		*lov = lov_lock_obd(lov2cl(loo));
+	struct lov_tgt_desc	*tgt;
+
+	tgt = lov->lov_tgts[loo->lo_lsm->lsm_oinfo[stripe]->loi_ost_idx];
+	return tgt != NULL && tgt->ltd_exp != NULL &&
+	       exp_connect_extent_nowait(tgt->ltd_exp);
+}
+
+/**
+ * Checks whether the \a nr sub-locks of \a lock can be enqueued in parallel.
+ *
+ * Only plain extent locks taken for the object of the current IO qualify,
+ * as the sub-locks are enqueued with the environments of its sub-ios. The
+ * caller also has to check that the OSTs of all stripes support
+ * OBD_CONNECT2_EXTENT_NOWAIT.
+ */
+static bool lov_lock_fanout_ok(const struct lu_env *env,
+			       const struct cl_object *obj,
+			       const struct cl_lock *lock, int nr)
+{
+	struct cl_io	*io = lov_env_io(env)->lis_cl.cis_io;
+	__u32		 threshold = lov_lock_obd(obj)->lov_io_fanout;
+	__u32		 enqflags = lock->cll_descr.cld_enq_flags;
+
+	if (threshold == 0 || nr < 2 || nr < threshold)
+		return false;
+
+	if (lock->cll_descr.cld_mode != CLM_READ &&
+	    lock->cll_descr.cld_mode != CLM_WRITE)
+		return false;
+
+	if (enqflags & (CEF_NONBLOCK | CEF_ASYNC | CEF_AGL | CEF_PEEK |
+			CEF_LOCK_MATCH | CEF_DISCARD_DATA))
+		return false;
+
+	return io != NULL && cl_object_same(io->ci_obj, lock->cll_descr.cld_obj);
+}
+
 /**
  * Creates sub-locks for a given lov_lock for the first time.
  *
@@ -130,6 +180,7 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 	int result = 0;
 	int i;
 	int nr;
+	bool nowait_ok = true;
 	loff_t start;
 	loff_t end;
 	loff_t file_start;
@@ -151,8 +202,11 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
                  */
 		if (likely(r0->lo_sub[i] != NULL) && /* spare layout */
 		    lov_stripe_intersects(loo->lo_lsm, i,
-					  file_start, file_end, &start, &end))
+					  file_start, file_end, &start, &end)) {
 			nr++;
+			if (nowait_ok && !lov_stripe_nowait_ok(loo, i))
+				nowait_ok = false;
+		}
 	}
 	LASSERT(nr > 0);
 
@@ -161,6 +215,8 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 		RETURN(ERR_PTR(-ENOMEM));
 
 	lovlck->lls_nr = nr;
+	lovlck->lls_fanout = nowait_ok &&
+			     lov_lock_fanout_ok(env, obj, lock, nr);
 	for (i = 0, nr = 0; i < r0->lo_nr; ++i) {
 		if (likely(r0->lo_sub[i] != NULL) &&
 		    lov_stripe_intersects(loo->lo_lsm, i,
@@ -177,6 +233,10 @@ static struct lov_lock *lov_lock_sub_init(const struct lu_env *env,
 			descr->cld_mode  = lock->cll_descr.cld_mode;
 			descr->cld_gid   = lock->cll_descr.cld_gid;
 			descr->cld_enq_flags = lock->cll_descr.cld_enq_flags;
+			/* first try, see lov_lock_enqueue_fanout() */
+			if (lovlck->lls_fanout)
+				descr->cld_enq_flags |= CEF_NONBLOCK |
+							CEF_NOWAIT_LOCAL;
 
 			lls->sub_stripe = i;
 
@@ -225,6 +285,145 @@ static void lov_lock_fini(const struct lu_env *env,
 	EXIT;
 }
 
+static void lov_sublock_cancel(const struct lu_env *env,
+			       const struct cl_lock *parent,
+			       struct lov_lock_sub *lls)
+{
+	struct lov_sublock_env	*subenv;
+
+	lls->sub_is_enqueued = 0;
+	subenv = lov_sublock_env_get(env, parent, lls);
+	if (!IS_ERR(subenv)) {
+		cl_lock_cancel(subenv->lse_env, &lls->sub_lock);
+		lov_sublock_env_put(subenv);
+	} else {
+		CL_LOCK_DEBUG(D_ERROR, env, parent,
+			      "lov_lock_cancel fails with %ld.\n",
+			      PTR_ERR(subenv));
+	}
+}
+
+/**
+ * Turns a sub-lock created non-blocking for lov_lock_enqueue_fanout() back
+ * into an ordinary one.
+ */
+static int lov_sublock_reinit(const struct lu_env *env,
+			      const struct cl_lock *parent,
+			      struct lov_lock_sub *lls)
+{
+	struct cl_lock_descr	descr = lls->sub_lock.cll_descr;
+	int			rc;
+
+	LASSERT(!lls->sub_is_enqueued);
+
+	cl_lock_fini(env, &lls->sub_lock);
+	lls->sub_initialized = 0;
+
+	descr.cld_enq_flags &= ~(CEF_NONBLOCK | CEF_NOWAIT_LOCAL);
+	lls->sub_lock.cll_descr = descr;
+	rc = lov_sublock_init(env, parent, lls);
+	if (rc == 0)
+		lls->sub_initialized = 1;
+	return rc;
+}
+
+struct lov_lock_item {
+	struct lov_fanout_item	 lli_item;
+	struct lov_lock_sub	*lli_lls;
+	int			 lli_rc;
+};
+
+static int lov_lock_item_enqueue(const struct lu_env *env,
+				 struct lov_fanout_item *item)
+{
+	struct lov_lock_item	*lli;
+
+	lli = container_of(item, struct lov_lock_item, lli_item);
+	lli->lli_rc = cl_lock_enqueue(env, item->lfi_sub->sub_io,
+				      &lli->lli_lls->sub_lock, NULL);
+	/* a conflict only sends this sub-lock to the ordered pass */
+	return lli->lli_rc == -EWOULDBLOCK ? 0 : lli->lli_rc;
+}
+
+/**
+ * Enqueues the sub-locks of \a lovlck in parallel.
+ *
+ * The sub-locks are created non-blocking, so the parallel pass never waits
+ * for a conflicting lock, be it held by this client or by another one: the
+ * OSTs support OBD_CONNECT2_EXTENT_NOWAIT and fail such an enqueue without
+ * calling the conflicting lock back. From
+ * the first sub-lock that conflicted on, sub-locks are released and have to
+ * be taken again in stripe order, so that a thread never waits for a
+ * sub-lock while holding one that follows it, as with the serial enqueue.
+ *
+ * \param[out] first	index of the first sub-lock to enqueue in order
+ *
+ * \retval 0 on success
+ * \retval negative error if the enqueue failed for another reason
+ */
+static int lov_lock_enqueue_fanout(const struct lu_env *env,
+				   struct cl_lock *lock,
+				   struct lov_lock *lovlck, int *first)
+{
+	struct lov_obd		*lov = lov_lock_obd(lovlck->lls_cl.cls_obj);
+	struct lov_io		*lio = lov_env_io(env);
+	struct lov_lock_item	*items;
+	struct list_head	 list;
+	int			 nr = lovlck->lls_nr;
+	int			 rc = 0;
+	int			 i;
+	ENTRY;
+
+	OBD_ALLOC_LARGE(items, nr * sizeof(items[0]));
+	if (items == NULL)
+		RETURN(-ENOMEM);
+
+	INIT_LIST_HEAD(&list);
+	for (i = 0; i < nr; i++) {
+		struct lov_io_sub *sub;
+
+		sub = lov_sub_get(env, lio, lovlck->lls_sub[i].sub_stripe);
+		if (IS_ERR(sub))
+			GOTO(out, rc = PTR_ERR(sub));
+
+		items[i].lli_lls = &lovlck->lls_sub[i];
+		items[i].lli_rc = -EWOULDBLOCK;
+		items[i].lli_item.lfi_sub = sub;
+		items[i].lli_item.lfi_func = lov_lock_item_enqueue;
+		list_add_tail(&items[i].lli_item.lfi_linkage, &list);
+	}
+
+	rc = lov_io_fanout(&list, lov->lov_io_fanout);
+	EXIT;
+out:
+	*first = nr;
+	for (i = 0; i < nr && items[i].lli_item.lfi_sub != NULL; i++) {
+		lov_sub_put(items[i].lli_item.lfi_sub);
+		if (items[i].lli_rc == 0)
+			lovlck->lls_sub[i].sub_is_enqueued = 1;
+		else if (*first == nr)
+			*first = i;
+	}
+	OBD_FREE_LARGE(items, nr * sizeof(items[0]));
+	if (rc != 0)
+		return rc;
+
+	for (i = *first; i < nr; i++) {
+		struct lov_lock_sub *lls = &lovlck->lls_sub[i];
+
+		if (lls->sub_is_enqueued)
+			lov_sublock_cancel(env, lock, lls);
+		rc = lov_sublock_reinit(env, lock, lls);
+		if (rc != 0)
+			return rc;
+	}
+
+	if (lov->lov_lock_stats != NULL && *first < nr)
+		lprocfs_counter_add(lov->lov_lock_stats,
+				    LOV_LOCK_STATS_ORDERED, nr - *first);
+	return 0;
+}
+
 /**
  * Implementation of cl_lock_operations::clo_enqueue() for lov layer. This
  * function is rather subtle, as it enqueues top-lock (i.e., advances top-lock
@@ -238,12 +437,23 @@ static int lov_lock_enqueue(const struct lu_env *env,
 {
 	struct cl_lock          *lock   = slice->cls_lock;
 	struct lov_lock         *lovlck = cl2lov_lock(slice);
-	int                     i;
+	struct lov_obd		*lov    = lov_lock_obd(slice->cls_obj);
+	struct timeval		start;
+	struct timeval		end;
+	int                     i       = 0;
 	int                     rc      = 0;
 
 	ENTRY;
 
-	for (i = 0; i < lovlck->lls_nr; ++i) {
+	do_gettimeofday(&start);
+	if (lovlck->lls_fanout) {
+		LASSERT(anchor == NULL);
+		rc = lov_lock_enqueue_fanout(env, lock, lovlck, &i);
+		if (rc != 0)
+			RETURN(rc);
+	}
+
+	for (; i < lovlck->lls_nr; ++i) {
 		struct lov_lock_sub     *lls = &lovlck->lls_sub[i];
 		struct lov_sublock_env  *subenv;
 
@@ -261,6 +471,18 @@ static int lov_lock_enqueue(const struct lu_env *env,
 
 		lls->sub_is_enqueued = 1;
 	}
+
+	if (rc == 0 && lov->lov_lock_stats != NULL) {
+		long usec;
+
+		do_gettimeofday(&end);
+		usec = cfs_timeval_sub(&end, &start, NULL);
+		lprocfs_counter_add(lov->lov_lock_stats,
+				    LOV_LOCK_STATS_ENQUEUE, usec);
+		if (lovlck->lls_fanout)
+			lprocfs_counter_add(lov->lov_lock_stats,
+					    LOV_LOCK_STATS_FANOUT, usec);
+	}
 	RETURN(rc);
 }
 
@@ -275,22 +497,9 @@ static void lov_lock_cancel(const struct lu_env *env,
 
 	for (i = 0; i < lovlck->lls_nr; ++i) {
 		struct lov_lock_sub     *lls = &lovlck->lls_sub[i];
-		struct cl_lock          *sublock = &lls->sub_lock;
-		struct lov_sublock_env  *subenv;
-
-		if (!lls->sub_is_enqueued)
-			continue;
 
-		lls->sub_is_enqueued = 0;
-		subenv = lov_sublock_env_get(env, lock, lls);
-		if (!IS_ERR(subenv)) {
-			cl_lock_cancel(subenv->lse_env, sublock);
-			lov_sublock_env_put(subenv);
-		} else {
-			CL_LOCK_DEBUG(D_ERROR, env, slice->cls_lock,
-				      "lov_lock_cancel fails with %ld.\n",
-				      PTR_ERR(subenv));
-		}
+		if (lls->sub_is_enqueued)
+			lov_sublock_cancel(env, lock, lls);
 	}
 }
 
@@ -867,6 +867,9 @@ int lov_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		if (rc)
 			CWARN("Error adding the target_obd file\n");
 
+		lov_lock_stats_init(obd);
+		lov_io_stats_init(obd);
+
 		lov->lov_pool_proc_entry = lprocfs_register("pools",
 							    obd->obd_proc_entry,
 							    NULL, NULL);
@@ -903,6 +906,10 @@ static int lov_cleanup(struct obd_device *obd)
         lov_ost_pool_free(&lov->lov_packed);
 
 	lprocfs_obd_cleanup(obd);
+	if (lov->lov_lock_stats != NULL)
+		lprocfs_free_stats(&lov->lov_lock_stats);
+	if (lov->lov_io_stats != NULL)
+		lprocfs_free_stats(&lov->lov_io_stats);
         if (lov->lov_tgts) {
                 int i;
                 obd_getref(obd);
@@ -1292,6 +1299,25 @@ static int lov_get_info(const struct lu_env *env, struct obd_export *exp,
 		*((u32 *)val) = lov_mds_md_size(def_stripe_count, LOV_MAGIC_V3);
 	} else if (KEY_IS(KEY_TGT_COUNT)) {
 		*((int *)val) = lov->desc.ld_tgt_count;
+	} else if (KEY_IS(KEY_BRW_SIZE)) {
+		/* the smallest RPC size of the active targets */
+		u32 brw_size = 0;
+		u32 i;
+
+		for (i = 0; i < ld->ld_tgt_count; i++) {
+			struct lov_tgt_desc *tgt = lov->lov_tgts[i];
+
+			if (tgt == NULL || tgt->ltd_exp == NULL ||
+			    !tgt->ltd_active)
+				continue;
+			if (brw_size == 0 ||
+			    cli_brw_size(tgt->ltd_exp->exp_obd) < brw_size)
+				brw_size = cli_brw_size(tgt->ltd_exp->exp_obd);
+		}
+		if (brw_size == 0)
+			rc = -ENODEV;
+		else
+			*((u32 *)val) = brw_size;
 	} else {
 		rc = -EINVAL;
 	}
@@ -1504,6 +1530,7 @@ static int __init lov_init(void)
 static void __exit lov_exit(void)
 {
 	class_unregister_type(LUSTRE_LOV_NAME);
+	lov_io_fanout_fini();
 	kmem_cache_destroy(lov_oinfo_slab);
 	lu_kmem_fini(lov_caches);
 }
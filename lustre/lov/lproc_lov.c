@@ -199,6 +199,42 @@ static int lov_desc_uuid_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(lov_desc_uuid);
 
+static int lov_io_fanout_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+
+	LASSERT(dev != NULL);
+	return seq_printf(m, "%u\n", dev->u.lov.lov_io_fanout);
+}
+
+static ssize_t lov_io_fanout_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	int val;
+	int rc;
+
+	LASSERT(dev != NULL);
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	/* a single stripe is always submitted by the calling thread */
+	if (val < 0 || val == 1)
+		return -ERANGE;
+
+	if (val > 0) {
+		rc = lov_io_fanout_start();
+		if (rc != 0)
+			return rc;
+	}
+
+	dev->u.lov.lov_io_fanout = val;
+	return count;
+}
+LPROC_SEQ_FOPS(lov_io_fanout);
+
 static void *lov_tgt_seq_start(struct seq_file *p, loff_t *pos)
 {
         struct obd_device *dev = p->private;
@@ -298,9 +334,64 @@ struct lprocfs_vars lprocfs_lov_obd_vars[] = {
 	  .fops	=	&lov_kbytesavail_fops	},
 	{ .name	=	"desc_uuid",
 	  .fops	=	&lov_desc_uuid_fops	},
+	{ .name	=	"io_fanout",
+	  .fops	=	&lov_io_fanout_fops	},
 	{ NULL }
 };
 
+/**
+ * Registers "lock_stats", the time taken to enqueue lov locks, in usec, and
+ * the number of sub-locks taken in order after a parallel enqueue conflicted.
+ */
+void lov_lock_stats_init(struct obd_device *obd)
+{
+	struct lov_obd		*lov = &obd->u.lov;
+	struct lprocfs_stats	*stats;
+
+	stats = lprocfs_alloc_stats(LOV_LOCK_STATS_LAST, 0);
+	if (stats == NULL)
+		return;
+
+	lprocfs_counter_init(stats, LOV_LOCK_STATS_ENQUEUE,
+			     LPROCFS_CNTR_AVGMINMAX, "lock_enqueue", "usec");
+	lprocfs_counter_init(stats, LOV_LOCK_STATS_FANOUT,
+			     LPROCFS_CNTR_AVGMINMAX, "lock_fanout", "usec");
+	lprocfs_counter_init(stats, LOV_LOCK_STATS_ORDERED,
+			     LPROCFS_CNTR_AVGMINMAX, "sublock_ordered", "locks");
+	if (lprocfs_register_stats(obd->obd_proc_entry, "lock_stats",
+				   stats) != 0) {
+		CWARN("%s: cannot register lock_stats\n", obd->obd_name);
+		lprocfs_free_stats(&stats);
+		return;
+	}
+	lov->lov_lock_stats = stats;
+}
+
+/**
+ * Registers "io_stats", the number of stripes of each page submission
+ * handed to the lov_io workers.
+ */
+void lov_io_stats_init(struct obd_device *obd)
+{
+	struct lov_obd		*lov = &obd->u.lov;
+	struct lprocfs_stats	*stats;
+
+	stats = lprocfs_alloc_stats(LOV_IO_STATS_LAST, 0);
+	if (stats == NULL)
+		return;
+
+	lprocfs_counter_init(stats, LOV_IO_STATS_SUBMIT_FANOUT,
+			     LPROCFS_CNTR_AVGMINMAX, "submit_fanout",
+			     "stripes");
+	if (lprocfs_register_stats(obd->obd_proc_entry, "io_stats",
+				   stats) != 0) {
+		CWARN("%s: cannot register io_stats\n", obd->obd_name);
+		lprocfs_free_stats(&stats);
+		return;
+	}
+	lov->lov_io_stats = stats;
+}
+
 struct file_operations lov_proc_target_fops = {
         .owner   = THIS_MODULE,
         .open    = lov_target_seq_open,
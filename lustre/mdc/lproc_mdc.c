@@ -171,6 +171,42 @@ static ssize_t mdc_rpc_stats_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(mdc_rpc_stats);
 
+static int mdc_readdir_ahead_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	seq_printf(m, "enabled: %d\n", cli->cl_readdir_ahead);
+	seq_printf(m, "rpcs: %d\n", atomic_read(&cli->cl_readdir_ra_rpcs));
+	seq_printf(m, "in_flight: %d\n",
+		   atomic_read(&cli->cl_readdir_in_flight));
+	return seq_printf(m, "hits: %d\n",
+			  atomic_read(&cli->cl_readdir_ra_hits));
+}
+
+/* writing 0 or 1 disables or enables readahead and clears the counters */
+static ssize_t mdc_readdir_ahead_seq_write(struct file *file,
+					   const char __user *buffer,
+					   size_t count, loff_t *off)
+{
+	struct obd_device *dev;
+	int val, rc;
+
+	dev = ((struct seq_file *)file->private_data)->private;
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+	if (val < 0 || val > 1)
+		return -ERANGE;
+
+	dev->u.cli.cl_readdir_ahead = val;
+	atomic_set(&dev->u.cli.cl_readdir_ra_rpcs, 0);
+	atomic_set(&dev->u.cli.cl_readdir_ra_hits, 0);
+
+	return count;
+}
+LPROC_SEQ_FOPS(mdc_readdir_ahead);
+
 
 LPROC_SEQ_FOPS_WO_TYPE(mdc, ping);
 
@@ -244,6 +280,8 @@ struct lprocfs_vars lprocfs_mdc_obd_vars[] = {
 	  .fops	=	&mdc_rpc_stats_fops		},
 	{ .name	=	"active",
 	  .fops	=	&mdc_active_fops		},
+	{ .name	=	"readdir_ahead",
+	  .fops	=	&mdc_readdir_ahead_fops		},
 	{ NULL }
 };
 #endif /* CONFIG_PROC_FS */
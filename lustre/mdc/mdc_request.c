@@ -840,31 +840,24 @@ static int mdc_close(struct obd_export *exp, struct md_op_data *op_data,
 	RETURN(rc < 0 ? rc : saved_rc);
 }
 
-static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
-		       u64 offset, struct page **pages, int npages,
-		       struct ptlrpc_request **request)
+static struct ptlrpc_request *mdc_getpage_prep(struct obd_export *exp,
+						const struct lu_fid *fid,
+						u64 offset, struct page **pages,
+						int npages)
 {
 	struct ptlrpc_request   *req;
 	struct ptlrpc_bulk_desc *desc;
 	int                      i;
-	wait_queue_head_t        waitq;
-	int                      resends = 0;
-	struct l_wait_info       lwi;
 	int                      rc;
-	ENTRY;
-
-	*request = NULL;
-	init_waitqueue_head(&waitq);
 
-restart_bulk:
 	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_MDS_READPAGE);
 	if (req == NULL)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_READPAGE);
 	if (rc) {
 		ptlrpc_request_free(req);
-		RETURN(rc);
+		return ERR_PTR(rc);
 	}
 
 	req->rq_request_portal = MDS_READPAGE_PORTAL;
@@ -876,7 +869,7 @@ restart_bulk:
 				    &ptlrpc_bulk_kiov_pin_ops);
 	if (desc == NULL) {
 		ptlrpc_request_free(req);
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 	}
 
 	/* NB req now owns desc and will free it when it gets freed */
@@ -887,7 +880,52 @@ restart_bulk:
 	mdc_readdir_pack(req, offset, PAGE_CACHE_SIZE * npages, fid);
 
 	ptlrpc_request_set_replen(req);
+
+	return req;
+}
+
+static int mdc_getpage_check(struct obd_export *exp,
+			     struct ptlrpc_request *req, int npages)
+{
+	int rc;
+
+	rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk,
+					  req->rq_bulk->bd_nob_transferred);
+	if (rc < 0)
+		return rc;
+
+	if (req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK) {
+		CERROR("%s: unexpected bytes transferred: %d (%ld expected)\n",
+		       exp->exp_obd->obd_name, req->rq_bulk->bd_nob_transferred,
+		       PAGE_CACHE_SIZE * npages);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
+		       u64 offset, struct page **pages, int npages,
+		       struct ptlrpc_request **request)
+{
+	struct ptlrpc_request   *req;
+	wait_queue_head_t        waitq;
+	int                      resends = 0;
+	struct l_wait_info       lwi;
+	int                      rc;
+	ENTRY;
+
+	*request = NULL;
+	init_waitqueue_head(&waitq);
+
+restart_bulk:
+	req = mdc_getpage_prep(exp, fid, offset, pages, npages);
+	if (IS_ERR(req))
+		RETURN(PTR_ERR(req));
+
+	atomic_inc(&exp->exp_obd->u.cli.cl_readdir_in_flight);
 	rc = ptlrpc_queue_wait(req);
+	atomic_dec(&exp->exp_obd->u.cli.cl_readdir_in_flight);
 	if (rc) {
 		ptlrpc_req_finished(req);
 		if (rc != -ETIMEDOUT)
@@ -906,21 +944,12 @@ restart_bulk:
 		goto restart_bulk;
 	}
 
-	rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk,
-					  req->rq_bulk->bd_nob_transferred);
+	rc = mdc_getpage_check(exp, req, npages);
 	if (rc < 0) {
 		ptlrpc_req_finished(req);
 		RETURN(rc);
 	}
 
-	if (req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK) {
-		CERROR("%s: unexpected bytes transferred: %d (%ld expected)\n",
-		       exp->exp_obd->obd_name, req->rq_bulk->bd_nob_transferred,
-		       PAGE_CACHE_SIZE * npages);
-		ptlrpc_req_finished(req);
-		RETURN(-EPROTO);
-	}
-
 	*request = req;
 	RETURN(0);
 }
@@ -961,8 +990,8 @@ static struct page *mdc_page_locate(struct address_space *mapping, __u64 *hash,
 		 * page cannot be truncated (while DLM lock is held) and,
 		 * hence, can avoid restart.
 		 *
-		 * In fact, page cannot be locked here at all, because
-		 * mdc_read_page_remote does synchronous io.
+		 * The page can only be locked while it is being read by
+		 * mdc_read_page_remote() or by readahead.
 		 */
 		wait_on_page_locked(page);
 		if (PageUptodate(page)) {
@@ -999,6 +1028,11 @@ static struct page *mdc_page_locate(struct address_space *mapping, __u64 *hash,
 				    le32_to_cpu(dp->ldp_flags) & LDF_COLLIDE);
 				page = NULL;
 			}
+		} else if (page->mapping == NULL) {
+			/* the read failed and the page was removed from
+			 * the cache, read it again */
+			page_cache_release(page);
+			page = NULL;
 		} else {
 			page_cache_release(page);
 			page = ERR_PTR(-EIO);
@@ -1120,8 +1154,67 @@ struct readpage_param {
 	int			rp_hash64;
 	struct obd_export	*rp_exp;
 	struct md_callback	*rp_cb;
+	/* where readahead should continue, MDS_DIR_END_OFF if not needed */
+	__u64			rp_ra_off;
+};
+
+/* parameters for readdir readahead RPC */
+struct mdc_readahead_args {
+	struct obd_export	*mra_exp;
+	struct inode		*mra_inode;
+	struct page		**mra_pages;
+	int			 mra_npages;
+	int			 mra_max_pages;
+	int			 mra_hash64;
+	struct lustre_handle	 mra_lockh;
+	enum ldlm_mode		 mra_mode;
+};
+
+/* parameters for the lock enqueue of a readdir prefetch */
+struct mdc_prefetch_args {
+	struct obd_export	*mpa_exp;
+	struct inode		*mpa_inode;
+	struct lu_fid		 mpa_fid;
+	__u64			 mpa_offset;
+	int			 mpa_hash64;
+	int			 mpa_max_pages;
+	struct lustre_handle	 mpa_lockh;
+	enum ldlm_mode		 mpa_mode;
 };
 
+/**
+ * Mark the first page of a window read ahead.
+ *
+ * PG_readahead tells the reader getting to \a page that the window is in
+ * the page cache and the next one should be read ahead, page private holds
+ * the index of the last page of the window. The page is still locked, so
+ * readers only see both once it is unlocked.
+ */
+static inline void mdc_page_ra_mark(struct page *page, pgoff_t last)
+{
+	set_page_private(page, last);
+	SetPageReadahead(page);
+}
+
+/**
+ * Claim the readahead mark of \a page set by mdc_page_ra_mark().
+ *
+ * \param[in] page	directory page the reader got to
+ * \param[out] last	index of the last page of the window
+ *
+ * \retval true		\a page was marked, only one reader gets this
+ * \retval false	\a page was not marked
+ */
+static inline bool mdc_page_ra_claim(struct page *page, pgoff_t *last)
+{
+	if (!test_and_clear_bit(PG_readahead, &page->flags))
+		return false;
+
+	*last = page_private(page);
+	set_page_private(page, 0);
+	return true;
+}
+
 #ifndef HAVE_DELETE_FROM_PAGE_CACHE
 static inline void delete_from_page_cache(struct page *page)
 {
@@ -1130,6 +1223,98 @@ static inline void delete_from_page_cache(struct page *page)
 }
 #endif
 
+/**
+ * Add pages read by MDS_READPAGE into the directory page cache.
+ *
+ * The first page was added to the page cache and locked before the RPC was
+ * sent, so concurrent readers wait for it. Other pages are added at the
+ * index of their start hash once the reply is in.
+ *
+ * \param[in] inode	directory inode
+ * \param[in] pages	pages the RPC was sent with
+ * \param[in] npages	number of \a pages
+ * \param[in] req	finished readpage request
+ * \param[in] hash64	whether 64-bit hashes are used
+ * \param[in] rc	result of the RPC
+ * \param[in] mark	mark the first page to trigger readahead of the next
+ *			pages once the reader gets to it
+ * \param[out] end	end hash of the last page read, MDS_DIR_END_OFF if
+ *			the end of the directory was reached or on error
+ */
+static void mdc_readpage_finish(struct inode *inode, struct page **pages,
+				int npages, struct ptlrpc_request *req,
+				int hash64, int rc, bool mark, __u64 *end)
+{
+	struct page		*page0 = pages[0];
+	struct page		*page;
+	struct lu_dirpage	*dp;
+	int			 rd_pgs = 0; /* number of pages read actually */
+	int			 i;
+
+	*end = MDS_DIR_END_OFF;
+	if (rc < 0) {
+		/* page0 is special, which was added into page cache early */
+		delete_from_page_cache(page0);
+	} else {
+		int lu_pgs;
+
+		rd_pgs = (req->rq_bulk->bd_nob_transferred +
+			    PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+		lu_pgs = req->rq_bulk->bd_nob_transferred >>
+							LU_PAGE_SHIFT;
+		LASSERT(!(req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK));
+
+		CDEBUG(D_INODE, "read %d(%d) pages\n", rd_pgs, lu_pgs);
+
+		mdc_adjust_dirpages(pages, rd_pgs, lu_pgs);
+
+		if (rd_pgs > 0) {
+			dp = kmap(pages[rd_pgs - 1]);
+			*end = le64_to_cpu(dp->ldp_hash_end);
+			if (mark && *end != MDS_DIR_END_OFF)
+				mdc_page_ra_mark(page0, hash_x_index(
+					le64_to_cpu(dp->ldp_hash_start),
+					hash64));
+			kunmap(pages[rd_pgs - 1]);
+		}
+
+		SetPageUptodate(page0);
+	}
+	unlock_page(page0);
+
+	CDEBUG(D_CACHE, "read %d/%d pages\n", rd_pgs, npages);
+	for (i = 1; i < npages; i++) {
+		unsigned long	offset;
+		__u64		hash;
+		int ret;
+
+		page = pages[i];
+
+		if (rc < 0 || i >= rd_pgs) {
+			page_cache_release(page);
+			continue;
+		}
+
+		SetPageUptodate(page);
+
+		dp = kmap(page);
+		hash = le64_to_cpu(dp->ldp_hash_start);
+		kunmap(page);
+
+		offset = hash_x_index(hash, hash64);
+
+		prefetchw(&page->flags);
+		ret = add_to_page_cache_lru(page, inode->i_mapping, offset,
+					    GFP_KERNEL);
+		if (ret == 0)
+			unlock_page(page);
+		else
+			CDEBUG(D_VFSTRACE, "page %lu add to page cache failed:"
+			       " rc = %d\n", offset, ret);
+		page_cache_release(page);
+	}
+}
+
 /**
  * Read pages from server.
  *
@@ -1145,15 +1330,12 @@ static int mdc_read_page_remote(void *data, struct page *page0)
 	struct readpage_param	*rp = data;
 	struct page		**page_pool;
 	struct page		*page;
-	struct lu_dirpage	*dp;
-	int			rd_pgs = 0; /* number of pages read actually */
 	int			npages;
 	struct md_op_data	*op_data = rp->rp_mod;
 	struct ptlrpc_request	*req;
 	int			max_pages = op_data->op_max_pages;
 	struct inode		*inode;
 	struct lu_fid		*fid;
-	int			i;
 	int			rc;
 	ENTRY;
 
@@ -1178,63 +1360,314 @@ static int mdc_read_page_remote(void *data, struct page *page0)
 	}
 
 	rc = mdc_getpage(rp->rp_exp, fid, rp->rp_off, page_pool, npages, &req);
-	if (rc < 0) {
-		/* page0 is special, which was added into page cache early */
-		delete_from_page_cache(page0);
-	} else {
-		int lu_pgs;
+	mdc_readpage_finish(inode, page_pool, npages, req, rp->rp_hash64, rc,
+			    false, &rp->rp_ra_off);
+	ptlrpc_req_finished(req);
 
-		rd_pgs = (req->rq_bulk->bd_nob_transferred +
-			    PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
-		lu_pgs = req->rq_bulk->bd_nob_transferred >>
-							LU_PAGE_SHIFT;
-		LASSERT(!(req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK));
+	if (page_pool != &page0)
+		OBD_FREE(page_pool, sizeof(page_pool[0]) * max_pages);
 
-		CDEBUG(D_INODE, "read %d(%d) pages\n", rd_pgs, lu_pgs);
+	RETURN(rc);
+}
 
-		mdc_adjust_dirpages(page_pool, rd_pgs, lu_pgs);
+static int mdc_read_page_ahead_interpret(const struct lu_env *env,
+					 struct ptlrpc_request *req,
+					 void *args, int rc)
+{
+	struct mdc_readahead_args	*aa = args;
+	struct page			*page0 = aa->mra_pages[0];
+	__u64				 end;
 
-		SetPageUptodate(page0);
-	}
-	unlock_page(page0);
+	if (rc == 0)
+		rc = mdc_getpage_check(aa->mra_exp, req, aa->mra_npages);
 
-	ptlrpc_req_finished(req);
-	CDEBUG(D_CACHE, "read %d/%d pages\n", rd_pgs, npages);
-	for (i = 1; i < npages; i++) {
-		unsigned long	offset;
-		__u64		hash;
-		int ret;
+	/* when the reader gets to this window, read ahead the next one */
+	mdc_readpage_finish(aa->mra_inode, aa->mra_pages, aa->mra_npages, req,
+			    aa->mra_hash64, rc, true, &end);
 
-		page = page_pool[i];
+	page_cache_release(page0);
+	ldlm_lock_decref(&aa->mra_lockh, aa->mra_mode);
+	iput(aa->mra_inode);
+	atomic_dec(&aa->mra_exp->exp_obd->u.cli.cl_readdir_in_flight);
+	class_export_put(aa->mra_exp);
+	OBD_FREE(aa->mra_pages, sizeof(aa->mra_pages[0]) * aa->mra_max_pages);
 
-		if (rc < 0 || i >= rd_pgs) {
-			page_cache_release(page);
-			continue;
-		}
+	return 0;
+}
 
-		SetPageUptodate(page);
+/**
+ * Find where readahead should continue after a window read ahead.
+ *
+ * \param[in] mapping	directory page cache
+ * \param[in] last	index of the last page of the window
+ *
+ * \retval		end hash of the window, MDS_DIR_END_OFF if unknown
+ */
+static __u64 mdc_read_page_ahead_offset(struct address_space *mapping,
+					pgoff_t last)
+{
+	struct lu_dirpage	*dp;
+	struct page		*page;
+	__u64			 end = MDS_DIR_END_OFF;
+
+	page = find_get_page(mapping, last);
+	if (page == NULL)
+		return end;
 
+	if (PageUptodate(page)) {
 		dp = kmap(page);
-		hash = le64_to_cpu(dp->ldp_hash_start);
+		end = le64_to_cpu(dp->ldp_hash_end);
 		kunmap(page);
+	}
+	page_cache_release(page);
 
-		offset = hash_x_index(hash, rp->rp_hash64);
+	return end;
+}
 
-		prefetchw(&page->flags);
-		ret = add_to_page_cache_lru(page, inode->i_mapping, offset,
-					    GFP_KERNEL);
-		if (ret == 0)
-			unlock_page(page);
-		else
-			CDEBUG(D_VFSTRACE, "page %lu add to page cache failed:"
-			       " rc = %d\n", offset, ret);
+/**
+ * Read directory pages ahead of the reader.
+ *
+ * Sends MDS_READPAGE for the pages starting at \a offset without waiting
+ * for the reply, so the next pages are in flight while the caller walks
+ * the current ones. The first page of the window is added to the page
+ * cache and locked first, so a reader catching up waits for the RPC
+ * instead of sending its own. A reference on the DLM lock protecting the
+ * pages is held until they are added to the page cache.
+ *
+ * \param[in] exp	MDC export
+ * \param[in] inode	directory inode
+ * \param[in] fid	FID of \a inode
+ * \param[in] hash64	whether 64-bit hashes are used
+ * \param[in] max_pages	maximum number of pages to read
+ * \param[in] lockh	DLM lock the pages are read under
+ * \param[in] mode	mode of \a lockh
+ * \param[in] offset	hash offset to read from
+ */
+static void mdc_read_page_ahead(struct obd_export *exp, struct inode *inode,
+				const struct lu_fid *fid, int hash64,
+				int max_pages, struct lustre_handle *lockh,
+				enum ldlm_mode mode, __u64 offset)
+{
+	struct client_obd		*cli = &exp->exp_obd->u.cli;
+	struct address_space		*mapping = inode->i_mapping;
+	struct mdc_readahead_args	*aa;
+	struct ptlrpc_request		*req;
+	struct page			**pages;
+	struct page			*page;
+	int				 npages;
+	__u64				 end;
+	int				 rc;
+	ENTRY;
+
+	if (!cli->cl_readdir_ahead || offset == MDS_DIR_END_OFF)
+		RETURN_EXIT;
+
+	/* don't compete with the reader for RPC slots */
+	if (atomic_read(&cli->cl_readdir_in_flight) >=
+	    cli->cl_max_rpcs_in_flight)
+		RETURN_EXIT;
+
+	OBD_ALLOC(pages, sizeof(pages[0]) * max_pages);
+	if (pages == NULL)
+		RETURN_EXIT;
+
+	page = page_cache_alloc_cold(mapping);
+	if (page == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	/* somebody else is reading this window already */
+	rc = add_to_page_cache_lru(page, mapping,
+				   hash_x_index(offset, hash64), GFP_KERNEL);
+	if (rc != 0) {
 		page_cache_release(page);
+		GOTO(out_free, rc);
 	}
+	pages[0] = page;
 
-	if (page_pool != &page0)
-		OBD_FREE(page_pool, sizeof(page_pool[0]) * max_pages);
+	for (npages = 1; npages < max_pages; npages++) {
+		page = page_cache_alloc_cold(mapping);
+		if (page == NULL)
+			break;
+		pages[npages] = page;
+	}
 
-	RETURN(rc);
+	req = mdc_getpage_prep(exp, fid, offset, pages, npages);
+	if (IS_ERR(req)) {
+		mdc_readpage_finish(inode, pages, npages, NULL, hash64,
+				    PTR_ERR(req), false, &end);
+		page_cache_release(pages[0]);
+		GOTO(out_free, rc = PTR_ERR(req));
+	}
+	req->rq_no_resend = req->rq_no_delay = 1;
+
+	CLASSERT(sizeof(*aa) <= sizeof(req->rq_async_args));
+	aa = ptlrpc_req_async_args(req);
+	aa->mra_exp = class_export_get(exp);
+	aa->mra_inode = igrab(inode);
+	aa->mra_pages = pages;
+	aa->mra_npages = npages;
+	aa->mra_max_pages = max_pages;
+	aa->mra_hash64 = hash64;
+	aa->mra_lockh = *lockh;
+	aa->mra_mode = mode;
+	ldlm_lock_addref(lockh, mode);
+
+	atomic_inc(&cli->cl_readdir_ra_rpcs);
+	atomic_inc(&cli->cl_readdir_in_flight);
+	req->rq_interpret_reply = mdc_read_page_ahead_interpret;
+	ptlrpcd_add_req(req);
+	RETURN_EXIT;
+
+out_free:
+	OBD_FREE(pages, sizeof(pages[0]) * max_pages);
+	EXIT;
+}
+
+static int mdc_read_page_prefetch_interpret(const struct lu_env *env,
+					    struct ptlrpc_request *req,
+					    void *args, int rc)
+{
+	struct mdc_prefetch_args	*pa = args;
+	struct obd_export		*exp = pa->mpa_exp;
+	struct ldlm_lock		*lock;
+	__u64				 flags = 0;
+	bool				 granted = false;
+
+	atomic_dec(&exp->exp_obd->u.cli.cl_readdir_in_flight);
+	rc = ldlm_cli_enqueue_fini(exp, req, LDLM_IBITS, 1, pa->mpa_mode,
+				   &flags, NULL, 0, &pa->mpa_lockh, rc);
+	if (rc < 0) {
+		CDEBUG(D_INODE, "%s: "DFID" prefetch enqueue: rc = %d\n",
+		       exp->exp_obd->obd_name, PFID(&pa->mpa_fid), rc);
+		GOTO(out, rc);
+	}
+
+	mdc_set_lock_data(exp, &pa->mpa_lockh.cookie, pa->mpa_inode, NULL);
+	lock = ldlm_handle2lock(&pa->mpa_lockh);
+	if (lock != NULL) {
+		granted = lock->l_granted_mode == lock->l_req_mode;
+		LDLM_LOCK_PUT(lock);
+	}
+
+	/* a conflicting lock is being revoked, leave the stripe to the
+	 * reader rather than wait for it here */
+	if (granted)
+		mdc_read_page_ahead(exp, pa->mpa_inode, &pa->mpa_fid,
+				    pa->mpa_hash64, pa->mpa_max_pages,
+				    &pa->mpa_lockh, pa->mpa_mode,
+				    pa->mpa_offset);
+	ldlm_lock_decref(&pa->mpa_lockh, pa->mpa_mode);
+	EXIT;
+out:
+	iput(pa->mpa_inode);
+	class_export_put(exp);
+	return 0;
+}
+
+/**
+ * Start reading the directory page at \a offset without waiting.
+ *
+ * Used by LMV to send the reads of all stripes of a striped directory at
+ * once. If the UPDATE lock is cached the pages are read ahead under it
+ * right away, otherwise the lock is enqueued through ptlrpcd and the pages
+ * are read ahead once it is granted, so a cold cache does not serialize
+ * the stripes on their lock enqueues. Like readahead, nothing is sent if
+ * the readdir RPCs in flight are at the limit already.
+ *
+ * \param[in] exp	MDC export
+ * \param[in] op_data	client MD stack parameters
+ * \param[in] cb_op	callback for the lock enqueue
+ * \param[in] offset	hash offset of the page to read
+ *
+ * \retval 0		reading started, or not needed
+ * \retval negative	errno if the lock could not be enqueued
+ */
+static int mdc_read_page_prefetch(struct obd_export *exp,
+				  struct md_op_data *op_data,
+				  struct md_callback *cb_op, __u64 offset)
+{
+	struct ldlm_enqueue_info einfo = {
+		.ei_type	= LDLM_IBITS,
+		.ei_mode	= LCK_CR,
+		.ei_cb_bl	= cb_op->md_blocking_ast,
+		.ei_cb_cp	= ldlm_completion_ast_async,
+	};
+	union ldlm_policy_data	 policy = {
+		.l_inodebits = { MDS_INODELOCK_UPDATE } };
+	struct client_obd	*cli = &exp->exp_obd->u.cli;
+	struct inode		*dir = op_data->op_data;
+	int			 hash64 = op_data->op_cli_flags & CLI_HASH64;
+	struct mdc_prefetch_args *pa;
+	struct ptlrpc_request	*req;
+	struct lustre_handle	 lockh;
+	struct ldlm_res_id	 res_id;
+	struct page		*page;
+	enum ldlm_mode		 mode;
+	__u64			 hash = offset;
+	__u64			 start = 0;
+	__u64			 end = 0;
+	__u64			 flags = 0;
+	int			 rc = 0;
+	ENTRY;
+
+	if (!cli->cl_readdir_ahead)
+		RETURN(0);
+
+	mode = mdc_lock_match(exp, LDLM_FL_BLOCK_GRANTED, &op_data->op_fid1,
+			      LDLM_IBITS, &policy,
+			      LCK_CR | LCK_CW | LCK_PR | LCK_PW, &lockh);
+	if (mode != 0) {
+		mdc_set_lock_data(exp, &lockh.cookie, dir, NULL);
+		/* only start reading the page if it is not cached yet */
+		page = mdc_page_locate(dir->i_mapping, &hash, &start, &end,
+				       hash64);
+		if (IS_ERR(page)) {
+			rc = PTR_ERR(page);
+		} else if (page != NULL) {
+			kunmap(page);
+			mdc_release_page(page, 0);
+		} else {
+			mdc_read_page_ahead(exp, dir, &op_data->op_fid1,
+					    hash64, op_data->op_max_pages,
+					    &lockh, mode, offset);
+		}
+		ldlm_lock_decref(&lockh, mode);
+		RETURN(rc);
+	}
+
+	/* the enqueue counts as a readdir RPC, see mdc_read_page_ahead() */
+	if (atomic_read(&cli->cl_readdir_in_flight) >=
+	    cli->cl_max_rpcs_in_flight)
+		RETURN(0);
+
+	req = ldlm_enqueue_pack(exp, 0);
+	if (IS_ERR(req))
+		RETURN(PTR_ERR(req));
+
+	fid_build_reg_res_name(&op_data->op_fid1, &res_id);
+	rc = ldlm_cli_enqueue(exp, &req, &einfo, &res_id, &policy, &flags,
+			      NULL, 0, LVB_T_NONE, &lockh, 1);
+	if (rc < 0) {
+		ptlrpc_req_finished(req);
+		RETURN(rc);
+	}
+
+	CLASSERT(sizeof(*pa) <= sizeof(req->rq_async_args));
+	pa = ptlrpc_req_async_args(req);
+	pa->mpa_exp = class_export_get(exp);
+	pa->mpa_inode = igrab(dir);
+	pa->mpa_fid = op_data->op_fid1;
+	pa->mpa_offset = offset;
+	pa->mpa_hash64 = hash64;
+	pa->mpa_max_pages = op_data->op_max_pages;
+	pa->mpa_lockh = lockh;
+	pa->mpa_mode = einfo.ei_mode;
+
+	atomic_inc(&cli->cl_readdir_in_flight);
+	req->rq_interpret_reply = mdc_read_page_prefetch_interpret;
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
 }
 
 /**
@@ -1266,6 +1699,7 @@ static int mdc_read_page(struct obd_export *exp, struct md_op_data *op_data,
 	struct lustre_handle	lockh;
 	struct ptlrpc_request	*enq_req = NULL;
 	struct readpage_param	rp_param;
+	pgoff_t			last;
 	int rc;
 
 	ENTRY;
@@ -1275,6 +1709,10 @@ static int mdc_read_page(struct obd_export *exp, struct md_op_data *op_data,
 	LASSERT(dir != NULL);
 	mapping = dir->i_mapping;
 
+	if (op_data->op_cli_flags & CLI_PREFETCH)
+		RETURN(mdc_read_page_prefetch(exp, op_data, cb_op,
+					      hash_offset));
+
 	rc = mdc_intent_lock(exp, op_data, &it, &enq_req,
 			     cb_op->md_blocking_ast, 0);
 	if (enq_req != NULL)
@@ -1291,6 +1729,8 @@ static int mdc_read_page(struct obd_export *exp, struct md_op_data *op_data,
 
 	rp_param.rp_off = hash_offset;
 	rp_param.rp_hash64 = op_data->op_cli_flags & CLI_HASH64;
+	rp_param.rp_ra_off = MDS_DIR_END_OFF;
+	lockh.cookie = it.d.lustre.it_lock_handle;
 	page = mdc_page_locate(mapping, &rp_param.rp_off, &start, &end,
 			       rp_param.rp_hash64);
 	if (IS_ERR(page)) {
@@ -1374,8 +1814,18 @@ hash_collision:
 		goto fail;
 	}
 	*ppage = page;
+
+	/* the reader got to pages read ahead, read ahead the next ones */
+	if (mdc_page_ra_claim(page, &last)) {
+		atomic_inc(&exp->exp_obd->u.cli.cl_readdir_ra_hits);
+		rp_param.rp_ra_off = mdc_read_page_ahead_offset(mapping, last);
+	}
+	if (rp_param.rp_ra_off != MDS_DIR_END_OFF)
+		mdc_read_page_ahead(exp, dir, &op_data->op_fid1,
+				    rp_param.rp_hash64, op_data->op_max_pages,
+				    &lockh, it.d.lustre.it_lock_mode,
+				    rp_param.rp_ra_off);
 out_unlock:
-	lockh.cookie = it.d.lustre.it_lock_handle;
 	ldlm_lock_decref(&lockh, it.d.lustre.it_lock_mode);
 	it.d.lustre.it_lock_handle = 0;
 	return rc;
@@ -1767,6 +2217,9 @@ out:
 	return rc;
 }
 
+/* records are sent to the reader in batches of up to this size */
+#define MDC_CHANGELOG_BATCH_SIZE	(64 << 10)
+
 static struct kuc_hdr *changelog_kuc_hdr(char *buf, size_t len, __u32 flags)
 {
 	struct kuc_hdr *lh = (struct kuc_hdr *)buf;
@@ -1786,7 +2239,13 @@ struct changelog_show {
 	enum changelog_send_flag	 cs_flags;
 	struct file			*cs_fp;
 	char				*cs_buf;
+	/* bytes of records in cs_buf not sent yet */
+	size_t				 cs_len;
 	struct obd_device		*cs_obd;
+	struct changelog_filter		 cs_filter;
+	/* last record processed and catalog index of its llog */
+	__u64				 cs_recno;
+	int				 cs_catidx;
 };
 
 static inline char *cs_obd_name(struct changelog_show *cs)
@@ -1794,6 +2253,54 @@ static inline char *cs_obd_name(struct changelog_show *cs)
 	return cs->cs_obd->obd_name;
 }
 
+static int changelog_flush(struct changelog_show *cs)
+{
+	int rc = 0;
+
+	if (cs->cs_len > 0)
+		rc = libcfs_kkuc_batch_put(cs->cs_fp, cs->cs_buf, cs->cs_len);
+	cs->cs_len = 0;
+
+	return rc;
+}
+
+/**
+ * Check a changelog record against the reader's filter
+ *
+ * \param[in] cs	changelog reader
+ * \param[in] rec	changelog record
+ *
+ * \retval		true if the record should be sent to the reader
+ */
+static bool changelog_filter_match(struct changelog_show *cs,
+				   struct changelog_rec *rec)
+{
+	struct changelog_filter		*cf = &cs->cs_filter;
+	struct changelog_ext_rename	*rnm;
+
+	if (cf->cf_mask != 0 && !(cf->cf_mask & (1 << rec->cr_type)))
+		return false;
+
+	if (cf->cf_jobid[0] != '\0' &&
+	    (!(rec->cr_flags & CLF_JOBID) ||
+	     strncmp(changelog_rec_jobid(rec)->cr_jobid, cf->cf_jobid,
+		     sizeof(cf->cf_jobid)) != 0))
+		return false;
+
+	if (fid_is_zero(&cf->cf_fid) || lu_fid_eq(&cf->cf_fid, &rec->cr_tfid) ||
+	    lu_fid_eq(&cf->cf_fid, &rec->cr_pfid))
+		return true;
+
+	if (rec->cr_flags & CLF_RENAME) {
+		rnm = changelog_rec_rename(rec);
+		if (lu_fid_eq(&cf->cf_fid, &rnm->cr_sfid) ||
+		    lu_fid_eq(&cf->cf_fid, &rnm->cr_spfid))
+			return true;
+	}
+
+	return false;
+}
+
 static int changelog_kkuc_cb(const struct lu_env *env, struct llog_handle *llh,
 			     struct llog_rec_hdr *hdr, void *data)
 {
@@ -1819,6 +2326,11 @@ static int changelog_kkuc_cb(const struct lu_env *env, struct llog_handle *llh,
 		RETURN(0);
 	}
 
+	cs->cs_recno = rec->cr.cr_index;
+	cs->cs_catidx = llh->u.phd.phd_cookie.lgc_index;
+	if (!changelog_filter_match(cs, &rec->cr))
+		RETURN(0);
+
 	CDEBUG(D_HSM, LPU64" %02d%-5s "LPU64" 0x%x t="DFID" p="DFID" %.*s\n",
 	       rec->cr.cr_index, rec->cr.cr_type,
 	       changelog_type2str(rec->cr.cr_type), rec->cr.cr_time,
@@ -1828,29 +2340,38 @@ static int changelog_kkuc_cb(const struct lu_env *env, struct llog_handle *llh,
 
 	len = sizeof(*lh) + changelog_rec_size(&rec->cr) + rec->cr.cr_namelen;
 
-        /* Set up the message */
-        lh = changelog_kuc_hdr(cs->cs_buf, len, cs->cs_flags);
-        memcpy(lh + 1, &rec->cr, len - sizeof(*lh));
+	if (cs->cs_len + len > MDC_CHANGELOG_BATCH_SIZE) {
+		rc = changelog_flush(cs);
+		CDEBUG(D_HSM, "kucmsg fp %p rc %d\n", cs->cs_fp, rc);
+		if (rc < 0)
+			RETURN(rc);
+	}
 
-        rc = libcfs_kkuc_msg_put(cs->cs_fp, lh);
-	CDEBUG(D_HSM, "kucmsg fp %p len %zu rc %d\n", cs->cs_fp, len, rc);
+	/* Set up the message */
+	lh = changelog_kuc_hdr(cs->cs_buf + cs->cs_len, len, cs->cs_flags);
+	memcpy(lh + 1, &rec->cr, len - sizeof(*lh));
+	cs->cs_len += len;
 
-        RETURN(rc);
+	RETURN(0);
 }
 
 static int mdc_changelog_send_thread(void *csdata)
 {
 	struct changelog_show	*cs = csdata;
+	struct client_obd	*cli = &cs->cs_obd->u.cli;
 	struct llog_ctxt	*ctxt = NULL;
 	struct llog_handle	*llh = NULL;
+	struct llog_log_hdr	*hdr;
 	struct kuc_hdr		*kuch;
 	enum llog_flag		 flags = LLOG_F_IS_CAT;
+	int			 startcat = 0;
 	int			 rc;
+	int			 rc2;
 
 	CDEBUG(D_HSM, "changelog to fp=%p start "LPU64"\n",
 	       cs->cs_fp, cs->cs_startrec);
 
-	OBD_ALLOC(cs->cs_buf, KUC_CHANGELOG_MSG_MAXSIZE);
+	OBD_ALLOC_LARGE(cs->cs_buf, MDC_CHANGELOG_BATCH_SIZE);
 	if (cs->cs_buf == NULL)
 		GOTO(out, rc = -ENOMEM);
 
@@ -1866,7 +2387,9 @@ static int mdc_changelog_send_thread(void *csdata)
 		GOTO(out, rc);
 	}
 
-	if (cs->cs_flags & CHANGELOG_FLAG_JOBID)
+	/* the jobid is needed to filter on it */
+	if (cs->cs_flags & CHANGELOG_FLAG_JOBID ||
+	    cs->cs_filter.cf_jobid[0] != '\0')
 		flags |= LLOG_F_EXT_JOBID;
 
 	rc = llog_init_handle(NULL, llh, flags, NULL);
@@ -1875,7 +2398,35 @@ static int mdc_changelog_send_thread(void *csdata)
 		GOTO(out, rc);
 	}
 
-	rc = llog_cat_process(NULL, llh, changelog_kkuc_cb, cs, 0, 0);
+	/* Start from the llog holding the last record seen by a previous
+	 * reader if the reader wants later records only. The cached index
+	 * is dropped if the catalog wrapped, since its indices are not in
+	 * record order then, and if it is outside of the live part of the
+	 * catalog, i.e. its llog was cleared or it was cached before a
+	 * wrap. */
+	hdr = llh->lgh_hdr;
+	spin_lock(&cli->cl_loi_list_lock);
+	if ((hdr->llh_cat_idx >= llh->lgh_last_idx && hdr->llh_count > 1) ||
+	    cli->cl_chlg_catidx <= hdr->llh_cat_idx ||
+	    cli->cl_chlg_catidx > llh->lgh_last_idx) {
+		cli->cl_chlg_recno = 0;
+		cli->cl_chlg_catidx = 0;
+	} else if (cs->cs_startrec > cli->cl_chlg_recno) {
+		startcat = cli->cl_chlg_catidx;
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	rc = llog_cat_process(NULL, llh, changelog_kkuc_cb, cs, startcat, 0);
+	rc2 = changelog_flush(cs);
+	if (rc == 0)
+		rc = rc2;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	if (cs->cs_recno > cli->cl_chlg_recno) {
+		cli->cl_chlg_recno = cs->cs_recno;
+		cli->cl_chlg_catidx = cs->cs_catidx;
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
 
 	/* Send EOF no matter what our result */
 	kuch = changelog_kuc_hdr(cs->cs_buf, sizeof(*kuch), cs->cs_flags);
@@ -1889,13 +2440,14 @@ out:
 	if (ctxt)
 		llog_ctxt_put(ctxt);
 	if (cs->cs_buf)
-		OBD_FREE(cs->cs_buf, KUC_CHANGELOG_MSG_MAXSIZE);
+		OBD_FREE_LARGE(cs->cs_buf, MDC_CHANGELOG_BATCH_SIZE);
 	OBD_FREE_PTR(cs);
 	return rc;
 }
 
 static int mdc_ioc_changelog_send(struct obd_device *obd,
-                                  struct ioc_changelog *icc)
+				  struct ioc_changelog *icc,
+				  struct changelog_filter *filter)
 {
 	struct changelog_show *cs;
 	struct task_struct *task;
@@ -1911,6 +2463,11 @@ static int mdc_ioc_changelog_send(struct obd_device *obd,
 	/* matching fput in mdc_changelog_send_thread */
 	cs->cs_fp = fget(icc->icc_id);
 	cs->cs_flags = icc->icc_flags;
+	if (filter != NULL)
+		cs->cs_filter = *filter;
+	/* the second half of old format renames goes with them */
+	if (cs->cs_filter.cf_mask & (1 << CL_RENAME))
+		cs->cs_filter.cf_mask |= 1 << CL_EXT;
 
 	/*
 	 * New thread because we should return to user app before
@@ -2044,8 +2601,15 @@ static int mdc_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 	}
         switch (cmd) {
         case OBD_IOC_CHANGELOG_SEND:
-                rc = mdc_ioc_changelog_send(obd, karg);
+		rc = mdc_ioc_changelog_send(obd, karg, NULL);
                 GOTO(out, rc);
+	case OBD_IOC_CHANGELOG_SEND_FILTER: {
+		struct ioc_changelog_filter *icf = karg;
+
+		rc = mdc_ioc_changelog_send(obd, &icf->icf_icc,
+					    &icf->icf_filter);
+		GOTO(out, rc);
+	}
         case OBD_IOC_CHANGELOG_CLEAR: {
                 struct ioc_changelog *icc = karg;
                 struct changelog_setinfo cs =
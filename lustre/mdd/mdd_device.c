@@ -367,10 +367,318 @@ out_cleanup:
 	return rc;
 }
 
+static inline int mdd_changelog_buf_size(struct llog_changelog_rec *rec)
+{
+	return offsetof(struct mdd_changelog_buf, mcb_rec) +
+	       rec->cr_hdr.lrh_len;
+}
+
+static void mdd_changelog_buf_free(struct mdd_changelog *mc,
+				   struct list_head *list)
+{
+	struct mdd_changelog_buf	*mcb;
+	struct mdd_changelog_buf	*tmp;
+
+	list_for_each_entry_safe(mcb, tmp, list, mcb_list) {
+		list_del(&mcb->mcb_list);
+		atomic_dec(&mc->mc_buffered);
+		OBD_FREE(mcb, mdd_changelog_buf_size(&mcb->mcb_rec));
+	}
+}
+
+/**
+ * Check whether a new changelog record goes through the buffered path.
+ *
+ * After buffering is turned off, records keep being buffered until the
+ * queues are drained, otherwise a record stored directly could reach the
+ * llog ahead of a buffered one with a lower index. If the record is to be
+ * buffered, a slot is taken in mc_buffered for mdd_changelog_buffer_add().
+ *
+ * \param[in] mdd	mdd device
+ *
+ * \retval		true if the record must be buffered
+ */
+bool mdd_changelog_buffer_get(struct mdd_device *mdd)
+{
+	struct mdd_changelog	*mc = &mdd->mdd_cl;
+
+	if (atomic_inc_not_zero(&mc->mc_buffered))
+		return true;
+	if (mc->mc_flush_ms == 0)
+		return false;
+
+	atomic_inc(&mc->mc_buffered);
+	return true;
+}
+
+/**
+ * Queue changelog record \a rec on the current CPT for the flush thread.
+ *
+ * The index is assigned while holding the per-CPT lock, so every queue
+ * is sorted by cr_index and the flush thread only has to merge them.
+ *
+ * The caller must have taken a slot with mdd_changelog_buffer_get().
+ *
+ * \param[in] mdd	mdd device
+ * \param[in] rec	changelog record with lrh_len, type and time set
+ *
+ * \retval		0 on success
+ * \retval		-ENOMEM if the record cannot be queued
+ */
+int mdd_changelog_buffer_add(struct mdd_device *mdd,
+			     struct llog_changelog_rec *rec)
+{
+	struct mdd_changelog		*mc = &mdd->mdd_cl;
+	struct mdd_changelog_cpt	*mcc;
+	struct mdd_changelog_buf	*mcb;
+	bool				 kick;
+	int				 cpt;
+
+	cpt = cfs_cpt_current(cfs_cpt_table, 0);
+	OBD_CPT_ALLOC(mcb, cfs_cpt_table, cpt, mdd_changelog_buf_size(rec));
+	if (mcb == NULL) {
+		atomic_dec(&mc->mc_buffered);
+		return -ENOMEM;
+	}
+
+	memcpy(&mcb->mcb_rec, rec, rec->cr_hdr.lrh_len);
+
+	mcc = mc->mc_cpt[cpt];
+	spin_lock(&mcc->mcc_lock);
+	spin_lock(&mc->mc_lock);
+	rec->cr.cr_index = ++mc->mc_index;
+	spin_unlock(&mc->mc_lock);
+	mcb->mcb_rec.cr.cr_index = rec->cr.cr_index;
+	list_add_tail(&mcb->mcb_list, &mcc->mcc_list);
+	kick = ++mcc->mcc_count == MDD_CHANGELOG_GROUP;
+	spin_unlock(&mcc->mcc_lock);
+
+	if (kick) {
+		mc->mc_flush_kick = true;
+		wake_up(&mc->mc_flush_waitq);
+	}
+	return 0;
+}
+
+/* merge the cr_index ordered list \a src into the ordered list \a dst */
+static void mdd_changelog_merge(struct list_head *dst, struct list_head *src)
+{
+	struct list_head		*pos = dst->next;
+	struct mdd_changelog_buf	*mcb;
+	struct mdd_changelog_buf	*tmp;
+
+	list_for_each_entry_safe(mcb, tmp, src, mcb_list) {
+		while (pos != dst &&
+		       list_entry(pos, struct mdd_changelog_buf,
+				  mcb_list)->mcb_rec.cr.cr_index <
+		       mcb->mcb_rec.cr.cr_index)
+			pos = pos->next;
+		list_move_tail(&mcb->mcb_list, pos);
+	}
+}
+
+/* append the records in \a group to the changelog in one transaction */
+static int mdd_changelog_append(const struct lu_env *env,
+				struct mdd_device *mdd,
+				struct list_head *group)
+{
+	struct mdd_changelog_buf	*mcb;
+	struct llog_ctxt		*ctxt;
+	struct dt_device		*dt;
+	struct thandle			*th;
+	int				 rc = 0;
+
+	ctxt = llog_get_context(mdd2obd_dev(mdd), LLOG_CHANGELOG_ORIG_CTXT);
+	if (ctxt == NULL)
+		return -ENXIO;
+
+	dt = lu2dt_dev(ctxt->loc_handle->lgh_obj->do_lu.lo_dev);
+	th = dt_trans_create(env, dt);
+	if (IS_ERR(th))
+		GOTO(out_put, rc = PTR_ERR(th));
+
+	list_for_each_entry(mcb, group, mcb_list) {
+		rc = llog_declare_add(env, ctxt->loc_handle,
+				      &mcb->mcb_rec.cr_hdr, th);
+		if (rc != 0)
+			GOTO(out_trans, rc);
+	}
+
+	rc = dt_trans_start_local(env, dt, th);
+	if (rc != 0)
+		GOTO(out_trans, rc);
+
+	list_for_each_entry(mcb, group, mcb_list) {
+		rc = llog_add(env, ctxt->loc_handle, &mcb->mcb_rec.cr_hdr,
+			      NULL, th);
+		if (rc < 0)
+			break;
+	}
+	if (rc > 0)
+		rc = 0;
+out_trans:
+	dt_trans_stop(env, dt, th);
+out_put:
+	llog_ctxt_put(ctxt);
+	return rc;
+}
+
+/**
+ * Append buffered changelog records to the llog in cr_index order.
+ *
+ * Records from all per-CPT queues are merged into mc_pending and written
+ * in groups of up to MDD_CHANGELOG_GROUP records per transaction. Only a
+ * contiguous run of indices following the last appended one is written,
+ * since a lower index may still be on its way into a per-CPT queue. A gap
+ * that is still there on the next flush (e.g. a record stored directly
+ * while buffering was being enabled) is skipped.
+ *
+ * \param[in] env	execution environment
+ * \param[in] mdd	mdd device
+ * \param[in] force	append everything queued, ignoring gaps
+ *
+ * \retval		0 on success
+ * \retval		negative errno if an append failed, the records of
+ *			the failed group are dropped
+ */
+int mdd_changelog_flush(const struct lu_env *env, struct mdd_device *mdd,
+			bool force)
+{
+	struct mdd_changelog		*mc = &mdd->mdd_cl;
+	struct mdd_changelog_cpt	*mcc;
+	struct mdd_changelog_buf	*mcb;
+	struct list_head		 list;
+	struct list_head		 group;
+	__u64				 next;
+	int				 count;
+	int				 rc = 0;
+	int				 i;
+	ENTRY;
+
+	if (mc->mc_cpt == NULL)
+		RETURN(0);
+
+	mutex_lock(&mc->mc_flush_mutex);
+	cfs_percpt_for_each(mcc, i, mc->mc_cpt) {
+		INIT_LIST_HEAD(&list);
+		spin_lock(&mcc->mcc_lock);
+		list_splice_init(&mcc->mcc_list, &list);
+		mcc->mcc_count = 0;
+		spin_unlock(&mcc->mcc_lock);
+		mdd_changelog_merge(&mc->mc_pending, &list);
+	}
+
+	while (!list_empty(&mc->mc_pending)) {
+		INIT_LIST_HEAD(&group);
+		next = mc->mc_flushed + 1;
+		count = 0;
+		while (!list_empty(&mc->mc_pending) &&
+		       count < MDD_CHANGELOG_GROUP) {
+			mcb = list_entry(mc->mc_pending.next,
+					 struct mdd_changelog_buf, mcb_list);
+			if (mcb->mcb_rec.cr.cr_index != next) {
+				if (count > 0)
+					break;
+				if (!force &&
+				    mcb->mcb_rec.cr.cr_index != mc->mc_stall) {
+					mc->mc_stall = mcb->mcb_rec.cr.cr_index;
+					GOTO(out, rc = 0);
+				}
+			}
+			next = mcb->mcb_rec.cr.cr_index + 1;
+			list_move_tail(&mcb->mcb_list, &group);
+			count++;
+		}
+
+		rc = mdd_changelog_append(env, mdd, &group);
+		mdd_changelog_buf_free(mc, &group);
+		mc->mc_flushed = next - 1;
+		if (rc != 0) {
+			CERROR("%s: failed to append %d changelog records: "
+			       "rc = %d\n", mdd2obd_dev(mdd)->obd_name, count,
+			       rc);
+			break;
+		}
+		mc->mc_flush_recs += count;
+		mc->mc_flush_groups++;
+	}
+out:
+	mutex_unlock(&mc->mc_flush_mutex);
+	RETURN(rc);
+}
+
+static int mdd_changelog_flush_main(void *args)
+{
+	struct mdd_generic_thread	*thread = args;
+	struct mdd_device		*mdd = thread->mgt_data;
+	struct mdd_changelog		*mc = &mdd->mdd_cl;
+	struct lu_env			 env;
+	int				 rc;
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_MD_THREAD);
+	complete(&thread->mgt_started);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	while (!thread->mgt_abort) {
+		unsigned int ms = mc->mc_flush_ms;
+
+		/* drain quickly once buffering is turned off */
+		if (ms == 0)
+			ms = atomic_read(&mc->mc_buffered) > 0 ? 1 :
+							       MSEC_PER_SEC;
+
+		wait_event_timeout(mc->mc_flush_waitq,
+				   thread->mgt_abort || mc->mc_flush_kick,
+				   msecs_to_jiffies(ms));
+		mc->mc_flush_kick = false;
+		if (atomic_read(&mc->mc_buffered) > 0)
+			mdd_changelog_flush(&env, mdd, false);
+	}
+	rc = mdd_changelog_flush(&env, mdd, true);
+	lu_env_fini(&env);
+	GOTO(out, rc);
+out:
+	complete(&thread->mgt_finished);
+	return rc;
+}
+
+static void mdd_changelog_buffer_fini(struct mdd_device *mdd)
+{
+	struct mdd_changelog		*mc = &mdd->mdd_cl;
+	struct mdd_changelog_cpt	*mcc;
+	int				 i;
+
+	if (mc->mc_flush_thread.mgt_init) {
+		mc->mc_flush_thread.mgt_abort = true;
+		wake_up(&mc->mc_flush_waitq);
+		mdd_generic_thread_stop(&mc->mc_flush_thread);
+		mc->mc_flush_thread.mgt_init = false;
+	}
+
+	if (mc->mc_cpt == NULL)
+		return;
+
+	/* the flush thread appends everything on exit, this only drops
+	 * records it failed to write */
+	cfs_percpt_for_each(mcc, i, mc->mc_cpt)
+		mdd_changelog_buf_free(mc, &mcc->mcc_list);
+	mdd_changelog_buf_free(mc, &mc->mc_pending);
+	cfs_percpt_free(mc->mc_cpt);
+	mc->mc_cpt = NULL;
+}
+
+static void mdd_changelog_fini(const struct lu_env *env,
+			       struct mdd_device *mdd);
+
 static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
 {
-	struct obd_device	*obd = mdd2obd_dev(mdd);
-	int			 rc;
+	struct obd_device		*obd = mdd2obd_dev(mdd);
+	struct mdd_changelog_cpt	*mcc;
+	char				 name[MTI_NAME_MAXLEN];
+	int				 rc;
+	int				 i;
 
 	mdd->mdd_cl.mc_index = 0;
 	spin_lock_init(&mdd->mdd_cl.mc_lock);
@@ -380,13 +688,44 @@ static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
 	spin_lock_init(&mdd->mdd_cl.mc_user_lock);
 	mdd->mdd_cl.mc_lastuser = 0;
 
+	mdd->mdd_cl.mc_flush_ms = 0; /* records written in-transaction */
+	atomic_set(&mdd->mdd_cl.mc_buffered, 0);
+	init_waitqueue_head(&mdd->mdd_cl.mc_flush_waitq);
+	mutex_init(&mdd->mdd_cl.mc_flush_mutex);
+	INIT_LIST_HEAD(&mdd->mdd_cl.mc_pending);
+	mdd->mdd_cl.mc_cpt = cfs_percpt_alloc(cfs_cpt_table,
+					      sizeof(*mcc));
+	if (mdd->mdd_cl.mc_cpt == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(mcc, i, mdd->mdd_cl.mc_cpt) {
+		spin_lock_init(&mcc->mcc_lock);
+		INIT_LIST_HEAD(&mcc->mcc_list);
+	}
+
 	rc = mdd_changelog_llog_init(env, mdd);
 	if (rc) {
 		CERROR("%s: changelog setup during init failed: rc = %d\n",
 		       obd->obd_name, rc);
 		mdd->mdd_cl.mc_flags |= CLM_ERR;
+		GOTO(out_free, rc);
 	}
+	mdd->mdd_cl.mc_flushed = mdd->mdd_cl.mc_index;
+
+	snprintf(name, sizeof(name), "chlg_flush_%s", obd->obd_name);
+	rc = mdd_generic_thread_start(&mdd->mdd_cl.mc_flush_thread,
+				      mdd_changelog_flush_main, mdd, name);
+	if (rc != 0) {
+		CERROR("%s: cannot start changelog flush thread: rc = %d\n",
+		       obd->obd_name, rc);
+		mdd_changelog_fini(env, mdd);
+		return rc;
+	}
+	return 0;
 
+out_free:
+	cfs_percpt_free(mdd->mdd_cl.mc_cpt);
+	mdd->mdd_cl.mc_cpt = NULL;
 	return rc;
 }
 
@@ -396,6 +735,7 @@ static void mdd_changelog_fini(const struct lu_env *env,
 	struct obd_device	*obd = mdd2obd_dev(mdd);
 	struct llog_ctxt	*ctxt;
 
+	mdd_changelog_buffer_fini(mdd);
 	mdd->mdd_cl.mc_flags = 0;
 
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
@@ -462,6 +802,10 @@ mdd_changelog_llog_cancel(const struct lu_env *env, struct mdd_device *mdd,
         if (ctxt == NULL)
                 return -ENXIO;
 
+	/* buffered records up to endrec must be in the llog to be purged */
+	if (atomic_read(&mdd->mdd_cl.mc_buffered) > 0)
+		mdd_changelog_flush(env, mdd, true);
+
 	spin_lock(&mdd->mdd_cl.mc_lock);
 	cur = (long long)mdd->mdd_cl.mc_index;
 	spin_unlock(&mdd->mdd_cl.mc_lock);
@@ -533,6 +877,15 @@ int mdd_changelog_write_header(const struct lu_env *env,
 					    rec->cr.cr_namelen);
 	rec->cr_hdr.lrh_type = CHANGELOG_REC;
 	rec->cr.cr_time = cl_time();
+
+	if (mdd_changelog_buffer_get(mdd)) {
+		/* keep the marker in order with the buffered records */
+		rc = mdd_changelog_buffer_add(mdd, rec);
+		if (rc == 0)
+			rc = mdd_changelog_flush(env, mdd, true);
+		GOTO(out, rc);
+	}
+
 	spin_lock(&mdd->mdd_cl.mc_lock);
 	rec->cr.cr_index = ++mdd->mdd_cl.mc_index;
 	spin_unlock(&mdd->mdd_cl.mc_lock);
@@ -544,6 +897,7 @@ int mdd_changelog_write_header(const struct lu_env *env,
 	if (rc > 0)
 		rc = 0;
 	llog_ctxt_put(ctxt);
+out:
 
 	/* assume on or off event; reset repeat-access time */
 	mdd->mdd_cl.mc_starttime = cfs_time_current_64();
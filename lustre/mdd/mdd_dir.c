@@ -727,6 +727,9 @@ out_put:
 }
 
 /** Add a changelog entry \a rec to the changelog llog
+ * If changelog buffering is enabled (see the changelog_buffer tunable), or
+ * buffered records are still queued, the record is queued per CPT and
+ * appended later by the flush thread instead.
  * \param mdd
  * \param rec
  * \param handle - currently ignored since llogs start their own transaction;
@@ -748,6 +751,11 @@ int mdd_changelog_store(const struct lu_env *env, struct mdd_device *mdd,
 	rec->cr_hdr.lrh_type = CHANGELOG_REC;
 	rec->cr.cr_time = cl_time();
 
+	/* buffered mode: queue the record for the flush thread, which
+	 * appends it in index order outside of this transaction */
+	if (mdd_changelog_buffer_get(mdd))
+		return mdd_changelog_buffer_add(mdd, rec);
+
 	spin_lock(&mdd->mdd_cl.mc_lock);
 	/* NB: I suppose it's possible llog_add adds out of order wrt cr_index,
 	 * but as long as the MDD transactions are ordered correctly for e.g.
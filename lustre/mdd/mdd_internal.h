@@ -64,6 +64,30 @@
 /** some changelog records purged */
 #define CLM_PURGE 0x40000
 
+struct mdd_generic_thread {
+	struct completion	mgt_started;
+	struct completion	mgt_finished;
+	void		       *mgt_data;
+	bool			mgt_abort;
+	bool			mgt_init;
+};
+
+/** Number of buffered changelog records appended in one transaction */
+#define MDD_CHANGELOG_GROUP	32
+
+/** Changelog record waiting in a per-CPT queue to be appended */
+struct mdd_changelog_buf {
+	struct list_head		mcb_list;
+	struct llog_changelog_rec	mcb_rec;	/* must be last */
+};
+
+/** Per-CPT queue of buffered changelog records, kept in cr_index order */
+struct mdd_changelog_cpt {
+	spinlock_t		mcc_lock;
+	struct list_head	mcc_list;
+	int			mcc_count;
+};
+
 struct mdd_changelog {
 	spinlock_t		mc_lock;	/* for index */
 	int			mc_flags;
@@ -72,6 +96,20 @@ struct mdd_changelog {
 	__u64			mc_starttime;
 	spinlock_t		mc_user_lock;
 	int			mc_lastuser;
+	/* buffered write path, used while mc_flush_ms != 0 */
+	unsigned int		mc_flush_ms;
+	struct mdd_changelog_cpt **mc_cpt;
+	atomic_t		mc_buffered;
+	wait_queue_head_t	mc_flush_waitq;
+	bool			mc_flush_kick;
+	struct mdd_generic_thread mc_flush_thread;
+	struct mutex		mc_flush_mutex;	/* serializes flushes */
+	struct list_head	mc_pending;	/* merged, not yet appended */
+	__u64			mc_flushed;	/* last appended index */
+	__u64			mc_stall;	/* head index left by last
+						 * flush due to a gap */
+	__u64			mc_flush_recs;
+	__u64			mc_flush_groups;
 };
 
 static inline __u64 cl_time(void) {
@@ -87,14 +125,6 @@ struct mdd_dot_lustre_objs {
 	struct mdd_object *mdd_lpf;
 };
 
-struct mdd_generic_thread {
-	struct completion	mgt_started;
-	struct completion	mgt_finished;
-	void		       *mgt_data;
-	bool			mgt_abort;
-	bool			mgt_init;
-};
-
 struct mdd_device {
         struct md_device                 mdd_md_dev;
 	struct obd_export               *mdd_child_exp;
@@ -337,6 +367,11 @@ int mdd_trans_stop(const struct lu_env *env, struct mdd_device *mdd,
 		   int rc, struct thandle *handle);
 
 /* mdd_device.c */
+bool mdd_changelog_buffer_get(struct mdd_device *mdd);
+int mdd_changelog_buffer_add(struct mdd_device *mdd,
+			     struct llog_changelog_rec *rec);
+int mdd_changelog_flush(const struct lu_env *env, struct mdd_device *mdd,
+			bool force);
 struct lu_object *mdd_object_alloc(const struct lu_env *env,
                                    const struct lu_object_header *hdr,
                                    struct lu_device *d);
@@ -177,6 +177,77 @@ static int mdd_changelog_users_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(mdd_changelog_users);
 
+static int mdd_changelog_buffer_seq_show(struct seq_file *m, void *data)
+{
+	struct mdd_device	*mdd = m->private;
+	struct mdd_changelog	*mc = &mdd->mdd_cl;
+
+	seq_printf(m, "flush_ms: %u\n", mc->mc_flush_ms);
+	seq_printf(m, "buffered: %d\n", atomic_read(&mc->mc_buffered));
+	seq_printf(m, "flushed index: "LPU64"\n", mc->mc_flushed);
+	seq_printf(m, "groups: "LPU64"\n", mc->mc_flush_groups);
+	return seq_printf(m, "records: "LPU64"\n", mc->mc_flush_recs);
+}
+
+/* Writing N > 0 buffers changelog records per CPT and appends them at
+ * least every N ms, outside of the metadata transaction. Records that
+ * are still buffered are lost if the MDS crashes. 0 restores the
+ * in-transaction write path once the queued records are appended, which
+ * is done before returning. */
+static ssize_t
+mdd_changelog_buffer_seq_write(struct file *file, const char __user *buffer,
+			       size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct mdd_device	*mdd = m->private;
+	struct mdd_changelog	*mc = &mdd->mdd_cl;
+	struct lu_env		 env;
+	int			 val;
+	int			 rc;
+	int			 i;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > 60 * MSEC_PER_SEC)
+		return -ERANGE;
+
+	mutex_lock(&mc->mc_flush_mutex);
+	if (mc->mc_flush_ms == 0 && val != 0) {
+		/* nothing older than this index will be buffered */
+		spin_lock(&mc->mc_lock);
+		mc->mc_flushed = mc->mc_index;
+		spin_unlock(&mc->mc_lock);
+	}
+	mc->mc_flush_ms = val;
+	mutex_unlock(&mc->mc_flush_mutex);
+
+	mc->mc_flush_kick = true;
+	wake_up(&mc->mc_flush_waitq);
+
+	if (val != 0 || atomic_read(&mc->mc_buffered) == 0)
+		return count;
+
+	/* New records are buffered until the queues are empty, so that
+	 * they stay in index order. Drain what is queued now, the flush
+	 * thread takes care of records still arriving after that. */
+	rc = lu_env_init(&env, LCT_MD_THREAD);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < 16 && atomic_read(&mc->mc_buffered) > 0; i++) {
+		rc = mdd_changelog_flush(&env, mdd, false);
+		if (rc != 0)
+			break;
+		cond_resched();
+	}
+	lu_env_fini(&env);
+
+	return rc != 0 ? rc : count;
+}
+LPROC_SEQ_FOPS(mdd_changelog_buffer);
+
 static int mdd_sync_perm_seq_show(struct seq_file *m, void *data)
 {
 	struct mdd_device *mdd = m->private;
@@ -283,6 +354,8 @@ static struct lprocfs_vars lprocfs_mdd_obd_vars[] = {
 	  .fops =	&mdd_changelog_mask_fops	},
 	{ .name =	"changelog_users",
 	  .fops =	&mdd_changelog_users_fops	},
+	{ .name =	"changelog_buffer",
+	  .fops =	&mdd_changelog_buffer_fops	},
 	{ .name =	"sync_permission",
 	  .fops =	&mdd_sync_perm_fops		},
 	{ .name =	"lfsck_speed_limit",
@@ -560,6 +560,48 @@ mdt_cos_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(mdt_cos);
 
+static int mdt_reply_data_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*obd = m->private;
+	struct mdt_device	*mdt = mdt_dev(obd->obd_lu_dev);
+	struct lu_target	*lut = &mdt->mdt_lut;
+	struct lprocfs_counter	 cnt;
+
+	seq_printf(m, "slots_used: %d\n"
+		   "slots_high: %d\n"
+		   "slot_cpts: %d\n",
+		   atomic_read(&lut->lut_reply_slots_used),
+		   lut->lut_reply_slots_high,
+		   lut->lut_reply_slot_cpt != NULL ?
+		   cfs_cpt_number(cfs_cpt_table) : 0);
+	if (lut->lut_reply_stats == NULL)
+		return 0;
+
+	lprocfs_stats_collect(lut->lut_reply_stats,
+			      LUT_REPLY_STATS_SLOT_SCAN, &cnt);
+	seq_printf(m, "slot_alloc: "LPD64" groups_scanned: "LPD64
+		   " max: "LPD64"\n", cnt.lc_count, cnt.lc_sum, cnt.lc_max);
+	lprocfs_stats_collect(lut->lut_reply_stats,
+			      LUT_REPLY_STATS_LOOKUP, &cnt);
+	return seq_printf(m, "lookup: "LPD64" replies_scanned: "LPD64
+			  " max: "LPD64"\n", cnt.lc_count, cnt.lc_sum,
+			  cnt.lc_max);
+}
+
+static ssize_t
+mdt_reply_data_stats_seq_write(struct file *file, const char __user *buffer,
+			       size_t count, loff_t *off)
+{
+	struct seq_file   *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	if (mdt->mdt_lut.lut_reply_stats != NULL)
+		lprocfs_clear_stats(mdt->mdt_lut.lut_reply_stats);
+	return count;
+}
+LPROC_SEQ_FOPS(mdt_reply_data_stats);
+
 static int mdt_root_squash_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
@@ -814,6 +856,8 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	  .fops =	&mdt_sec_level_fops			},
 	{ .name =	"commit_on_sharing",
 	  .fops =	&mdt_cos_fops				},
+	{ .name =	"reply_data_stats",
+	  .fops =	&mdt_reply_data_stats_fops		},
 	{ .name =	"root_squash",
 	  .fops =	&mdt_root_squash_fops			},
 	{ .name =	"nosquash_nids",
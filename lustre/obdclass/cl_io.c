@@ -1013,19 +1013,31 @@ EXPORT_SYMBOL(cl_page_list_fini);
 int cl_page_list_own(const struct lu_env *env,
 		     struct cl_io *io, struct cl_page_list *plist)
 {
+	struct cl_page *pvec[CL_PAGE_VEC_MAX];
+	int rcs[CL_PAGE_VEC_MAX];
 	struct cl_page *page;
 	struct cl_page *temp;
 	int result;
+	int nr = 0;
+	int i;
 
 	LINVRNT(plist->pl_owner == current);
 
 	ENTRY;
 	result = 0;
 	cl_page_list_for_each_safe(page, temp, plist) {
-		if (cl_page_own(env, io, page) == 0)
-			result = result ?: page->cp_error;
-		else
-			cl_page_list_del(env, plist, page);
+		pvec[nr++] = page;
+		if (nr < CL_PAGE_VEC_MAX && &temp->cp_batch != &plist->pl_pages)
+			continue;
+
+		cl_page_own_vec(env, io, pvec, rcs, nr);
+		for (i = 0; i < nr; i++) {
+			if (rcs[i] == 0)
+				result = result ?: pvec[i]->cp_error;
+			else
+				cl_page_list_del(env, plist, pvec[i]);
+		}
+		nr = 0;
 	}
 	RETURN(result);
 }
@@ -1071,6 +1083,32 @@ void cl_2queue_init(struct cl_2queue *queue)
 }
 EXPORT_SYMBOL(cl_2queue_init);
 
+/**
+ * Give up the ownership of both lists of \a queue, so that another thread
+ * can take it with cl_2queue_adopt(). Nobody may use the lists until then.
+ */
+void cl_2queue_release(struct cl_2queue *queue)
+{
+	LINVRNT(queue->c2_qin.pl_owner == current);
+	LINVRNT(queue->c2_qout.pl_owner == current);
+	queue->c2_qin.pl_owner = NULL;
+	queue->c2_qout.pl_owner = NULL;
+}
+EXPORT_SYMBOL(cl_2queue_release);
+
+/**
+ * Make the current thread the owner of both lists of \a queue, which was
+ * released by its previous owner with cl_2queue_release().
+ */
+void cl_2queue_adopt(struct cl_2queue *queue)
+{
+	LINVRNT(queue->c2_qin.pl_owner == NULL);
+	LINVRNT(queue->c2_qout.pl_owner == NULL);
+	queue->c2_qin.pl_owner = current;
+	queue->c2_qout.pl_owner = current;
+}
+EXPORT_SYMBOL(cl_2queue_adopt);
+
 /**
  * Add a page to the incoming page list of 2-queue.
  */
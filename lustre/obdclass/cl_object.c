@@ -1428,6 +1428,7 @@ void cl_global_fini(void)
 {
 	cl_env_percpu_fini();
         lu_context_key_degister(&cl_key);
+	cl_page_kmem_fini();
         lu_kmem_fini(cl_object_caches);
         cl_env_store_fini();
 }
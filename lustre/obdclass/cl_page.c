@@ -130,6 +130,77 @@ cl_page_at_trusted(const struct cl_page *page,
 	RETURN(NULL);
 }
 
+/*
+ * cl_pages are allocated with all their layer slices in one buffer of
+ * cl_object_header::coh_page_bufsize bytes. The stacks of layers in use
+ * produce only a handful of distinct sizes, so each of them gets a slab
+ * cache of its own instead of going through the kmalloc size classes.
+ */
+#define CL_PAGE_KMEM_MAX	16
+#define CL_PAGE_KMEM_NAME_LEN	24
+
+static struct kmem_cache *cl_page_kmem_array[CL_PAGE_KMEM_MAX];
+static unsigned short cl_page_kmem_size_array[CL_PAGE_KMEM_MAX];
+static char cl_page_kmem_name_array[CL_PAGE_KMEM_MAX][CL_PAGE_KMEM_NAME_LEN];
+static DEFINE_MUTEX(cl_page_kmem_mutex);
+
+/**
+ * Returns the index of the slab cache for cl_pages of \a bufsize bytes,
+ * creating the cache if needed, or -1 if no cache can be used.
+ */
+static int cl_page_kmem_index(int bufsize)
+{
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_MAX; i++) {
+		if (cl_page_kmem_size_array[i] == bufsize) {
+			/* pairs with smp_wmb() below */
+			smp_rmb();
+			return i;
+		}
+		if (cl_page_kmem_size_array[i] == 0)
+			break;
+	}
+
+	mutex_lock(&cl_page_kmem_mutex);
+	for (i = 0; i < CL_PAGE_KMEM_MAX; i++) {
+		if (cl_page_kmem_size_array[i] == bufsize)
+			break;
+		if (cl_page_kmem_size_array[i] != 0)
+			continue;
+
+		snprintf(cl_page_kmem_name_array[i], CL_PAGE_KMEM_NAME_LEN,
+			 "cl_page_kmem-%u", bufsize);
+		cl_page_kmem_array[i] =
+			kmem_cache_create(cl_page_kmem_name_array[i], bufsize,
+					  0, 0, NULL);
+		if (cl_page_kmem_array[i] == NULL) {
+			i = CL_PAGE_KMEM_MAX;
+			break;
+		}
+		/* publish the cache before its size */
+		smp_wmb();
+		cl_page_kmem_size_array[i] = bufsize;
+		break;
+	}
+	mutex_unlock(&cl_page_kmem_mutex);
+
+	return i < CL_PAGE_KMEM_MAX ? i : -1;
+}
+
+void cl_page_kmem_fini(void)
+{
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_MAX; i++) {
+		if (cl_page_kmem_array[i] == NULL)
+			break;
+		kmem_cache_destroy(cl_page_kmem_array[i]);
+		cl_page_kmem_array[i] = NULL;
+		cl_page_kmem_size_array[i] = 0;
+	}
+}
+
 static void cl_page_free(const struct lu_env *env, struct cl_page *page)
 {
 	struct cl_object *obj  = page->cp_obj;
@@ -154,7 +225,11 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page)
 	lu_object_ref_del_at(&obj->co_lu, &page->cp_obj_ref, "cl_page", page);
 	cl_object_put(env, obj);
 	lu_ref_fini(&page->cp_reference);
-	OBD_FREE(page, pagesize);
+	if (page->cp_kmem_index >= 0)
+		OBD_SLAB_FREE(page, cl_page_kmem_array[page->cp_kmem_index],
+			      pagesize);
+	else
+		OBD_FREE(page, pagesize);
 	EXIT;
 }
 
@@ -175,12 +250,19 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 {
 	struct cl_page          *page;
 	struct lu_object_header *head;
+	int bufsize = cl_object_header(o)->coh_page_bufsize;
+	int index;
 
 	ENTRY;
-	OBD_ALLOC_GFP(page, cl_object_header(o)->coh_page_bufsize,
-			GFP_NOFS);
+	index = cl_page_kmem_index(bufsize);
+	if (index >= 0)
+		OBD_SLAB_ALLOC_GFP(page, cl_page_kmem_array[index], bufsize,
+				   GFP_NOFS);
+	else
+		OBD_ALLOC_GFP(page, bufsize, GFP_NOFS);
 	if (page != NULL) {
 		int result = 0;
+		page->cp_kmem_index = index;
 		atomic_set(&page->cp_ref, 1);
 		page->cp_obj = o;
 		cl_object_get(o);
@@ -481,6 +563,91 @@ do {									\
 	}								\
 } while (0)
 
+/**
+ * Layer-major counterpart of CL_PAGE_INVOKE() for a batch of pages.
+ *
+ * Each layer is called for every page of \a _pvec before the walk moves on
+ * to the next layer, so a method that is missing from a layer is found
+ * missing once per batch instead of once per page. A page leaves the walk at
+ * its first non-zero result, as with CL_PAGE_INVOKE(). Pages whose entry in
+ * \a _rcs is non-zero on the way in are not walked at all.
+ */
+#define CL_PAGE_VEC_INVOKE(_env, _pvec, _rcs, _nr, _op, _proto, ...)	\
+do {									\
+	const struct lu_env	   *__env  = (_env);			\
+	struct cl_page		  **__pvec = (_pvec);			\
+	int			   *__rcs  = (_rcs);			\
+	int			    __nr   = (_nr);			\
+	const struct cl_page_slice *__scan[CL_PAGE_VEC_MAX];		\
+	const struct cl_page_operations *__ops;				\
+	ptrdiff_t		    __op   = (_op);			\
+	int			   (*__method)_proto;			\
+	int			    __active = 0;			\
+	int			    __i;				\
+									\
+	LASSERT(__nr <= CL_PAGE_VEC_MAX);				\
+	for (__i = 0; __i < __nr; __i++) {				\
+		struct list_head *__head = &__pvec[__i]->cp_layers;	\
+									\
+		__scan[__i] = NULL;					\
+		if (__rcs[__i] == 0 && !list_empty(__head)) {		\
+			__scan[__i] = list_entry(__head->next,		\
+						 struct cl_page_slice,	\
+						 cpl_linkage);		\
+			__active++;					\
+		}							\
+	}								\
+	while (__active > 0) {						\
+		/* same operations vector on this layer for all pages? */ \
+		__ops = NULL;						\
+		for (__i = 0; __i < __nr; __i++) {			\
+			if (__scan[__i] == NULL)			\
+				continue;				\
+			if (__ops == NULL) {				\
+				__ops = __scan[__i]->cpl_ops;		\
+			} else if (__ops != __scan[__i]->cpl_ops) {	\
+				__ops = NULL;				\
+				break;					\
+			}						\
+		}							\
+		if (__ops == NULL ||					\
+		    *(void **)((char *)__ops + __op) != NULL) {		\
+			for (__i = 0; __i < __nr; __i++) {		\
+				if (__scan[__i] == NULL)		\
+					continue;			\
+				__method = *(void **)((char *)		\
+					__scan[__i]->cpl_ops + __op);	\
+				if (__method == NULL)			\
+					continue;			\
+				__rcs[__i] = (*__method)(__env, __scan[__i], \
+							 ## __VA_ARGS__); \
+				if (__rcs[__i] != 0) {			\
+					__scan[__i] = NULL;		\
+					__active--;			\
+				}					\
+			}						\
+		}							\
+		for (__i = 0; __i < __nr; __i++) {			\
+			if (__scan[__i] == NULL)			\
+				continue;				\
+			if (__scan[__i]->cpl_linkage.next ==		\
+			    &__pvec[__i]->cp_layers) {			\
+				__scan[__i] = NULL;			\
+				__active--;				\
+			} else {					\
+				__scan[__i] = list_entry(		\
+					__scan[__i]->cpl_linkage.next,	\
+					struct cl_page_slice,		\
+					cpl_linkage);			\
+			}						\
+		}							\
+	}								\
+	for (__i = 0; __i < __nr; __i++) {				\
+		if (__rcs[__i] > 0)					\
+			__rcs[__i] = 0;					\
+	}								\
+} while (0)
+
 static int cl_page_invoke(const struct lu_env *env,
                           struct cl_io *io, struct cl_page *page, ptrdiff_t op)
 
@@ -638,6 +805,55 @@ int cl_page_own_try(const struct lu_env *env, struct cl_io *io,
 }
 EXPORT_SYMBOL(cl_page_own_try);
 
+/**
+ * Owns a batch of pages, might be blocked.
+ *
+ * Same as calling cl_page_own() on each page of \a pvec in turn, except that
+ * cl_page_operations::cpo_own() is walked layer by layer over the whole
+ * batch.
+ *
+ * \param[in] pvec	pages to own, at most CL_PAGE_VEC_MAX
+ * \param[out] rcs	per-page result, as cl_page_own() would return it
+ * \param[in] nr	number of pages in \a pvec
+ */
+void cl_page_own_vec(const struct lu_env *env, struct cl_io *io,
+		     struct cl_page **pvec, int *rcs, int nr)
+{
+	struct cl_page *pg;
+	int i;
+
+	ENTRY;
+	io = cl_io_top(io);
+	for (i = 0; i < nr; i++) {
+		pg = pvec[i];
+		PINVRNT(env, pg, !cl_page_is_owned(pg, io));
+		rcs[i] = pg->cp_state == CPS_FREEING ? -ENOENT : 0;
+	}
+
+	CL_PAGE_VEC_INVOKE(env, pvec, rcs, nr, CL_PAGE_OP(cpo_own),
+			   (const struct lu_env *,
+			    const struct cl_page_slice *, struct cl_io *, int),
+			   io, 0);
+
+	for (i = 0; i < nr; i++) {
+		pg = pvec[i];
+		if (rcs[i] == 0) {
+			PASSERT(env, pg, pg->cp_owner == NULL);
+			pg->cp_owner = io;
+			cl_page_owner_set(pg);
+			if (pg->cp_state != CPS_FREEING) {
+				cl_page_state_set(env, pg, CPS_OWNED);
+			} else {
+				cl_page_disown0(env, io, pg);
+				rcs[i] = -ENOENT;
+			}
+		}
+		PINVRNT(env, pg, ergo(rcs[i] == 0, cl_page_invariant(pg)));
+	}
+	EXIT;
+}
+EXPORT_SYMBOL(cl_page_own_vec);
+
 
 /**
  * Assume page ownership.
@@ -891,6 +1107,53 @@ int cl_page_prep(const struct lu_env *env, struct cl_io *io,
 }
 EXPORT_SYMBOL(cl_page_prep);
 
+/**
+ * Prepares a batch of pages for immediate transfer.
+ *
+ * Same as calling cl_page_prep() on each page of \a pvec in turn, except
+ * that cl_page_operations::cpo_prep() is walked layer by layer over the
+ * whole batch. A failure on one page does not stop the preparation of the
+ * others, so the caller has to look at every entry of \a rcs.
+ *
+ * \param[in] pvec	pages owned by \a io, at most CL_PAGE_VEC_MAX
+ * \param[out] rcs	per-page result, as cl_page_prep() would return it
+ * \param[in] nr	number of pages in \a pvec
+ */
+void cl_page_prep_vec(const struct lu_env *env, struct cl_io *io,
+		      struct cl_page **pvec, int *rcs, int nr,
+		      enum cl_req_type crt)
+{
+	struct cl_page *pg;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		pg = pvec[i];
+		PINVRNT(env, pg, cl_page_is_owned(pg, io));
+		PINVRNT(env, pg, cl_page_invariant(pg));
+		PINVRNT(env, pg, cl_object_same(pg->cp_obj, io->ci_obj));
+		rcs[i] = crt < CRT_NR ? 0 : -EINVAL;
+	}
+	if (crt >= CRT_NR)
+		return;
+
+	CL_PAGE_VEC_INVOKE(env, pvec, rcs, nr, CL_PAGE_OP(io[crt].cpo_prep),
+			   (const struct lu_env *,
+			    const struct cl_page_slice *, struct cl_io *),
+			   io);
+
+	for (i = 0; i < nr; i++) {
+		pg = pvec[i];
+		if (rcs[i] == 0)
+			cl_page_io_start(env, pg, crt);
+
+		KLASSERT(ergo(crt == CRT_WRITE && pg->cp_type == CPT_CACHEABLE,
+			      equi(rcs[i] == 0,
+				   PageWriteback(cl_page_vmpage(pg)))));
+		CL_PAGE_HEADER(D_TRACE, env, pg, "%d %d\n", crt, rcs[i]);
+	}
+}
+EXPORT_SYMBOL(cl_page_prep_vec);
+
 /**
  * Notify layers about transfer completion.
  *
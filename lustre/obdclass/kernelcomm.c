@@ -94,6 +94,36 @@ int libcfs_kkuc_msg_put(struct file *filp, void *payload)
 }
 EXPORT_SYMBOL(libcfs_kkuc_msg_put);
 
+/**
+ * libcfs_kkuc_batch_put - send several messages from kernel to userspace
+ * @param fp to send the messages to
+ * @param payload Messages, each one starting with a struct kuc_hdr
+ * @param len Total length of the messages
+ */
+int libcfs_kkuc_batch_put(struct file *filp, void *payload, size_t len)
+{
+	struct kuc_hdr *kuch = (struct kuc_hdr *)payload;
+	int rc = -ENOSYS;
+	loff_t offset = 0;
+
+	if (filp == NULL || IS_ERR(filp))
+		return -EBADF;
+
+	if (kuch->kuc_magic != KUC_MAGIC) {
+		CERROR("KernelComm: bad magic %x\n", kuch->kuc_magic);
+		return -ENOSYS;
+	}
+
+	rc = filp_user_write(filp, payload, len, &offset);
+	if (rc < 0)
+		CWARN("message send failed (%d)\n", rc);
+	else
+		CDEBUG(D_KUC, "Sent %zu bytes rc=%d, fp=%p\n", len, rc, filp);
+
+	return rc;
+}
+EXPORT_SYMBOL(libcfs_kkuc_batch_put);
+
 /* Broadcast groups are global across all mounted filesystems;
  * i.e. registering for a group on 1 fs will get messages for that
  * group from any fs */
@@ -193,41 +193,76 @@ out_trans:
 }
 EXPORT_SYMBOL(llog_destroy);
 
-/* returns negative on error; 0 if success; 1 if success & log destroyed */
-int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
-		    int index)
+/**
+ * Cancel a set of records in one plain llog.
+ *
+ * All of the bits are cleared and the header is updated inside a single
+ * transaction, so cancelling several records of the same llog costs one
+ * transaction (and for a remote llog one update RPC) instead of one per
+ * record. The bitmap word of each index is written separately, which keeps
+ * the update small when \a index is sorted.
+ *
+ * \param[in] env	execution environment
+ * \param[in] loghandle	plain llog handle
+ * \param[in] num	number of indexes in \a index
+ * \param[in] index	indexes of the records to be cancelled
+ *
+ * \retval		0 if cancellation succeeds
+ * \retval		LLOG_DEL_PLAIN if the llog has been destroyed
+ * \retval		negative errno if cancellation fails
+ */
+int llog_cancel_arr_rec(const struct lu_env *env,
+			struct llog_handle *loghandle, int num, int *index)
 {
 	struct llog_thread_info *lgi = llog_info(env);
 	struct dt_device	*dt;
 	struct llog_log_hdr	*llh = loghandle->lgh_hdr;
 	struct thandle		*th;
 	int			 rc;
-	int rc1;
-	bool subtract_count = false;
+	int			 rc1;
+	int			 i;
+	int			 cleared = 0;
+	__u32			 cleared_one;
+	__u32			*cleared_bits = &cleared_one;
 
 	ENTRY;
 
-	CDEBUG(D_RPCTRACE, "Canceling %d in log "DOSTID"\n", index,
-	       POSTID(&loghandle->lgh_id.lgl_oi));
+	LASSERT(loghandle != NULL);
+	LASSERT(loghandle->lgh_ctxt != NULL);
+	LASSERT(loghandle->lgh_obj != NULL);
 
-	if (index == 0) {
-		CERROR("Can't cancel index 0 which is header\n");
+	if (num <= 0)
 		RETURN(-EINVAL);
+
+	for (i = 0; i < num; i++) {
+		CDEBUG(D_RPCTRACE, "Canceling %d in log "DOSTID"\n", index[i],
+		       POSTID(&loghandle->lgh_id.lgl_oi));
+		if (index[i] == 0) {
+			CERROR("Can't cancel index 0 which is header\n");
+			RETURN(-EINVAL);
+		}
 	}
 
-	LASSERT(loghandle != NULL);
-	LASSERT(loghandle->lgh_ctxt != NULL);
-	LASSERT(loghandle->lgh_obj != NULL);
+	/* Remember which bits this call cleared so they can be restored
+	 * if the transaction fails. */
+	if (num > 1) {
+		OBD_ALLOC(cleared_bits, num * sizeof(*cleared_bits));
+		if (cleared_bits == NULL)
+			RETURN(-ENOMEM);
+	}
 
 	dt = lu2dt_dev(loghandle->lgh_obj->do_lu.lo_dev);
 
 	th = dt_trans_create(env, dt);
 	if (IS_ERR(th))
-		RETURN(PTR_ERR(th));
+		GOTO(out_free, rc = PTR_ERR(th));
 
-	rc = llog_declare_write_rec(env, loghandle, &llh->llh_hdr, index, th);
-	if (rc < 0)
-		GOTO(out_trans, rc);
+	for (i = 0; i < num; i++) {
+		rc = llog_declare_write_rec(env, loghandle, &llh->llh_hdr,
+					    index[i], th);
+		if (rc < 0)
+			GOTO(out_trans, rc);
+	}
 
 	if ((llh->llh_flags & LLOG_F_ZAP_WHEN_EMPTY))
 		rc = llog_declare_destroy(env, loghandle, th);
@@ -240,21 +275,32 @@ int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 	down_write(&loghandle->lgh_lock);
 	/* clear bitmap */
 	mutex_lock(&loghandle->lgh_hdr_mutex);
-	if (!ext2_clear_bit(index, LLOG_HDR_BITMAP(llh))) {
-		CDEBUG(D_RPCTRACE, "Catalog index %u already clear?\n", index);
-		GOTO(out_unlock, rc);
+	for (i = 0; i < num; i++) {
+		if (!ext2_clear_bit(index[i], LLOG_HDR_BITMAP(llh))) {
+			CDEBUG(D_RPCTRACE, "Catalog index %u already clear?\n",
+			       index[i]);
+			continue;
+		}
+		loghandle->lgh_hdr->llh_count--;
+		cleared_bits[cleared++] = index[i];
 	}
 
-	loghandle->lgh_hdr->llh_count--;
-	subtract_count = true;
-	/* Pass this index to llog_osd_write_rec(), which will use the index
-	 * to only update the necesary bitmap. */
-	lgi->lgi_cookie.lgc_index = index;
-	/* update header */
-	rc = llog_write_rec(env, loghandle, &llh->llh_hdr, &lgi->lgi_cookie,
-			    LLOG_HEADER_IDX, th);
-	if (rc != 0)
-		GOTO(out_unlock, rc);
+	if (cleared == 0)
+		GOTO(out_unlock, rc = 0);
+
+	/* Pass the index to llog_osd_write_rec(), which will use it to
+	 * only update the necessary bitmap word. Indexes sharing a word
+	 * with the previous one have been written already. */
+	for (i = 0; i < cleared; i++) {
+		if (i > 0 && cleared_bits[i] / 32 == cleared_bits[i - 1] / 32)
+			continue;
+		lgi->lgi_cookie.lgc_index = cleared_bits[i];
+		/* update header */
+		rc = llog_write_rec(env, loghandle, &llh->llh_hdr,
+				    &lgi->lgi_cookie, LLOG_HEADER_IDX, th);
+		if (rc != 0)
+			GOTO(out_unlock, rc);
+	}
 
 	if ((llh->llh_flags & LLOG_F_ZAP_WHEN_EMPTY) &&
 	    (llh->llh_count == 1) &&
@@ -285,14 +331,27 @@ out_trans:
 	rc1 = dt_trans_stop(env, dt, th);
 	if (rc == 0)
 		rc = rc1;
-	if (rc < 0 && subtract_count) {
+	if (rc < 0 && cleared > 0) {
 		mutex_lock(&loghandle->lgh_hdr_mutex);
-		loghandle->lgh_hdr->llh_count++;
-		ext2_set_bit(index, LLOG_HDR_BITMAP(llh));
+		for (i = 0; i < cleared; i++) {
+			loghandle->lgh_hdr->llh_count++;
+			ext2_set_bit(cleared_bits[i], LLOG_HDR_BITMAP(llh));
+		}
 		mutex_unlock(&loghandle->lgh_hdr_mutex);
 	}
+out_free:
+	if (num > 1)
+		OBD_FREE(cleared_bits, num * sizeof(*cleared_bits));
 	RETURN(rc);
 }
+EXPORT_SYMBOL(llog_cancel_arr_rec);
+
+/* returns negative on error; 0 if success; 1 if success & log destroyed */
+int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
+		    int index)
+{
+	return llog_cancel_arr_rec(env, loghandle, 1, &index);
+}
 
 int llog_read_header(const struct lu_env *env, struct llog_handle *handle,
 		     const struct obd_uuid *uuid)
@@ -715,6 +715,53 @@ int llog_cat_cancel_records(const struct lu_env *env,
 }
 EXPORT_SYMBOL(llog_cat_cancel_records);
 
+/**
+ * Cancel several records of the same plain llog of a catalog.
+ *
+ * Unlike llog_cat_cancel_records(), which opens the plain llog and runs
+ * one transaction per cookie, all of \a index are cancelled in a single
+ * transaction on the plain llog identified by \a lgl.
+ *
+ * \param[in] env	execution environment
+ * \param[in] cathandle	catalog handle
+ * \param[in] lgl	logid of the plain llog holding the records
+ * \param[in] num	number of indexes in \a index
+ * \param[in] index	indexes of the records to be cancelled
+ *
+ * \retval		0 if cancellation succeeds
+ * \retval		negative errno if cancellation fails
+ */
+int llog_cat_cancel_arr_rec(const struct lu_env *env,
+			    struct llog_handle *cathandle,
+			    struct llog_logid *lgl, int num, int *index)
+{
+	struct llog_handle	*loghandle;
+	int			 rc;
+
+	ENTRY;
+
+	rc = llog_cat_id2handle(env, cathandle, &loghandle, lgl);
+	if (rc) {
+		CERROR("%s: cannot find handle for llog "DOSTID": %d\n",
+		       cathandle->lgh_ctxt->loc_obd->obd_name,
+		       POSTID(&lgl->lgl_oi), rc);
+		RETURN(rc);
+	}
+
+	rc = llog_cancel_arr_rec(env, loghandle, num, index);
+	if (rc == LLOG_DEL_PLAIN) /* log has been destroyed */
+		rc = llog_cat_cleanup(env, cathandle, loghandle,
+				      loghandle->u.phd.phd_cookie.lgc_index);
+	else if (rc < 0 && rc != -ENOENT)
+		CERROR("%s: fail to cancel %d llog-records in "DOSTID
+		       ": rc = %d\n", cathandle->lgh_ctxt->loc_obd->obd_name,
+		       num, POSTID(&lgl->lgl_oi), rc);
+	llog_handle_put(loghandle);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(llog_cat_cancel_arr_rec);
+
 static int llog_cat_process_cb(const struct lu_env *env,
 			       struct llog_handle *cat_llh,
 			       struct llog_rec_hdr *rec, void *data)
@@ -730,6 +777,13 @@ static int llog_cat_process_cb(const struct lu_env *env,
                 CERROR("invalid record in catalog\n");
                 RETURN(-EINVAL);
         }
+
+	/* Skip processing of the logs until startcat. Remote llogs are not
+	 * cleaned below, so skip them without opening them as this costs
+	 * RPCs, local ones are opened to destroy them if they are empty */
+	if (rec->lrh_index < d->lpd_startcat && cat_llh->lgh_obj == NULL)
+		RETURN(0);
+
 	CDEBUG(D_HA, "processing log "DOSTID":%x at index %u of catalog "
 	       DOSTID"\n", POSTID(&lir->lid_id.lgl_oi), lir->lid_id.lgl_ogen,
 	       rec->lrh_index, POSTID(&cat_llh->lgh_id.lgl_oi));
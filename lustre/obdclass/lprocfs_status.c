@@ -747,6 +747,9 @@ static void obd_connect_data_seqprint(struct seq_file *m,
 	if (flags & OBD_CONNECT_MULTIMODRPCS)
 		seq_printf(m, "       max_mod_rpcs: %hu\n",
 			      ocd->ocd_maxmodrpcs);
+	if (flags & OBD_CONNECT_FLAGS2)
+		seq_printf(m, "       flags2: "LPX64"\n",
+			      ocd->ocd_connect_flags2);
 }
 
 int lprocfs_import_seq_show(struct seq_file *m, void *data)
@@ -228,6 +228,31 @@ static int lprocfs_exp_hash_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_exp_hash);
 
+static int
+lprocfs_exp_print_lock_count_seq(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				 struct hlist_node *hnode, void *cb_data)
+{
+	struct seq_file *m = cb_data;
+	struct obd_export *exp = cfs_hash_object(hs, hnode);
+
+	if (exp->exp_lock_hash != NULL)
+		seq_printf(m, "%s: "LPU64"\n",
+			   obd_uuid2str(&exp->exp_client_uuid),
+			   cfs_hash_size_get(exp->exp_lock_hash));
+	return 0;
+}
+
+static int lprocfs_exp_lock_count_seq_show(struct seq_file *m, void *data)
+{
+	struct nid_stat *stats = m->private;
+	struct obd_device *obd = stats->nid_obd;
+
+	cfs_hash_for_each_key(obd->obd_nid_hash, &stats->nid,
+			      lprocfs_exp_print_lock_count_seq, m);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(lprocfs_exp_lock_count);
+
 int lprocfs_exp_print_replydata_seq(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 				    struct hlist_node *hnode, void *cb_data)
 
@@ -403,6 +428,15 @@ int lprocfs_exp_setup(struct obd_export *exp, lnet_nid_t *nid)
 		GOTO(destroy_new_ns, rc);
 	}
 
+	entry = lprocfs_add_simple(new_stat->nid_proc, "lock_count", new_stat,
+				   &lprocfs_exp_lock_count_fops);
+	if (IS_ERR(entry)) {
+		rc = PTR_ERR(entry);
+		CWARN("%s: Error adding the lock_count file: rc = %d\n",
+		      obd->obd_name, rc);
+		GOTO(destroy_new_ns, rc);
+	}
+
 	entry = lprocfs_add_simple(new_stat->nid_proc, "reply_data", new_stat,
 				   &lprocfs_exp_replydata_fops);
 	if (IS_ERR(entry)) {
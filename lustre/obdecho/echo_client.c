@@ -77,6 +77,14 @@ struct echo_device {
 #endif /* HAVE_SERVER_SUPPORT */
 };
 
+enum {
+	ECHO_PAGE_STATS_PAGES,
+	ECHO_PAGE_STATS_SETUP,
+	ECHO_PAGE_STATS_TRANSFER,
+	ECHO_PAGE_STATS_TEARDOWN,
+	ECHO_PAGE_STATS_LAST
+};
+
 struct echo_object {
 	struct cl_object	eo_cl;
 	struct cl_object_header	eo_hdr;
@@ -1294,6 +1302,11 @@ static int cl_echo_object_brw(struct echo_object *eco, int rw, u64 offset,
         struct cl_io            *io;
         struct cl_page          *clp;
         struct lustre_handle    lh = { 0 };
+	struct lprocfs_stats	*stats = ed->ed_ec->ec_page_stats;
+	struct timeval		 start = { 0 };
+	struct timeval		 setup = { 0 };
+	struct timeval		 transfer = { 0 };
+	struct timeval		 end = { 0 };
         int page_size = cl_page_size(obj);
         int rc;
         int i;
@@ -1326,6 +1339,7 @@ static int cl_echo_object_brw(struct echo_object *eco, int rw, u64 offset,
         if (rc < 0)
                 GOTO(error_lock, rc);
 
+	do_gettimeofday(&start);
         for (i = 0; i < npages; i++) {
                 LASSERT(pages[i]);
                 clp = cl_page_find(env, obj, cl_index(obj, offset),
@@ -1353,6 +1367,7 @@ static int cl_echo_object_brw(struct echo_object *eco, int rw, u64 offset,
                 offset += page_size;
         }
 
+	do_gettimeofday(&setup);
         if (rc == 0) {
                 enum cl_req_type typ = rw == READ ? CRT_READ : CRT_WRITE;
 
@@ -1366,6 +1381,7 @@ static int cl_echo_object_brw(struct echo_object *eco, int rw, u64 offset,
                 CDEBUG(D_INFO, "echo_client %s write returns %d\n",
                        async ? "async" : "sync", rc);
         }
+	do_gettimeofday(&transfer);
 
         cl_echo_cancel0(env, ed, lh.cookie);
         EXIT;
@@ -1373,6 +1389,16 @@ error_lock:
         cl_2queue_discard(env, io, queue);
         cl_2queue_disown(env, io, queue);
         cl_2queue_fini(env, queue);
+	if (rc == 0 && stats != NULL) {
+		do_gettimeofday(&end);
+		lprocfs_counter_add(stats, ECHO_PAGE_STATS_PAGES, npages);
+		lprocfs_counter_add(stats, ECHO_PAGE_STATS_SETUP,
+				    cfs_timeval_sub(&setup, &start, NULL));
+		lprocfs_counter_add(stats, ECHO_PAGE_STATS_TRANSFER,
+				    cfs_timeval_sub(&transfer, &setup, NULL));
+		lprocfs_counter_add(stats, ECHO_PAGE_STATS_TEARDOWN,
+				    cfs_timeval_sub(&end, &transfer, NULL));
+	}
         cl_io_fini(env, io);
 out:
         cl_env_put(env, &refcheck);
@@ -2741,6 +2767,52 @@ out_alloc:
         return rc;
 }
 
+/*
+ * Statistics of the bulk IO of the echo client, split into the setup of
+ * the cl_pages, the transfer itself and the teardown of the pages. Driven
+ * by "lctl test_brw", they give the per-page CPU cost of the client IO
+ * stack: (setup + teardown) / pages.
+ */
+static void echo_page_stats_init(struct obd_device *obddev)
+{
+	struct echo_client_obd *ec = &obddev->u.echo_client;
+	struct lprocfs_stats *stats;
+
+	if (lprocfs_obd_setup(obddev) != 0)
+		return;
+
+	stats = lprocfs_alloc_stats(ECHO_PAGE_STATS_LAST, 0);
+	if (stats == NULL)
+		return;
+
+	lprocfs_counter_init(stats, ECHO_PAGE_STATS_PAGES,
+			     LPROCFS_CNTR_AVGMINMAX, "pages", "pages");
+	lprocfs_counter_init(stats, ECHO_PAGE_STATS_SETUP,
+			     LPROCFS_CNTR_AVGMINMAX, "page_setup", "usec");
+	lprocfs_counter_init(stats, ECHO_PAGE_STATS_TRANSFER,
+			     LPROCFS_CNTR_AVGMINMAX, "transfer", "usec");
+	lprocfs_counter_init(stats, ECHO_PAGE_STATS_TEARDOWN,
+			     LPROCFS_CNTR_AVGMINMAX, "page_teardown", "usec");
+	if (lprocfs_register_stats(obddev->obd_proc_entry, "page_stats",
+				   stats) != 0) {
+		lprocfs_free_stats(&stats);
+		return;
+	}
+	ec->ec_page_stats = stats;
+}
+
+static void echo_page_stats_fini(struct obd_device *obddev)
+{
+	struct echo_client_obd *ec = &obddev->u.echo_client;
+
+	if (obddev->obd_proc_entry == NULL)
+		return;
+
+	lprocfs_obd_cleanup(obddev);
+	if (ec->ec_page_stats != NULL)
+		lprocfs_free_stats(&ec->ec_page_stats);
+}
+
 static int echo_client_setup(const struct lu_env *env,
                              struct obd_device *obddev, struct lustre_cfg *lcfg)
 {
@@ -2767,6 +2839,7 @@ static int echo_client_setup(const struct lu_env *env,
 	INIT_LIST_HEAD(&ec->ec_objects);
 	INIT_LIST_HEAD(&ec->ec_locks);
         ec->ec_unique = 0;
+	ec->ec_page_stats = NULL;
 
 	if (!strcmp(tgt->obd_type->typ_name, LUSTRE_MDT_NAME)) {
 #ifdef HAVE_SERVER_SUPPORT
@@ -2812,6 +2885,8 @@ static int echo_client_setup(const struct lu_env *env,
                 return (rc);
         }
 
+	echo_page_stats_init(obddev);
+
         RETURN(rc);
 }
 
@@ -2842,6 +2917,8 @@ static int echo_client_cleanup(struct obd_device *obddev)
                 RETURN(-EBUSY);
         }
 
+	echo_page_stats_fini(obddev);
+
 	LASSERT(atomic_read(&ec->ec_exp->exp_refcount) > 0);
         rc = obd_disconnect(ec->ec_exp);
         if (rc != 0)
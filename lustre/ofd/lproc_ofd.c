@@ -81,10 +81,14 @@ static int ofd_tot_dirty_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
 	struct ofd_device *ofd;
+	u64		   tot_dirty;
+	u64		   tot_granted;
+	u64		   tot_pending;
 
 	LASSERT(obd != NULL);
 	ofd = ofd_dev(obd->obd_lu_dev);
-	return seq_printf(m, LPU64"\n", ofd->ofd_tot_dirty);
+	ofd_grant_totals(ofd, &tot_dirty, &tot_granted, &tot_pending);
+	return seq_printf(m, LPU64"\n", tot_dirty);
 }
 LPROC_SEQ_FOPS_RO(ofd_tot_dirty);
 
@@ -101,10 +105,14 @@ static int ofd_tot_granted_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
 	struct ofd_device *ofd;
+	u64		   tot_dirty;
+	u64		   tot_granted;
+	u64		   tot_pending;
 
 	LASSERT(obd != NULL);
 	ofd = ofd_dev(obd->obd_lu_dev);
-	return seq_printf(m, LPU64"\n", ofd->ofd_tot_granted);
+	ofd_grant_totals(ofd, &tot_dirty, &tot_granted, &tot_pending);
+	return seq_printf(m, LPU64"\n", tot_granted);
 }
 LPROC_SEQ_FOPS_RO(ofd_tot_granted);
 
@@ -121,13 +129,59 @@ static int ofd_tot_pending_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
 	struct ofd_device *ofd;
+	u64		   tot_dirty;
+	u64		   tot_granted;
+	u64		   tot_pending;
 
 	LASSERT(obd != NULL);
 	ofd = ofd_dev(obd->obd_lu_dev);
-	return seq_printf(m, LPU64"\n", ofd->ofd_tot_pending);
+	ofd_grant_totals(ofd, &tot_dirty, &tot_granted, &tot_pending);
+	return seq_printf(m, LPU64"\n", tot_pending);
 }
 LPROC_SEQ_FOPS_RO(ofd_tot_pending);
 
+/**
+ * Show per-CPT grant accounting.
+ *
+ * For each grant shard, show the space granted to the clients hashed to it,
+ * the space borrowed but not granted yet, the space released by committed
+ * writes and not returned yet, and how often space had to be borrowed from
+ * the device or reclaimed from other shards.
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+static int ofd_grant_shards_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*obd = m->private;
+	struct ofd_device	*ofd;
+	struct ofd_grant_shard	*ogs;
+	int			 i;
+
+	LASSERT(obd != NULL);
+	ofd = ofd_dev(obd->obd_lu_dev);
+
+	seq_printf(m, "%-4s %14s %14s %14s %14s %14s %10s %10s\n",
+		   "cpt", "dirty", "granted", "pending", "reserve", "released",
+		   "borrows", "steals");
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards) {
+		spin_lock(&ogs->ogs_lock);
+		seq_printf(m, "%-4d %14"LPF64"u %14"LPF64"u %14"LPF64"u "
+			   "%14"LPF64"u %14"LPF64"u %10"LPF64"u %10"LPF64"u\n",
+			   i, ogs->ogs_tot_dirty,
+			   ogs->ogs_tot_granted, ogs->ogs_tot_pending,
+			   ogs->ogs_reserve, ogs->ogs_released,
+			   ogs->ogs_borrows, ogs->ogs_steals);
+		spin_unlock(&ogs->ogs_lock);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ofd_grant_shards);
+
 /**
  * Show total number of grants for precreate.
  *
@@ -894,6 +948,72 @@ ofd_lfsck_verify_pfid_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(ofd_lfsck_verify_pfid);
 
+/**
+ * Show object prefetch status and counters.
+ *
+ * "loaded" counts objects brought into the cache by the prefetch thread,
+ * "hits" counts those later used by a BRW request before being dropped.
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+static int ofd_object_prefetch_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*obd = m->private;
+	struct ofd_device	*ofd = ofd_dev(obd->obd_lu_dev);
+	__u64			 queued, dropped, loaded, hits;
+
+	spin_lock(&ofd->ofd_prefetch_lock);
+	queued = ofd->ofd_prefetch_queued;
+	dropped = ofd->ofd_prefetch_dropped;
+	loaded = ofd->ofd_prefetch_loaded;
+	hits = ofd->ofd_prefetch_hits;
+	spin_unlock(&ofd->ofd_prefetch_lock);
+
+	return seq_printf(m, "switch: %s\nqueued: "LPU64"\ndropped: "LPU64
+			  "\nloaded: "LPU64"\nhits: "LPU64"\n",
+			  ofd->ofd_prefetch_enabled ? "on" : "off",
+			  queued, dropped, loaded, hits);
+}
+
+/**
+ * Enable or disable object prefetch on BRW request arrival.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	string which represents behavior
+ *			1: prefetch objects
+ *			0: don't prefetch objects
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ *
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t
+ofd_object_prefetch_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct obd_device	*obd = m->private;
+	struct ofd_device	*ofd = ofd_dev(obd->obd_lu_dev);
+	__u32			 val;
+	int			 rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc != 0)
+		return rc;
+
+	spin_lock(&ofd->ofd_flags_lock);
+	ofd->ofd_prefetch_enabled = !!val;
+	spin_unlock(&ofd->ofd_flags_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ofd_object_prefetch);
+
 LPROC_SEQ_FOPS_RO_TYPE(ofd, uuid);
 LPROC_SEQ_FOPS_RO_TYPE(ofd, blksize);
 LPROC_SEQ_FOPS_RO_TYPE(ofd, kbytestotal);
@@ -938,6 +1058,8 @@ struct lprocfs_vars lprocfs_ofd_obd_vars[] = {
 	  .fops =	&ofd_tot_pending_fops		},
 	{ .name =	"tot_granted",
 	  .fops =	&ofd_tot_granted_fops		},
+	{ .name =	"grant_shards",
+	  .fops =	&ofd_grant_shards_fops		},
 	{ .name =	"grant_precreate",
 	  .fops =	&ofd_grant_precreate_fops	},
 	{ .name =	"grant_ratio",
@@ -980,6 +1102,8 @@ struct lprocfs_vars lprocfs_ofd_obd_vars[] = {
 	  .fops =	&ofd_lfsck_layout_fops		},
 	{ .name	=	"lfsck_verify_pfid",
 	  .fops	=	&ofd_lfsck_verify_pfid_fops	},
+	{ .name	=	"object_prefetch",
+	  .fops	=	&ofd_object_prefetch_fops	},
 	{ NULL }
 };
 
@@ -404,6 +404,7 @@ static int ofd_object_init(const struct lu_env *env, struct lu_object *o,
 			   const struct lu_object_conf *conf)
 {
 	struct ofd_device	*d = ofd_dev(o->lo_dev);
+	struct ofd_thread_info	*info;
 	struct lu_device	*under;
 	struct lu_object	*below;
 	int			 rc = 0;
@@ -420,6 +421,15 @@ static int ofd_object_init(const struct lu_env *env, struct lu_object *o,
 	else
 		rc = -ENOMEM;
 
+	/* not every environment finding OFD objects carries OFD context */
+	info = lu_context_key_get(&env->le_ctx, &ofd_thread_key);
+	if (rc == 0 && info != NULL && info->fti_prefetch) {
+		set_bit(OFO_PREFETCHED, &ofd_obj(o)->ofo_flags);
+		spin_lock(&d->ofd_prefetch_lock);
+		d->ofd_prefetch_loaded++;
+		spin_unlock(&d->ofd_prefetch_lock);
+	}
+
 	RETURN(rc);
 }
 
@@ -1834,6 +1844,7 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 	struct lu_fid		*fid = &fti->fti_fid;
 	u64			 oid;
 	u32			 count;
+	u32			 done = 0;
 	int			 rc = 0;
 
 	ENTRY;
@@ -1871,7 +1882,15 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 	while (count > 0) {
 		int lrc;
 
-		lrc = ofd_destroy_by_fid(tsi->tsi_env, ofd, fid, 0);
+		/* fail an object in the middle of a range */
+		if (done > 0 && OBD_FAIL_CHECK(OBD_FAIL_OST_DESTROY_PARTIAL))
+			lrc = -EIO;
+		else
+			lrc = ofd_destroy_by_fid(tsi->tsi_env, ofd, fid, 0);
+		/* report objects of a range as destroyed already */
+		if (lrc == 0 && count > 1 &&
+		    OBD_FAIL_CHECK(OBD_FAIL_OST_DESTROY_ENOENT))
+			lrc = ofd_destroy_by_fid(tsi->tsi_env, ofd, fid, 0);
 		if (lrc == -ENOENT) {
 			CDEBUG(D_INODE,
 			       "%s: destroying non-existent object "DFID"\n",
@@ -1882,10 +1901,18 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 		} else if (lrc != 0) {
 			CERROR("%s: error destroying object "DFID": %d\n",
 			       ofd_name(ofd), PFID(fid), lrc);
-			rc = lrc;
+			/* stop at the first failed object of a range and
+			 * report how many objects were handled before it,
+			 * the caller keeps the llog records of the rest */
+			if (body->oa.o_valid & OBD_MD_FLOBJCOUNT) {
+				repbody->oa.o_misc = done;
+				repbody->oa.o_valid |= OBD_MD_FLOBJCOUNT;
+			}
+			GOTO(out, rc = lrc);
 		}
 
 		count--;
+		done++;
 		oid++;
 		lrc = fid_set_id(fid, oid);
 		if (unlikely(lrc != 0 && count > 0))
@@ -2248,12 +2275,14 @@ static int ofd_prolong_one_lock(struct tgt_session_info *tsi,
  * request may cover multiple locks.
  *
  * \param[in] tsi	target session environment for this request
+ * \param[in] resid	resource of the object the extent belongs to
  * \param[in] start	start of extent
  * \param[in] end	end of extent
  *
  * \retval		number of prolonged locks
  */
 static int ofd_prolong_extent_locks(struct tgt_session_info *tsi,
+				    const struct ldlm_res_id *resid,
 				    __u64 start, __u64 end)
 {
 	struct obd_export	*exp = tsi->tsi_exp;
@@ -2275,6 +2304,7 @@ static int ofd_prolong_extent_locks(struct tgt_session_info *tsi,
 			/* Fast path to check if the lock covers the whole IO
 			 * region exclusively. */
 			if (lock->l_granted_mode == LCK_PW &&
+			    ldlm_res_eq(resid, &lock->l_resource->lr_name) &&
 			    ldlm_extent_contain(&lock->l_policy_data.l_extent,
 						&extent)) {
 				/* bingo */
@@ -2298,7 +2328,7 @@ static int ofd_prolong_extent_locks(struct tgt_session_info *tsi,
 		if (lock->l_granted_mode != lock->l_req_mode)
 			break;
 
-		if (!ldlm_res_eq(&tsi->tsi_resid, &lock->l_resource->lr_name))
+		if (!ldlm_res_eq(resid, &lock->l_resource->lr_name))
 			continue;
 
 		if (!ldlm_extent_overlap(&lock->l_policy_data.l_extent,
@@ -2316,7 +2346,8 @@ static int ofd_prolong_extent_locks(struct tgt_session_info *tsi,
  * Implementation of ptlrpc_hpreq_ops::hpreq_lock_match for OFD RW requests.
  *
  * Determine if \a lock and the lock from request \a req are equivalent
- * by comparing their resource names, modes, and extents.
+ * by comparing their resource names, modes, and extents. Each object of
+ * a multi-object BRW is compared with the extent of its own niobufs.
  *
  * It is used to give priority to read and write RPCs being done
  * under this lock so that the client can drop the contended
@@ -2339,23 +2370,19 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	enum ldlm_mode  mode;
 	struct ldlm_extent ext;
 	__u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	int obj_count;
+	int i;
 
 	ENTRY;
 
 	ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
 	LASSERT(ioo != NULL);
+	obj_count = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					 RCL_CLIENT) / sizeof(*ioo);
 
 	rnb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
 	LASSERT(rnb != NULL);
 
-	ext.start = rnb->rnb_offset;
-	rnb += ioo->ioo_bufcnt - 1;
-	ext.end = rnb->rnb_offset + rnb->rnb_len - 1;
-
-	LASSERT(lock->l_resource != NULL);
-	if (!ostid_res_name_eq(&ioo->ioo_oid, &lock->l_resource->lr_name))
-		RETURN(0);
-
 	/* a bulk write can only hold a reference on a PW extent lock */
 	mode = LCK_PW;
 	if (opc == OST_READ)
@@ -2366,7 +2393,20 @@ static int ofd_rw_hpreq_lock_match(struct ptlrpc_request *req,
 	if (!(lock->l_granted_mode & mode))
 		RETURN(0);
 
-	RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext));
+	LASSERT(lock->l_resource != NULL);
+	for (i = 0; i < obj_count; rnb += ioo[i].ioo_bufcnt, i++) {
+		if (!ostid_res_name_eq(&ioo[i].ioo_oid,
+				       &lock->l_resource->lr_name))
+			continue;
+
+		ext.start = rnb[0].rnb_offset;
+		ext.end = rnb[ioo[i].ioo_bufcnt - 1].rnb_offset +
+			  rnb[ioo[i].ioo_bufcnt - 1].rnb_len - 1;
+		if (ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext))
+			RETURN(1);
+	}
+
+	RETURN(0);
 }
 
 /**
@@ -2385,8 +2425,11 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 	struct tgt_session_info	*tsi;
 	struct obd_ioobj	*ioo;
 	struct niobuf_remote	*rnb;
+	struct ldlm_res_id	 resid;
 	__u64			 start, end;
-	int			 lock_count;
+	int			 lock_count = 0;
+	int			 obj_count;
+	int			 i;
 
 	ENTRY;
 
@@ -2400,21 +2443,28 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 	 */
 	ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
 	LASSERT(ioo != NULL);
+	obj_count = req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+					 RCL_CLIENT) / sizeof(*ioo);
 
 	rnb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
 	LASSERT(rnb != NULL);
 	LASSERT(!(rnb->rnb_flags & OBD_BRW_SRVLOCK));
 
-	start = rnb->rnb_offset;
-	rnb += ioo->ioo_bufcnt - 1;
-	end = rnb->rnb_offset + rnb->rnb_len - 1;
+	/* each object of a multi-object BRW has its own locks */
+	for (i = 0; i < obj_count; rnb += ioo[i].ioo_bufcnt, i++) {
+		start = rnb[0].rnb_offset;
+		end = rnb[ioo[i].ioo_bufcnt - 1].rnb_offset +
+		      rnb[ioo[i].ioo_bufcnt - 1].rnb_len - 1;
 
-	DEBUG_REQ(D_RPCTRACE, req, "%s %s: refresh rw locks: "DFID
-				   " ("LPU64"->"LPU64")\n",
-		  tgt_name(tsi->tsi_tgt), current->comm,
-		  PFID(&tsi->tsi_fid), start, end);
+		DEBUG_REQ(D_RPCTRACE, req, "%s %s: refresh rw locks: "DOSTID
+					   " ("LPU64"->"LPU64")\n",
+			  tgt_name(tsi->tsi_tgt), current->comm,
+			  POSTID(&ioo[i].ioo_oid), start, end);
 
-	lock_count = ofd_prolong_extent_locks(tsi, start, end);
+		ostid_build_res_name(&ioo[i].ioo_oid, &resid);
+		lock_count += ofd_prolong_extent_locks(tsi, &resid, start,
+						       end);
+	}
 
 	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
 	       tgt_name(tsi->tsi_tgt), lock_count, req);
@@ -2503,7 +2553,8 @@ static int ofd_punch_hpreq_check(struct ptlrpc_request *req)
 	       tgt_name(tsi->tsi_tgt), tsi->tsi_resid.name[0],
 	       tsi->tsi_resid.name[1], oa->o_size, oa->o_blocks);
 
-	lock_count = ofd_prolong_extent_locks(tsi, oa->o_size, oa->o_blocks);
+	lock_count = ofd_prolong_extent_locks(tsi, &tsi->tsi_resid,
+					      oa->o_size, oa->o_blocks);
 
 	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
 	       tgt_name(tsi->tsi_tgt), lock_count, req);
@@ -2552,6 +2603,9 @@ static void ofd_hp_brw(struct tgt_session_info *tsi)
 
 	ENTRY;
 
+	/* start loading the object while the request waits in NRS */
+	ofd_prefetch_queue(ofd_exp(tsi->tsi_exp), &tsi->tsi_fid);
+
 	ioo = req_capsule_client_get(tsi->tsi_pill, &RMF_OBD_IOOBJ);
 	LASSERT(ioo != NULL); /* must exist after request preprocessing */
 	if (ioo->ioo_bufcnt > 0) {
@@ -2763,14 +2817,16 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	m->ofd_osfs_inflight = 0;
 
 	/* grant data */
-	spin_lock_init(&m->ofd_grant_lock);
-	m->ofd_tot_dirty = 0;
-	m->ofd_tot_granted = 0;
-	m->ofd_tot_pending = 0;
+	rc = ofd_grant_init(m);
+	if (rc != 0)
+		RETURN(rc);
 	m->ofd_seq_count = 0;
 	init_waitqueue_head(&m->ofd_inconsistency_thread.t_ctl_waitq);
 	INIT_LIST_HEAD(&m->ofd_inconsistency_list);
 	spin_lock_init(&m->ofd_inconsistency_lock);
+	init_waitqueue_head(&m->ofd_prefetch_thread.t_ctl_waitq);
+	spin_lock_init(&m->ofd_prefetch_lock);
+	m->ofd_prefetch_enabled = 1;
 
 	spin_lock_init(&m->ofd_batch_lock);
 	init_rwsem(&m->ofd_lastid_rwsem);
@@ -2783,7 +2839,7 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	rc = ofd_procfs_init(m);
 	if (rc) {
 		CERROR("Can't init ofd lprocfs, rc %d\n", rc);
-		RETURN(rc);
+		GOTO(err_fini_grant, rc);
 	}
 
 	/* No connection accepted until configurations will finish */
@@ -2871,10 +2927,17 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	if (rc != 0)
 		GOTO(err_fini_fs, rc);
 
+	rc = ofd_start_prefetch_thread(m);
+	if (rc != 0)
+		GOTO(err_stop_verify, rc);
+
 	tgt_adapt_sptlrpc_conf(&m->ofd_lut, 1);
 
 	RETURN(0);
 
+err_stop_verify:
+	ofd_stop_prefetch_thread(m);
+	ofd_stop_inconsistency_verification_thread(m);
 err_fini_fs:
 	ofd_fs_cleanup(env, m);
 err_fini_lut:
@@ -2886,6 +2949,8 @@ err_fini_stack:
 	ofd_stack_fini(env, m, &m->ofd_osd->dd_lu_dev);
 err_fini_proc:
 	ofd_procfs_fini(m);
+err_fini_grant:
+	ofd_grant_fini(m);
 	return rc;
 }
 
@@ -2917,6 +2982,7 @@ static void ofd_fini(const struct lu_env *env, struct ofd_device *m)
 
 	tgt_fini(env, &m->ofd_lut);
 	ofd_stop_inconsistency_verification_thread(m);
+	ofd_stop_prefetch_thread(m);
 	lfsck_degister(env, m->ofd_osd);
 	ofd_fs_cleanup(env, m);
 
@@ -2927,6 +2993,7 @@ static void ofd_fini(const struct lu_env *env, struct ofd_device *m)
 
 	ofd_stack_fini(env, m, &m->ofd_dt_dev.dd_lu_dev);
 	ofd_procfs_fini(m);
+	ofd_grant_fini(m);
 	LASSERT(atomic_read(&d->ld_ref) == 0);
 	server_put_mount(obd->obd_name, true);
 	EXIT;
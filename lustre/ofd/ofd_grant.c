@@ -60,6 +60,10 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define OFD_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Space released by committed writes in a grant shard is given back to
+ * ofd_tot_granted once it exceeds this threshold */
+#define OFD_GRANT_SHARD_RELEASE		(8 * OFD_GRANT_CHUNK)
+
 static inline u64 ofd_grant_from_cli(struct obd_export *exp,
 				     struct ofd_device *ofd, u64 val)
 {
@@ -96,48 +100,147 @@ static inline u64 ofd_grant_chunk(struct obd_export *exp,
 }
 
 /**
- * Perform extra sanity checks for grant accounting.
+ * Find the grant shard accounting for an export.
  *
- * This function scans the export list, sanity checks per-export grant counters
- * and verifies accuracy of global grant accounting. If an inconsistency is
- * found, a CERROR is printed with the function name \func that was passed as
- * argument. LBUG is only called in case of serious counter corruption (i.e.
- * value larger than the device size).
- * Those sanity checks can be pretty expensive and are disabled if the OBD
- * device has more than 100 connected exports.
+ * Shards are per-CPT, but an export is not bound to the CPT of the thread
+ * handling its request: the fed_* counters of an export must always be
+ * protected by the same lock, while requests of one client are served on
+ * any CPT. The export handle cookie is used instead since it is stable for
+ * the lifetime of the export and handles are allocated with a fixed
+ * increment, which spreads exports evenly across shards.
  *
- * \param[in] obd	OBD device for which grant accounting should be
- *			verified
- * \param[in] func	caller's function name
+ * \param[in] ofd	OFD device
+ * \param[in] exp	export
+ *
+ * \retval		grant shard of \a exp
  */
-void ofd_grant_sanity_check(struct obd_device *obd, const char *func)
+static inline struct ofd_grant_shard *ofd_grant_shard(struct ofd_device *ofd,
+						      struct obd_export *exp)
 {
-	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
-	struct obd_export *exp;
-	u64		   maxsize;
-	u64		   tot_dirty = 0;
-	u64		   tot_pending = 0;
-	u64		   tot_granted = 0;
-	u64		   fo_tot_granted;
-	u64		   fo_tot_pending;
-	u64		   fo_tot_dirty;
+	unsigned long	cookie = exp->exp_handle.h_cookie;
 
-	if (list_empty(&obd->obd_exports))
-		return;
+	return ofd->ofd_grant_shards[cookie %
+				     cfs_percpt_number(ofd->ofd_grant_shards)];
+}
 
-	/* We don't want to do this for large machines that do lots of
-	 * mounts or unmounts.  It burns... */
-	if (obd->obd_num_exports > 100)
+/**
+ * Allocate per-CPT grant shards.
+ *
+ * \param[in] ofd	OFD device
+ *
+ * \retval		0 on success
+ * \retval		-ENOMEM if shards cannot be allocated
+ */
+int ofd_grant_init(struct ofd_device *ofd)
+{
+	struct ofd_grant_shard	*ogs;
+	int			 i;
+
+	spin_lock_init(&ofd->ofd_grant_lock);
+	ofd->ofd_tot_granted = 0;
+
+	ofd->ofd_grant_shards = cfs_percpt_alloc(cfs_cpt_table, sizeof(*ogs));
+	if (ofd->ofd_grant_shards == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards)
+		spin_lock_init(&ogs->ogs_lock);
+
+	return 0;
+}
+
+/**
+ * Free per-CPT grant shards.
+ *
+ * \param[in] ofd	OFD device
+ */
+void ofd_grant_fini(struct ofd_device *ofd)
+{
+	if (ofd->ofd_grant_shards == NULL)
 		return;
 
-	maxsize = ofd->ofd_osfs.os_blocks << ofd->ofd_blockbits;
+	cfs_percpt_free(ofd->ofd_grant_shards);
+	ofd->ofd_grant_shards = NULL;
+}
 
-	spin_lock(&obd->obd_dev_lock);
-	spin_lock(&ofd->ofd_grant_lock);
-	list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+/**
+ * Sum grant counters over all shards.
+ *
+ * Each shard is locked in turn, so the result is not an atomic snapshot, but
+ * it is good enough for statfs and procfs reporting.
+ *
+ * \param[in] ofd	OFD device
+ * \param[out] dirty	total amount of dirty data reported by clients
+ * \param[out] granted	total space granted to clients
+ * \param[out] pending	total grant used by I/Os in progress
+ */
+void ofd_grant_totals(struct ofd_device *ofd, u64 *dirty, u64 *granted,
+		      u64 *pending)
+{
+	struct ofd_grant_shard	*ogs;
+	int			 i;
+
+	*dirty = *granted = *pending = 0;
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards) {
+		spin_lock(&ogs->ogs_lock);
+		*dirty += ogs->ogs_tot_dirty;
+		*granted += ogs->ogs_tot_granted;
+		*pending += ogs->ogs_tot_pending;
+		spin_unlock(&ogs->ogs_lock);
+	}
+}
+
+/**
+ * Return space released by committed writes to ofd_tot_granted.
+ *
+ * Caller must hold ofd_grant_lock and the shard lock.
+ *
+ * \param[in] ofd	OFD device
+ * \param[in] ogs	grant shard
+ */
+static void ofd_grant_shard_flush(struct ofd_device *ofd,
+				  struct ofd_grant_shard *ogs)
+{
+	assert_spin_locked(&ofd->ofd_grant_lock);
+	LASSERTF(ofd->ofd_tot_granted >= ogs->ogs_released,
+		 "%s: tot_granted "LPU64" < released "LPU64"\n",
+		 ofd_name(ofd), ofd->ofd_tot_granted, ogs->ogs_released);
+
+	ofd->ofd_tot_granted -= ogs->ogs_released;
+	ogs->ogs_borrowed -= ogs->ogs_released;
+	ogs->ogs_released = 0;
+}
+
+/**
+ * Check the grant counters of the exports of one shard.
+ *
+ * Walk \a list and add the counters of the exports accounted in \a ogs to
+ * the totals. LBUG is called if a counter is larger than the device size.
+ * Caller must hold obd_dev_lock and the lock of \a ogs.
+ *
+ * \param[in] obd		OBD device
+ * \param[in] ogs		grant shard
+ * \param[in] list		export list to walk
+ * \param[in] maxsize		device size in bytes
+ * \param[in,out] granted	sum of fed_grant + fed_pending
+ * \param[in,out] pending	sum of fed_pending
+ * \param[in,out] dirty		sum of fed_dirty
+ */
+static void ofd_grant_shard_check(struct obd_device *obd,
+				  struct ofd_grant_shard *ogs,
+				  struct list_head *list, u64 maxsize,
+				  u64 *granted, u64 *pending, u64 *dirty)
+{
+	struct ofd_device	*ofd = ofd_dev(obd->obd_lu_dev);
+	struct obd_export	*exp;
+
+	list_for_each_entry(exp, list, exp_obd_chain) {
 		struct filter_export_data	*fed;
 		int				 error = 0;
 
+		if (ofd_grant_shard(ofd, exp) != ogs)
+			continue;
+
 		fed = &exp->exp_filter_data;
 
 		if (obd->obd_self_export == exp)
@@ -154,7 +257,7 @@ void ofd_grant_sanity_check(struct obd_device *obd, const char *func)
 			       exp->exp_client_uuid.uuid, exp, fed->fed_grant,
 			       fed->fed_pending, maxsize);
 			spin_unlock(&obd->obd_dev_lock);
-			spin_unlock(&ofd->ofd_grant_lock);
+			spin_unlock(&ogs->ogs_lock);
 			LBUG();
 		}
 		if (fed->fed_dirty > maxsize) {
@@ -162,60 +265,87 @@ void ofd_grant_sanity_check(struct obd_device *obd, const char *func)
 			       ")\n", obd->obd_name, exp->exp_client_uuid.uuid,
 			       exp, fed->fed_dirty, maxsize);
 			spin_unlock(&obd->obd_dev_lock);
-			spin_unlock(&ofd->ofd_grant_lock);
+			spin_unlock(&ogs->ogs_lock);
 			LBUG();
 		}
 		CDEBUG_LIMIT(error ? D_ERROR : D_CACHE, "%s: cli %s/%p dirty "
 			     "%ld pend %ld grant %ld\n", obd->obd_name,
 			     exp->exp_client_uuid.uuid, exp, fed->fed_dirty,
 			     fed->fed_pending, fed->fed_grant);
-		tot_granted += fed->fed_grant + fed->fed_pending;
-		tot_pending += fed->fed_pending;
-		tot_dirty += fed->fed_dirty;
+		*granted += fed->fed_grant + fed->fed_pending;
+		*pending += fed->fed_pending;
+		*dirty += fed->fed_dirty;
 	}
+}
 
-	/* exports about to be unlinked should also be taken into account since
-	 * they might still hold pending grant space to be released at
-	 * commit time */
-	list_for_each_entry(exp, &obd->obd_unlinked_exports, exp_obd_chain) {
-		struct filter_export_data	*fed;
-		int				 error = 0;
+/**
+ * Perform extra sanity checks for grant accounting.
+ *
+ * This function scans the export list, sanity checks per-export grant counters
+ * and verifies accuracy of global grant accounting. If an inconsistency is
+ * found, a CERROR is printed with the function name \func that was passed as
+ * argument. LBUG is only called in case of serious counter corruption (i.e.
+ * value larger than the device size).
+ * Those sanity checks can be pretty expensive and are disabled if the OBD
+ * device has more than 100 connected exports.
+ *
+ * \param[in] obd	OBD device for which grant accounting should be
+ *			verified
+ * \param[in] func	caller's function name
+ */
+void ofd_grant_sanity_check(struct obd_device *obd, const char *func)
+{
+	struct ofd_device	*ofd = ofd_dev(obd->obd_lu_dev);
+	struct ofd_grant_shard	*ogs;
+	u64			 maxsize;
+	u64			 tot_dirty = 0;
+	u64			 tot_pending = 0;
+	u64			 tot_granted = 0;
+	u64			 fo_tot_granted = 0;
+	u64			 fo_tot_pending = 0;
+	u64			 fo_tot_dirty = 0;
+	u64			 fo_tot_borrowed = 0;
+	int			 i;
 
-		fed = &exp->exp_filter_data;
+	if (list_empty(&obd->obd_exports))
+		return;
 
-		if (fed->fed_grant < 0 || fed->fed_pending < 0 ||
-		    fed->fed_dirty < 0)
-			error = 1;
-		if (fed->fed_grant + fed->fed_pending > maxsize) {
-			CERROR("%s: cli %s/%p fed_grant(%ld) + fed_pending(%ld)"
-			       " > maxsize("LPU64")\n", obd->obd_name,
-			       exp->exp_client_uuid.uuid, exp, fed->fed_grant,
-			       fed->fed_pending, maxsize);
-			spin_unlock(&obd->obd_dev_lock);
-			spin_unlock(&ofd->ofd_grant_lock);
-			LBUG();
-		}
-		if (fed->fed_dirty > maxsize) {
-			CERROR("%s: cli %s/%p fed_dirty(%ld) > maxsize("LPU64
-			       ")\n", obd->obd_name, exp->exp_client_uuid.uuid,
-			       exp, fed->fed_dirty, maxsize);
-			spin_unlock(&obd->obd_dev_lock);
-			spin_unlock(&ofd->ofd_grant_lock);
-			LBUG();
-		}
-		CDEBUG_LIMIT(error ? D_ERROR : D_CACHE, "%s: cli %s/%p dirty "
-			     "%ld pend %ld grant %ld\n", obd->obd_name,
-			     exp->exp_client_uuid.uuid, exp, fed->fed_dirty,
-			     fed->fed_pending, fed->fed_grant);
-		tot_granted += fed->fed_grant + fed->fed_pending;
-		tot_pending += fed->fed_pending;
-		tot_dirty += fed->fed_dirty;
-	}
+	/* We don't want to do this for large machines that do lots of
+	 * mounts or unmounts.  It burns... */
+	if (obd->obd_num_exports > 100)
+		return;
 
-	spin_unlock(&obd->obd_dev_lock);
-	fo_tot_granted = ofd->ofd_tot_granted;
-	fo_tot_pending = ofd->ofd_tot_pending;
-	fo_tot_dirty = ofd->ofd_tot_dirty;
+	maxsize = ofd->ofd_osfs.os_blocks << ofd->ofd_blockbits;
+
+	/* shards are checked one at a time, the fed_* counters of an export
+	 * only change under the lock of its shard */
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards) {
+		u64	borrowed;
+
+		spin_lock(&obd->obd_dev_lock);
+		spin_lock(&ogs->ogs_lock);
+		ofd_grant_shard_check(obd, ogs, &obd->obd_exports, maxsize,
+				      &tot_granted, &tot_pending, &tot_dirty);
+		/* exports about to be unlinked should also be taken into
+		 * account since they might still hold pending grant space to
+		 * be released at commit time */
+		ofd_grant_shard_check(obd, ogs, &obd->obd_unlinked_exports,
+				      maxsize, &tot_granted, &tot_pending,
+				      &tot_dirty);
+		spin_unlock(&obd->obd_dev_lock);
+
+		fo_tot_granted += ogs->ogs_tot_granted;
+		fo_tot_pending += ogs->ogs_tot_pending;
+		fo_tot_dirty += ogs->ogs_tot_dirty;
+		borrowed = ogs->ogs_tot_granted + ogs->ogs_reserve +
+			   ogs->ogs_released;
+		if (borrowed != ogs->ogs_borrowed)
+			CERROR("%s: shard %d granted "LPU64" + reserve "LPU64
+			       " + released "LPU64" != borrowed "LPU64"\n",
+			       func, i, ogs->ogs_tot_granted, ogs->ogs_reserve,
+			       ogs->ogs_released, ogs->ogs_borrowed);
+		spin_unlock(&ogs->ogs_lock);
+	}
 
 	if (tot_granted != fo_tot_granted)
 		CERROR("%s: tot_granted "LPU64" != fo_tot_granted "LPU64"\n",
@@ -235,6 +365,14 @@ void ofd_grant_sanity_check(struct obd_device *obd, const char *func)
 	if (tot_dirty > maxsize)
 		CERROR("%s: tot_dirty "LPU64" > maxsize "LPU64"\n",
 		       func, tot_dirty, maxsize);
+
+	/* ogs_borrowed only changes under ofd_grant_lock */
+	spin_lock(&ofd->ofd_grant_lock);
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards)
+		fo_tot_borrowed += ogs->ogs_borrowed;
+	if (fo_tot_borrowed != ofd->ofd_tot_granted)
+		CERROR("%s: shards borrowed "LPU64" != ofd_tot_granted "LPU64
+		       "\n", func, fo_tot_borrowed, ofd->ofd_tot_granted);
 	spin_unlock(&ofd->ofd_grant_lock);
 }
 
@@ -286,7 +424,8 @@ static void ofd_grant_statfs(const struct lu_env *env, struct obd_export *exp,
  *
  * This is done by accessing cached statfs data previously populated by
  * ofd_grant_statfs(), from which we withdraw the space already granted to
- * clients and the reserved space.
+ * clients and the reserved space. Space borrowed by grant shards but not
+ * granted yet is withdrawn as well, see ofd_grant_shard_reserve().
  * Caller must hold ofd_grant_lock spinlock.
  *
  * \param[in] exp	export associated with the device for which the amount
@@ -295,12 +434,16 @@ static void ofd_grant_statfs(const struct lu_env *env, struct obd_export *exp,
  */
 static u64 ofd_grant_space_left(struct obd_export *exp)
 {
-	struct obd_device *obd = exp->exp_obd;
-	struct ofd_device *ofd = ofd_exp(exp);
-	u64		   tot_granted;
-	u64		   left;
-	u64		   avail;
-	u64		   unstable;
+	struct obd_device	*obd = exp->exp_obd;
+	struct ofd_device	*ofd = ofd_exp(exp);
+	struct ofd_grant_shard	*ogs;
+	u64			 tot_granted;
+	u64			 tot_pending = 0;
+	u64			 unused = 0;
+	u64			 left;
+	u64			 avail;
+	u64			 unstable;
+	int			 i;
 
 	ENTRY;
 	assert_spin_locked(&ofd->ofd_grant_lock);
@@ -314,16 +457,22 @@ static u64 ofd_grant_space_left(struct obd_export *exp)
 	tot_granted = ofd->ofd_tot_granted;
 
 	if (left < tot_granted) {
-		int mask = (left + unstable <
-			    tot_granted - ofd->ofd_tot_pending) ?
-			    D_ERROR : D_CACHE;
+		int mask;
+
+		/* shard counters are only used to decide how loud to be */
+		cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards) {
+			tot_pending += ACCESS_ONCE(ogs->ogs_tot_pending);
+			unused += ACCESS_ONCE(ogs->ogs_reserve) +
+				  ACCESS_ONCE(ogs->ogs_released);
+		}
+		mask = (left + unstable + unused < tot_granted - tot_pending) ?
+		       D_ERROR : D_CACHE;
 
 		CDEBUG_LIMIT(mask, "%s: cli %s/%p left "LPU64" < tot_grant "
 			     LPU64" unstable "LPU64" pending "LPU64" "
-			     "dirty "LPU64"\n",
+			     "unused "LPU64"\n",
 			     obd->obd_name, exp->exp_client_uuid.uuid, exp,
-			     left, tot_granted, unstable,
-			     ofd->ofd_tot_pending, ofd->ofd_tot_dirty);
+			     left, tot_granted, unstable, tot_pending, unused);
 		RETURN(0);
 	}
 
@@ -343,27 +492,147 @@ static u64 ofd_grant_space_left(struct obd_export *exp)
 	left &= ~((1ULL << ofd->ofd_blockbits) - 1);
 
 	CDEBUG(D_CACHE, "%s: cli %s/%p avail "LPU64" left "LPU64" unstable "
-	       LPU64" tot_grant "LPU64" pending "LPU64"\n", obd->obd_name,
+	       LPU64" tot_grant "LPU64"\n", obd->obd_name,
 	       exp->exp_client_uuid.uuid, exp, avail, left, unstable,
-	       tot_granted, ofd->ofd_tot_pending);
+	       tot_granted);
 
 	RETURN(left);
 }
 
+/**
+ * Reclaim the space borrowed by other grant shards.
+ *
+ * Called when free space runs short, so that space sitting in the reserve of
+ * idle shards is made available again. Shards are only trylocked since the
+ * caller already holds its own shard lock; a busy shard is skipped and will
+ * give its space back by itself on its next borrow.
+ * Caller must hold ofd_grant_lock and the lock of \a self.
+ *
+ * \param[in] ofd	OFD device
+ * \param[in] self	grant shard of the caller
+ *
+ * \retval		amount of space given back to ofd_tot_granted
+ */
+static u64 ofd_grant_reclaim(struct ofd_device *ofd,
+			     struct ofd_grant_shard *self)
+{
+	struct ofd_grant_shard	*ogs;
+	u64			 reclaimed = 0;
+	int			 i;
+
+	assert_spin_locked(&ofd->ofd_grant_lock);
+
+	cfs_percpt_for_each(ogs, i, ofd->ofd_grant_shards) {
+		if (ogs == self || !spin_trylock(&ogs->ogs_lock))
+			continue;
+
+		reclaimed += ogs->ogs_reserve;
+		ofd->ofd_tot_granted -= ogs->ogs_reserve;
+		ogs->ogs_borrowed -= ogs->ogs_reserve;
+		ogs->ogs_reserve = 0;
+		reclaimed += ogs->ogs_released;
+		ofd_grant_shard_flush(ofd, ogs);
+		spin_unlock(&ogs->ogs_lock);
+	}
+
+	if (reclaimed > 0)
+		self->ogs_steals++;
+
+	return reclaimed;
+}
+
+/**
+ * Make sure a grant shard can hand out \a need bytes of new grant.
+ *
+ * If the shard reserve is large enough, nothing is done and ofd_grant_lock is
+ * not taken: this is the common case for BRWs. Otherwise, the space released
+ * by committed writes is given back to ofd_tot_granted, the reserve is topped
+ * up with a batch of free space and, if free space is short, the reserves of
+ * the other shards are reclaimed so that no shard can fail a write with
+ * -ENOSPC while free space is sitting idle in another shard.
+ * All grant space must be taken from the reserve, which was accounted in
+ * ofd_tot_granted when borrowed, so the shards can never grant more space
+ * than ofd_grant_space_left() allows.
+ * Caller must hold the shard lock.
+ *
+ * \param[in] exp	export for which space is needed
+ * \param[in] ogs	grant shard of \a exp
+ * \param[in] need	amount of space needed, in bytes
+ * \param[in] force	check the free space even if the reserve is large
+ *			enough, e.g. to process a grant shrink request
+ *
+ * \retval		free space visible from this shard, i.e. its reserve
+ *			plus the space not borrowed by any shard
+ */
+static u64 ofd_grant_shard_reserve(struct obd_export *exp,
+				   struct ofd_grant_shard *ogs, u64 need,
+				   bool force)
+{
+	struct ofd_device	*ofd = ofd_exp(exp);
+	int			 nshards;
+	u64			 low;
+	u64			 target;
+	u64			 borrow = 0;
+	u64			 left;
+
+	assert_spin_locked(&ogs->ogs_lock);
+
+	/* the reserves of all shards together are kept above the threshold
+	 * under which callers refresh statfs data, and topped up to twice
+	 * that amount, so each shard only holds its share of it */
+	nshards = cfs_percpt_number(ofd->ofd_grant_shards);
+	low = max_t(u64, 32 * ofd_grant_chunk(exp, ofd) / nshards,
+		    ofd_grant_chunk(exp, ofd));
+	target = need + 2 * low;
+
+	if (!force && ogs->ogs_reserve >= need + low)
+		return ogs->ogs_reserve;
+
+	spin_lock(&ofd->ofd_grant_lock);
+	ogs->ogs_borrows++;
+	ofd_grant_shard_flush(ofd, ogs);
+	left = ofd_grant_space_left(exp);
+	if (left < need + low && ofd_grant_reclaim(ofd, ogs) > 0)
+		left = ofd_grant_space_left(exp);
+
+	if (ogs->ogs_reserve < target) {
+		/* leave most of the free space to the other shards */
+		borrow = min(target - ogs->ogs_reserve, left / (nshards + 1));
+		if (ogs->ogs_reserve + borrow < need)
+			borrow = need - ogs->ogs_reserve;
+		/* round up to the block size, left is already aligned */
+		borrow = (borrow + (1 << ofd->ofd_blockbits) - 1) &
+			 ~((1ULL << ofd->ofd_blockbits) - 1);
+		borrow = min(borrow, left);
+		ogs->ogs_reserve += borrow;
+		ogs->ogs_borrowed += borrow;
+		ofd->ofd_tot_granted += borrow;
+	}
+	spin_unlock(&ofd->ofd_grant_lock);
+
+	CDEBUG(D_CACHE, "%s: cli %s/%p need "LPU64" borrowed "LPU64
+	       " reserve "LPU64" left "LPU64"\n", exp->exp_obd->obd_name,
+	       exp->exp_client_uuid.uuid, exp, need, borrow, ogs->ogs_reserve,
+	       left - borrow);
+
+	return ogs->ogs_reserve + left - borrow;
+}
+
 /**
  * Process grant information from obdo structure packed in incoming BRW
  *
  * Grab the dirty and seen grant announcements from the incoming obdo.
  * We will later calculate the client's new grant and return it.
- * Caller must hold ofd_grant_lock spinlock.
+ * Caller must hold the grant shard lock.
  *
  * \param[in] env	LU environment supplying osfs storage
  * \param[in] exp	export for which we received the request
+ * \param[in] ogs	grant shard of \a exp
  * \param[in,out] oa	incoming obdo sent by the client
  *
  */
 static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
-			       struct obdo *oa)
+			       struct ofd_grant_shard *ogs, struct obdo *oa)
 {
 	struct filter_export_data	*fed;
 	struct ofd_device		*ofd = ofd_exp(exp);
@@ -373,7 +642,7 @@ static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	long				 grant_chunk;
 	ENTRY;
 
-	assert_spin_locked(&ofd->ofd_grant_lock);
+	assert_spin_locked(&ogs->ogs_lock);
 
 	if ((oa->o_valid & (OBD_MD_FLBLOCKS|OBD_MD_FLGRANT)) !=
 					(OBD_MD_FLBLOCKS|OBD_MD_FLGRANT)) {
@@ -404,7 +673,7 @@ static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	 * on fed_dirty however, but we must check sanity to not assert. */
 	if (dirty > fed->fed_grant + 4 * grant_chunk)
 		dirty = fed->fed_grant + 4 * grant_chunk;
-	ofd->ofd_tot_dirty += dirty - fed->fed_dirty;
+	ogs->ogs_tot_dirty += dirty - fed->fed_dirty;
 	if (fed->fed_grant < dropped) {
 		CDEBUG(D_CACHE,
 		       "%s: cli %s/%p reports %lu dropped > grant %lu\n",
@@ -412,13 +681,15 @@ static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 		       fed->fed_grant);
 		dropped = 0;
 	}
-	if (ofd->ofd_tot_granted < dropped) {
+	if (ogs->ogs_tot_granted < dropped) {
 		CERROR("%s: cli %s/%p reports %lu dropped > tot_grant "LPU64
 		       "\n", obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       dropped, ofd->ofd_tot_granted);
+		       dropped, ogs->ogs_tot_granted);
 		dropped = 0;
 	}
-	ofd->ofd_tot_granted -= dropped;
+	/* dropped grant goes back to the shard reserve */
+	ogs->ogs_tot_granted -= dropped;
+	ogs->ogs_reserve += dropped;
 	fed->fed_grant -= dropped;
 	fed->fed_dirty = dirty;
 
@@ -426,7 +697,7 @@ static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       fed->fed_dirty, fed->fed_pending, fed->fed_grant);
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
 	EXIT;
@@ -439,14 +710,16 @@ static void ofd_grant_incoming(const struct lu_env *env, struct obd_export *exp,
  * shrinking). This function proceeds with the shrink request when there is
  * less ungranted space remaining than the amount all of the connected clients
  * would consume if they used their full grant.
- * Caller must hold ofd_grant_lock spinlock.
+ * Caller must hold the grant shard lock.
  *
  * \param[in] exp		export releasing grant space
+ * \param[in] ogs		grant shard of \a exp
  * \param[in,out] oa		incoming obdo sent by the client
  * \param[in] left_space	remaining free space with space already granted
  *				taken out
  */
-static void ofd_grant_shrink(struct obd_export *exp, struct obdo *oa,
+static void ofd_grant_shrink(struct obd_export *exp,
+			     struct ofd_grant_shard *ogs, struct obdo *oa,
 			     u64 left_space)
 {
 	struct filter_export_data	*fed;
@@ -454,7 +727,7 @@ static void ofd_grant_shrink(struct obd_export *exp, struct obdo *oa,
 	struct obd_device		*obd = exp->exp_obd;
 	long				 grant_shrink;
 
-	assert_spin_locked(&ofd->ofd_grant_lock);
+	assert_spin_locked(&ogs->ogs_lock);
 	LASSERT(exp);
 	if (left_space >= ofd->ofd_tot_granted_clients *
 			  OFD_GRANT_SHRINK_LIMIT(exp))
@@ -464,11 +737,12 @@ static void ofd_grant_shrink(struct obd_export *exp, struct obdo *oa,
 
 	fed = &exp->exp_filter_data;
 	fed->fed_grant       -= grant_shrink;
-	ofd->ofd_tot_granted -= grant_shrink;
+	ogs->ogs_tot_granted -= grant_shrink;
+	ogs->ogs_reserve     += grant_shrink;
 
 	CDEBUG(D_CACHE, "%s: cli %s/%p shrink %ld fed_grant %ld total "
 	       LPU64"\n", obd->obd_name, exp->exp_client_uuid.uuid,
-	       exp, grant_shrink, fed->fed_grant, ofd->ofd_tot_granted);
+	       exp, grant_shrink, fed->fed_grant, ogs->ogs_tot_granted);
 
 	/* client has just released some grant, don't grant any space back */
 	oa->o_grant = 0;
@@ -528,10 +802,11 @@ static inline u64 ofd_grant_rnb_size(struct obd_export *exp,
  * The OBD_BRW_GRANTED flag will be set in the rnb_flags of each network
  * buffer which has been granted enough space to proceed. Buffers without
  * this flag will fail to be written with -ENOSPC (see ofd_preprw_write().
- * Caller must hold ofd_grant_lock spinlock.
+ * Caller must hold the grant shard lock.
  *
  * \param[in] env	LU environment passed by the caller
  * \param[in] exp	export identifying the client which sent the RPC
+ * \param[in] ogs	grant shard of \a exp
  * \param[in] oa	incoming obdo in which we should return the pack the
  *			additional grant
  * \param[in,out] rnb	the list of network buffers
@@ -540,8 +815,8 @@ static inline u64 ofd_grant_rnb_size(struct obd_export *exp,
  *			taken out
  */
 static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
-			    struct obdo *oa, struct niobuf_remote *rnb,
-			    int niocount, u64 *left)
+			    struct ofd_grant_shard *ogs, struct obdo *oa,
+			    struct niobuf_remote *rnb, int niocount, u64 *left)
 {
 	struct filter_export_data	*fed = &exp->exp_filter_data;
 	struct obd_device		*obd = exp->exp_obd;
@@ -554,7 +829,7 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
 
 	ENTRY;
 
-	assert_spin_locked(&ofd->ofd_grant_lock);
+	assert_spin_locked(&ogs->ogs_lock);
 
 	if ((oa->o_valid & OBD_MD_FLFLAGS) &&
 	    (oa->o_flags & OBD_FL_RECOV_RESEND)) {
@@ -614,7 +889,8 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
 		 * done on purpose since the server can deal with large block
 		 * size, unlike some clients */
 		bytes = ofd_grant_rnb_size(NULL, ofd, &rnb[i]);
-		if (*left > ungranted + bytes) {
+		if (*left > ungranted + bytes &&
+		    ogs->ogs_reserve >= ungranted + bytes) {
 			/* if enough space, pretend it was granted */
 			ungranted += bytes;
 			rnb[i].rnb_flags |= OBD_BRW_GRANTED;
@@ -646,8 +922,9 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
 	*left -= ungranted;
 	fed->fed_grant -= granted;
 	fed->fed_pending += oa->o_grant_used;
-	ofd->ofd_tot_granted += ungranted;
-	ofd->ofd_tot_pending += oa->o_grant_used;
+	ogs->ogs_reserve -= ungranted;
+	ogs->ogs_tot_granted += ungranted;
+	ogs->ogs_tot_pending += oa->o_grant_used;
 
 	CDEBUG(D_CACHE,
 	       "%s: cli %s/%p granted: %lu ungranted: %lu grant: %lu dirty: %lu"
@@ -664,14 +941,14 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
 		       granted, fed->fed_dirty);
 		granted = fed->fed_dirty;
 	}
-	ofd->ofd_tot_dirty -= granted;
+	ogs->ogs_tot_dirty -= granted;
 	fed->fed_dirty -= granted;
 
 	if (fed->fed_dirty < 0 || fed->fed_grant < 0 || fed->fed_pending < 0) {
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       fed->fed_dirty, fed->fed_pending, fed->fed_grant);
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
 	EXIT;
@@ -681,10 +958,12 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
  * Allocate additional grant space to a client
  *
  * Calculate how much grant space to return to client, based on how much space
- * is currently free and how much of that is already granted.
- * Caller must hold ofd_grant_lock spinlock.
+ * is currently free and how much of that is already granted. The space is
+ * taken from the reserve of the grant shard.
+ * Caller must hold the grant shard lock.
  *
  * \param[in] exp		export of the client which sent the request
+ * \param[in] ogs		grant shard of \a exp
  * \param[in] curgrant		current grant claimed by the client
  * \param[in] want		how much grant space the client would like to
  *				have
@@ -697,7 +976,8 @@ static void ofd_grant_check(const struct lu_env *env, struct obd_export *exp,
  *
  * \retval			amount of grant space allocated
  */
-static long ofd_grant_alloc(struct obd_export *exp, u64 curgrant,
+static long ofd_grant_alloc(struct obd_export *exp,
+			    struct ofd_grant_shard *ogs, u64 curgrant,
 			    u64 want, u64 left, bool conservative)
 {
 	struct obd_device		*obd = exp->exp_obd;
@@ -754,14 +1034,22 @@ static long ofd_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if ((grant > grant_chunk) && conservative)
 		grant = grant_chunk;
 
-	ofd->ofd_tot_granted += grant;
+	/* never grant more than what the shard has borrowed */
+	if (grant > ogs->ogs_reserve)
+		grant = ogs->ogs_reserve &
+			~((1ULL << ofd->ofd_blockbits) - 1);
+	if (!grant)
+		RETURN(0);
+
+	ogs->ogs_reserve -= grant;
+	ogs->ogs_tot_granted += grant;
 	fed->fed_grant += grant;
 
 	if (fed->fed_grant < 0) {
 		CERROR("%s: cli %s/%p grant %ld want "LPU64" current "LPU64"\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       fed->fed_grant, want, curgrant);
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
 
@@ -770,10 +1058,10 @@ static long ofd_grant_alloc(struct obd_export *exp, u64 curgrant,
 	       " granting: "LPU64"\n", obd->obd_name, exp->exp_client_uuid.uuid,
 	       exp, want, curgrant, grant);
 	CDEBUG(D_CACHE,
-	       "%s: cli %s/%p tot cached:"LPU64" granted:"LPU64
-	       " num_exports: %d\n", obd->obd_name, exp->exp_client_uuid.uuid,
-	       exp, ofd->ofd_tot_dirty, ofd->ofd_tot_granted,
-	       obd->obd_num_exports);
+	       "%s: cli %s/%p shard cached:"LPU64" granted:"LPU64
+	       " reserve:"LPU64" num_exports: %d\n", obd->obd_name,
+	       exp->exp_client_uuid.uuid, exp, ogs->ogs_tot_dirty,
+	       ogs->ogs_tot_granted, ogs->ogs_reserve, obd->obd_num_exports);
 
 	RETURN(ofd_grant_to_cli(exp, ofd, grant));
 }
@@ -799,7 +1087,9 @@ long ofd_grant_connect(const struct lu_env *env, struct obd_export *exp,
 {
 	struct ofd_device		*ofd = ofd_exp(exp);
 	struct filter_export_data	*fed = &exp->exp_filter_data;
+	struct ofd_grant_shard		*ogs = ofd_grant_shard(ofd, exp);
 	u64				 left = 0;
+	u64				 need;
 	long				 grant;
 	int				 from_cache;
 	int				 force = 0; /* can use cached data */
@@ -809,31 +1099,37 @@ long ofd_grant_connect(const struct lu_env *env, struct obd_export *exp,
 	    ofd_grant_prohibit(exp, ofd))
 		return 0;
 
+	/* ofd_grant_alloc() refuses requests larger than 2GB anyway */
+	need = want > 0x7fffffff ? 0 : ofd_grant_from_cli(exp, ofd, want);
+
 refresh:
 	ofd_grant_statfs(env, exp, force, &from_cache);
 
-	spin_lock(&ofd->ofd_grant_lock);
+	spin_lock(&ogs->ogs_lock);
 
 	/* Grab free space from cached info and take out space already granted
 	 * to clients as well as reserved space */
-	left = ofd_grant_space_left(exp);
+	left = ofd_grant_shard_reserve(exp, ogs, need, false);
 
 	/* get fresh statfs data if we are short in ungranted space */
 	if (from_cache && left < 32 * ofd_grant_chunk(exp, ofd)) {
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		CDEBUG(D_CACHE, "fs has no space left and statfs too old\n");
 		force = 1;
 		goto refresh;
 	}
 
-	ofd_grant_alloc(exp,
+	ofd_grant_alloc(exp, ogs,
 			ofd_grant_to_cli(exp, ofd, (u64)fed->fed_grant),
 			want, left, new_conn);
 
 	/* return to client its current grant */
 	grant = ofd_grant_to_cli(exp, ofd, (u64)fed->fed_grant);
-	ofd->ofd_tot_granted_clients++;
 
+	spin_unlock(&ogs->ogs_lock);
+
+	spin_lock(&ofd->ofd_grant_lock);
+	ofd->ofd_tot_granted_clients++;
 	spin_unlock(&ofd->ofd_grant_lock);
 
 	CDEBUG(D_CACHE, "%s: cli %s/%p ocd_grant: %ld want: "LPU64" left: "
@@ -858,27 +1154,30 @@ void ofd_grant_discard(struct obd_export *exp)
 	struct obd_device		*obd = exp->exp_obd;
 	struct ofd_device		*ofd = ofd_exp(exp);
 	struct filter_export_data	*fed = &exp->exp_filter_data;
+	struct ofd_grant_shard		*ogs = ofd_grant_shard(ofd, exp);
 
-	spin_lock(&ofd->ofd_grant_lock);
-	LASSERTF(ofd->ofd_tot_granted >= fed->fed_grant,
+	spin_lock(&ogs->ogs_lock);
+	LASSERTF(ogs->ogs_tot_granted >= fed->fed_grant,
 		 "%s: tot_granted "LPU64" cli %s/%p fed_grant %ld\n",
-		 obd->obd_name, ofd->ofd_tot_granted,
+		 obd->obd_name, ogs->ogs_tot_granted,
 		 exp->exp_client_uuid.uuid, exp, fed->fed_grant);
-	ofd->ofd_tot_granted -= fed->fed_grant;
+	/* the space stays borrowed by the shard for the other exports */
+	ogs->ogs_tot_granted -= fed->fed_grant;
+	ogs->ogs_reserve += fed->fed_grant;
 	fed->fed_grant = 0;
-	LASSERTF(ofd->ofd_tot_pending >= fed->fed_pending,
+	LASSERTF(ogs->ogs_tot_pending >= fed->fed_pending,
 		 "%s: tot_pending "LPU64" cli %s/%p fed_pending %ld\n",
-		 obd->obd_name, ofd->ofd_tot_pending,
+		 obd->obd_name, ogs->ogs_tot_pending,
 		 exp->exp_client_uuid.uuid, exp, fed->fed_pending);
-	/* ofd_tot_pending is handled in ofd_grant_commit as bulk
+	/* ogs_tot_pending is handled in ofd_grant_commit as bulk
 	 * commmits */
-	LASSERTF(ofd->ofd_tot_dirty >= fed->fed_dirty,
+	LASSERTF(ogs->ogs_tot_dirty >= fed->fed_dirty,
 		 "%s: tot_dirty "LPU64" cli %s/%p fed_dirty %ld\n",
-		 obd->obd_name, ofd->ofd_tot_dirty,
+		 obd->obd_name, ogs->ogs_tot_dirty,
 		 exp->exp_client_uuid.uuid, exp, fed->fed_dirty);
-	ofd->ofd_tot_dirty -= fed->fed_dirty;
+	ogs->ogs_tot_dirty -= fed->fed_dirty;
 	fed->fed_dirty = 0;
-	spin_unlock(&ofd->ofd_grant_lock);
+	spin_unlock(&ogs->ogs_lock);
 }
 
 /**
@@ -898,6 +1197,7 @@ void ofd_grant_prepare_read(const struct lu_env *env,
 			    struct obd_export *exp, struct obdo *oa)
 {
 	struct ofd_device	*ofd = ofd_exp(exp);
+	struct ofd_grant_shard	*ogs = ofd_grant_shard(ofd, exp);
 	int			 do_shrink;
 	u64			 left = 0;
 
@@ -917,12 +1217,12 @@ void ofd_grant_prepare_read(const struct lu_env *env,
 		 * statfs information. */
 		ofd_grant_statfs(env, exp, 1, NULL);
 
-		/* protect all grant counters */
-		spin_lock(&ofd->ofd_grant_lock);
+		/* protect the grant counters of this export */
+		spin_lock(&ogs->ogs_lock);
 
 		/* Grab free space from cached statfs data and take out space
 		 * already granted to clients as well as reserved space */
-		left = ofd_grant_space_left(exp);
+		left = ofd_grant_shard_reserve(exp, ogs, 0, true);
 
 		/* all set now to proceed with shrinking */
 		do_shrink = 1;
@@ -931,21 +1231,21 @@ void ofd_grant_prepare_read(const struct lu_env *env,
 		 * since we don't grant space back on reads, no point
 		 * in running statfs, so just skip it and process
 		 * incoming grant data directly. */
-		spin_lock(&ofd->ofd_grant_lock);
+		spin_lock(&ogs->ogs_lock);
 		do_shrink = 0;
 	}
 
 	/* extract incoming grant infomation provided by the client */
-	ofd_grant_incoming(env, exp, oa);
+	ofd_grant_incoming(env, exp, ogs, oa);
 
 	/* unlike writes, we don't return grants back on reads unless a grant
 	 * shrink request was packed and we decided to turn it down. */
 	if (do_shrink)
-		ofd_grant_shrink(exp, oa, left);
+		ofd_grant_shrink(exp, ogs, oa, left);
 	else
 		oa->o_grant = 0;
 
-	spin_unlock(&ofd->ofd_grant_lock);
+	spin_unlock(&ogs->ogs_lock);
 }
 
 /**
@@ -975,26 +1275,36 @@ void ofd_grant_prepare_write(const struct lu_env *env,
 {
 	struct obd_device	*obd = exp->exp_obd;
 	struct ofd_device	*ofd = ofd_exp(exp);
+	struct ofd_grant_shard	*ogs = ofd_grant_shard(ofd, exp);
 	u64			 left;
+	u64			 need;
 	int			 from_cache;
 	int			 force = 0; /* can use cached data intially */
 	int			 rc;
+	int			 i;
 
 	ENTRY;
 
+	/* upper bound of the space this request can take from the shard:
+	 * all the buffers not covered by the client grant plus new grant */
+	need = ofd_grant_chunk(exp, ofd);
+	for (i = 0; i < niocount; i++)
+		need += ofd_grant_rnb_size(NULL, ofd, &rnb[i]);
+
 refresh:
 	/* get statfs information from OSD layer */
 	ofd_grant_statfs(env, exp, force, &from_cache);
 
-	spin_lock(&ofd->ofd_grant_lock); /* protect all grant counters */
+	/* protect the grant counters of this export */
+	spin_lock(&ogs->ogs_lock);
 
 	/* Grab free space from cached statfs data and take out space already
 	 * granted to clients as well as reserved space */
-	left = ofd_grant_space_left(exp);
+	left = ofd_grant_shard_reserve(exp, ogs, need, force != 0);
 
 	/* Get fresh statfs data if we are short in ungranted space */
 	if (from_cache && left < 32 * ofd_grant_chunk(exp, ofd)) {
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		CDEBUG(D_CACHE, "%s: fs has no space left and statfs too old\n",
 		       obd->obd_name);
 		force = 1;
@@ -1006,7 +1316,6 @@ refresh:
 	 * much space as possible. */
 	if (!obd->obd_recovering && force != 2 && left < OFD_GRANT_CHUNK) {
 		bool from_grant = true;
-		int  i;
 
 		/* That said, it is worth running a sync only if some pages did
 		 * not consume grant space on the client and could thus fail
@@ -1018,7 +1327,7 @@ refresh:
 		if (!from_grant) {
 			/* at least one network buffer requires acquiring grant
 			 * space on the server */
-			spin_unlock(&ofd->ofd_grant_lock);
+			spin_unlock(&ogs->ogs_lock);
 			/* discard errors, at least we tried ... */
 			rc = dt_sync(env, ofd->ofd_osd);
 			force = 2;
@@ -1027,13 +1336,13 @@ refresh:
 	}
 
 	/* extract incoming grant information provided by the client */
-	ofd_grant_incoming(env, exp, oa);
+	ofd_grant_incoming(env, exp, ogs, oa);
 
 	/* check limit */
-	ofd_grant_check(env, exp, oa, rnb, niocount, &left);
+	ofd_grant_check(env, exp, ogs, oa, rnb, niocount, &left);
 
 	if (!(oa->o_valid & OBD_MD_FLGRANT)) {
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		RETURN_EXIT;
 	}
 
@@ -1041,12 +1350,12 @@ refresh:
 	 * grant space. */
 	if ((oa->o_valid & OBD_MD_FLFLAGS) &&
 	    (oa->o_flags & OBD_FL_SHRINK_GRANT))
-		ofd_grant_shrink(exp, oa, left);
+		ofd_grant_shrink(exp, ogs, oa, left);
 	else
 		/* grant more space back to the client if possible */
-		oa->o_grant = ofd_grant_alloc(exp, oa->o_grant, oa->o_undirty,
-					      left, true);
-	spin_unlock(&ofd->ofd_grant_lock);
+		oa->o_grant = ofd_grant_alloc(exp, ogs, oa->o_grant,
+					      oa->o_undirty, left, true);
+	spin_unlock(&ogs->ogs_lock);
 }
 
 /**
@@ -1071,6 +1380,7 @@ long ofd_grant_create(const struct lu_env *env, struct obd_export *exp, int *nr)
 {
 	struct ofd_device		*ofd = ofd_exp(exp);
 	struct filter_export_data	*fed = &exp->exp_filter_data;
+	struct ofd_grant_shard		*ogs = ofd_grant_shard(ofd, exp);
 	u64				 left = 0;
 	unsigned long			 wanted;
 	unsigned long			 granted;
@@ -1084,27 +1394,30 @@ long ofd_grant_create(const struct lu_env *env, struct obd_export *exp, int *nr)
 	/* Update statfs data if required */
 	ofd_grant_statfs(env, exp, 1, NULL);
 
-	/* protect all grant counters */
-	spin_lock(&ofd->ofd_grant_lock);
+	/* protect the grant counters of the self export */
+	spin_lock(&ogs->ogs_lock);
 
 	/* fail precreate request if there is not enough blocks available for
 	 * writing */
 	if (ofd->ofd_osfs.os_bavail - (fed->fed_grant >> ofd->ofd_blockbits) <
 	    (ofd->ofd_osfs.os_blocks >> 10)) {
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		CDEBUG(D_RPCTRACE, "%s: not enough space for create "LPU64"\n",
 		       ofd_name(ofd),
 		       ofd->ofd_osfs.os_bavail * ofd->ofd_osfs.os_blocks);
 		RETURN(-ENOSPC);
 	}
 
-	/* Grab free space from cached statfs data and take out space
-	 * already granted to clients as well as reserved space */
-	left = ofd_grant_space_left(exp);
-
 	/* compute how much space is required to handle the precreation
 	 * request */
 	wanted = *nr * ofd->ofd_dt_conf.ddp_inodespace;
+
+	/* Grab free space from cached statfs data and take out space
+	 * already granted to clients as well as reserved space */
+	left = ofd_grant_shard_reserve(exp, ogs, wanted + OST_MAX_PRECREATE *
+				       ofd->ofd_dt_conf.ddp_inodespace / 2,
+				       false);
+
 	if (wanted > fed->fed_grant + left) {
 		/* that's beyond what remains, adjust the number of objects that
 		 * can be safely precreated */
@@ -1113,7 +1426,7 @@ long ofd_grant_create(const struct lu_env *env, struct obd_export *exp, int *nr)
 		if (*nr == 0) {
 			/* we really have no space any more for precreation,
 			 * fail the precreate request with ENOSPC */
-			spin_unlock(&ofd->ofd_grant_lock);
+			spin_unlock(&ogs->ogs_lock);
 			RETURN(-ENOSPC);
 		}
 		/* compute space needed for the new number of creations */
@@ -1126,13 +1439,15 @@ long ofd_grant_create(const struct lu_env *env, struct obd_export *exp, int *nr)
 		fed->fed_grant -= wanted;
 	} else {
 		/* we need to take some space from the ungranted pool */
-		ofd->ofd_tot_granted += wanted - fed->fed_grant;
+		LASSERT(ogs->ogs_reserve >= wanted - fed->fed_grant);
+		ogs->ogs_reserve -= wanted - fed->fed_grant;
+		ogs->ogs_tot_granted += wanted - fed->fed_grant;
 		left -= wanted - fed->fed_grant;
 		fed->fed_grant = 0;
 	}
 	granted = wanted;
 	fed->fed_pending += granted;
-	ofd->ofd_tot_pending += granted;
+	ogs->ogs_tot_pending += granted;
 
 	/* grant more space for precreate purpose if possible. */
 	wanted = OST_MAX_PRECREATE * ofd->ofd_dt_conf.ddp_inodespace / 2;
@@ -1140,9 +1455,9 @@ long ofd_grant_create(const struct lu_env *env, struct obd_export *exp, int *nr)
 		/* always try to book enough space to handle a large precreate
 		 * request */
 		wanted -= fed->fed_grant;
-		ofd_grant_alloc(exp, fed->fed_grant, wanted, left, false);
+		ofd_grant_alloc(exp, ogs, fed->fed_grant, wanted, left, false);
 	}
-	spin_unlock(&ofd->ofd_grant_lock);
+	spin_unlock(&ogs->ogs_lock);
 	RETURN(granted);
 }
 
@@ -1159,6 +1474,7 @@ void ofd_grant_commit(struct obd_export *exp, unsigned long pending,
 		      int rc)
 {
 	struct ofd_device	*ofd  = ofd_exp(exp);
+	struct ofd_grant_shard	*ogs  = ofd_grant_shard(ofd, exp);
 	ENTRY;
 
 	/* get space accounted in tot_pending for the I/O, set in
@@ -1166,7 +1482,7 @@ void ofd_grant_commit(struct obd_export *exp, unsigned long pending,
 	if (pending == 0)
 		RETURN_EXIT;
 
-	spin_lock(&ofd->ofd_grant_lock);
+	spin_lock(&ogs->ogs_lock);
 	/* Don't update statfs data for errors raised before commit (e.g.
 	 * bulk transfer failed, ...) since we know those writes have not been
 	 * processed. For other errors hit during commit, we cannot really tell
@@ -1190,30 +1506,46 @@ void ofd_grant_commit(struct obd_export *exp, unsigned long pending,
 		CERROR("%s: cli %s/%p fed_pending(%lu) < grant_used(%lu)\n",
 		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
 		       exp->exp_filter_data.fed_pending, pending);
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
 	exp->exp_filter_data.fed_pending -= pending;
 
-	if (ofd->ofd_tot_granted < pending) {
+	if (ogs->ogs_tot_granted < pending) {
 		 CERROR("%s: cli %s/%p tot_granted("LPU64") < grant_used(%lu)"
 			"\n", exp->exp_obd->obd_name,
-			exp->exp_client_uuid.uuid, exp, ofd->ofd_tot_granted,
+			exp->exp_client_uuid.uuid, exp, ogs->ogs_tot_granted,
 			pending);
-		spin_unlock(&ofd->ofd_grant_lock);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
-	ofd->ofd_tot_granted -= pending;
+	ogs->ogs_tot_granted -= pending;
 
-	if (ofd->ofd_tot_pending < pending) {
+	if (ogs->ogs_tot_pending < pending) {
 		 CERROR("%s: cli %s/%p tot_pending("LPU64") < grant_used(%lu)"
 			"\n", exp->exp_obd->obd_name, exp->exp_client_uuid.uuid,
-			exp, ofd->ofd_tot_pending, pending);
-		spin_unlock(&ofd->ofd_grant_lock);
+			exp, ogs->ogs_tot_pending, pending);
+		spin_unlock(&ogs->ogs_lock);
 		LBUG();
 	}
-	ofd->ofd_tot_pending -= pending;
-	spin_unlock(&ofd->ofd_grant_lock);
+	ogs->ogs_tot_pending -= pending;
+
+	if (rc != 0) {
+		/* nothing was written, the space can be granted again */
+		ogs->ogs_reserve += pending;
+	} else {
+		/* the space is now accounted in the statfs data, return it to
+		 * ofd_tot_granted lazily to not take ofd_grant_lock on each
+		 * commit, this only makes ofd_grant_space_left() more
+		 * conservative in the meantime */
+		ogs->ogs_released += pending;
+		if (ogs->ogs_released >= OFD_GRANT_SHARD_RELEASE) {
+			spin_lock(&ofd->ofd_grant_lock);
+			ofd_grant_shard_flush(ofd, ogs);
+			spin_unlock(&ofd->ofd_grant_lock);
+		}
+	}
+	spin_unlock(&ogs->ogs_lock);
 	EXIT;
 }
 
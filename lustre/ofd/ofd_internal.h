@@ -153,14 +153,13 @@ struct ofd_device {
 	u64			 ofd_osfs_inflight;
 
 	/* grants: all values in bytes */
-	/* grant lock to protect all grant counters */
+	/* grant lock to protect ofd_tot_granted and ofd_grant_ratio */
 	spinlock_t		 ofd_grant_lock;
-	/* total amount of dirty data reported by clients in incoming obdo */
-	u64			 ofd_tot_dirty;
-	/* sum of filesystem space granted to clients for async writes */
+	/* space handed out to the grant shards, i.e. the sum over all shards
+	 * of ogs_tot_granted + ogs_reserve + ogs_released */
 	u64			 ofd_tot_granted;
-	/* grant used by I/Os in progress (between prepare and commit) */
-	u64			 ofd_tot_pending;
+	/* per-CPT grant accounting, see struct ofd_grant_shard */
+	struct ofd_grant_shard	**ofd_grant_shards;
 	/* free space threshold over which we stop granting space to clients
 	 * ofd_grant_ratio is stored as a fixed-point fraction using
 	 * OFD_GRANT_RATIO_SHIFT of the remaining free space, not in percentage
@@ -184,7 +183,8 @@ struct ofd_device {
 				 ofd_lastid_rebuilding:1,
 				 ofd_record_fid_accessed:1,
 				 ofd_lfsck_verify_pfid:1,
-				 ofd_skip_lfsck:1;
+				 ofd_skip_lfsck:1,
+				 ofd_prefetch_enabled:1;
 	struct seq_server_site	 ofd_seq_site;
 	/* the limit of SOFT_SYNC RPCs that will trigger a soft sync */
 	unsigned int		 ofd_soft_sync_limit;
@@ -194,6 +194,54 @@ struct ofd_device {
 	struct ptlrpc_thread	 ofd_inconsistency_thread;
 	struct list_head	 ofd_inconsistency_list;
 	spinlock_t		 ofd_inconsistency_lock;
+
+	/* object prefetch: FIDs of incoming BRW requests are queued into
+	 * a ring and loaded by ofd_prefetch_main() so the inode is cached
+	 * before a service thread gets to the request */
+	struct ptlrpc_thread	 ofd_prefetch_thread;
+	spinlock_t		 ofd_prefetch_lock;
+	struct lu_fid		*ofd_prefetch_ring;
+	unsigned int		 ofd_prefetch_head;
+	unsigned int		 ofd_prefetch_tail;
+	/* counters protected by ofd_prefetch_lock */
+	__u64			 ofd_prefetch_queued;
+	__u64			 ofd_prefetch_dropped;
+	__u64			 ofd_prefetch_loaded;
+	__u64			 ofd_prefetch_hits;
+};
+
+/* number of FIDs the prefetch ring can hold, must be a power of two */
+#define OFD_PREFETCH_DEPTH	256
+
+/*
+ * Per-CPT grant accounting.
+ *
+ * Each export is hashed to one shard, and all its fed_{dirty,grant,pending}
+ * counters are protected by that shard's lock. A shard borrows space from
+ * ofd_tot_granted in batches and serves client grant out of its reserve, so
+ * most BRWs never take ofd_grant_lock. Space released by committed writes is
+ * returned to ofd_tot_granted lazily, ofd_tot_granted thus always overstates
+ * the space really granted, which keeps ofd_grant_space_left() conservative.
+ */
+struct ofd_grant_shard {
+	spinlock_t		ogs_lock;
+	/* sum of fed_dirty of the exports in this shard */
+	u64			ogs_tot_dirty;
+	/* sum of fed_grant + fed_pending of the exports in this shard */
+	u64			ogs_tot_granted;
+	/* sum of fed_pending of the exports in this shard */
+	u64			ogs_tot_pending;
+	/* space borrowed from ofd_tot_granted, not granted to anybody yet */
+	u64			ogs_reserve;
+	/* space consumed by committed writes, still in ofd_tot_granted */
+	u64			ogs_released;
+	/* share of ofd_tot_granted taken by this shard, i.e. ogs_tot_granted
+	 * + ogs_reserve + ogs_released, only changed under ofd_grant_lock */
+	u64			ogs_borrowed;
+	/* number of times ofd_grant_lock had to be taken to borrow space */
+	__u64			ogs_borrows;
+	/* number of times reserves of other shards were reclaimed */
+	__u64			ogs_steals;
 };
 
 static inline struct ofd_device *ofd_dev(struct lu_device *d)
@@ -222,6 +270,13 @@ struct ofd_object {
 	struct lu_fid		ofo_pfid;
 	unsigned int		ofo_pfid_checking:1,
 				ofo_pfid_verified:1;
+	/* OFO_* bits, updated atomically */
+	unsigned long		ofo_flags;
+};
+
+enum ofd_object_flags {
+	/* loaded by the prefetch thread and not yet used by a BRW */
+	OFO_PREFETCHED		= 0,
 };
 
 static inline struct ofd_object *ofd_obj(struct lu_object *o)
@@ -322,6 +377,8 @@ struct ofd_thread_info {
 	unsigned long			 fti_used;
 	struct ost_lvb			 fti_lvb;
 	struct lfsck_request		 fti_lr;
+	/* set by the prefetch thread around ofd_object_find() */
+	unsigned int			 fti_prefetch:1;
 };
 
 extern void target_recovery_fini(struct obd_device *obd);
@@ -365,6 +422,10 @@ void ofd_seqs_free(const struct lu_env *env, struct ofd_device *ofd);
 /* ofd_io.c */
 int ofd_start_inconsistency_verification_thread(struct ofd_device *ofd);
 int ofd_stop_inconsistency_verification_thread(struct ofd_device *ofd);
+int ofd_start_prefetch_thread(struct ofd_device *ofd);
+int ofd_stop_prefetch_thread(struct ofd_device *ofd);
+void ofd_prefetch_queue(struct ofd_device *ofd, const struct lu_fid *fid);
+void ofd_prefetch_hit(struct ofd_device *ofd, struct ofd_object *fo);
 int ofd_verify_ff(const struct lu_env *env, struct ofd_object *fo,
 		  struct obdo *oa);
 int ofd_preprw(const struct lu_env *env,int cmd, struct obd_export *exp,
@@ -472,6 +533,10 @@ static inline int ofd_grant_prohibit(struct obd_export *exp,
 	return !!(ofd_grant_compat(exp, ofd) && ofd->ofd_grant_compat_disable);
 }
 
+int ofd_grant_init(struct ofd_device *ofd);
+void ofd_grant_fini(struct ofd_device *ofd);
+void ofd_grant_totals(struct ofd_device *ofd, u64 *dirty, u64 *granted,
+		      u64 *pending);
 void ofd_grant_sanity_check(struct obd_device *obd, const char *func);
 long ofd_grant_connect(const struct lu_env *env, struct obd_export *exp,
 		       u64 want, bool new_conn);
@@ -307,6 +307,244 @@ int ofd_stop_inconsistency_verification_thread(struct ofd_device *ofd)
 	return 0;
 }
 
+/**
+ * Object prefetch thread.
+ *
+ * Kernel thread to load OFD objects queued by ofd_prefetch_queue() into
+ * the lu_object cache, so that the OSD inode lookup and the LMA check are
+ * done before a service thread handles the BRW request for that object.
+ * If parent FID verification is enabled, the filter_fid xattr is loaded
+ * as well.
+ *
+ * \param[in] args	OFD device
+ *
+ * \retval		0 on successful thread termination
+ * \retval		negative value if thread can't start
+ */
+static int ofd_prefetch_main(void *args)
+{
+	struct lu_env		 env;
+	struct ofd_device	*ofd	= args;
+	struct ptlrpc_thread	*thread = &ofd->ofd_prefetch_thread;
+	struct ofd_thread_info	*info;
+	struct ofd_object	*fo;
+	struct l_wait_info	 lwi	= { 0 };
+	int			 rc;
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_DT_THREAD);
+	spin_lock(&ofd->ofd_prefetch_lock);
+	thread_set_flags(thread, rc != 0 ? SVC_STOPPED : SVC_RUNNING);
+	wake_up_all(&thread->t_ctl_waitq);
+	spin_unlock(&ofd->ofd_prefetch_lock);
+	if (rc != 0)
+		RETURN(rc);
+
+	info = ofd_info(&env);
+	spin_lock(&ofd->ofd_prefetch_lock);
+	while (1) {
+		if (unlikely(!thread_is_running(thread)))
+			break;
+
+		while (ofd->ofd_prefetch_tail != ofd->ofd_prefetch_head) {
+			info->fti_fid = ofd->ofd_prefetch_ring[
+				ofd->ofd_prefetch_tail &
+				(OFD_PREFETCH_DEPTH - 1)];
+			ofd->ofd_prefetch_tail++;
+			spin_unlock(&ofd->ofd_prefetch_lock);
+
+			info->fti_prefetch = 1;
+			fo = ofd_object_find(&env, ofd, &info->fti_fid);
+			info->fti_prefetch = 0;
+			if (!IS_ERR(fo)) {
+				if (ofd->ofd_lfsck_verify_pfid &&
+				    ofd_object_exists(fo)) {
+					ofd_read_lock(&env, fo);
+					ofd_object_ff_load(&env, fo);
+					ofd_read_unlock(&env, fo);
+				}
+				ofd_object_put(&env, fo);
+			}
+
+			spin_lock(&ofd->ofd_prefetch_lock);
+		}
+
+		spin_unlock(&ofd->ofd_prefetch_lock);
+		l_wait_event(thread->t_ctl_waitq,
+			     ofd->ofd_prefetch_tail != ofd->ofd_prefetch_head ||
+			     !thread_is_running(thread),
+			     &lwi);
+		spin_lock(&ofd->ofd_prefetch_lock);
+	}
+
+	/* drop whatever is left, nobody is waiting for it */
+	ofd->ofd_prefetch_tail = ofd->ofd_prefetch_head;
+	thread_set_flags(thread, SVC_STOPPED);
+	wake_up_all(&thread->t_ctl_waitq);
+	spin_unlock(&ofd->ofd_prefetch_lock);
+	lu_env_fini(&env);
+
+	RETURN(0);
+}
+
+/**
+ * Start object prefetch thread.
+ *
+ * See ofd_prefetch_main().
+ *
+ * \param[in] ofd	OFD device
+ *
+ * \retval		0 on successful start of thread
+ * \retval		negative value on error
+ */
+int ofd_start_prefetch_thread(struct ofd_device *ofd)
+{
+	struct ptlrpc_thread	*thread = &ofd->ofd_prefetch_thread;
+	struct l_wait_info	 lwi	= { 0 };
+	struct task_struct	*task;
+	int			 rc;
+
+	spin_lock(&ofd->ofd_prefetch_lock);
+	if (unlikely(thread_is_running(thread))) {
+		spin_unlock(&ofd->ofd_prefetch_lock);
+
+		return -EALREADY;
+	}
+
+	thread_set_flags(thread, 0);
+	spin_unlock(&ofd->ofd_prefetch_lock);
+
+	if (ofd->ofd_prefetch_ring == NULL) {
+		OBD_ALLOC(ofd->ofd_prefetch_ring,
+			  OFD_PREFETCH_DEPTH * sizeof(struct lu_fid));
+		if (ofd->ofd_prefetch_ring == NULL)
+			return -ENOMEM;
+	}
+
+	task = kthread_run(ofd_prefetch_main, ofd, "ofd_prefetch");
+	if (IS_ERR(task)) {
+		rc = PTR_ERR(task);
+		CERROR("%s: cannot start object prefetch thread: rc = %d\n",
+		       ofd_name(ofd), rc);
+	} else {
+		rc = 0;
+		l_wait_event(thread->t_ctl_waitq,
+			     thread_is_running(thread) ||
+			     thread_is_stopped(thread),
+			     &lwi);
+	}
+
+	return rc;
+}
+
+/**
+ * Stop object prefetch thread.
+ *
+ * \param[in] ofd	OFD device
+ *
+ * \retval		0 on successful stop of thread
+ * \retval		-EALREADY if thread is already stopped
+ */
+int ofd_stop_prefetch_thread(struct ofd_device *ofd)
+{
+	struct ptlrpc_thread	*thread = &ofd->ofd_prefetch_thread;
+	struct l_wait_info	 lwi	= { 0 };
+	int			 rc;
+
+	spin_lock(&ofd->ofd_prefetch_lock);
+	if (thread_is_init(thread) || thread_is_stopped(thread)) {
+		spin_unlock(&ofd->ofd_prefetch_lock);
+		GOTO(out_free, rc = -EALREADY);
+	}
+
+	thread_set_flags(thread, SVC_STOPPING);
+	spin_unlock(&ofd->ofd_prefetch_lock);
+	wake_up_all(&thread->t_ctl_waitq);
+	l_wait_event(thread->t_ctl_waitq,
+		     thread_is_stopped(thread),
+		     &lwi);
+	rc = 0;
+
+out_free:
+	if (ofd->ofd_prefetch_ring != NULL) {
+		OBD_FREE(ofd->ofd_prefetch_ring,
+			 OFD_PREFETCH_DEPTH * sizeof(struct lu_fid));
+		ofd->ofd_prefetch_ring = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * Queue an object for prefetch.
+ *
+ * Called from the request arrival path, so it never blocks: if the ring
+ * is full the FID is dropped, and a FID equal to the last queued one is
+ * skipped since a client usually sends several BRWs for the same object
+ * back to back.
+ *
+ * \param[in] ofd	OFD device
+ * \param[in] fid	FID of the object to load
+ */
+void ofd_prefetch_queue(struct ofd_device *ofd, const struct lu_fid *fid)
+{
+	struct lu_fid	*last;
+	bool		 wakeup = false;
+
+	if (!ofd->ofd_prefetch_enabled || !fid_is_sane(fid))
+		return;
+
+	spin_lock(&ofd->ofd_prefetch_lock);
+	if (unlikely(!thread_is_running(&ofd->ofd_prefetch_thread))) {
+		spin_unlock(&ofd->ofd_prefetch_lock);
+		return;
+	}
+
+	if (ofd->ofd_prefetch_head != ofd->ofd_prefetch_tail) {
+		last = &ofd->ofd_prefetch_ring[(ofd->ofd_prefetch_head - 1) &
+					       (OFD_PREFETCH_DEPTH - 1)];
+		if (lu_fid_eq(last, fid)) {
+			spin_unlock(&ofd->ofd_prefetch_lock);
+			return;
+		}
+	}
+
+	if (ofd->ofd_prefetch_head - ofd->ofd_prefetch_tail >=
+	    OFD_PREFETCH_DEPTH) {
+		ofd->ofd_prefetch_dropped++;
+		spin_unlock(&ofd->ofd_prefetch_lock);
+		return;
+	}
+
+	if (ofd->ofd_prefetch_head == ofd->ofd_prefetch_tail)
+		wakeup = true;
+	ofd->ofd_prefetch_ring[ofd->ofd_prefetch_head &
+			       (OFD_PREFETCH_DEPTH - 1)] = *fid;
+	ofd->ofd_prefetch_head++;
+	ofd->ofd_prefetch_queued++;
+	spin_unlock(&ofd->ofd_prefetch_lock);
+	if (wakeup)
+		wake_up_all(&ofd->ofd_prefetch_thread.t_ctl_waitq);
+}
+
+/**
+ * Account the use of an object loaded by the prefetch thread.
+ *
+ * \param[in] ofd	OFD device
+ * \param[in] fo	OFD object
+ */
+void ofd_prefetch_hit(struct ofd_device *ofd, struct ofd_object *fo)
+{
+	if (likely(!test_bit(OFO_PREFETCHED, &fo->ofo_flags)))
+		return;
+
+	if (test_and_clear_bit(OFO_PREFETCHED, &fo->ofo_flags)) {
+		spin_lock(&ofd->ofd_prefetch_lock);
+		ofd->ofd_prefetch_hits++;
+		spin_unlock(&ofd->ofd_prefetch_lock);
+	}
+}
+
 /**
  * Add new item for parent FID verification.
  *
@@ -453,6 +691,7 @@ static int ofd_preprw_read(const struct lu_env *env, struct obd_export *exp,
 	if (IS_ERR(fo))
 		RETURN(PTR_ERR(fo));
 	LASSERT(fo != NULL);
+	ofd_prefetch_hit(ofd, fo);
 
 	ofd_read_lock(env, fo);
 	if (!ofd_object_exists(fo))
@@ -595,6 +834,7 @@ static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
 	if (IS_ERR(fo))
 		GOTO(out, rc = PTR_ERR(fo));
 	LASSERT(fo != NULL);
+	ofd_prefetch_hit(ofd, fo);
 
 	ofd_read_lock(env, fo);
 	if (!ofd_object_exists(fo)) {
@@ -164,6 +164,8 @@ static int ofd_parse_connect_data(const struct lu_env *env,
 	fed->fed_group = data->ocd_group;
 
 	data->ocd_connect_flags &= OST_CONNECT_SUPPORTED;
+	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2)
+		data->ocd_connect_flags2 &= OST_CONNECT_SUPPORTED2;
 	data->ocd_version = LUSTRE_VERSION_CODE;
 
 	/* Kindly make sure the SKIP_ORPHAN flag is from MDS. */
@@ -701,6 +703,9 @@ int ofd_statfs_internal(const struct lu_env *env, struct ofd_device *ofd,
 	spin_lock(&ofd->ofd_osfs_lock);
 	if (cfs_time_before_64(ofd->ofd_osfs_age, max_age) || max_age == 0) {
 		u64 unstable;
+		u64 tot_dirty;
+		u64 tot_granted;
+		u64 tot_pending;
 
 		/* statfs data are too old, get up-to-date one.
 		 * we must be cautious here since multiple threads might be
@@ -725,7 +730,7 @@ int ofd_statfs_internal(const struct lu_env *env, struct ofd_device *ofd,
 		if (unlikely(rc))
 			GOTO(out, rc);
 
-		spin_lock(&ofd->ofd_grant_lock);
+		ofd_grant_totals(ofd, &tot_dirty, &tot_granted, &tot_pending);
 		spin_lock(&ofd->ofd_osfs_lock);
 		/* calculate how much space was written while we released the
 		 * ofd_osfs_lock */
@@ -749,8 +754,7 @@ int ofd_statfs_internal(const struct lu_env *env, struct ofd_device *ofd,
 		}
 		/* similarly, there is some uncertainty on write requests
 		 * between prepare & commit */
-		ofd->ofd_osfs_unstable += ofd->ofd_tot_pending;
-		spin_unlock(&ofd->ofd_grant_lock);
+		ofd->ofd_osfs_unstable += tot_pending;
 
 		/* finally udpate cached statfs data */
 		ofd->ofd_osfs = *osfs;
@@ -802,6 +806,9 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 {
         struct obd_device	*obd = class_exp2obd(exp);
 	struct ofd_device	*ofd = ofd_exp(exp);
+	u64			 tot_dirty;
+	u64			 tot_granted;
+	u64			 tot_pending;
 	int			 rc;
 
 	ENTRY;
@@ -813,15 +820,16 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	/* at least try to account for cached pages.  its still racy and
 	 * might be under-reporting if clients haven't announced their
 	 * caches with brw recently */
+	ofd_grant_totals(ofd, &tot_dirty, &tot_granted, &tot_pending);
 
 	CDEBUG(D_SUPER | D_CACHE, "blocks cached "LPU64" granted "LPU64
 	       " pending "LPU64" free "LPU64" avail "LPU64"\n",
-	       ofd->ofd_tot_dirty, ofd->ofd_tot_granted, ofd->ofd_tot_pending,
+	       tot_dirty, tot_granted, tot_pending,
 	       osfs->os_bfree << ofd->ofd_blockbits,
 	       osfs->os_bavail << ofd->ofd_blockbits);
 
 	osfs->os_bavail -= min_t(u64, osfs->os_bavail,
-				 ((ofd->ofd_tot_dirty + ofd->ofd_tot_pending +
+				 ((tot_dirty + tot_pending +
 				   osfs->os_bsize - 1) >> ofd->ofd_blockbits));
 
 	/* The QoS code on the MDS does not care about space reserved for
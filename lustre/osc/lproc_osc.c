@@ -184,11 +184,11 @@ static int osc_cached_mb_seq_show(struct seq_file *m, void *v)
 	rc = seq_printf(m,
 		      "used_mb: %ld\n"
 		      "busy_cnt: %ld\n"
-		      "reclaim: "LPU64"\n",
+		      "reclaim: %ld\n",
 		      (atomic_long_read(&cli->cl_lru_in_list) +
 		       atomic_long_read(&cli->cl_lru_busy)) >> shift,
 		      atomic_long_read(&cli->cl_lru_busy),
-		      cli->cl_lru_reclaim);
+		      atomic_long_read(&cli->cl_lru_reclaim));
 
 	return rc;
 }
@@ -788,6 +788,8 @@ static int osc_stats_seq_show(struct seq_file *seq, void *v)
 		   stats->os_lockless_reads);
 	seq_printf(seq, "lockless_truncate\t\t"LPU64"\n",
 		   stats->os_lockless_truncates);
+	seq_printf(seq, "skipped_sync\t\t\t"LPU64"\n",
+		   stats->os_skipped_syncs);
 	return 0;
 }
 
@@ -805,6 +807,33 @@ static ssize_t osc_stats_seq_write(struct file *file,
 
 LPROC_SEQ_FOPS(osc_stats);
 
+/**
+ * "lru_stats": time spent by IO threads reclaiming LRU slots and waiting for
+ * free slots, in usec, and pages freed by the background LRU work.
+ */
+static void osc_lru_stats_init(struct obd_device *dev)
+{
+	struct client_obd	*cli = &dev->u.cli;
+	struct lprocfs_stats	*stats;
+
+	stats = lprocfs_alloc_stats(OSC_LRU_STATS_LAST, 0);
+	if (stats == NULL)
+		return;
+
+	lprocfs_counter_init(stats, OSC_LRU_STATS_RECLAIM,
+			     LPROCFS_CNTR_AVGMINMAX, "reclaim", "usec");
+	lprocfs_counter_init(stats, OSC_LRU_STATS_STALL,
+			     LPROCFS_CNTR_AVGMINMAX, "alloc_stall", "usec");
+	lprocfs_counter_init(stats, OSC_LRU_STATS_SHRINK,
+			     LPROCFS_CNTR_AVGMINMAX, "async_shrink", "pages");
+	if (lprocfs_register_stats(dev->obd_proc_entry, "lru_stats",
+				   stats) != 0) {
+		lprocfs_free_stats(&stats);
+		return;
+	}
+	cli->cl_lru_stats = stats;
+}
+
 int lproc_osc_attach_seqstat(struct obd_device *dev)
 {
 	int rc;
@@ -814,6 +843,8 @@ int lproc_osc_attach_seqstat(struct obd_device *dev)
 	if (rc == 0)
 		rc = lprocfs_obd_seq_create(dev, "rpc_stats", 0644,
 					    &osc_rpc_stats_fops, dev);
+	if (rc == 0)
+		osc_lru_stats_init(dev);
 
 	return rc;
 }
@@ -1906,13 +1906,16 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 4. If urgent list is not empty, goto 2;
  * 5. Traverse the extent tree from the 1st extent;
  * 6. Above steps exit if there is no space in this RPC.
+ *
+ * \a rpclist may already hold \a page_count pages of other objects, the
+ * total number of pages in the RPC is returned.
  */
 static unsigned int get_write_extents(struct osc_object *obj,
-				      struct list_head *rpclist)
+				      struct list_head *rpclist,
+				      unsigned int page_count)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	unsigned int page_count = 0;
 	unsigned int max_pages = cli->cl_max_pages_per_rpc;
 
 	LASSERT(osc_object_is_locked(obj));
@@ -1970,6 +1973,166 @@ static unsigned int get_write_extents(struct osc_object *obj,
 	return page_count;
 }
 
+#define list_to_obj(list, item) ({					      \
+	struct list_head *__tmp = (list)->next;				      \
+	list_del_init(__tmp);					      \
+	list_entry(__tmp, struct osc_object, oo_##item);		      \
+})
+
+/* Mark the extents added to an RPC after \a after as being sent. */
+static void osc_write_extents_start(struct list_head *rpclist,
+				    struct list_head *after)
+{
+	struct osc_extent *ext = list_entry(after, struct osc_extent, oe_link);
+
+	list_for_each_entry_continue(ext, rpclist, oe_link) {
+		LASSERT(ext->oe_state == OES_CACHE ||
+			ext->oe_state == OES_LOCK_DONE);
+		if (ext->oe_state == OES_CACHE)
+			osc_extent_state_set(ext, OES_LOCKING);
+		else
+			osc_extent_state_set(ext, OES_RPC);
+	}
+}
+
+static inline bool osc_multiobj_brw(struct client_obd *cli)
+{
+	struct obd_connect_data *ocd = &cli->cl_import->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_MULTIOBJ_BRW);
+}
+
+/* Pick another object with dirty pages to fill a write RPC, the same way
+ * as osc_next_obj() does, but leave the HP objects to their own RPCs. */
+static struct osc_object *osc_next_write_obj(struct client_obd *cli)
+{
+	if (!list_empty(&cli->cl_loi_ready_list))
+		return list_to_obj(&cli->cl_loi_ready_list, ready_item);
+	if (!list_empty(&cli->cl_cache_waiters) &&
+	    !list_empty(&cli->cl_loi_write_list))
+		return list_to_obj(&cli->cl_loi_write_list, write_item);
+	return NULL;
+}
+
+/**
+ * Move the extents of \a obj added to \a rpclist after \a tail next to
+ * the extents \a obj already had in the RPC, if any, so that osc_build_rpc()
+ * makes a single obd_ioobj for it.
+ *
+ * \retval true	\a obj already had extents in the RPC
+ * \retval false	\a obj is new to the RPC
+ */
+static bool osc_write_extents_regroup(struct osc_object *obj,
+				      struct list_head *rpclist,
+				      struct list_head *tail)
+{
+	struct osc_extent *last = NULL;
+	struct osc_extent *ext;
+	struct list_head *pos;
+
+	list_for_each_entry(ext, rpclist, oe_link) {
+		if (ext->oe_obj == obj)
+			last = ext;
+		if (&ext->oe_link == tail)
+			break;
+	}
+	if (last == NULL)
+		return false;
+
+	pos = &last->oe_link;
+	if (pos == tail)
+		return true;
+
+	while (tail->next != rpclist) {
+		struct list_head *next = tail->next;
+
+		list_move(next, pos);
+		pos = next;
+	}
+	return true;
+}
+
+/**
+ * Fill the rest of a write RPC with the extents of other objects.
+ *
+ * A job writing many small files has a few pages per object only, which
+ * make one small BRW each.  If the server supports it, the ready extents of
+ * up to OST_MAX_BRW_OBJS objects are packed into the same RPC instead.  The
+ * extents of each object are kept together in \a rpclist, also when an
+ * object is picked again, osc_build_rpc() relies on it to lay out one
+ * obd_ioobj per object.
+ *
+ * No object lock is held by the caller, and only one object is locked at a
+ * time here.
+ *
+ * \param[in] env	execution environment
+ * \param[in] cli	client obd
+ * \param[in] osc	object the RPC was built for
+ * \param[in] rpclist	extents of the RPC, not empty
+ * \param[in] page_count	number of pages already in the RPC
+ *
+ * \retval		number of pages in the RPC
+ */
+static unsigned int osc_pack_write_objs(const struct lu_env *env,
+					struct client_obd *cli,
+					struct osc_object *osc,
+					struct list_head *rpclist,
+					unsigned int page_count)
+{
+	struct osc_extent *first;
+	int nr_objs = 1;
+	int tries;
+
+	first = list_entry(rpclist->next, struct osc_extent, oe_link);
+	if (first->oe_srvlock || first->oe_no_merge ||
+	    oap2cl_page(list_first_entry(&first->oe_pages,
+					 struct osc_async_page,
+					 oap_pending_item))->cp_type !=
+	    CPT_CACHEABLE)
+		return page_count;
+
+	for (tries = 0; tries < OST_MAX_BRW_OBJS &&
+	     nr_objs < OST_MAX_BRW_OBJS &&
+	     page_count < cli->cl_max_pages_per_rpc; tries++) {
+		struct osc_object *obj;
+		struct list_head *tail;
+		unsigned int count;
+
+		spin_lock(&cli->cl_loi_list_lock);
+		obj = osc_next_write_obj(cli);
+		if (obj != NULL)
+			cl_object_get(osc2cl(obj));
+		spin_unlock(&cli->cl_loi_list_lock);
+		if (obj == NULL)
+			break;
+
+		if (obj != osc) {
+			tail = rpclist->prev;
+			osc_object_lock(obj);
+			if (osc_makes_rpc(cli, obj, OBD_BRW_WRITE)) {
+				count = get_write_extents(obj, rpclist,
+							  page_count);
+				if (count > page_count) {
+					osc_update_pending(obj, OBD_BRW_WRITE,
+						-(int)(count - page_count));
+					osc_write_extents_start(rpclist, tail);
+					page_count = count;
+					if (!osc_write_extents_regroup(obj,
+							rpclist, tail))
+						nr_objs++;
+				}
+			}
+			osc_object_unlock(obj);
+		}
+
+		osc_list_maint(cli, obj);
+		cl_object_put(env, osc2cl(obj));
+	}
+
+	return page_count;
+}
+
 static int
 osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 		   struct osc_object *osc)
@@ -1986,7 +2149,7 @@ __must_hold(osc)
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = get_write_extents(osc, &rpclist, 0);
 	LASSERT(equi(page_count == 0, list_empty(&rpclist)));
 
 	if (list_empty(&rpclist))
@@ -1994,19 +2157,16 @@ __must_hold(osc)
 
 	osc_update_pending(osc, OBD_BRW_WRITE, -page_count);
 
-	list_for_each_entry(ext, &rpclist, oe_link) {
-		LASSERT(ext->oe_state == OES_CACHE ||
-			ext->oe_state == OES_LOCK_DONE);
-		if (ext->oe_state == OES_CACHE)
-			osc_extent_state_set(ext, OES_LOCKING);
-		else
-			osc_extent_state_set(ext, OES_RPC);
-	}
+	osc_write_extents_start(&rpclist, &rpclist);
 
 	/* we're going to grab page lock, so release object lock because
 	 * lock order is page lock -> object lock. */
 	osc_object_unlock(osc);
 
+	if (page_count < cli->cl_max_pages_per_rpc && osc_multiobj_brw(cli))
+		page_count = osc_pack_write_objs(env, cli, osc, &rpclist,
+						 page_count);
+
 	list_for_each_entry_safe(ext, tmp, &rpclist, oe_link) {
 		if (ext->oe_state == OES_LOCKING) {
 			rc = osc_extent_make_ready(env, ext);
@@ -2083,12 +2243,6 @@ __must_hold(osc)
 	RETURN(rc);
 }
 
-#define list_to_obj(list, item) ({					      \
-	struct list_head *__tmp = (list)->next;				      \
-	list_del_init(__tmp);					      \
-	list_entry(__tmp, struct osc_object, oo_##item);		      \
-})
-
 /* This is called by osc_check_rpcs() to find which objects have pages that
  * we could be sending.  These lists are maintained by osc_makes_rpc(). */
 static struct osc_object *osc_next_obj(struct client_obd *cli)
@@ -2208,7 +2362,10 @@ static int osc_io_unplug0(const struct lu_env *env, struct client_obd *cli,
 	} else {
 		CDEBUG(D_CACHE, "Queue writeback work for client %p.\n", cli);
 		LASSERT(cli->cl_writeback_work != NULL);
-		rc = ptlrpcd_queue_work(cli->cl_writeback_work);
+		/* Writeback may run anywhere, let ptlrpcd pick an idle
+		 * thread rather than queueing behind the caller's CPT. */
+		rc = ptlrpcd_queue_work_cpt(cli->cl_writeback_work,
+					    CFS_CPT_ANY);
 	}
 	return rc;
 }
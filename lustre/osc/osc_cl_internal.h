@@ -172,6 +172,19 @@ struct osc_object {
 	/** number of active IOs of this object */
 	atomic_t		oo_nr_ios;
 	wait_queue_head_t	oo_io_waitq;
+
+	/**
+	 * Commit tracking used to avoid redundant OST_SYNC RPCs, see
+	 * osc_object_sync_needed(). oo_mod_transno is the last transno
+	 * of a write to this object, oo_mod_gen is bumped for every
+	 * modification whose commit cannot be tracked by transno, and
+	 * oo_synced_{gen,transno} are covered by the last OST_SYNC.
+	 * Protected by oo_lock.
+	 */
+	__u64			oo_mod_transno;
+	__u64			oo_synced_transno;
+	unsigned int		oo_mod_gen;
+	unsigned int		oo_synced_gen;
 };
 
 static inline void osc_object_lock(struct osc_object *obj)
@@ -203,6 +216,21 @@ static inline int osc_object_is_locked(struct osc_object *obj)
 #endif
 }
 
+/**
+ * Record a modification of \a obj on the OST. A zero \a transno means the
+ * commit of the modification cannot be tracked, so the next fsync has to
+ * send an OST_SYNC RPC.
+ */
+static inline void osc_object_modified(struct osc_object *obj, __u64 transno)
+{
+	osc_object_lock(obj);
+	if (transno == 0)
+		obj->oo_mod_gen++;
+	else if (transno > obj->oo_mod_transno)
+		obj->oo_mod_transno = transno;
+	osc_object_unlock(obj);
+}
+
 /*
  * Lock "micro-states" for osc layer.
  */
@@ -320,7 +348,11 @@ struct osc_lock {
         /**
          * For async glimpse lock.
          */
-                                 ols_agl:1;
+                                 ols_agl:1,
+        /**
+         * Do not wait for conflicting osc locks, see CEF_NOWAIT_LOCAL.
+         */
+                                 ols_nowait_local:1;
 };
 
 
@@ -360,7 +392,11 @@ struct osc_page {
 	/**
 	 * Set if the page must be transferred with OBD_BRW_SRVLOCK.
 	 */
-			      ops_srvlock:1;
+			      ops_srvlock:1,
+	/**
+	 * CPT of the LRU segment the page belongs to, see osc_lru_alloc().
+	 */
+			      ops_lru_cpt:16;
 	/**
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
@@ -120,10 +120,10 @@ int osc_match_base(struct obd_export *exp, struct ldlm_res_id *res_id,
 		   __u64 *flags, void *data, struct lustre_handle *lockh,
 		   int unref);
 
-int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
+int osc_setattr_async(struct osc_object *obj, struct obdo *oa,
 		      obd_enqueue_update_f upcall, void *cookie,
 		      struct ptlrpc_request_set *rqset);
-int osc_punch_base(struct obd_export *exp, struct obdo *oa,
+int osc_punch_base(struct osc_object *obj, struct obdo *oa,
                    obd_enqueue_update_f upcall, void *cookie,
                    struct ptlrpc_request_set *rqset);
 int osc_sync_base(struct osc_object *obj, struct obdo *oa,
@@ -137,10 +137,22 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   long target, bool force);
 unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages);
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages);
+int osc_lru_segs_init(struct client_obd *cli);
+void osc_lru_segs_fini(struct client_obd *cli);
+int osc_lru_waitq_init(void);
+void osc_lru_waitq_fini(void);
+
+enum {
+	OSC_LRU_STATS_RECLAIM = 0,
+	OSC_LRU_STATS_STALL,
+	OSC_LRU_STATS_SHRINK,
+	OSC_LRU_STATS_LAST
+};
 
 extern struct lu_kmem_descr osc_caches[];
 
-unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock);
+unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock,
+				 unsigned long *pages);
 
 int osc_cleanup(struct obd_device *obd);
 int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg);
@@ -184,6 +196,7 @@ struct osc_device {
                 uint64_t     os_lockless_writes;          /* by bytes */
                 uint64_t     os_lockless_reads;           /* by bytes */
                 uint64_t     os_lockless_truncates;       /* by times */
+		uint64_t     os_skipped_syncs;            /* by times */
         } od_stats;
 
         /* configuration item(s) */
@@ -110,40 +110,109 @@ static int osc_io_read_ahead(const struct lu_env *env,
 	RETURN(result);
 }
 
+/**
+ * Prepares a batch of pages of \a osc with cl_page_prep_vec() and queues the
+ * ones accepted by every layer for transfer, flushing \a list into a sync
+ * extent each time it reaches cl_max_pages_per_rpc pages.
+ *
+ * A page failing the preparation with -EALREADY is left in the in-queue, as
+ * cl_page_prep() callers always did. Any other failure is remembered but
+ * does not stop the rest of the batch, whose pages are already prepared and
+ * have to go through osc to be completed.
+ *
+ * \retval 0	success
+ * \retval -ve	first failure met on the batch
+ */
+static int osc_io_submit_vec(const struct lu_env *env, struct osc_object *osc,
+			     struct cl_page **pvec, int nr,
+			     enum cl_req_type crt, int brw_flags,
+			     struct cl_2queue *queue, struct list_head *list,
+			     unsigned int *queued)
+{
+	struct cl_page_list *qin  = &queue->c2_qin;
+	struct cl_page_list *qout = &queue->c2_qout;
+	unsigned int max_pages = osc_cli(osc)->cl_max_pages_per_rpc;
+	int rcs[CL_PAGE_VEC_MAX];
+	int cmd = crt == CRT_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ;
+	int result = 0;
+	int rc;
+	int i;
+
+	/* NOTE: pages are top-level pages, all owned by the same top io. */
+	cl_page_prep_vec(env, pvec[0]->cp_owner, pvec, rcs, nr, crt);
+	for (i = 0; i < nr; i++) {
+		struct cl_page *page = pvec[i];
+		struct osc_page *opg = osc_cl_page_osc(page, osc);
+		struct osc_async_page *oap = &opg->ops_oap;
+
+		if (rcs[i] != 0) {
+			LASSERT(rcs[i] < 0);
+			/*
+			 * Handle -EALREADY error: for read case, the page is
+			 * already in UPTODATE state; for write, the page
+			 * is not dirty.
+			 */
+			if (rcs[i] != -EALREADY && result == 0)
+				result = rcs[i];
+			continue;
+		}
+
+		spin_lock(&oap->oap_lock);
+		oap->oap_async_flags = ASYNC_URGENT|ASYNC_READY;
+		oap->oap_async_flags |= ASYNC_COUNT_STABLE;
+		spin_unlock(&oap->oap_lock);
+
+		osc_page_submit(env, opg, crt, brw_flags);
+		list_add_tail(&oap->oap_pending_item, list);
+
+		if (page->cp_sync_io != NULL)
+			cl_page_list_move(qout, qin, page);
+		else /* async IO */
+			cl_page_list_del(env, qin, page);
+
+		if (++*queued == max_pages) {
+			*queued = 0;
+			rc = osc_queue_sync_pages(env, osc, list, cmd,
+						  brw_flags);
+			if (rc < 0 && result == 0)
+				result = rc;
+		}
+	}
+	return result;
+}
+
 /**
  * An implementation of cl_io_operations::cio_io_submit() method for osc
- * layer. Iterates over pages in the in-queue, prepares each for io by calling
- * cl_page_prep() and then either submits them through osc_io_submit_page()
- * or, if page is already submitted, changes osc flags through
- * osc_set_async_flags().
+ * layer. Iterates over pages in the in-queue, prepares them for io in
+ * batches of up to CL_PAGE_VEC_MAX pages by calling cl_page_prep_vec() and
+ * then either submits them through osc_io_submit_page() or, if page is
+ * already submitted, changes osc flags through osc_set_async_flags().
  */
 static int osc_io_submit(const struct lu_env *env,
                          const struct cl_io_slice *ios,
 			 enum cl_req_type crt, struct cl_2queue *queue)
 {
+	struct cl_page	  *pvec[CL_PAGE_VEC_MAX];
 	struct cl_page	  *page;
 	struct cl_page	  *tmp;
-	struct client_obd *cli  = NULL;
 	struct osc_object *osc  = NULL;	/* to keep gcc happy */
 	struct osc_page	  *opg;
-	struct cl_io	  *io;
 	struct list_head  list = LIST_HEAD_INIT(list);
 
 	struct cl_page_list *qin      = &queue->c2_qin;
 	struct cl_page_list *qout     = &queue->c2_qout;
 	unsigned int queued = 0;
 	int result = 0;
+	int rc;
+	int nr = 0;
 	int cmd;
 	int brw_flags;
-	unsigned int max_pages;
 
 	LASSERT(qin->pl_nr > 0);
 
 	CDEBUG(D_CACHE, "%d %d\n", qin->pl_nr, crt);
 
 	osc = cl2osc(ios->cis_obj);
-	cli = osc_cli(osc);
-	max_pages = cli->cl_max_pages_per_rpc;
 
 	cmd = crt == CRT_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ;
 	brw_flags = osc_io_srvlock(cl2osc_io(env, ios)) ? OBD_BRW_SRVLOCK : 0;
@@ -156,8 +225,7 @@ static int osc_io_submit(const struct lu_env *env,
                 struct osc_async_page *oap;
 
                 /* Top level IO. */
-                io = page->cp_owner;
-                LASSERT(io != NULL);
+		LASSERT(page->cp_owner != NULL);
 
 		opg = osc_cl_page_osc(page, osc);
 		oap = &opg->ops_oap;
@@ -171,40 +239,32 @@ static int osc_io_submit(const struct lu_env *env,
                         break;
                 }
 
-                result = cl_page_prep(env, io, page, crt);
-		if (result != 0) {
-                        LASSERT(result < 0);
-                        if (result != -EALREADY)
-                                break;
-                        /*
-                         * Handle -EALREADY error: for read case, the page is
-                         * already in UPTODATE state; for write, the page
-                         * is not dirty.
-                         */
-                        result = 0;
-			continue;
-                }
-
-		spin_lock(&oap->oap_lock);
-		oap->oap_async_flags = ASYNC_URGENT|ASYNC_READY;
-		oap->oap_async_flags |= ASYNC_COUNT_STABLE;
-		spin_unlock(&oap->oap_lock);
-
-		osc_page_submit(env, opg, crt, brw_flags);
-		list_add_tail(&oap->oap_pending_item, &list);
-
-		if (page->cp_sync_io != NULL)
-			cl_page_list_move(qout, qin, page);
-		else /* async IO */
-			cl_page_list_del(env, qin, page);
-
-		if (++queued == max_pages) {
-			queued = 0;
-			result = osc_queue_sync_pages(env, osc, &list, cmd,
-						      brw_flags);
+		if (nr > 0 && page->cp_owner != pvec[0]->cp_owner) {
+			result = osc_io_submit_vec(env, osc, pvec, nr, crt,
+						   brw_flags, queue, &list,
+						   &queued);
+			nr = 0;
 			if (result < 0)
 				break;
 		}
+
+		pvec[nr++] = page;
+		if (nr < CL_PAGE_VEC_MAX && &tmp->cp_batch != &qin->pl_pages)
+			continue;
+
+		result = osc_io_submit_vec(env, osc, pvec, nr, crt, brw_flags,
+					   queue, &list, &queued);
+		nr = 0;
+		if (result < 0)
+			break;
+	}
+
+	/* pages batched before a busy one still have to be submitted */
+	if (nr > 0) {
+		rc = osc_io_submit_vec(env, osc, pvec, nr, crt, brw_flags,
+				       queue, &list, &queued);
+		if (result == 0)
+			result = rc;
 	}
 
 	if (queued > 0)
@@ -561,11 +621,11 @@ static int osc_io_setattr_start(const struct lu_env *env,
 		init_completion(&cbargs->opc_sync);
 
 		if (ia_valid & ATTR_SIZE)
-			result = osc_punch_base(osc_export(cl2osc(obj)),
+			result = osc_punch_base(cl2osc(obj),
 						oa, osc_async_upcall,
 						cbargs, PTLRPCD_SET);
 		else
-			result = osc_setattr_async(osc_export(cl2osc(obj)),
+			result = osc_setattr_async(cl2osc(obj),
 						   oa, osc_async_upcall,
 						   cbargs, PTLRPCD_SET);
 
@@ -747,6 +807,41 @@ static int osc_io_write_start(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Check whether an OST_SYNC RPC is needed to make the changes this client
+ * made to \a obj durable.
+ *
+ * It is not if every write, punch and setattr of the object has been
+ * committed by the OST, or was already covered by an earlier OST_SYNC.
+ * Changes made by other clients are left to those clients to sync.
+ *
+ * This is the only OST_SYNC/OST_PUNCH/OST_SETATTR traffic cut on the client:
+ * these RPCs are not merged across objects. Each punch and setattr is sent
+ * under the cl_io of one file, which waits for it in osc_io_setattr_end()
+ * while holding that object's extent lock. Merging would make that io wait
+ * for the RPCs of unrelated files, and the OST would need a multi-object
+ * request that takes an extent lock on each object it touches.
+ */
+static bool osc_object_sync_needed(struct osc_object *obj)
+{
+	struct obd_import	*imp = osc_cli(obj)->cl_import;
+	__u64			 committed;
+	bool			 needed;
+
+	spin_lock(&imp->imp_lock);
+	committed = imp->imp_peer_committed_transno;
+	spin_unlock(&imp->imp_lock);
+
+	osc_object_lock(obj);
+	if (obj->oo_synced_transno > committed)
+		committed = obj->oo_synced_transno;
+	needed = obj->oo_synced_gen != obj->oo_mod_gen ||
+		 obj->oo_mod_transno > committed;
+	osc_object_unlock(obj);
+
+	return needed;
+}
+
 static int osc_fsync_ost(const struct lu_env *env, struct osc_object *obj,
 			 struct cl_fsync_io *fio)
 {
@@ -757,6 +852,19 @@ static int osc_fsync_ost(const struct lu_env *env, struct osc_object *obj,
 	int rc = 0;
 	ENTRY;
 
+	init_completion(&cbargs->opc_sync);
+
+	if (!osc_object_sync_needed(obj)) {
+		struct osc_device *osd = lu2osc_dev(obj->oo_cl.co_lu.lo_dev);
+
+		CDEBUG(D_CACHE, "skip OST_SYNC for "DOSTID", all committed\n",
+		       POSTID(&loi->loi_oi));
+		/* XXX: Need a lock. */
+		osd->od_stats.os_skipped_syncs++;
+		osc_async_upcall(cbargs, 0);
+		RETURN(0);
+	}
+
 	memset(oa, 0, sizeof(*oa));
 	oa->o_oi = loi->loi_oi;
 	oa->o_valid = OBD_MD_FLID | OBD_MD_FLGROUP;
@@ -768,8 +876,6 @@ static int osc_fsync_ost(const struct lu_env *env, struct osc_object *obj,
 
 	obdo_set_parent_fid(oa, fio->fi_fid);
 
-	init_completion(&cbargs->opc_sync);
-
 	rc = osc_sync_base(obj, oa, osc_async_upcall, cbargs, PTLRPCD_SET);
 	RETURN(rc);
 }
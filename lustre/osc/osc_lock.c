@@ -489,6 +489,78 @@ static int osc_dlm_blocking_ast0(const struct lu_env *env,
 	RETURN(result);
 }
 
+static inline bool osc_lock_convert_supported(struct ldlm_lock *dlmlock)
+{
+	struct obd_connect_data *ocd;
+
+	if (dlmlock->l_conn_export == NULL)
+		return false;
+
+	ocd = &class_exp2cliimp(dlmlock->l_conn_export)->imp_connect_data;
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_LOCK_CONVERT);
+}
+
+/**
+ * Try to downgrade an unused PW dlm lock to PR instead of cancelling it when
+ * the conflicting lock \a new only reads, so that a writer keeps its cached
+ * pages when another client starts to read the same range.
+ *
+ * Dirty pages under the lock are written back first, as a PR lock must not
+ * cover them.  Shrinking the extent of a lock is not negotiated by
+ * OBD_CONNECT2_LOCK_CONVERT, such conflicts are resolved by a cancel.
+ *
+ * \retval 0		\a dlmlock was downgraded and stays cached
+ * \retval negative	\a dlmlock has to be cancelled
+ */
+static int osc_ldlm_downgrade(struct ldlm_lock *dlmlock,
+			      const struct lustre_handle *lockh,
+			      const struct ldlm_lock_desc *new)
+{
+	struct ldlm_extent	 ext;
+	struct lu_env		*env;
+	struct cl_env_nest	 nest;
+	struct cl_object	*obj;
+	int			 rc;
+	ENTRY;
+
+	if (new->l_req_mode != LCK_PR || !osc_lock_convert_supported(dlmlock))
+		RETURN(-EOPNOTSUPP);
+
+	env = cl_env_nested_get(&nest);
+	if (IS_ERR(env))
+		RETURN(PTR_ERR(env));
+
+	lock_res_and_lock(dlmlock);
+	ext = dlmlock->l_policy_data.l_extent;
+	if (dlmlock->l_granted_mode != LCK_PW ||
+	    dlmlock->l_req_mode != LCK_PW ||
+	    dlmlock->l_readers != 0 || dlmlock->l_writers != 0 ||
+	    ldlm_is_discard_data(dlmlock) || ldlm_is_canceling(dlmlock) ||
+	    dlmlock->l_ast_data == NULL) {
+		unlock_res_and_lock(dlmlock);
+		GOTO(out_env, rc = -EBUSY);
+	}
+
+	obj = osc2cl(dlmlock->l_ast_data);
+	cl_object_get(obj);
+	unlock_res_and_lock(dlmlock);
+
+	/* a read lock must not cover dirty pages */
+	rc = osc_cache_writeback_range(env, cl2osc(obj),
+				       cl_index(obj, ext.start),
+				       cl_index(obj, ext.end), 1, 0);
+	if (rc >= 0)
+		rc = ldlm_cli_extent_downgrade(lockh, LCK_PR, &ext);
+
+	cl_object_put(env, obj);
+	LDLM_DEBUG(dlmlock, "downgrade to PR: rc = %d", rc);
+	EXIT;
+out_env:
+	cl_env_nested_put(&nest, env);
+	return rc;
+}
+
 /**
  * Blocking ast invoked by ldlm when dlm lock is either blocking progress of
  * some other lock, or is canceled. This function is installed as a
@@ -514,7 +586,8 @@ static int osc_dlm_blocking_ast0(const struct lu_env *env,
  *
  *     - ldlm calls dlmlock->l_blocking_ast(..., LDLM_CB_BLOCKING) to notify
  *       us that dlmlock conflicts with another lock that some client is
- *       enqueuing. Lock is canceled.
+ *       enqueuing. Lock is downgraded by osc_ldlm_downgrade() if that
+ *       resolves the conflict, or canceled.
  *
  *           - cl_lock_cancel() is called. osc_lock_cancel() calls
  *             ldlm_cli_cancel() that calls
@@ -543,6 +616,10 @@ static int osc_ldlm_blocking_ast(struct ldlm_lock *dlmlock,
 		struct lustre_handle lockh;
 
 		ldlm_lock2handle(dlmlock, &lockh);
+		/* new is only known when the lock was unused as the AST came */
+		if (new != NULL && osc_ldlm_downgrade(dlmlock, &lockh, new) == 0)
+			break;
+
 		result = ldlm_cli_cancel(&lockh, LCF_ASYNC);
 		if (result == -ENODATA)
 			result = 0;
@@ -641,9 +718,17 @@ static int osc_ldlm_glimpse_ast(struct ldlm_lock *dlmlock, void *data)
 	RETURN(result);
 }
 
+struct osc_weigh_data {
+	/** next page to look at */
+	pgoff_t		owd_index;
+	/** clean pages seen so far */
+	unsigned long	owd_pages;
+};
+
 static int weigh_cb(const struct lu_env *env, struct cl_io *io,
 		    struct osc_page *ops, void *cbdata)
 {
+	struct osc_weigh_data *data = cbdata;
 	struct cl_page *page = ops->ops_cl.cpl_page;
 
 	if (cl_page_is_vmlocked(env, page)
@@ -651,17 +736,19 @@ static int weigh_cb(const struct lu_env *env, struct cl_io *io,
 	   )
 		return CLP_GANG_ABORT;
 
-	*(pgoff_t *)cbdata = osc_index(ops) + 1;
+	data->owd_index = osc_index(ops) + 1;
+	data->owd_pages++;
 	return CLP_GANG_OKAY;
 }
 
 static unsigned long osc_lock_weight(const struct lu_env *env,
 				     struct osc_object *oscobj,
-				     struct ldlm_extent *extent)
+				     struct ldlm_extent *extent,
+				     unsigned long *pages)
 {
 	struct cl_io     *io = &osc_env_info(env)->oti_io;
 	struct cl_object *obj = cl_object_top(&oscobj->oo_cl);
-	pgoff_t          page_index;
+	struct osc_weigh_data data = { .owd_pages = 0 };
 	int              result;
 	ENTRY;
 
@@ -671,12 +758,12 @@ static unsigned long osc_lock_weight(const struct lu_env *env,
 	if (result != 0)
 		RETURN(result);
 
-	page_index = cl_index(obj, extent->start);
+	data.owd_index = cl_index(obj, extent->start);
 	do {
 		result = osc_page_gang_lookup(env, io, oscobj,
-					      page_index,
+					      data.owd_index,
 					      cl_index(obj, extent->end),
-					      weigh_cb, (void *)&page_index);
+					      weigh_cb, (void *)&data);
 		if (result == CLP_GANG_ABORT)
 			break;
 		if (result == CLP_GANG_RESCHED)
@@ -684,13 +771,22 @@ static unsigned long osc_lock_weight(const struct lu_env *env,
 	} while (result != CLP_GANG_OKAY);
 	cl_io_fini(env, io);
 
+	if (pages != NULL)
+		*pages = data.owd_pages;
 	return result == CLP_GANG_ABORT ? 1 : 0;
 }
 
 /**
  * Get the weight of dlm lock for early cancellation.
+ *
+ * \param pages if not NULL, set to the number of clean cached pages under
+ *		\a dlmlock when it can be canceled without waiting
+ *
+ * \retval 0 \a dlmlock can be canceled without waiting for IO
+ * \retval 1 \a dlmlock is in use or covers pages under IO
  */
-unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock)
+unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock,
+				 unsigned long *pages)
 {
 	struct cl_env_nest       nest;
 	struct lu_env           *env;
@@ -732,7 +828,8 @@ unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock)
 		GOTO(out, weight = 1);
 	}
 
-	weight = osc_lock_weight(env, obj, &dlmlock->l_policy_data.l_extent);
+	weight = osc_lock_weight(env, obj, &dlmlock->l_policy_data.l_extent,
+				 pages);
 	EXIT;
 
 out:
@@ -883,6 +980,12 @@ restart:
 		    osc_lock_compatible(oscl, tmp_oscl))
 			continue;
 
+		/* the caller of a parallel enqueue retries in order */
+		if (oscl->ols_nowait_local) {
+			rc = -EWOULDBLOCK;
+			break;
+		}
+
 		/* wait for conflicting lock to be canceled */
 		cl_sync_io_init(waiter, 1, cl_sync_io_end);
 		oscl->ols_owner = waiter;
@@ -1178,6 +1281,7 @@ int osc_lock_init(const struct lu_env *env,
 
 	oscl->ols_flags = osc_enq2ldlm_flags(enqflags);
 	oscl->ols_agl = !!(enqflags & CEF_AGL);
+	oscl->ols_nowait_local = !!(enqflags & CEF_NOWAIT_LOCAL);
 	if (oscl->ols_agl)
 		oscl->ols_flags |= LDLM_FL_BLOCK_NOWAIT;
 	if (oscl->ols_flags & LDLM_FL_HAS_INTENT) {
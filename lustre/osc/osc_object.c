@@ -100,6 +100,10 @@ static int osc_object_init(const struct lu_env *env, struct lu_object *obj,
 	atomic_set(&osc->oo_nr_ios, 0);
 	init_waitqueue_head(&osc->oo_io_waitq);
 
+	/* modifications made before the object was set up are unknown */
+	osc->oo_mod_gen = 1;
+	osc->oo_synced_gen = 0;
+
 	cl_object_page_init(lu2cl(obj), sizeof(struct osc_page));
 
 	return 0;
@@ -465,7 +465,131 @@ void osc_page_submit(const struct lu_env *env, struct osc_page *opg,
  * at any time.
  */
 
-static DECLARE_WAIT_QUEUE_HEAD(osc_lru_waitq);
+/**
+ * Threads waiting for free LRU slots, per CPT so that waking them up does not
+ * bounce a single wait queue between all the CPUs doing IO.
+ */
+static wait_queue_head_t **osc_lru_waitqs;
+
+int osc_lru_waitq_init(void)
+{
+	wait_queue_head_t *waitq;
+	int i;
+
+	osc_lru_waitqs = cfs_percpt_alloc(cfs_cpt_table, sizeof(*waitq));
+	if (osc_lru_waitqs == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(waitq, i, osc_lru_waitqs)
+		init_waitqueue_head(waitq);
+	return 0;
+}
+
+void osc_lru_waitq_fini(void)
+{
+	if (osc_lru_waitqs != NULL)
+		cfs_percpt_free(osc_lru_waitqs);
+	osc_lru_waitqs = NULL;
+}
+
+static inline wait_queue_head_t *osc_lru_waitq_local(void)
+{
+	return osc_lru_waitqs[cfs_cpt_current(cfs_cpt_table, 0)];
+}
+
+static bool osc_lru_waiters(void)
+{
+	wait_queue_head_t *waitq;
+	int i;
+
+	cfs_percpt_for_each(waitq, i, osc_lru_waitqs) {
+		if (waitqueue_active(waitq))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * A single LRU slot was freed, wake up waiters of the local CPT. If it has
+ * none, wake up those of the next CPT that has some, going round from the
+ * local one so that waiters of no CPT are favoured.
+ *
+ * The barrier orders the update of cl_lru_left with the waitqueue_active()
+ * checks, otherwise a waiter checking its condition at the same time may
+ * be missed and sleep until the next bulk wake up.
+ */
+static void osc_lru_wake_one(void)
+{
+	int ncpt = cfs_cpt_number(cfs_cpt_table);
+	int local = cfs_cpt_current(cfs_cpt_table, 0);
+	wait_queue_head_t *waitq;
+	int i;
+
+	smp_mb();
+	for (i = 0; i < ncpt; i++) {
+		waitq = osc_lru_waitqs[(local + i) % ncpt];
+		if (waitqueue_active(waitq)) {
+			wake_up(waitq);
+			return;
+		}
+	}
+}
+
+static void osc_lru_wake_all(void)
+{
+	wait_queue_head_t *waitq;
+	int i;
+
+	/* see osc_lru_wake_one() */
+	smp_mb();
+	cfs_percpt_for_each(waitq, i, osc_lru_waitqs) {
+		if (waitqueue_active(waitq))
+			wake_up_all(waitq);
+	}
+}
+
+int osc_lru_segs_init(struct client_obd *cli)
+{
+	struct cl_lru_segment *seg;
+	int i;
+
+	cli->cl_lru_segs = cfs_percpt_alloc(cfs_cpt_table, sizeof(*seg));
+	if (cli->cl_lru_segs == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(seg, i, cli->cl_lru_segs) {
+		spin_lock_init(&seg->cls_lock);
+		INIT_LIST_HEAD(&seg->cls_list);
+	}
+	return 0;
+}
+
+void osc_lru_segs_fini(struct client_obd *cli)
+{
+	struct cl_lru_segment *seg;
+	int i;
+
+	if (cli->cl_lru_segs == NULL)
+		return;
+
+	cfs_percpt_for_each(seg, i, cli->cl_lru_segs)
+		LASSERT(list_empty(&seg->cls_list));
+	cfs_percpt_free(cli->cl_lru_segs);
+	cli->cl_lru_segs = NULL;
+}
+
+static inline struct cl_lru_segment *osc_lru_seg(struct client_obd *cli,
+						 struct osc_page *opg)
+{
+	return cli->cl_lru_segs[opg->ops_lru_cpt];
+}
+
+static inline void osc_lru_stats_add(struct client_obd *cli, int idx,
+				     long amount)
+{
+	if (cli->cl_lru_stats != NULL)
+		lprocfs_counter_add(cli->cl_lru_stats, idx, amount);
+}
 
 /**
  * LRU pages are freed in batch mode. OSC should at least free this
@@ -484,6 +608,15 @@ static inline int lru_shrink_max(struct client_obd *cli)
 	return cli->cl_max_pages_per_rpc * cli->cl_max_rpcs_in_flight;
 }
 
+/**
+ * The background LRU work is queued as soon as fewer free slots than this are
+ * left, so that IO threads seldom have to reclaim slots by themselves.
+ */
+static inline long lru_headroom(struct client_obd *cli)
+{
+	return lru_shrink_max(cli);
+}
+
 /**
  * Check if we can free LRU slots from this OSC. If there exists LRU waiters,
  * we should free slots aggressively. In this way, slots are freed in a steady
@@ -530,6 +663,8 @@ int lru_queue_work(const struct lu_env *env, void *data)
 
 		CDEBUG(D_CACHE, "%s: shrank %d/%d pages from client obd\n",
 		       cli_name(cli), rc, count);
+		if (rc > 0)
+			osc_lru_stats_add(cli, OSC_LRU_STATS_SHRINK, rc);
 		if (rc >= count) {
 			CDEBUG(D_CACHE, "%s: queue again\n", cli_name(cli));
 			ptlrpcd_queue_work(cli->cl_lru_work);
@@ -539,9 +674,13 @@ int lru_queue_work(const struct lu_env *env, void *data)
 	RETURN(0);
 }
 
+/**
+ * Pages go back to the LRU segment of the CPT they were allocated from, most
+ * pages of a batch come from the same one.
+ */
 void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
-	struct list_head lru = LIST_HEAD_INIT(lru);
+	struct cl_lru_segment *seg = NULL;
 	struct osc_async_page *oap;
 	long npages = 0;
 
@@ -551,20 +690,26 @@ void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 		if (!opg->ops_in_lru)
 			continue;
 
+		if (seg != osc_lru_seg(cli, opg)) {
+			if (seg != NULL)
+				spin_unlock(&seg->cls_lock);
+			seg = osc_lru_seg(cli, opg);
+			spin_lock(&seg->cls_lock);
+		}
+
 		++npages;
 		LASSERT(list_empty(&opg->ops_lru));
-		list_add(&opg->ops_lru, &lru);
+		list_add_tail(&opg->ops_lru, &seg->cls_list);
 	}
+	if (seg != NULL)
+		spin_unlock(&seg->cls_lock);
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
 		atomic_long_sub(npages, &cli->cl_lru_busy);
 		atomic_long_add(npages, &cli->cl_lru_in_list);
 		cli->cl_lru_last_used = cfs_time_current_sec();
-		spin_unlock(&cli->cl_lru_list_lock);
 
-		if (waitqueue_active(&osc_lru_waitq))
+		if (osc_lru_waiters())
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 	}
 }
@@ -583,14 +728,16 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_segment *seg = osc_lru_seg(cli, opg);
+
+		spin_lock(&seg->cls_lock);
 		if (!list_empty(&opg->ops_lru)) {
 			__osc_lru_del(cli, opg);
 		} else {
 			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
 			atomic_long_dec(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&seg->cls_lock);
 
 		atomic_long_inc(cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
@@ -600,7 +747,7 @@ static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 			CDEBUG(D_CACHE, "%s: queue LRU work\n", cli_name(cli));
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 		}
-		wake_up(&osc_lru_waitq);
+		osc_lru_wake_one();
 	} else {
 		LASSERT(list_empty(&opg->ops_lru));
 	}
@@ -614,9 +761,11 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru && !list_empty(&opg->ops_lru)) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_segment *seg = osc_lru_seg(cli, opg);
+
+		spin_lock(&seg->cls_lock);
 		__osc_lru_del(cli, opg);
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&seg->cls_lock);
 		atomic_long_inc(&cli->cl_lru_busy);
 	}
 }
@@ -663,6 +812,8 @@ static inline bool lru_page_busy(struct client_obd *cli, struct cl_page *page)
 
 /**
  * Drop @target of pages from LRU at most.
+ *
+ * The LRU segment of the current CPT is scanned first, then the other ones.
  */
 long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   long target, bool force)
@@ -670,10 +821,14 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	struct cl_io *io;
 	struct cl_object *clobj = NULL;
 	struct cl_page **pvec;
+	struct cl_lru_segment *seg;
 	struct osc_page *opg;
 	long count = 0;
 	int maxscan = 0;
 	int index = 0;
+	int ncpt = cfs_cpt_number(cfs_cpt_table);
+	int cpt;
+	int i;
 	int rc = 0;
 	ENTRY;
 
@@ -698,91 +853,101 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = &osc_env_info(env)->oti_io;
 
-	spin_lock(&cli->cl_lru_list_lock);
-	if (force)
-		cli->cl_lru_reclaim++;
+	cpt = cfs_cpt_current(cfs_cpt_table, 0);
 	maxscan = min(target << 1, atomic_long_read(&cli->cl_lru_in_list));
-	while (!list_empty(&cli->cl_lru_list)) {
-		struct cl_page *page;
-		bool will_free = false;
+	for (i = 0; i < ncpt && maxscan > 0 && count < target && rc == 0;
+	     i++) {
+		seg = cli->cl_lru_segs[(cpt + i) % ncpt];
+
+		if (force && i == 0)
+			atomic_long_inc(&cli->cl_lru_reclaim);
+		spin_lock(&seg->cls_lock);
+		while (!list_empty(&seg->cls_list)) {
+			struct cl_page *page;
+			bool will_free = false;
+
+			if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1) {
+				maxscan = 0;
+				break;
+			}
 
-		if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
-			break;
+			if (--maxscan < 0)
+				break;
 
-		if (--maxscan < 0)
-			break;
+			opg = list_entry(seg->cls_list.next, struct osc_page,
+					 ops_lru);
+			page = opg->ops_cl.cpl_page;
+			if (lru_page_busy(cli, page)) {
+				list_move_tail(&opg->ops_lru, &seg->cls_list);
+				continue;
+			}
 
-		opg = list_entry(cli->cl_lru_list.next, struct osc_page,
-				 ops_lru);
-		page = opg->ops_cl.cpl_page;
-		if (lru_page_busy(cli, page)) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
-			continue;
-		}
+			LASSERT(page->cp_obj != NULL);
+			if (clobj != page->cp_obj) {
+				struct cl_object *tmp = page->cp_obj;
 
-		LASSERT(page->cp_obj != NULL);
-		if (clobj != page->cp_obj) {
-			struct cl_object *tmp = page->cp_obj;
+				cl_object_get(tmp);
+				spin_unlock(&seg->cls_lock);
 
-			cl_object_get(tmp);
-			spin_unlock(&cli->cl_lru_list_lock);
+				if (clobj != NULL) {
+					discard_pagevec(env, io, pvec, index);
+					index = 0;
 
-			if (clobj != NULL) {
-				discard_pagevec(env, io, pvec, index);
-				index = 0;
+					cl_io_fini(env, io);
+					cl_object_put(env, clobj);
+					clobj = NULL;
+				}
 
-				cl_io_fini(env, io);
-				cl_object_put(env, clobj);
-				clobj = NULL;
-			}
+				clobj = tmp;
+				io->ci_obj = clobj;
+				io->ci_ignore_layout = 1;
+				rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-			clobj = tmp;
-			io->ci_obj = clobj;
-			io->ci_ignore_layout = 1;
-			rc = cl_io_init(env, io, CIT_MISC, clobj);
+				spin_lock(&seg->cls_lock);
 
-			spin_lock(&cli->cl_lru_list_lock);
+				if (rc != 0)
+					break;
 
-			if (rc != 0)
-				break;
+				++maxscan;
+				continue;
+			}
 
-			++maxscan;
-			continue;
-		}
+			if (cl_page_own_try(env, io, page) == 0) {
+				if (!lru_page_busy(cli, page)) {
+					/* remove it from lru list earlier to
+					 * avoid lock contention */
+					__osc_lru_del(cli, opg);
+					/* will be discarded */
+					opg->ops_in_lru = 0;
+
+					cl_page_get(page);
+					will_free = true;
+				} else {
+					cl_page_disown(env, io, page);
+				}
+			}
 
-		if (cl_page_own_try(env, io, page) == 0) {
-			if (!lru_page_busy(cli, page)) {
-				/* remove it from lru list earlier to avoid
-				 * lock contention */
-				__osc_lru_del(cli, opg);
-				opg->ops_in_lru = 0; /* will be discarded */
-
-				cl_page_get(page);
-				will_free = true;
-			} else {
-				cl_page_disown(env, io, page);
+			if (!will_free) {
+				list_move_tail(&opg->ops_lru, &seg->cls_list);
+				continue;
 			}
-		}
 
-		if (!will_free) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
-			continue;
-		}
+			/* Don't discard and free the page with cls_lock
+			 * held */
+			pvec[index++] = page;
+			if (unlikely(index == OTI_PVEC_SIZE)) {
+				spin_unlock(&seg->cls_lock);
+				discard_pagevec(env, io, pvec, index);
+				index = 0;
 
-		/* Don't discard and free the page with cl_lru_list held */
-		pvec[index++] = page;
-		if (unlikely(index == OTI_PVEC_SIZE)) {
-			spin_unlock(&cli->cl_lru_list_lock);
-			discard_pagevec(env, io, pvec, index);
-			index = 0;
+				spin_lock(&seg->cls_lock);
+			}
 
-			spin_lock(&cli->cl_lru_list_lock);
+			if (++count >= target)
+				break;
 		}
-
-		if (++count >= target)
-			break;
+		spin_unlock(&seg->cls_lock);
 	}
-	spin_unlock(&cli->cl_lru_list_lock);
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -794,7 +959,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	atomic_dec(&cli->cl_lru_shrinkers);
 	if (count > 0) {
 		atomic_long_add(count, cli->cl_lru_left);
-		wake_up_all(&osc_lru_waitq);
+		osc_lru_wake_all();
 	}
 	RETURN(count > 0 ? count : rc);
 }
@@ -810,6 +975,9 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 	struct cl_env_nest nest;
 	struct lu_env *env;
 	struct cl_client_cache *cache = cli->cl_cache;
+	struct client_obd *scan;
+	struct timeval start;
+	struct timeval end;
 	int max_scans;
 	long rc = 0;
 	ENTRY;
@@ -820,6 +988,8 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 	if (IS_ERR(env))
 		RETURN(rc);
 
+	do_gettimeofday(&start);
+
 	npages = max_t(int, npages, cli->cl_max_pages_per_rpc);
 	CDEBUG(D_CACHE, "%s: start to reclaim %ld pages from LRU\n",
 	       cli_name(cli), npages);
@@ -848,19 +1018,19 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 
 	max_scans = atomic_read(&cache->ccc_users) - 2;
 	while (--max_scans > 0 && !list_empty(&cache->ccc_lru)) {
-		cli = list_entry(cache->ccc_lru.next, struct client_obd,
-				 cl_lru_osc);
+		scan = list_entry(cache->ccc_lru.next, struct client_obd,
+				  cl_lru_osc);
 
 		CDEBUG(D_CACHE, "%s: cli %p LRU pages: %ld, busy: %ld.\n",
-			cli_name(cli), cli,
-			atomic_long_read(&cli->cl_lru_in_list),
-			atomic_long_read(&cli->cl_lru_busy));
+			cli_name(scan), scan,
+			atomic_long_read(&scan->cl_lru_in_list),
+			atomic_long_read(&scan->cl_lru_busy));
 
-		list_move_tail(&cli->cl_lru_osc, &cache->ccc_lru);
-		if (osc_cache_too_much(cli) > 0) {
+		list_move_tail(&scan->cl_lru_osc, &cache->ccc_lru);
+		if (osc_cache_too_much(scan) > 0) {
 			spin_unlock(&cache->ccc_lru_lock);
 
-			rc = osc_lru_shrink(env, cli, npages, true);
+			rc = osc_lru_shrink(env, scan, npages, true);
 			spin_lock(&cache->ccc_lru_lock);
 			if (rc >= npages)
 				break;
@@ -872,6 +1042,9 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 
 out:
 	cl_env_nested_put(&nest, env);
+	do_gettimeofday(&end);
+	osc_lru_stats_add(cli, OSC_LRU_STATS_RECLAIM,
+			  cfs_timeval_sub(&end, &start, NULL));
 	CDEBUG(D_CACHE, "%s: cli %p freed %ld pages.\n",
 		cli_name(cli), cli, rc);
 	return rc;
@@ -902,6 +1075,10 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 
 	LASSERT(atomic_long_read(cli->cl_lru_left) >= 0);
 	while (!atomic_long_add_unless(cli->cl_lru_left, -1, 0)) {
+		wait_queue_head_t *waitq;
+		struct timeval start;
+		struct timeval end;
+
 		/* run out of LRU spaces, try to drop some by itself */
 		rc = osc_lru_reclaim(cli, 1);
 		if (rc < 0)
@@ -910,17 +1087,27 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 			continue;
 
 		cond_resched();
-		rc = l_wait_event(osc_lru_waitq,
+		waitq = osc_lru_waitq_local();
+		do_gettimeofday(&start);
+		rc = l_wait_event(*waitq,
 				atomic_long_read(cli->cl_lru_left) > 0,
 				&lwi);
+		do_gettimeofday(&end);
+		osc_lru_stats_add(cli, OSC_LRU_STATS_STALL,
+				  cfs_timeval_sub(&end, &start, NULL));
 		if (rc < 0)
 			break;
 	}
 
+	/* get the background work going before the next IO has to wait */
+	if (atomic_long_read(cli->cl_lru_left) < lru_headroom(cli))
+		(void)ptlrpcd_queue_work(cli->cl_lru_work);
+
 out:
 	if (rc >= 0) {
 		atomic_long_inc(&cli->cl_lru_busy);
 		opg->ops_in_lru = 1;
+		opg->ops_lru_cpt = cfs_cpt_current(cfs_cpt_table, 0);
 		rc = 0;
 	}
 
@@ -955,7 +1142,7 @@ unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages)
 		}
 		c = atomic_long_read(cli->cl_lru_left);
 	}
-	if (atomic_long_read(cli->cl_lru_left) < max_pages) {
+	if (atomic_long_read(cli->cl_lru_left) < lru_headroom(cli)) {
 		/* If there aren't enough pages in the per-OSC LRU then
 		 * wake up the LRU thread to try and clear out space, so
 		 * we don't block if pages are being dirtied quickly. */
@@ -978,7 +1165,7 @@ unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages)
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages)
 {
 	atomic_long_add(npages, cli->cl_lru_left);
-	wake_up_all(&osc_lru_waitq);
+	osc_lru_wake_all();
 }
 
 /**
@@ -1058,7 +1245,7 @@ void osc_dec_unstable_pages(struct ptlrpc_request *req)
 	if (unstable_count == 0)
 		wake_up_all(&cli->cl_cache->ccc_unstable_waitq);
 
-	if (waitqueue_active(&osc_lru_waitq))
+	if (osc_lru_waiters())
 		(void)ptlrpcd_queue_work(cli->cl_lru_work);
 }
 
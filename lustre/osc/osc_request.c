@@ -72,11 +72,16 @@ struct osc_brw_async_args {
 	struct client_obd	 *aa_cli;
 	struct list_head	  aa_oaps;
 	struct list_head	  aa_exts;
+	/* attributes of the objects after the first one of a multi-object
+	 * BRW, aa_obj_count - 1 of them */
+	struct obdo		 *aa_oas;
+	u32			  aa_obj_count;
 };
 
 #define osc_grant_args osc_brw_async_args
 
 struct osc_setattr_args {
+	struct osc_object	*sa_obj;
 	struct obdo		*sa_oa;
 	obd_enqueue_update_f	 sa_upcall;
 	void			*sa_cookie;
@@ -87,6 +92,9 @@ struct osc_fsync_args {
 	struct obdo		*fa_oa;
 	obd_enqueue_update_f	fa_upcall;
 	void			*fa_cookie;
+	/* modifications of fa_obj covered by this sync */
+	__u64			fa_transno;
+	unsigned int		fa_gen;
 };
 
 struct osc_enqueue_args {
@@ -216,14 +224,17 @@ static int osc_setattr_interpret(const struct lu_env *env,
 	lustre_get_wire_obdo(&req->rq_import->imp_connect_data, sa->sa_oa,
 			     &body->oa);
 out:
+	/* a failed or untracked change always needs the next OST_SYNC */
+	osc_object_modified(sa->sa_obj, rc == 0 ? req->rq_transno : 0);
         rc = sa->sa_upcall(sa->sa_cookie, rc);
         RETURN(rc);
 }
 
-int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
+int osc_setattr_async(struct osc_object *obj, struct obdo *oa,
 		      obd_enqueue_update_f upcall, void *cookie,
 		      struct ptlrpc_request_set *rqset)
 {
+	struct obd_export	*exp = osc_export(obj);
 	struct ptlrpc_request	*req;
 	struct osc_setattr_args	*sa;
 	int			 rc;
@@ -246,7 +257,8 @@ int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
 
 	/* do mds to ost setattr asynchronously */
 	if (!rqset) {
-		/* Do not wait for response. */
+		/* Do not wait for response, nor track its commit. */
+		osc_object_modified(obj, 0);
 		ptlrpcd_add_req(req);
 	} else {
 		req->rq_interpret_reply =
@@ -254,6 +266,7 @@ int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
 
 		CLASSERT(sizeof(*sa) <= sizeof(req->rq_async_args));
 		sa = ptlrpc_req_async_args(req);
+		sa->sa_obj = obj;
 		sa->sa_oa = oa;
 		sa->sa_upcall = upcall;
 		sa->sa_cookie = cookie;
@@ -318,10 +331,11 @@ out:
 	RETURN(rc);
 }
 
-int osc_punch_base(struct obd_export *exp, struct obdo *oa,
+int osc_punch_base(struct osc_object *obj, struct obdo *oa,
                    obd_enqueue_update_f upcall, void *cookie,
                    struct ptlrpc_request_set *rqset)
 {
+	struct obd_export	*exp = osc_export(obj);
         struct ptlrpc_request   *req;
         struct osc_setattr_args *sa;
         struct ost_body         *body;
@@ -349,6 +363,7 @@ int osc_punch_base(struct obd_export *exp, struct obdo *oa,
 	req->rq_interpret_reply = (ptlrpc_interpterer_t)osc_setattr_interpret;
 	CLASSERT(sizeof(*sa) <= sizeof(req->rq_async_args));
 	sa = ptlrpc_req_async_args(req);
+	sa->sa_obj = obj;
 	sa->sa_oa = oa;
 	sa->sa_upcall = upcall;
 	sa->sa_cookie = cookie;
@@ -383,6 +398,14 @@ static int osc_sync_interpret(const struct lu_env *env,
 	*fa->fa_oa = body->oa;
 	obj = osc2cl(fa->fa_obj);
 
+	/* everything done to the object before the sync is now on disk */
+	osc_object_lock(fa->fa_obj);
+	if ((int)(fa->fa_gen - fa->fa_obj->oo_synced_gen) > 0)
+		fa->fa_obj->oo_synced_gen = fa->fa_gen;
+	if (fa->fa_transno > fa->fa_obj->oo_synced_transno)
+		fa->fa_obj->oo_synced_transno = fa->fa_transno;
+	osc_object_unlock(fa->fa_obj);
+
 	/* Update osc object's blocks attribute */
 	cl_object_attr_lock(obj);
 	if (body->oa.o_valid & OBD_MD_FLBLOCKS) {
@@ -435,6 +458,11 @@ int osc_sync_base(struct osc_object *obj, struct obdo *oa,
 	fa->fa_upcall = upcall;
 	fa->fa_cookie = cookie;
 
+	osc_object_lock(obj);
+	fa->fa_transno = obj->oo_mod_transno;
+	fa->fa_gen = obj->oo_mod_gen;
+	osc_object_unlock(obj);
+
 	if (rqset == PTLRPCD_SET)
 		ptlrpcd_add_req(req);
 	else
@@ -930,6 +958,15 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
         return (p1->off + p1->count == p2->off);
 }
 
+/* Whether \a pga[i] is the first page of another object in a multi-object
+ * BRW. Pages of an object are contiguous and sorted by offset in \a pga. */
+static inline bool osc_brw_new_obj(struct brw_page **pga, int i,
+				   u32 obj_count)
+{
+	return obj_count > 1 &&
+	       brw_page2oap(pga[i])->oap_obj != brw_page2oap(pga[i - 1])->oap_obj;
+}
+
 static u32 osc_checksum_bulk(int nob, size_t pg_count,
 			     struct brw_page **pga, int opc,
 			     cksum_type_t cksum_type)
@@ -987,6 +1024,7 @@ static u32 osc_checksum_bulk(int nob, size_t pg_count,
 
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
+		     struct obdo *oas, u32 obj_count,
 		     u32 page_count, struct brw_page **pga,
 		     struct ptlrpc_request **reqp, int resend)
 {
@@ -995,7 +1033,9 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct ost_body         *body;
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
+	struct obdo		*wire_oas = NULL;
         int niocount, i, requested_nob, opc, rc;
+	int obj = 0;
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
@@ -1018,16 +1058,20 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         if (req == NULL)
                 RETURN(-ENOMEM);
 
-        for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
-                        niocount++;
-        }
+	LASSERT(obj_count == 1 || (cmd & OBD_BRW_WRITE) != 0);
+	for (niocount = i = 1; i < page_count; i++) {
+		if (!can_merge_pages(pga[i - 1], pga[i]) ||
+		    osc_brw_new_obj(pga, i, obj_count))
+			niocount++;
+	}
 
         pill = &req->rq_pill;
         req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
+			     obj_count * sizeof(*ioobj));
         req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
                              niocount * sizeof(*niobuf));
+	req_capsule_set_size(pill, &RMF_OST_OBDOS, RCL_CLIENT,
+			     (obj_count - 1) * sizeof(*oas));
 
         rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, opc);
         if (rc) {
@@ -1060,29 +1104,47 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 	lustre_set_wire_obdo(&req->rq_import->imp_connect_data, &body->oa, oa);
 
 	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
+	if (obj_count > 1) {
+		wire_oas = req_capsule_client_get(pill, &RMF_OST_OBDOS);
+		LASSERT(wire_oas != NULL);
+		for (i = 1; i < obj_count; i++) {
+			lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+					     &wire_oas[i - 1], &oas[i - 1]);
+			obdo_to_ioobj(&oas[i - 1], &ioobj[i]);
+		}
+	}
 	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
 	 * that might be send for this request.  The actual number is decided
 	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
 	 * "max - 1" for old client compatibility sending "0", and also so the
 	 * the actual maximum is a power-of-two number, not one less. LU-1431 */
-	ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
+	for (i = 0; i < obj_count; i++) {
+		ioobj[i].ioo_bufcnt = 0;
+		ioobj_max_brw_set(&ioobj[i], desc->bd_md_max_brw);
+	}
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
         for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
                 struct brw_page *pg = pga[i];
 		int poff = pg->off & ~PAGE_MASK;
+		/* first and last pages of the object @pg belongs to */
+		bool first = i == 0 || osc_brw_new_obj(pga, i, obj_count);
+		bool last = i == page_count - 1 ||
+			    osc_brw_new_obj(pga, i + 1, obj_count);
+
+		if (first && i > 0)
+			obj++;
 
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_CACHE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF((first && last) ||
+			 (ergo(first, poff + pg->count == PAGE_CACHE_SIZE) &&
+			  ergo(!first && !last,
 			       poff == 0 && pg->count == PAGE_CACHE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(last, poff == 0)),
 			 "i: %d/%d pg: %p off: "LPU64", count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+                LASSERTF(first || pg->off > pg_prev->off,
                          "i %d p_c %u pg %p [pri %lu ind %lu] off "LPU64
                          " prev_pg %p [pri %lu ind %lu] off "LPU64"\n",
                          i, page_count,
@@ -1095,16 +1157,18 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		desc->bd_frag_ops->add_kiov_frag(desc, pg->pg, poff, pg->count);
                 requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
+		if (!first && can_merge_pages(pg_prev, pg)) {
                         niobuf--;
 			niobuf->rnb_len += pg->count;
 		} else {
 			niobuf->rnb_offset = pg->off;
 			niobuf->rnb_len    = pg->count;
 			niobuf->rnb_flags  = pg->flag;
+			ioobj[obj].ioo_bufcnt++;
                 }
                 pg_prev = pg;
         }
+	LASSERT(obj == obj_count - 1);
 
         LASSERTF((void *)(niobuf - niocount) ==
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
@@ -1118,6 +1182,14 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
                         body->oa.o_flags = 0;
                 }
                 body->oa.o_flags |= OBD_FL_RECOV_RESEND;
+		/* the grant of every object was already accounted */
+		for (i = 0; i < obj_count - 1; i++) {
+			if ((wire_oas[i].o_valid & OBD_MD_FLFLAGS) == 0) {
+				wire_oas[i].o_valid |= OBD_MD_FLFLAGS;
+				wire_oas[i].o_flags = 0;
+			}
+			wire_oas[i].o_flags |= OBD_FL_RECOV_RESEND;
+		}
         }
 
         if (osc_should_shrink_grant(cli))
@@ -1175,6 +1247,8 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         aa->aa_resends = 0;
         aa->aa_ppga = pga;
         aa->aa_cli = cli;
+	aa->aa_oas = oas;
+	aa->aa_obj_count = obj_count;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
 	*reqp = req;
@@ -1397,7 +1471,8 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
-				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
+				  aa->aa_cli, aa->aa_oa, aa->aa_oas,
+				  aa->aa_obj_count, aa->aa_page_count,
 				  aa->aa_ppga, &new_req, 1);
         if (rc)
                 RETURN(rc);
@@ -1490,6 +1565,71 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/**
+ * Update the attributes of one object of a completed BRW.
+ *
+ * \param[in] env	execution environment
+ * \param[in] req	completed BRW request
+ * \param[in] oa	attributes returned by the server, NULL for the objects
+ *			after the first one of a multi-object BRW as the reply
+ *			only describes the first object
+ * \param[in] last	last page of the object in the BRW
+ */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct osc_async_page *last)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+	unsigned long valid = 0;
+
+	cl_object_attr_lock(obj);
+	if (oa != NULL) {
+		if (oa->o_valid & OBD_MD_FLBLOCKS) {
+			attr->cat_blocks = oa->o_blocks;
+			valid |= CAT_BLOCKS;
+		}
+		if (oa->o_valid & OBD_MD_FLMTIME) {
+			attr->cat_mtime = oa->o_mtime;
+			valid |= CAT_MTIME;
+		}
+		if (oa->o_valid & OBD_MD_FLATIME) {
+			attr->cat_atime = oa->o_atime;
+			valid |= CAT_ATIME;
+		}
+		if (oa->o_valid & OBD_MD_FLCTIME) {
+			attr->cat_ctime = oa->o_ctime;
+			valid |= CAT_CTIME;
+		}
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off +
+			last->oap_page_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_update(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE)
+		osc_object_modified(cl2osc(obj), req->rq_transno);
+}
+
 static int brw_interpret(const struct lu_env *env,
                          struct ptlrpc_request *req, void *data, int rc)
 {
@@ -1527,57 +1667,27 @@ static int brw_interpret(const struct lu_env *env,
 	}
 
 	if (rc == 0) {
+		struct brw_page **pga = aa->aa_ppga;
 		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
-		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
+		int i;
+
+		/* update each object at its last page, the reply body only
+		 * describes the first object of a multi-object BRW */
+		for (i = 1; aa->aa_obj_count > 1 && i < aa->aa_page_count;
+		     i++) {
+			if (!osc_brw_new_obj(pga, i, aa->aa_obj_count))
+				continue;
+			osc_brw_update_attr(env, req, oa,
+					    brw_page2oap(pga[i - 1]));
+			oa = NULL;
 		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off +
-				last->oap_page_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
-		}
-
-		if (valid != 0)
-			cl_object_attr_update(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
+		osc_brw_update_attr(env, req, oa,
+				    brw_page2oap(pga[aa->aa_page_count - 1]));
 	}
 	OBDO_FREE(aa->aa_oa);
+	if (aa->aa_oas != NULL)
+		OBD_FREE(aa->aa_oas,
+			 (aa->aa_obj_count - 1) * sizeof(*aa->aa_oas));
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0)
 		osc_inc_unstable_pages(req);
@@ -1625,10 +1735,39 @@ static void brw_commit(struct ptlrpc_request *req)
 	}
 }
 
+/**
+ * Set the attributes of the objects after the first one of a multi-object
+ * BRW, \a oas[k - 1] gets the ones of object k.
+ */
+static void osc_brw_objs_attr_set(const struct lu_env *env,
+				  struct cl_req_attr *crattr,
+				  struct brw_page **pga, int page_count,
+				  u32 obj_count, struct obdo *oas, u64 flags)
+{
+	int i;
+	int k = 0;
+
+	for (i = 1; i < page_count; i++) {
+		struct osc_async_page *oap;
+
+		if (!osc_brw_new_obj(pga, i, obj_count))
+			continue;
+
+		oap = brw_page2oap(pga[i]);
+		crattr->cra_flags = flags;
+		crattr->cra_page = oap2cl_page(oap);
+		crattr->cra_oa = &oas[k++];
+		cl_req_attr_set(env, osc2cl(oap->oap_obj), crattr);
+	}
+	LASSERT(k == obj_count - 1);
+}
+
 /**
  * Build an RPC by the list of extent @ext_list. The caller must ensure
  * that the total pages in this list are NOT over max pages per RPC.
- * Extents in the list must be in OES_RPC state.
+ * Extents in the list must be in OES_RPC state. The extents of each object
+ * must be contiguous in the list, several objects are only allowed for a
+ * write to a server supporting OBD_CONNECT2_MULTIOBJ_BRW.
  */
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd)
@@ -1638,14 +1777,19 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct brw_page			**pga = NULL;
 	struct osc_brw_async_args	*aa = NULL;
 	struct obdo			*oa = NULL;
+	struct obdo			*oas = NULL;
 	struct osc_async_page		*oap;
 	struct osc_object		*obj = NULL;
+	struct osc_object		*cur = NULL;
 	struct cl_req_attr		*crattr = NULL;
 	loff_t				starting_offset = OBD_OBJECT_EOF;
+	loff_t				obj_offset = OBD_OBJECT_EOF;
 	loff_t				ending_offset = 0;
 	int				mpflag = 0;
 	int				mem_tight = 0;
 	int				page_count = 0;
+	int				obj_start = 0;
+	u32				obj_count = 0;
 	bool				soft_sync = false;
 	bool				interrupted = false;
 	int				i;
@@ -1662,7 +1806,12 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		page_count += ext->oe_nr_pages;
 		if (obj == NULL)
 			obj = ext->oe_obj;
+		if (ext->oe_obj != cur) {
+			cur = ext->oe_obj;
+			obj_count++;
+		}
 	}
+	LASSERT(obj_count <= OST_MAX_BRW_OBJS);
 
 	soft_sync = osc_over_unstable_soft_limit(cli);
 	if (mem_tight)
@@ -1676,8 +1825,24 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (oa == NULL)
 		GOTO(out, rc = -ENOMEM);
 
+	if (obj_count > 1) {
+		OBD_ALLOC(oas, (obj_count - 1) * sizeof(*oas));
+		if (oas == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
+
 	i = 0;
+	cur = NULL;
 	list_for_each_entry(ext, ext_list, oe_link) {
+		if (ext->oe_obj != cur) {
+			/* pages are sorted per object */
+			if (cur != NULL)
+				sort_brw_pages(pga + obj_start, i - obj_start);
+			obj_start = i;
+			obj_offset = OBD_OBJECT_EOF;
+			ending_offset = 0;
+			cur = ext->oe_obj;
+		}
 		list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
 			if (mem_tight)
 				oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -1688,9 +1853,11 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 			i++;
 
 			list_add_tail(&oap->oap_rpc_item, &rpc_list);
-			if (starting_offset == OBD_OBJECT_EOF ||
-			    starting_offset > oap->oap_obj_off)
+			if (starting_offset > oap->oap_obj_off)
 				starting_offset = oap->oap_obj_off;
+			if (obj_offset == OBD_OBJECT_EOF ||
+			    obj_offset > oap->oap_obj_off)
+				obj_offset = oap->oap_obj_off;
 			else
 				LASSERT(oap->oap_page_off == 0);
 			if (ending_offset < oap->oap_obj_off + oap->oap_count)
@@ -1704,19 +1871,24 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		}
 	}
 
+	sort_brw_pages(pga + obj_start, page_count - obj_start);
+
 	/* first page in the list */
 	oap = list_entry(rpc_list.next, typeof(*oap), oap_rpc_item);
 
 	crattr = &osc_env_info(env)->oti_req_attr;
 	memset(crattr, 0, sizeof(*crattr));
 	crattr->cra_type = (cmd & OBD_BRW_WRITE) ? CRT_WRITE : CRT_READ;
+	if (obj_count > 1)
+		osc_brw_objs_attr_set(env, crattr, pga, page_count, obj_count,
+				      oas, ~0ULL);
 	crattr->cra_flags = ~0ULL;
 	crattr->cra_page = oap2cl_page(oap);
 	crattr->cra_oa = oa;
 	cl_req_attr_set(env, osc2cl(obj), crattr);
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	rc = osc_brw_prep_request(cmd, cli, oa, oas, obj_count, page_count,
+				  pga, &req, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -1734,9 +1906,16 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	 * later setattr before earlier BRW (as determined by the request xid),
 	 * the OST will not use BRW timestamps.  Sadly, there is no obvious
 	 * way to do this in a single call.  bug 10150 */
+	if (obj_count > 1)
+		osc_brw_objs_attr_set(env, crattr, pga, page_count, obj_count,
+				      req_capsule_client_get(&req->rq_pill,
+							     &RMF_OST_OBDOS),
+				      OBD_MD_FLMTIME | OBD_MD_FLCTIME |
+				      OBD_MD_FLATIME);
 	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
 	crattr->cra_oa = &body->oa;
 	crattr->cra_flags = OBD_MD_FLMTIME|OBD_MD_FLCTIME|OBD_MD_FLATIME;
+	crattr->cra_page = oap2cl_page(oap);
 	cl_req_attr_set(env, osc2cl(obj), crattr);
 	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
 
@@ -1781,6 +1960,8 @@ out:
 
 		if (oa)
 			OBDO_FREE(oa);
+		if (oas)
+			OBD_FREE(oas, (obj_count - 1) * sizeof(*oas));
 		if (pga)
 			OBD_FREE(pga, sizeof(*pga) * page_count);
 		/* this should happen rarely and is pretty bad, it makes the
@@ -2585,20 +2766,24 @@ static int osc_import_event(struct obd_device *obd,
 
 /**
  * Determine whether the lock can be canceled before replaying the lock
- * during recovery, see bug16774 for detailed information.
+ * during recovery, see bug16774 for detailed information.  The LRU memory
+ * pressure policy also uses the number of cached pages it returns to
+ * prefer canceling locks that cache little.
  *
  * \retval zero the lock can't be canceled
- * \retval other ok to cancel
+ * \retval other ok to cancel, 1 plus the number of cached pages under it
  */
 static int osc_cancel_weight(struct ldlm_lock *lock)
 {
+	unsigned long pages = 0;
+
 	/*
 	 * Cancel all unused and granted extent lock.
 	 */
 	if (lock->l_resource->lr_type == LDLM_EXTENT &&
 	    lock->l_granted_mode == lock->l_req_mode &&
-	    osc_ldlm_weigh_ast(lock) == 0)
-		RETURN(1);
+	    osc_ldlm_weigh_ast(lock, &pages) == 0)
+		RETURN(1 + min_t(unsigned long, pages, INT_MAX - 1));
 
 	RETURN(0);
 }
@@ -2642,6 +2827,10 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
 	cli->cl_lru_work = handler;
 
+	rc = osc_lru_segs_init(cli);
+	if (rc)
+		GOTO(out_ptlrpcd_work, rc);
+
 	rc = osc_quota_setup(obd);
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
@@ -2711,6 +2900,7 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_lru_work);
 		cli->cl_lru_work = NULL;
 	}
+	osc_lru_segs_fini(cli);
 out_client_setup:
 	client_obd_cleanup(obd);
 out_ptlrpcd:
@@ -2771,6 +2961,10 @@ int osc_cleanup(struct obd_device *obd)
 		cli->cl_cache = NULL;
 	}
 
+	osc_lru_segs_fini(cli);
+	if (cli->cl_lru_stats != NULL)
+		lprocfs_free_stats(&cli->cl_lru_stats);
+
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
 
@@ -2855,6 +3049,10 @@ static int __init osc_init(void)
 	if (rc)
 		RETURN(rc);
 
+	rc = osc_lru_waitq_init();
+	if (rc)
+		GOTO(out_kmem, rc);
+
 	type = class_search_type(LUSTRE_OSP_NAME);
 	if (type != NULL && type->typ_procsym != NULL)
 		enable_proc = false;
@@ -2894,6 +3092,7 @@ static int __init osc_init(void)
 out_type:
 	class_unregister_type(LUSTRE_OSC_NAME);
 out_kmem:
+	osc_lru_waitq_fini();
 	lu_kmem_fini(osc_caches);
 out:
 	RETURN(rc);
@@ -2903,6 +3102,7 @@ static void __exit osc_exit(void)
 {
 	remove_shrinker(osc_cache_shrinker);
 	class_unregister_type(LUSTRE_OSC_NAME);
+	osc_lru_waitq_fini();
 	lu_kmem_fini(osc_caches);
 	ptlrpc_free_rq_pool(osc_rq_pool);
 }
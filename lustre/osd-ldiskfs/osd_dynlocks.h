@@ -3,16 +3,30 @@
 
 #include <linux/list.h>
 #include <linux/wait.h>
+#include <linux/hash.h>
+
+#define DYNLOCK_HASH_BITS	5
+#define DYNLOCK_HASH_SIZE	(1 << DYNLOCK_HASH_BITS)
+
+/*
+ * hash bucket of a lock's namespace:
+ *   - list of locks whose values hash to this bucket
+ *   - lock to protect this list and the locks on it
+ */
+struct dynlock_bucket {
+	struct list_head	db_list;
+	spinlock_t		db_lock;
+};
 
 /*
  * lock's namespace:
- *   - list of locks
- *   - lock to protect this list
+ *   - table of buckets, so that lookups only scan the locks held on
+ *     values sharing the same hash and holders of different values
+ *     do not contend on a single spinlock
  */
 struct dynlock {
 	unsigned		dl_magic;
-	struct list_head	dl_list;
-	spinlock_t		dl_list_lock;
+	struct dynlock_bucket	dl_hash[DYNLOCK_HASH_SIZE];
 };
 
 enum dynlock_type {
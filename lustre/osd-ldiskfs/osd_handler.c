@@ -2231,6 +2231,7 @@ static int osd_attr_set(const struct lu_env *env,
 		rc = iam_update(oh->ot_handle, bag, (const struct iam_key *)fid1,
 				(const struct iam_rec *)id, ipd);
 		osd_ipd_put(env, bag, ipd);
+		osd_oi_cache_invalidate(osd_dev(dt->do_lu.lo_dev), fid0);
 		return(rc > 0 ? 0 : rc);
 	}
 
@@ -2290,6 +2291,204 @@ static struct dentry *osd_child_dentry_get(const struct lu_env *env,
         return osd_child_dentry_by_inode(env, obj->oo_inode, name, namelen);
 }
 
+/* skip block groups with fewer free inodes than this when looking for a
+ * goal, so concurrent creates on a CPT don't pile up in a full group */
+#define OSD_IALLOC_LOOKAHEAD	32
+/* most block groups looked at by one goal lookup */
+#define OSD_IALLOC_SCAN_MAX	16
+/* seconds to leave inode placement to ldiskfs once the whole range of a
+ * CPT was found nearly full */
+#define OSD_IALLOC_FULL_RETRY	5
+
+static inline __u32 osd_group_free_inodes(struct super_block *sb,
+					  struct ldiskfs_group_desc *gdp)
+{
+	__u32 count = le16_to_cpu(gdp->bg_free_inodes_count_lo);
+
+	if (LDISKFS_DESC_SIZE(sb) >= LDISKFS_MIN_DESC_SIZE_64BIT)
+		count |= (__u32)le16_to_cpu(gdp->bg_free_inodes_count_hi) << 16;
+
+	return count;
+}
+
+/**
+ * Compute the range of block groups preferred by CPT \a cpt
+ *
+ * Called with oia_lock held, or before \a oia is in use.
+ *
+ * \param[in] sb	super block of the OSD
+ * \param[in] oia	per-CPT inode allocation state
+ * \param[in] cpt	CPT \a oia belongs to
+ * \param[in] ngroups	number of block groups of the file system
+ */
+static void osd_ialloc_range(struct super_block *sb, struct osd_ialloc *oia,
+			     int cpt, __u32 ngroups)
+{
+	int ncpt = cfs_cpt_number(cfs_cpt_table);
+
+	oia->oia_ngroups = ngroups;
+	oia->oia_first = ngroups / ncpt * cpt;
+	oia->oia_last = cpt == ncpt - 1 ? ngroups :
+					  oia->oia_first + ngroups / ncpt;
+	oia->oia_goal = 1 + oia->oia_first * LDISKFS_INODES_PER_GROUP(sb);
+	oia->oia_scanned = 0;
+	oia->oia_full_time = 0;
+}
+
+/**
+ * Split block groups between CPTs for inode allocation
+ *
+ * Each CPT gets a contiguous range of block groups to allocate inodes for
+ * new objects from. The policy is only enabled by default if there is more
+ * than one CPT and enough groups to give each CPT a few of them. The ranges
+ * are computed again by osd_ialloc_goal() if the file system is resized.
+ *
+ * \param[in] osd	OSD device
+ *
+ * \retval 0		on success
+ * \retval -ENOMEM	if per-CPT state cannot be allocated
+ */
+static int osd_ialloc_init(struct osd_device *osd)
+{
+	struct super_block	*sb = osd_sb(osd);
+	struct osd_ialloc	*oia;
+	__u32			 ngroups = LDISKFS_SB(sb)->s_groups_count;
+	int			 ncpt = cfs_cpt_number(cfs_cpt_table);
+	int			 i;
+
+	osd->od_ialloc = cfs_percpt_alloc(cfs_cpt_table, sizeof(*oia));
+	if (osd->od_ialloc == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(oia, i, osd->od_ialloc) {
+		spin_lock_init(&oia->oia_lock);
+		osd_ialloc_range(sb, oia, i, ngroups);
+	}
+
+	if (ncpt > 1 && ngroups >= 2 * ncpt)
+		osd->od_ialloc_policy = OSD_IALLOC_CPT;
+	else
+		osd->od_ialloc_policy = OSD_IALLOC_PARENT;
+
+	return 0;
+}
+
+static void osd_ialloc_fini(struct osd_device *osd)
+{
+	if (osd->od_ialloc == NULL)
+		return;
+
+	cfs_percpt_free(osd->od_ialloc);
+	osd->od_ialloc = NULL;
+}
+
+/**
+ * Find goal inode number for a new object
+ *
+ * Starts from the cursor of the current CPT and looks ahead for a group in
+ * the CPT range which has enough free inodes. Directories are still spread
+ * by the ldiskfs Orlov allocator.
+ *
+ * At most OSD_IALLOC_SCAN_MAX groups are looked at under oia_lock, the next
+ * lookup goes on from there. Once the whole range has been looked at without
+ * success, the range is taken as full and inode placement is left to ldiskfs
+ * for OSD_IALLOC_FULL_RETRY seconds.
+ *
+ * \param[in] osd	OSD device
+ * \param[in] mode	mode of the new inode
+ * \param[out] cpt	CPT the goal was taken from
+ *
+ * \retval		goal inode number, 0 to let ldiskfs choose
+ */
+static __u32 osd_ialloc_goal(struct osd_device *osd, umode_t mode, int *cpt)
+{
+	struct super_block	*sb = osd_sb(osd);
+	struct ldiskfs_group_desc *gdp;
+	struct osd_ialloc	*oia;
+	__u32			 ipg = LDISKFS_INODES_PER_GROUP(sb);
+	__u32			 ngroups = LDISKFS_SB(sb)->s_groups_count;
+	__u32			 group;
+	__u32			 goal = 0;
+	__u32			 i;
+
+	if (osd->od_ialloc_policy != OSD_IALLOC_CPT || S_ISDIR(mode))
+		return 0;
+
+	*cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	oia = osd->od_ialloc[*cpt];
+
+	spin_lock(&oia->oia_lock);
+	/* the file system was resized online */
+	if (unlikely(oia->oia_ngroups != ngroups))
+		osd_ialloc_range(sb, oia, *cpt, ngroups);
+	if (unlikely(oia->oia_first >= oia->oia_last))
+		goto out;
+
+	/* all preferred groups were nearly full lately, let ldiskfs choose */
+	if (oia->oia_full_time != 0) {
+		if (cfs_time_current_sec() <
+		    oia->oia_full_time + OSD_IALLOC_FULL_RETRY)
+			goto out;
+		oia->oia_full_time = 0;
+		oia->oia_scanned = 0;
+	}
+
+	group = (oia->oia_goal - 1) / ipg;
+	if (group < oia->oia_first || group >= oia->oia_last)
+		group = oia->oia_first;
+
+	for (i = 0; i < OSD_IALLOC_SCAN_MAX; i++) {
+		gdp = ldiskfs_get_group_desc(sb, group, NULL);
+		if (gdp != NULL &&
+		    osd_group_free_inodes(sb, gdp) >= OSD_IALLOC_LOOKAHEAD) {
+			goal = 1 + group * ipg;
+			if ((oia->oia_goal - 1) / ipg == group)
+				goal = oia->oia_goal;
+			oia->oia_goal = goal;
+			oia->oia_scanned = 0;
+			break;
+		}
+
+		oia->oia_skips++;
+		if (++group >= oia->oia_last)
+			group = oia->oia_first;
+		oia->oia_goal = 1 + group * ipg;
+
+		if (++oia->oia_scanned >= oia->oia_last - oia->oia_first) {
+			oia->oia_full_time = cfs_time_current_sec();
+			break;
+		}
+	}
+out:
+	spin_unlock(&oia->oia_lock);
+
+	return goal;
+}
+
+/**
+ * Advance the CPT cursor past a newly allocated inode
+ *
+ * \param[in] osd	OSD device
+ * \param[in] cpt	CPT the goal was taken from
+ * \param[in] inode	new inode
+ */
+static void osd_ialloc_done(struct osd_device *osd, int cpt,
+			    struct inode *inode)
+{
+	struct osd_ialloc	*oia = osd->od_ialloc[cpt];
+	__u32			 group;
+
+	group = (inode->i_ino - 1) / LDISKFS_INODES_PER_GROUP(osd_sb(osd));
+
+	spin_lock(&oia->oia_lock);
+	oia->oia_allocs++;
+	if (group >= oia->oia_first && group < oia->oia_last)
+		oia->oia_goal = inode->i_ino + 1;
+	else
+		oia->oia_spills++;
+	spin_unlock(&oia->oia_lock);
+}
+
 static int osd_mkfile(struct osd_thread_info *info, struct osd_object *obj,
 		      umode_t mode, struct dt_allocation_hint *hint,
 		      struct thandle *th)
@@ -2299,6 +2498,8 @@ static int osd_mkfile(struct osd_thread_info *info, struct osd_object *obj,
         struct osd_thandle *oth;
         struct dt_object   *parent = NULL;
         struct inode       *inode;
+	__u32		    goal;
+	int		    cpt = 0;
 
         LINVRNT(osd_invariant(obj));
         LASSERT(obj->oo_inode == NULL);
@@ -2317,11 +2518,15 @@ static int osd_mkfile(struct osd_thread_info *info, struct osd_object *obj,
 	    !dt_object_remote(hint->dah_parent))
 		parent = hint->dah_parent;
 
-        inode = ldiskfs_create_inode(oth->ot_handle,
-                                     parent ? osd_dt_obj(parent)->oo_inode :
-                                              osd_sb(osd)->s_root->d_inode,
-                                     mode);
+	goal = osd_ialloc_goal(osd, mode, &cpt);
+	inode = ldiskfs_create_inode(oth->ot_handle,
+				     parent ? osd_dt_obj(parent)->oo_inode :
+					      osd_sb(osd)->s_root->d_inode,
+				     mode, goal);
         if (!IS_ERR(inode)) {
+		if (goal != 0)
+			osd_ialloc_done(osd, cpt, inode);
+
 		/* Do not update file c/mtime in ldiskfs. */
 		inode->i_flags |= S_NOCMTIME;
 
@@ -2976,7 +3181,7 @@ static struct inode *osd_create_local_agent_inode(const struct lu_env *env,
 	oh = container_of(th, struct osd_thandle, ot_super);
 	LASSERT(oh->ot_handle->h_transaction != NULL);
 
-	local = ldiskfs_create_inode(oh->ot_handle, pobj->oo_inode, type);
+	local = ldiskfs_create_inode(oh->ot_handle, pobj->oo_inode, type, 0);
 	if (IS_ERR(local)) {
 		CERROR("%s: create local error %d\n", osd_name(osd),
 		       (int)PTR_ERR(local));
@@ -6373,6 +6578,7 @@ static struct lu_device *osd_device_fini(const struct lu_env *env,
 	osd_procfs_fini(o);
 	osd_scrub_cleanup(env, o);
 	osd_obj_map_fini(o);
+	osd_ialloc_fini(o);
 	osd_umount(env, o);
 
 	RETURN(NULL);
@@ -6423,10 +6629,14 @@ static int osd_device_init0(const struct lu_env *env,
 	if (rc != 0)
 		GOTO(out, rc);
 
-	rc = osd_obj_map_init(env, o);
+	rc = osd_ialloc_init(o);
 	if (rc != 0)
 		GOTO(out_mnt, rc);
 
+	rc = osd_obj_map_init(env, o);
+	if (rc != 0)
+		GOTO(out_ialloc, rc);
+
 	rc = lu_site_init(&o->od_site, l);
 	if (rc != 0)
 		GOTO(out_compat, rc);
@@ -6471,6 +6681,8 @@ out_site:
 	lu_site_fini(&o->od_site);
 out_compat:
 	osd_obj_map_fini(o);
+out_ialloc:
+	osd_ialloc_fini(o);
 out_mnt:
 	osd_umount(env, o);
 out:
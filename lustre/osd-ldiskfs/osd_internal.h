@@ -240,6 +240,8 @@ struct osd_device {
         struct osd_oi           **od_oi_table;
         /* total number of OI containers */
         int                       od_oi_count;
+	/* per-CPT cache of the OI mappings, see osd_oi_lookup() */
+	struct osd_oi_cache	**od_oi_cache;
         /*
          * Fid Capability
          */
@@ -298,6 +300,42 @@ struct osd_device {
 
 	/* a list of orphaned agent inodes, protected with od_osfs_lock */
 	struct list_head	 od_orphan_list;
+
+	/* per-CPT inode allocation state, see osd_ialloc_goal() */
+	struct osd_ialloc	**od_ialloc;
+	int			 od_ialloc_policy;
+};
+
+/* placement of inodes for new non-directory objects */
+enum osd_ialloc_policy {
+	/* let ldiskfs place the inode near the parent directory */
+	OSD_IALLOC_PARENT	= 0,
+	/* place the inode in the block groups preferred by the current CPT */
+	OSD_IALLOC_CPT		= 1,
+};
+
+/* Each CPT prefers its own range of block groups for new inodes, so that
+ * concurrent creates on different CPTs do not contend on the same inode
+ * bitmaps and group locks. */
+struct osd_ialloc {
+	spinlock_t		 oia_lock;
+	/* preferred block groups [oia_first, oia_last) */
+	__u32			 oia_first;
+	__u32			 oia_last;
+	/* next inode number to try */
+	__u32			 oia_goal;
+	/* number of block groups the range was computed for */
+	__u32			 oia_ngroups;
+	/* nearly full groups seen in a row, see osd_ialloc_goal() */
+	__u32			 oia_scanned;
+	/* when the whole range was last found nearly full, 0 if it was not */
+	__u64			 oia_full_time;
+	/* inodes allocated with a goal */
+	__u64			 oia_allocs;
+	/* inodes ldiskfs placed outside of the preferred groups */
+	__u64			 oia_spills;
+	/* groups skipped by lookahead because they were nearly full */
+	__u64			 oia_skips;
 };
 
 enum osd_full_scrub_ratio {
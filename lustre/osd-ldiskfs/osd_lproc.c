@@ -325,6 +325,98 @@ ldiskfs_osd_wcache_seq_write(struct file *file, const char *buffer,
 }
 LPROC_SEQ_FOPS(ldiskfs_osd_wcache);
 
+static int ldiskfs_osd_ialloc_policy_seq_show(struct seq_file *m, void *data)
+{
+	struct osd_device *osd = osd_dt_dev((struct dt_device *)m->private);
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	return seq_printf(m, "%d\n", osd->od_ialloc_policy);
+}
+
+static ssize_t
+ldiskfs_osd_ialloc_policy_seq_write(struct file *file, const char *buffer,
+				    size_t count, loff_t *off)
+{
+	struct seq_file	  *m = file->private_data;
+	struct dt_device  *dt = m->private;
+	struct osd_device *osd = osd_dt_dev(dt);
+	int		   val, rc;
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val != OSD_IALLOC_PARENT && val != OSD_IALLOC_CPT)
+		return -EINVAL;
+
+	osd->od_ialloc_policy = val;
+	return count;
+}
+LPROC_SEQ_FOPS(ldiskfs_osd_ialloc_policy);
+
+static int ldiskfs_osd_ialloc_groups_seq_show(struct seq_file *m, void *data)
+{
+	struct osd_device *osd = osd_dt_dev((struct dt_device *)m->private);
+	struct osd_ialloc *oia;
+	__u32		   ipg;
+	int		   i;
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	ipg = LDISKFS_INODES_PER_GROUP(osd_sb(osd));
+	seq_printf(m, "%-4s %10s %10s %10s %14s %14s %14s\n",
+		   "cpt", "first", "last", "goal", "allocs", "spills",
+		   "skips");
+	cfs_percpt_for_each(oia, i, osd->od_ialloc) {
+		spin_lock(&oia->oia_lock);
+		seq_printf(m, "%-4d %10u %10u %10u %14"LPF64"u %14"LPF64"u "
+			   "%14"LPF64"u\n", i, oia->oia_first,
+			   oia->oia_last - 1, (oia->oia_goal - 1) / ipg,
+			   oia->oia_allocs, oia->oia_spills, oia->oia_skips);
+		spin_unlock(&oia->oia_lock);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ldiskfs_osd_ialloc_groups);
+
+static int ldiskfs_osd_oi_cache_seq_show(struct seq_file *m, void *data)
+{
+	struct osd_device   *osd = osd_dt_dev((struct dt_device *)m->private);
+	struct osd_oi_cache *oc;
+	int		     i;
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	if (osd->od_oi_cache == NULL)
+		return seq_printf(m, "disabled\n");
+
+	seq_printf(m, "%-4s %10s %14s %14s %14s %14s\n",
+		   "cpt", "entries", "hits", "neg_hits", "misses",
+		   "invalidates");
+	cfs_percpt_for_each(oc, i, osd->od_oi_cache) {
+		spin_lock(&oc->oc_lock);
+		seq_printf(m, "%-4d %10u %14"LPF64"u %14"LPF64"u %14"LPF64"u "
+			   "%14"LPF64"u\n", i, oc->oc_mask + 1, oc->oc_hits,
+			   oc->oc_neg_hits, oc->oc_misses, oc->oc_invalidates);
+		spin_unlock(&oc->oc_lock);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ldiskfs_osd_oi_cache);
+
 static ssize_t
 lprocfs_osd_force_sync_seq_write(struct file *file, const char *buffer,
 					size_t count, loff_t *off)
@@ -668,6 +760,12 @@ struct lprocfs_vars lprocfs_osd_obd_vars[] = {
 	  .fops	=	&ldiskfs_osd_wcache_fops	},
 	{ .name	=	"readcache_max_filesize",
 	  .fops	=	&ldiskfs_osd_readcache_fops	},
+	{ .name	=	"inode_alloc_policy",
+	  .fops	=	&ldiskfs_osd_ialloc_policy_fops	},
+	{ .name	=	"inode_alloc_groups",
+	  .fops	=	&ldiskfs_osd_ialloc_groups_fops	},
+	{ .name	=	"oi_cache",
+	  .fops	=	&ldiskfs_osd_oi_cache_fops	},
 	{ NULL }
 };
 
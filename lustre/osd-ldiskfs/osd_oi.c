@@ -67,6 +67,10 @@ CFS_MODULE_PARM(osd_oi_count, "i", int, 0444,
                 "Number of Object Index containers to be created, "
                 "it's only valid for new filesystem.");
 
+static unsigned int osd_oi_cache_size = 1 << 16;
+CFS_MODULE_PARM(osd_oi_cache_size, "i", int, 0444,
+		"Number of OI mappings cached per device, 0 to disable.");
+
 /** to serialize concurrent OI index initialization */
 static struct mutex oi_init_lock;
 
@@ -133,7 +137,7 @@ static int osd_oi_index_create_one(struct osd_thread_info *info,
 	if (IS_ERR(jh))
 		return PTR_ERR(jh);
 
-	inode = ldiskfs_create_inode(jh, dir, (S_IFREG | S_IRUGO | S_IWUSR));
+	inode = ldiskfs_create_inode(jh, dir, (S_IFREG | S_IRUGO | S_IWUSR), 0);
 	if (IS_ERR(inode)) {
 		ldiskfs_journal_stop(jh);
 		return PTR_ERR(inode);
@@ -384,6 +388,198 @@ static int osd_remove_ois(struct osd_thread_info *info, struct osd_device *osd)
 	return rc;
 }
 
+/**
+ * Set up the OI cache of a device
+ *
+ * The cache is split into one shard per CPT, each with a power of two
+ * number of direct mapped entries allocated on the CPT.
+ *
+ * \param[in] osd	OSD device
+ *
+ * \retval 0		on success
+ * \retval -ENOMEM	if the cache cannot be allocated
+ */
+static int osd_oi_cache_init(struct osd_device *osd)
+{
+	struct osd_oi_cache	*oc;
+	unsigned int		 entries;
+	int			 ncpt = cfs_cpt_number(cfs_cpt_table);
+	int			 i;
+
+	if (osd_oi_cache_size == 0)
+		return 0;
+
+	entries = size_roundup_power2(max_t(unsigned int,
+					    osd_oi_cache_size / ncpt, 1));
+
+	osd->od_oi_cache = cfs_percpt_alloc(cfs_cpt_table, sizeof(*oc));
+	if (osd->od_oi_cache == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(oc, i, osd->od_oi_cache) {
+		spin_lock_init(&oc->oc_lock);
+		oc->oc_mask = entries - 1;
+		OBD_CPT_ALLOC_LARGE(oc->oc_entries, cfs_cpt_table, i,
+				    sizeof(*oc->oc_entries) * entries);
+		if (oc->oc_entries == NULL)
+			goto failed;
+	}
+
+	return 0;
+
+failed:
+	cfs_percpt_for_each(oc, i, osd->od_oi_cache) {
+		if (oc->oc_entries != NULL)
+			OBD_FREE_LARGE(oc->oc_entries,
+				       sizeof(*oc->oc_entries) * entries);
+	}
+	cfs_percpt_free(osd->od_oi_cache);
+	osd->od_oi_cache = NULL;
+
+	return -ENOMEM;
+}
+
+static void osd_oi_cache_fini(struct osd_device *osd)
+{
+	struct osd_oi_cache	*oc;
+	int			 i;
+
+	if (osd->od_oi_cache == NULL)
+		return;
+
+	cfs_percpt_for_each(oc, i, osd->od_oi_cache)
+		OBD_FREE_LARGE(oc->oc_entries,
+			       sizeof(*oc->oc_entries) * (oc->oc_mask + 1));
+	cfs_percpt_free(osd->od_oi_cache);
+	osd->od_oi_cache = NULL;
+}
+
+static struct osd_oi_cache_entry *
+osd_oi_cache_slot(struct osd_device *osd, const struct lu_fid *fid,
+		  struct osd_oi_cache **ocp)
+{
+	struct osd_oi_cache	*oc;
+	__u32			 hash = fid_hash(fid, 32);
+
+	oc = osd->od_oi_cache[hash % cfs_cpt_number(cfs_cpt_table)];
+	*ocp = oc;
+
+	return &oc->oc_entries[(hash >> 8) & oc->oc_mask];
+}
+
+/**
+ * Look up a FID in the OI cache
+ *
+ * \param[in] osd	OSD device
+ * \param[in] fid	FID to look up
+ * \param[out] id	cached inode id
+ * \param[out] seq	shard sequence to pass to osd_oi_cache_fill()
+ *
+ * \retval 0		cached mapping found
+ * \retval -ENOENT	FID is cached as not in the OI files
+ * \retval 1		FID is not cached
+ */
+static int osd_oi_cache_lookup(struct osd_device *osd,
+			       const struct lu_fid *fid,
+			       struct osd_inode_id *id, unsigned int *seq)
+{
+	struct osd_oi_cache		*oc;
+	struct osd_oi_cache_entry	*ooce;
+	int				 rc = 1;
+
+	ooce = osd_oi_cache_slot(osd, fid, &oc);
+
+	spin_lock(&oc->oc_lock);
+	if (lu_fid_eq(&ooce->ooce_fid, fid)) {
+		if (ooce->ooce_id.oii_ino != 0) {
+			*id = ooce->ooce_id;
+			oc->oc_hits++;
+			rc = 0;
+		} else {
+			oc->oc_neg_hits++;
+			rc = -ENOENT;
+		}
+	} else {
+		oc->oc_misses++;
+		*seq = oc->oc_seq;
+	}
+	spin_unlock(&oc->oc_lock);
+
+	return rc;
+}
+
+/**
+ * Cache the result of an OI lookup
+ *
+ * The mapping is only cached if the OI files were not modified for the
+ * shard since osd_oi_cache_lookup() returned \a seq, otherwise the result
+ * read from the OI file may be stale already.
+ *
+ * \param[in] osd	OSD device
+ * \param[in] fid	FID looked up
+ * \param[in] id	inode id found, NULL if the FID is not in the OI files
+ * \param[in] seq	shard sequence returned by osd_oi_cache_lookup()
+ */
+static void osd_oi_cache_fill(struct osd_device *osd, const struct lu_fid *fid,
+			      const struct osd_inode_id *id, unsigned int seq)
+{
+	struct osd_oi_cache		*oc;
+	struct osd_oi_cache_entry	*ooce;
+
+	ooce = osd_oi_cache_slot(osd, fid, &oc);
+
+	spin_lock(&oc->oc_lock);
+	if (oc->oc_seq == seq) {
+		ooce->ooce_fid = *fid;
+		if (id != NULL)
+			ooce->ooce_id = *id;
+		else
+			osd_id_gen(&ooce->ooce_id, 0, OSD_OII_NOGEN);
+	}
+	spin_unlock(&oc->oc_lock);
+}
+
+/**
+ * Update the OI cache after the OI files were modified for a FID
+ *
+ * \param[in] osd	OSD device
+ * \param[in] fid	FID modified
+ * \param[in] id	new inode id, NULL to drop the cached mapping
+ */
+static void osd_oi_cache_set(struct osd_device *osd, const struct lu_fid *fid,
+			     const struct osd_inode_id *id)
+{
+	struct osd_oi_cache		*oc;
+	struct osd_oi_cache_entry	*ooce;
+
+	if (osd->od_oi_cache == NULL)
+		return;
+
+	ooce = osd_oi_cache_slot(osd, fid, &oc);
+
+	spin_lock(&oc->oc_lock);
+	oc->oc_seq++;
+	if (id != NULL) {
+		ooce->ooce_fid = *fid;
+		ooce->ooce_id = *id;
+	} else if (lu_fid_eq(&ooce->ooce_fid, fid)) {
+		fid_zero(&ooce->ooce_fid);
+		oc->oc_invalidates++;
+	}
+	spin_unlock(&oc->oc_lock);
+}
+
+/**
+ * Drop the cached mapping of a FID whose OI entry was modified directly
+ *
+ * \param[in] osd	OSD device
+ * \param[in] fid	FID modified
+ */
+void osd_oi_cache_invalidate(struct osd_device *osd, const struct lu_fid *fid)
+{
+	osd_oi_cache_set(osd, fid, NULL);
+}
+
 int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
 		bool restored)
 {
@@ -403,6 +599,12 @@ int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
 	if (oi == NULL)
 		RETURN(-ENOMEM);
 
+	rc = osd_oi_cache_init(osd);
+	if (rc != 0) {
+		OBD_FREE(oi, sizeof(*oi) * OSD_OI_FID_NR_MAX);
+		RETURN(rc);
+	}
+
 	mutex_lock(&oi_init_lock);
 	/* try to open existing multiple OIs first */
 	rc = osd_oi_table_open(info, osd, oi, sf->sf_oi_count, false);
@@ -491,6 +693,8 @@ out:
 	}
 
 	mutex_unlock(&oi_init_lock);
+	if (rc < 0)
+		osd_oi_cache_fini(osd);
 	return rc;
 }
 
@@ -504,6 +708,7 @@ void osd_oi_fini(struct osd_thread_info *info, struct osd_device *osd)
         OBD_FREE(osd->od_oi_table,
                  sizeof(*(osd->od_oi_table)) * OSD_OI_FID_NR_MAX);
         osd->od_oi_table = NULL;
+	osd_oi_cache_fini(osd);
 }
 
 static inline int fid_is_fs_root(const struct lu_fid *fid)
@@ -588,8 +793,15 @@ static int __osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 			   const struct lu_fid *fid, struct osd_inode_id *id)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	unsigned int   seq = 0;
 	int	       rc;
 
+	if (osd->od_oi_cache != NULL) {
+		rc = osd_oi_cache_lookup(osd, fid, id, &seq);
+		if (rc <= 0)
+			return rc;
+	}
+
 	fid_cpu_to_be(oi_fid, fid);
 	rc = osd_oi_iam_lookup(info, osd_fid2oi(osd, fid), (struct dt_rec *)id,
 			       (const struct dt_key *)oi_fid);
@@ -599,6 +811,9 @@ static int __osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 	} else if (rc == 0) {
 		rc = -ENOENT;
 	}
+
+	if (osd->od_oi_cache != NULL && (rc == 0 || rc == -ENOENT))
+		osd_oi_cache_fill(osd, fid, rc == 0 ? id : NULL, seq);
 	return rc;
 }
 
@@ -688,6 +903,7 @@ int osd_oi_insert(struct osd_thread_info *info, struct osd_device *osd,
 	rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 			       (const struct dt_rec *)oi_id,
 			       (const struct dt_key *)oi_fid, th, true);
+	osd_oi_cache_set(osd, fid, rc == 0 ? id : NULL);
 	if (rc != 0) {
 		struct inode *inode;
 		struct lustre_mdt_attrs *lma = &info->oti_mdt_attrs;
@@ -741,6 +957,7 @@ update:
 		rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 					(const struct dt_rec *)oi_id,
 					(const struct dt_key *)oi_fid, th, false);
+		osd_oi_cache_set(osd, fid, rc == 0 ? id : NULL);
 		if (rc != 0)
 			return rc;
 	}
@@ -781,6 +998,7 @@ int osd_oi_delete(struct osd_thread_info *info,
 		  handle_t *th, enum oi_check_flags flags)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	int	       rc;
 
 	/* clear idmap cache */
 	if (lu_fid_eq(fid, &info->oti_cache.oic_fid))
@@ -793,8 +1011,10 @@ int osd_oi_delete(struct osd_thread_info *info,
 		return osd_obj_map_delete(info, osd, fid, th);
 
 	fid_cpu_to_be(oi_fid, fid);
-	return osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
-				 (const struct dt_key *)oi_fid, th);
+	rc = osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
+			       (const struct dt_key *)oi_fid, th);
+	osd_oi_cache_set(osd, fid, NULL);
+	return rc;
 }
 
 int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
@@ -816,6 +1036,7 @@ int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 	rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 			       (const struct dt_rec *)oi_id,
 			       (const struct dt_key *)oi_fid, th, false);
+	osd_oi_cache_set(osd, fid, rc == 0 ? id : NULL);
 	if (rc != 0)
 		return rc;
 
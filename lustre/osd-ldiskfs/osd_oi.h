@@ -91,6 +91,27 @@ struct osd_idmap_cache {
 	__u16			oic_remote:1;	/* FID isn't local */
 };
 
+/* Entry of the FID to inode id cache in front of the OI files. */
+struct osd_oi_cache_entry {
+	struct lu_fid		ooce_fid;
+	/* oii_ino is 0 if the FID is known not to be in the OI files */
+	struct osd_inode_id	ooce_id;
+};
+
+/* One shard of the OI cache, FIDs are spread over the CPTs by hash. */
+struct osd_oi_cache {
+	spinlock_t			 oc_lock;
+	struct osd_oi_cache_entry	*oc_entries;
+	unsigned int			 oc_mask;
+	/* changed whenever the OI files are modified for a FID of the shard,
+	 * a lookup only fills the cache if it did not change meanwhile */
+	unsigned int			 oc_seq;
+	__u64				 oc_hits;
+	__u64				 oc_neg_hits;
+	__u64				 oc_misses;
+	__u64				 oc_invalidates;
+};
+
 static inline void osd_id_pack(struct osd_inode_id *tgt,
 			       const struct osd_inode_id *src)
 {
@@ -142,6 +163,7 @@ int osd_oi_mod_init(void);
 int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
 		bool restored);
 void osd_oi_fini(struct osd_thread_info *info, struct osd_device *osd);
+void osd_oi_cache_invalidate(struct osd_device *osd, const struct lu_fid *fid);
 int  osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 		   const struct lu_fid *fid, struct osd_inode_id *id,
 		   enum oi_check_flags flags);
@@ -522,6 +522,85 @@ static int osp_prealloc_reserved_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(osp_prealloc_reserved);
 
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+/**
+ * Show precreate rate estimation and histogram of time creators waited
+ * for precreated objects
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_prealloc_wait_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*obd = m->private;
+	struct osp_device	*osp = lu2osp_dev(obd->obd_lu_dev);
+	struct obd_histogram	*hist;
+	struct timeval		 now;
+	unsigned long		 tot, cum = 0;
+	int			 i;
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return 0;
+
+	hist = &osp->opd_pre_wait_hist;
+	do_gettimeofday(&now);
+
+	seq_printf(m, "snapshot_time:         %lu.%lu (secs.usecs)\n",
+		   now.tv_sec, now.tv_usec);
+	seq_printf(m, "create_rate:           %u objs/s\n",
+		   osp->opd_pre_rate);
+	seq_printf(m, "precreate_rtt:         %u usecs\n",
+		   osp->opd_pre_rpc_usec);
+	seq_printf(m, "create_count:          %d\n",
+		   osp->opd_pre_create_count);
+	seq_printf(m, "reserved:              "LPU64"\n",
+		   osp->opd_pre_reserve_count);
+
+	tot = lprocfs_oh_sum(hist);
+	seq_printf(m, "waited:                %lu\n", tot);
+
+	seq_printf(m, "\nwait time (usecs)     waits   %% cum %%\n");
+	for (i = 0; i < OBD_HIST_MAX && cum < tot; i++) {
+		unsigned long w = hist->oh_buckets[i];
+
+		cum += w;
+		seq_printf(m, "%d:\t\t%10lu %3lu %3lu\n",
+			   1 << i, w, pct(w, tot), pct(cum, tot));
+	}
+
+	return 0;
+}
+
+/**
+ * Reset histogram of time creators waited for precreated objects
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	unused
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ * \retval		\a count
+ */
+static ssize_t
+osp_prealloc_wait_stats_seq_write(struct file *file,
+				  const char __user *buffer,
+				  size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct obd_device	*obd = m->private;
+	struct osp_device	*osp = lu2osp_dev(obd->obd_lu_dev);
+
+	if (osp == NULL || osp->opd_pre == NULL)
+		return 0;
+
+	lprocfs_oh_clear(&osp->opd_pre_wait_hist);
+
+	return count;
+}
+LPROC_SEQ_FOPS(osp_prealloc_wait_stats);
+
 /**
  * Show interval (in seconds) to update statfs data
  *
@@ -621,10 +700,109 @@ static int osp_destroys_in_flight_seq_show(struct seq_file *m, void *data)
 		return -EINVAL;
 
 	return seq_printf(m, "%lu\n",
-			  osp->opd_syn_rpc_in_progress + osp->opd_syn_changes);
+			  osp->opd_syn_rpc_in_progress + osp->opd_syn_changes +
+			  osp->opd_syn_batch_count);
 }
 LPROC_SEQ_FOPS_RO(osp_destroys_in_flight);
 
+/**
+ * Show maximum number of unlink records gathered for a batched destroy
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_destroy_batch_max_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*dev = m->private;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+
+	if (osp == NULL)
+		return -EINVAL;
+
+	return seq_printf(m, "%d\n", osp->opd_syn_batch_max);
+}
+
+/**
+ * Change maximum number of unlink records gathered for a batched destroy
+ *
+ * 0 or 1 sends every unlink record in its own RPC.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	string which represents maximum number
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t
+osp_destroy_batch_max_seq_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct obd_device	*dev = m->private;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+	int			 val, rc;
+
+	if (osp == NULL || osp->opd_syn_batch == NULL)
+		return -EINVAL;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > OSP_SYNC_BATCH_MAX)
+		return -ERANGE;
+
+	osp->opd_syn_batch_max = val;
+	/* let the sync thread send what no longer fits */
+	__osp_sync_check_for_work(osp);
+	return count;
+}
+LPROC_SEQ_FOPS(osp_destroy_batch_max);
+
+/**
+ * Show object destroy queue depth and rate
+ *
+ * The rate is the number of objects whose destroy was committed by the OST
+ * per second since the previous read of this file.
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ * \retval		0 on success
+ * \retval		negative number on error
+ */
+static int osp_destroy_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*dev = m->private;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+	cfs_time_t		 now = cfs_time_current();
+	__u64			 destroyed;
+	__u64			 rate = 0;
+	long			 secs;
+
+	if (osp == NULL)
+		return -EINVAL;
+
+	destroyed = osp->opd_syn_destroyed;
+	secs = cfs_duration_sec(cfs_time_sub(now, osp->opd_syn_rate_time));
+	if (secs > 0) {
+		rate = destroyed - osp->opd_syn_rate_destroyed;
+		do_div(rate, secs);
+		osp->opd_syn_rate_destroyed = destroyed;
+		osp->opd_syn_rate_time = now;
+	}
+
+	seq_printf(m, "llog_changes: %lu\n", osp->opd_syn_changes);
+	seq_printf(m, "gathered: %d\n", osp->opd_syn_batch_count);
+	seq_printf(m, "rpcs_in_progress: %d\n", osp->opd_syn_rpc_in_progress);
+	seq_printf(m, "batch_rpcs: "LPU64"\n", osp->opd_syn_batch_rpcs);
+	seq_printf(m, "destroyed: "LPU64"\n", destroyed);
+	return seq_printf(m, "destroy_rate: "LPU64"\n", rate);
+}
+LPROC_SEQ_FOPS_RO(osp_destroy_stats);
+
 /**
  * Show changes synced from previous mount
  *
@@ -750,6 +928,8 @@ static struct lprocfs_vars lprocfs_osp_obd_vars[] = {
 	  .fops =	&osp_prealloc_last_seq_fops	},
 	{ .name =	"prealloc_reserved",
 	  .fops =	&osp_prealloc_reserved_fops	},
+	{ .name =	"prealloc_wait_stats",
+	  .fops =	&osp_prealloc_wait_stats_fops	},
 	{ .name =	"timeouts",
 	  .fops =	&osp_timeouts_fops		},
 	{ .name =	"import",
@@ -768,6 +948,10 @@ static struct lprocfs_vars lprocfs_osp_obd_vars[] = {
 	  .fops =	&osp_syn_in_prog_fops		},
 	{ .name =	"old_sync_processed",
 	  .fops =	&osp_old_sync_processed_fops	},
+	{ .name =	"destroy_batch_max",
+	  .fops =	&osp_destroy_batch_max_fops	},
+	{ .name =	"destroy_stats",
+	  .fops =	&osp_destroy_stats_fops		},
 
 	/* for compatibility reasons */
 	{ .name =	"destroys_in_flight",
@@ -840,28 +840,32 @@ static int osp_sync(const struct lu_env *env, struct dt_device *dev)
 
 	/* block new processing (barrier>0 - few callers are possible */
 	atomic_inc(&d->opd_syn_barrier);
+	/* gathered unlinks are sent once the sync thread sees the barrier */
+	__osp_sync_check_for_work(d);
 
-	CDEBUG(D_CACHE, "%s: %u in flight\n", d->opd_obd->obd_name,
-	       d->opd_syn_rpc_in_flight);
+	CDEBUG(D_CACHE, "%s: %u in flight, %d gathered\n",
+	       d->opd_obd->obd_name, d->opd_syn_rpc_in_flight,
+	       d->opd_syn_batch_count);
 
 	/* wait till all-in-flight are replied, so executed by the target */
 	/* XXX: this is used by LFSCK at the moment, which doesn't require
 	 *	all the changes to be committed, but in general it'd be
 	 *	better to wait till commit */
-	while (d->opd_syn_rpc_in_flight > 0) {
+	while (d->opd_syn_rpc_in_flight + d->opd_syn_batch_count > 0) {
 
-		old = d->opd_syn_rpc_in_flight;
+		old = d->opd_syn_rpc_in_flight + d->opd_syn_batch_count;
 
 		expire = cfs_time_shift(obd_timeout);
 		lwi = LWI_TIMEOUT(expire - cfs_time_current(),
 				  osp_sync_timeout, d);
 		l_wait_event(d->opd_syn_barrier_waitq,
-				d->opd_syn_rpc_in_flight == 0, &lwi);
+			     d->opd_syn_rpc_in_flight +
+			     d->opd_syn_batch_count == 0, &lwi);
 
-		if (d->opd_syn_rpc_in_flight == 0)
+		if (d->opd_syn_rpc_in_flight + d->opd_syn_batch_count == 0)
 			break;
 
-		if (d->opd_syn_rpc_in_flight != old) {
+		if (d->opd_syn_rpc_in_flight + d->opd_syn_batch_count != old) {
 			/* some progress have been made */
 			continue;
 		}
@@ -1431,6 +1435,7 @@ static int osp_obd_connect(const struct lu_env *env, struct obd_export **exp,
 	ocd->ocd_version = LUSTRE_VERSION_CODE;
 	ocd->ocd_index = data->ocd_index;
 	imp->imp_connect_flags_orig = ocd->ocd_connect_flags;
+	imp->imp_connect_flags2_orig = ocd->ocd_connect_flags2;
 
 	rc = ptlrpc_connect_import(imp);
 	if (rc) {
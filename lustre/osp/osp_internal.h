@@ -92,6 +92,17 @@ struct osp_precreate {
 	int				 osp_pre_create_slow;
 	/* cleaning up orphans or recreating missing objects */
 	int				 osp_pre_recovering;
+	/* start and number of objects used in current rate sample */
+	ktime_t				 osp_pre_rate_start;
+	unsigned int			 osp_pre_rate_count;
+	/* smoothed rate objects are used at, objects per second */
+	unsigned int			 osp_pre_rate;
+	/* smoothed round trip time of precreate RPC, usec */
+	unsigned int			 osp_pre_rpc_usec;
+	/* number of objects reserved by creators */
+	__u64				 osp_pre_reserve_count;
+	/* time creators spent waiting for precreated objects, usec */
+	struct obd_histogram		 osp_pre_wait_hist;
 };
 
 struct osp_update_request_sub {
@@ -124,6 +135,10 @@ struct osp_update_request {
 	__u32				our_batchid;
 	__u32				our_req_ready:1;
 
+	/* update requests of the following transactions sent in the same
+	 * RPC as this one, linked through their own our_batch_list, see
+	 * osp_send_update_thread() */
+	struct list_head		our_batch_list;
 };
 
 struct osp_updates {
@@ -135,6 +150,21 @@ struct osp_updates {
 	__u64			ou_version;
 };
 
+/* maximum number of transactions packed into one OUT RPC by the sending
+ * thread */
+#define OSP_UPDATE_BATCH_MAX	16
+
+/* maximum number of unlink records gathered for batched destroy */
+#define OSP_SYNC_BATCH_MAX	128
+#define OSP_SYNC_BATCH_DEFAULT	64
+
+/* unlink record gathered in osp_device::opd_syn_batch */
+struct osp_sync_batch_ent {
+	struct ost_id		ose_oi;
+	__u32			ose_count;
+	struct llog_cookie	ose_cookie;
+};
+
 struct osp_device {
 	struct dt_device		 opd_dt_dev;
 	/* corresponded OST index */
@@ -226,6 +256,16 @@ struct osp_device {
 	/* stop processing new requests until barrier=0 */
 	atomic_t			 opd_syn_barrier;
 	wait_queue_head_t		 opd_syn_barrier_waitq;
+	/* unlink records waiting to be packed into OST_DESTROY RPCs
+	 * covering runs of adjacent objects, see osp_sync_batch_flush() */
+	struct osp_sync_batch_ent	*opd_syn_batch;
+	int				 opd_syn_batch_count;
+	int				 opd_syn_batch_max;
+	/* destroy stats */
+	__u64				 opd_syn_batch_rpcs;
+	__u64				 opd_syn_destroyed;
+	__u64				 opd_syn_rate_destroyed;
+	cfs_time_t			 opd_syn_rate_time;
 
 	/*
 	 * statfs related fields: OSP maintains it on its own
@@ -263,6 +303,12 @@ struct osp_device {
 #define opd_pre_max_create_count	opd_pre->osp_pre_max_create_count
 #define opd_pre_create_slow		opd_pre->osp_pre_create_slow
 #define opd_pre_recovering		opd_pre->osp_pre_recovering
+#define opd_pre_rate_start		opd_pre->osp_pre_rate_start
+#define opd_pre_rate_count		opd_pre->osp_pre_rate_count
+#define opd_pre_rate			opd_pre->osp_pre_rate
+#define opd_pre_rpc_usec		opd_pre->osp_pre_rpc_usec
+#define opd_pre_reserve_count		opd_pre->osp_pre_reserve_count
+#define opd_pre_wait_hist		opd_pre->osp_pre_wait_hist
 
 extern struct kmem_cache *osp_object_kmem;
 
@@ -589,6 +635,15 @@ static inline int osp_is_fid_client(struct osp_device *osp)
 	return imp->imp_connect_data.ocd_connect_flags & OBD_CONNECT_FID;
 }
 
+static inline bool osp_destroy_batch_supported(struct osp_device *osp)
+{
+	struct obd_connect_data *ocd;
+
+	ocd = &osp->opd_obd->u.cli.cl_import->imp_connect_data;
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_DESTROY_BATCH);
+}
+
 struct object_update *
 update_buffer_get_update(struct object_update_request *request,
 			 unsigned int index);
@@ -256,6 +256,75 @@ static inline int osp_objs_precreated(const struct lu_env *env,
 			    &osp->opd_pre_used_fid);
 }
 
+/* length of a single sample of object use rate, usec */
+#define OSP_PRE_RATE_INTERVAL	USEC_PER_SEC
+/* keep objects for this many precreate round trips ready */
+#define OSP_PRE_RPC_AHEAD	2
+
+/**
+ * Account object taken from the pool in the use rate estimation
+ *
+ * The rate objects are used at is sampled every OSP_PRE_RATE_INTERVAL and
+ * smoothed with a moving average, so short bursts do not inflate the pool.
+ * Must be called with opd_pre_lock held.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_precreate_rate_update(struct osp_device *d)
+{
+	ktime_t	now = ktime_get();
+	s64	elapsed;
+	__u64	rate;
+
+	d->opd_pre_rate_count++;
+	elapsed = ktime_us_delta(now, d->opd_pre_rate_start);
+	if (elapsed < OSP_PRE_RATE_INTERVAL)
+		return;
+
+	/* no objects were used for a while, start over */
+	if (elapsed > 2 * OSP_PRE_RATE_INTERVAL) {
+		d->opd_pre_rate = 0;
+		d->opd_pre_rate_start = now;
+		d->opd_pre_rate_count = 1;
+		return;
+	}
+
+	rate = (__u64)d->opd_pre_rate_count * USEC_PER_SEC;
+	do_div(rate, (__u32)elapsed);
+	d->opd_pre_rate = (3 * (__u64)d->opd_pre_rate + rate) / 4;
+	d->opd_pre_rate_start = now;
+	d->opd_pre_rate_count = 0;
+}
+
+/**
+ * Predict number of objects used while precreate RPCs are in flight
+ *
+ * Uses the smoothed use rate and precreate round trip time to estimate how
+ * many objects creators will ask for in OSP_PRE_RPC_AHEAD round trips. The
+ * pool should be refilled before it drops below this number, otherwise the
+ * creators will block in osp_precreate_reserve(). Must be called with
+ * opd_pre_lock held.
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval		number of objects expected to be used
+ */
+static int osp_precreate_predict_nolock(struct osp_device *d)
+{
+	__u64 want;
+
+	/* no objects taken for a while, the rate is stale */
+	if (ktime_us_delta(ktime_get(), d->opd_pre_rate_start) >
+	    2 * OSP_PRE_RATE_INTERVAL)
+		return 0;
+
+	want = (__u64)d->opd_pre_rate * d->opd_pre_rpc_usec *
+	       OSP_PRE_RPC_AHEAD;
+	do_div(want, USEC_PER_SEC);
+
+	return min_t(__u64, want, d->opd_pre_max_create_count / 2);
+}
+
 /**
  * Check pool of precreated objects is nearly empty
  *
@@ -274,10 +343,12 @@ static inline int osp_precreate_near_empty_nolock(const struct lu_env *env,
 						  struct osp_device *d)
 {
 	int window = osp_objs_precreated(env, d);
+	int low = max(d->opd_pre_create_count / 2,
+		      osp_precreate_predict_nolock(d));
 
 	/* don't consider new precreation till OST is healty and
 	 * has free space */
-	return ((window - d->opd_pre_reserved < d->opd_pre_create_count / 2) &&
+	return ((window - d->opd_pre_reserved < low) &&
 		(d->opd_pre_status == 0));
 }
 
@@ -545,6 +616,8 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	struct ost_body		*body;
 	int			 rc, grow, diff;
 	struct lu_fid		*fid = &oti->osi_fid;
+	ktime_t			 start;
+	s64			 rtt;
 	ENTRY;
 
 	/* don't precreate new objects till OST healthy and has free space */
@@ -578,6 +651,10 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	if (d->opd_pre_create_count > d->opd_pre_max_create_count / 2)
 		d->opd_pre_create_count = d->opd_pre_max_create_count / 2;
 	grow = d->opd_pre_create_count;
+	/* ask for enough objects to cover the use expected before the next
+	 * precreate completes, unless the OST can't keep up already */
+	if (d->opd_pre_create_slow == 0)
+		grow = max(grow, osp_precreate_predict_nolock(d));
 	spin_unlock(&d->opd_pre_lock);
 
 	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
@@ -607,6 +684,7 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 
 	ptlrpc_request_set_replen(req);
 
+	start = ktime_get();
 	rc = ptlrpc_queue_wait(req);
 	if (rc) {
 		CERROR("%s: can't precreate: rc = %d\n", d->opd_obd->obd_name,
@@ -615,6 +693,11 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	}
 	LASSERT(req->rq_transno == 0);
 
+	rtt = ktime_us_delta(ktime_get(), start);
+	spin_lock(&d->opd_pre_lock);
+	d->opd_pre_rpc_usec = (3 * (__u64)d->opd_pre_rpc_usec + rtt) / 4;
+	spin_unlock(&d->opd_pre_lock);
+
 	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
 	if (body == NULL)
 		GOTO(out_req, rc = -EPROTO);
@@ -1228,8 +1311,8 @@ static int osp_precreate_ready_condition(const struct lu_env *env,
 		return 1;
 
 	/* ready if OST reported no space and no destroys in progress */
-	if (d->opd_syn_changes + d->opd_syn_rpc_in_progress == 0 &&
-	    d->opd_pre_status == -ENOSPC)
+	if (d->opd_syn_changes + d->opd_syn_rpc_in_progress +
+	    d->opd_syn_batch_count == 0 && d->opd_pre_status == -ENOSPC)
 		return 1;
 
 	/* Bail out I/O fails to OST */
@@ -1290,6 +1373,8 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 {
 	struct l_wait_info	 lwi;
 	cfs_time_t		 expire = cfs_time_shift(obd_timeout);
+	ktime_t			 start = ktime_get();
+	bool			 waited = false;
 	int			 precreated, rc;
 
 	ENTRY;
@@ -1326,6 +1411,7 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 		if (precreated > d->opd_pre_reserved &&
 		    !d->opd_pre_recovering) {
 			d->opd_pre_reserved++;
+			d->opd_pre_reserve_count++;
 			spin_unlock(&d->opd_pre_lock);
 			rc = 0;
 
@@ -1353,8 +1439,8 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 				/* just wait till destroys are done */
 				/* see l_wait_even() few lines below */
 			}
-			if (d->opd_syn_changes +
-			    d->opd_syn_rpc_in_progress == 0) {
+			if (d->opd_syn_changes + d->opd_syn_rpc_in_progress +
+			    d->opd_syn_batch_count == 0) {
 				/* no hope for free space */
 				break;
 			}
@@ -1370,10 +1456,15 @@ int osp_precreate_reserve(const struct lu_env *env, struct osp_device *d)
 			break;
 		}
 
+		waited = true;
 		l_wait_event(d->opd_pre_user_waitq,
 			     osp_precreate_ready_condition(env, d), &lwi);
 	}
 
+	if (waited)
+		lprocfs_oh_tally_log2(&d->opd_pre_wait_hist,
+				      ktime_us_delta(ktime_get(), start));
+
 	RETURN(rc);
 }
 
@@ -1414,6 +1505,7 @@ int osp_precreate_get_fid(const struct lu_env *env, struct osp_device *d,
 	d->opd_pre_used_fid.f_oid++;
 	memcpy(fid, &d->opd_pre_used_fid, sizeof(*fid));
 	d->opd_pre_reserved--;
+	osp_precreate_rate_update(d);
 	/*
 	 * last_used_id must be changed along with getting new id otherwise
 	 * we might miscalculate gap causing object loss or leak
@@ -1548,8 +1640,10 @@ int osp_init_precreate(struct osp_device *d)
 	d->opd_pre_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_min_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_max_create_count = OST_MAX_PRECREATE;
+	d->opd_pre_rate_start = ktime_get();
 
 	spin_lock_init(&d->opd_pre_lock);
+	spin_lock_init(&d->opd_pre_wait_hist.oh_lock);
 	init_waitqueue_head(&d->opd_pre_waitq);
 	init_waitqueue_head(&d->opd_pre_user_waitq);
 	init_waitqueue_head(&d->opd_pre_thread.t_ctl_waitq);
@@ -44,6 +44,7 @@
 #define DEBUG_SUBSYSTEM S_MDS
 
 #include <linux/kthread.h>
+#include <linux/sort.h>
 #include <lustre_log.h>
 #include <lustre_update.h>
 #include "osp_internal.h"
@@ -84,6 +85,10 @@ static void osp_sync_remove_from_tracker(struct osp_device *d);
  *
  * opd_syn_rpc_in_flight is a number of RPC in flight.
  * we control this with OSP_MAX_IN_FLIGHT
+ *
+ * opd_syn_batch_count is a number of unlink records read from llog but
+ * not sent yet. they're sorted and sent as OST_DESTROY RPCs covering runs
+ * of adjacent objects once no more records can be read at the moment.
  */
 
 /* XXX: do math to learn reasonable threshold
@@ -101,6 +106,11 @@ struct osp_job_req_args {
 	struct list_head		jra_committed_link;
 	struct list_head		jra_inflight_link;
 	__u32				jra_magic;
+	/** llog cookies of a batched destroy, see osp_sync_batch_flush() */
+	struct llog_cookie		*jra_cookies;
+	/** number of objects each of \a jra_cookies covers */
+	__u32				*jra_counts;
+	int				 jra_ncookies;
 };
 
 static inline int osp_sync_running(struct osp_device *d)
@@ -204,6 +214,20 @@ static inline int osp_sync_low_in_flight(struct osp_device *d)
 	return d->opd_syn_rpc_in_flight < d->opd_syn_max_rpc_in_flight;
 }
 
+/**
+ * Check whether gathered unlink records can be sent now
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval 1		there are records and room to send them
+ * \retval 0		nothing to send or no room
+ */
+static inline int osp_sync_batch_ready(struct osp_device *d)
+{
+	return d->opd_syn_batch_count > 0 && osp_sync_low_in_progress(d) &&
+	       osp_sync_low_in_flight(d) && d->opd_imp_connected;
+}
+
 /**
  * Wake up check for the main sync thread
  *
@@ -223,6 +247,10 @@ static inline int osp_sync_has_work(struct osp_device *d)
 	if (!list_empty(&d->opd_syn_committed_there))
 		return 1;
 
+	/* has gathered unlinks to send? */
+	if (osp_sync_batch_ready(d))
+		return 1;
+
 	return 0;
 }
 
@@ -267,6 +295,9 @@ static inline int osp_sync_can_process_new(struct osp_device *d,
 		return 0;
 	if (!d->opd_imp_connected)
 		return 0;
+	if (d->opd_syn_batch_count > 0 &&
+	    d->opd_syn_batch_count >= d->opd_syn_batch_max)
+		return 0;
 	if (d->opd_syn_prev_done == 0)
 		return 1;
 	if (d->opd_syn_changes == 0)
@@ -495,6 +526,78 @@ static void osp_sync_request_commit_cb(struct ptlrpc_request *req)
 	wake_up(&d->opd_syn_waitq);
 }
 
+static void osp_sync_job_cookies_free(struct osp_job_req_args *jra)
+{
+	if (jra->jra_cookies != NULL)
+		OBD_FREE(jra->jra_cookies,
+			 jra->jra_ncookies * sizeof(*jra->jra_cookies));
+	if (jra->jra_counts != NULL)
+		OBD_FREE(jra->jra_counts,
+			 jra->jra_ncookies * sizeof(*jra->jra_counts));
+	jra->jra_cookies = NULL;
+	jra->jra_counts = NULL;
+	jra->jra_ncookies = 0;
+}
+
+/**
+ * Find how many llog records of a committed destroy can be cancelled.
+ *
+ * A destroy of a range of objects stops at the first object the OST fails
+ * to destroy and reports how many objects it handled before that one. Only
+ * the records covering those objects are cancelled, the others stay in the
+ * llog and are processed again after restart.
+ *
+ * \param[in] req		committed OST_DESTROY request
+ * \param[in] body		request body
+ * \param[out] destroyed	number of objects the cancelled records cover
+ *
+ * \retval			number of leading cookies to cancel
+ */
+static int osp_sync_destroy_done(struct ptlrpc_request *req,
+				 struct ost_body *body, __u64 *destroyed)
+{
+	struct osp_job_req_args	*jra = ptlrpc_req_async_args(req);
+	struct ost_body		*repbody;
+	__u32			 objs;
+	__u32			 count;
+	int			 ncookies;
+	int			 status = 0;
+	int			 i;
+
+	ncookies = jra->jra_cookies != NULL ? jra->jra_ncookies : 1;
+	objs = body->oa.o_valid & OBD_MD_FLOBJCOUNT ? body->oa.o_misc : 1;
+
+	if (req->rq_repmsg != NULL)
+		status = lustre_msg_get_status(req->rq_repmsg);
+	if (status == 0 || status == -ENOENT) {
+		*destroyed = objs;
+		return ncookies;
+	}
+
+	*destroyed = 0;
+	repbody = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
+	if (repbody == NULL || !(repbody->oa.o_valid & OBD_MD_FLOBJCOUNT))
+		return 0;
+
+	objs = repbody->oa.o_misc;
+	for (i = 0; i < ncookies; i++) {
+		if (jra->jra_counts != NULL)
+			count = jra->jra_counts[i];
+		else
+			count = body->oa.o_valid & OBD_MD_FLOBJCOUNT ?
+				body->oa.o_misc : 1;
+		if (count > objs)
+			break;
+		objs -= count;
+		*destroyed += count;
+	}
+
+	DEBUG_REQ(D_HA, req, "destroy failed: %d, cancel %d of %d records",
+		  status, i, ncookies);
+
+	return i;
+}
+
 /**
  * RPC interpretation callback.
  *
@@ -529,12 +632,29 @@ static int osp_sync_interpret(const struct lu_env *env,
 	       rc, (unsigned) req->rq_transno);
 	LASSERT(rc || req->rq_transno);
 
-	if (rc == -ENOENT) {
+	if (rc == -ENOENT && req->rq_transno != 0) {
+		/*
+		 * a batched destroy found some of its objects gone already
+		 * but did destroy the others, so the OST started a transaction
+		 * and osp_sync_request_commit_cb() cancels the llog records
+		 */
+		CDEBUG(D_HA, "%s: partial destroy, transno "LPU64"\n",
+		       d->opd_obd->obd_name, req->rq_transno);
+	} else if (rc != 0 && req->rq_transno != 0 &&
+		   lustre_msg_get_opc(req->rq_reqmsg) == OST_DESTROY) {
+		/*
+		 * a destroy of a range failed after destroying some objects,
+		 * once committed only their records are cancelled, see
+		 * osp_sync_destroy_done()
+		 */
+		CERROR("%s: partial destroy, transno "LPU64": rc = %d\n",
+		       d->opd_obd->obd_name, req->rq_transno, rc);
+		wake_up(&d->opd_syn_waitq);
+	} else if (rc == -ENOENT) {
 		/*
 		 * we tried to destroy object or update attributes,
 		 * but object doesn't exist anymore - cancell llog record
 		 */
-		LASSERT(req->rq_transno == 0);
 		LASSERT(list_empty(&jra->jra_committed_link));
 
 		ptlrpc_request_addref(req);
@@ -562,6 +682,7 @@ static int osp_sync_interpret(const struct lu_env *env,
 			spin_lock(&d->opd_syn_lock);
 			d->opd_syn_rpc_in_progress--;
 			spin_unlock(&d->opd_syn_lock);
+			osp_sync_job_cookies_free(jra);
 		}
 
 		wake_up(&d->opd_syn_waitq);
@@ -626,7 +747,8 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
  * are initialized.
  *
  * \param[in] d		OSP device
- * \param[in] llh	llog handle where the record is stored
+ * \param[in] llh	llog handle where the record is stored, NULL if
+ *			the caller sets the cookie itself
  * \param[in] h		llog record
  * \param[in] op	type of the change
  * \param[in] format	request format to be used
@@ -640,6 +762,7 @@ static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 					       ost_cmd_t op,
 					       const struct req_format *format)
 {
+	struct osp_job_req_args	*jra;
 	struct ptlrpc_request	*req;
 	struct ost_body		*body;
 	struct obd_import	*imp;
@@ -670,9 +793,16 @@ static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 	 */
 	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
 	LASSERT(body);
-	body->oa.o_lcookie.lgc_lgl = llh->lgh_id;
-	body->oa.o_lcookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
-	body->oa.o_lcookie.lgc_index = h->lrh_index;
+	if (llh != NULL) {
+		body->oa.o_lcookie.lgc_lgl = llh->lgh_id;
+		body->oa.o_lcookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
+		body->oa.o_lcookie.lgc_index = h->lrh_index;
+	}
+
+	jra = ptlrpc_req_async_args(req);
+	jra->jra_cookies = NULL;
+	jra->jra_counts = NULL;
+	jra->jra_ncookies = 0;
 
 	req->rq_interpret_reply = osp_sync_interpret;
 	req->rq_commit_cb = osp_sync_request_commit_cb;
@@ -830,6 +960,173 @@ static int osp_sync_new_unlink64_job(struct osp_device *d,
 	RETURN(0);
 }
 
+/**
+ * Gather an unlink record for a batched destroy.
+ *
+ * MDS_UNLINK64_REC records are not sent right away but kept in
+ * osp_device::opd_syn_batch, so that records for adjacent objects can be
+ * destroyed with a single OST_DESTROY RPC, see osp_sync_batch_flush().
+ * This is done only if the OST negotiated OBD_CONNECT2_DESTROY_BATCH.
+ *
+ * \param[in] d		OSP device
+ * \param[in] llh	llog handle where the record is stored
+ * \param[in] h		llog record
+ *
+ * \retval 1		record is gathered
+ * \retval 0		record should be sent on its own
+ */
+static int osp_sync_batch_add(struct osp_device *d, struct llog_handle *llh,
+			      struct llog_rec_hdr *h)
+{
+	struct llog_unlink64_rec	*rec = (struct llog_unlink64_rec *)h;
+	struct osp_sync_batch_ent	*ent;
+
+	if (h->lrh_type != MDS_UNLINK64_REC || rec->lur_count == 0 ||
+	    d->opd_syn_batch_count >= d->opd_syn_batch_max ||
+	    d->opd_syn_batch_max <= 1 || !osp_destroy_batch_supported(d))
+		return 0;
+
+	ent = &d->opd_syn_batch[d->opd_syn_batch_count];
+	if (fid_to_ostid(&rec->lur_fid, &ent->ose_oi) < 0)
+		return 0;
+
+	ent->ose_count = rec->lur_count;
+	ent->ose_cookie.lgc_lgl = llh->lgh_id;
+	ent->ose_cookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
+	ent->ose_cookie.lgc_index = h->lrh_index;
+
+	spin_lock(&d->opd_syn_lock);
+	d->opd_syn_batch_count++;
+	spin_unlock(&d->opd_syn_lock);
+
+	return 1;
+}
+
+static int osp_sync_batch_cmp(const void *a, const void *b)
+{
+	const struct osp_sync_batch_ent	*e1 = a;
+	const struct osp_sync_batch_ent	*e2 = b;
+
+	if (ostid_seq(&e1->ose_oi) != ostid_seq(&e2->ose_oi))
+		return ostid_seq(&e1->ose_oi) < ostid_seq(&e2->ose_oi) ?
+		       -1 : 1;
+	if (ostid_id(&e1->ose_oi) != ostid_id(&e2->ose_oi))
+		return ostid_id(&e1->ose_oi) < ostid_id(&e2->ose_oi) ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Send gathered unlink records.
+ *
+ * The gathered records are sorted by object ID and every run of adjacent
+ * objects of the same sequence is destroyed with one OST_DESTROY RPC using
+ * OBD_MD_FLOBJCOUNT, the way orphan ranges are destroyed. The llog cookies
+ * of the run are attached to the request and all cancelled once the RPC is
+ * committed. Runs are sent while the RPC limits allow, the rest are kept
+ * so that later records can extend them.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_sync_batch_flush(struct osp_device *d)
+{
+	struct osp_sync_batch_ent	*ents = d->opd_syn_batch;
+	struct osp_job_req_args		*jra;
+	struct ptlrpc_request		*req;
+	struct ost_body			*body;
+	int				 total = d->opd_syn_batch_count;
+	int				 sent = 0;
+	int				 count;
+	__u32				 objs;
+	int				 i;
+	ENTRY;
+
+	if (total == 0)
+		RETURN_EXIT;
+
+	sort(ents, total, sizeof(*ents), osp_sync_batch_cmp, NULL);
+
+	while (sent < total && osp_sync_low_in_flight(d) &&
+	       osp_sync_low_in_progress(d) && d->opd_imp_connected) {
+		objs = ents[sent].ose_count;
+		for (count = 1; sent + count < total; count++) {
+			struct osp_sync_batch_ent *ent = &ents[sent + count];
+
+			if (ostid_seq(&ent->ose_oi) !=
+			    ostid_seq(&ents[sent].ose_oi) ||
+			    ostid_id(&ent->ose_oi) !=
+			    ostid_id(&ents[sent].ose_oi) + objs)
+				break;
+			objs += ent->ose_count;
+		}
+
+		spin_lock(&d->opd_syn_lock);
+		d->opd_syn_rpc_in_flight++;
+		d->opd_syn_rpc_in_progress++;
+		spin_unlock(&d->opd_syn_lock);
+
+		req = osp_sync_new_job(d, NULL, NULL, OST_DESTROY,
+				       &RQF_OST_DESTROY);
+		if (!IS_ERR(req) && count > 1) {
+			jra = ptlrpc_req_async_args(req);
+			OBD_ALLOC(jra->jra_cookies,
+				  count * sizeof(*jra->jra_cookies));
+			OBD_ALLOC(jra->jra_counts,
+				  count * sizeof(*jra->jra_counts));
+			jra->jra_ncookies = count;
+			if (jra->jra_cookies == NULL ||
+			    jra->jra_counts == NULL) {
+				osp_sync_job_cookies_free(jra);
+				ptlrpc_req_finished(req);
+				req = ERR_PTR(-ENOMEM);
+			}
+		}
+		if (IS_ERR(req)) {
+			/* the records stay in the llog and are
+			 * processed again after restart */
+			CERROR("%s: can't destroy %d objects from "DOSTID
+			       ": rc = %ld\n", d->opd_obd->obd_name, objs,
+			       POSTID(&ents[sent].ose_oi), PTR_ERR(req));
+			spin_lock(&d->opd_syn_lock);
+			d->opd_syn_rpc_in_flight--;
+			d->opd_syn_rpc_in_progress--;
+			spin_unlock(&d->opd_syn_lock);
+			sent += count;
+			continue;
+		}
+
+		jra = ptlrpc_req_async_args(req);
+		body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
+		LASSERT(body);
+		body->oa.o_oi = ents[sent].ose_oi;
+		body->oa.o_misc = objs;
+		body->oa.o_valid = OBD_MD_FLGROUP | OBD_MD_FLID |
+				   OBD_MD_FLOBJCOUNT;
+		body->oa.o_lcookie = ents[sent].ose_cookie;
+		if (count > 1) {
+			for (i = 0; i < count; i++) {
+				jra->jra_cookies[i] = ents[sent + i].ose_cookie;
+				jra->jra_counts[i] = ents[sent + i].ose_count;
+			}
+			d->opd_syn_batch_rpcs++;
+		}
+
+		osp_sync_send_new_rpc(d, req);
+		sent += count;
+	}
+
+	if (sent == 0)
+		RETURN_EXIT;
+
+	memmove(ents, ents + sent, (total - sent) * sizeof(*ents));
+	spin_lock(&d->opd_syn_lock);
+	d->opd_syn_batch_count -= sent;
+	spin_unlock(&d->opd_syn_lock);
+	if (unlikely(atomic_read(&d->opd_syn_barrier) > 0))
+		wake_up(&d->opd_syn_barrier_waitq);
+
+	EXIT;
+}
+
 /**
  * Process llog records.
  *
@@ -883,6 +1180,10 @@ static void osp_sync_process_record(const struct lu_env *env,
 	 * and fire after next commit callback
 	 */
 
+	/* unlinks are gathered and sent later by osp_sync_batch_flush() */
+	if (osp_sync_batch_add(d, llh, rec))
+		goto account;
+
 	/* notice we increment counters before sending RPC, to be consistent
 	 * in RPC interpret callback which may happen very quickly */
 	spin_lock(&d->opd_syn_lock);
@@ -909,6 +1210,7 @@ static void osp_sync_process_record(const struct lu_env *env,
 		break;
 	}
 
+account:
 	spin_lock(&d->opd_syn_lock);
 
 	/* For all kinds of records, not matter successful or not,
@@ -973,6 +1275,7 @@ static void osp_sync_process_committed(const struct lu_env *env,
 	struct llog_ctxt	*ctxt;
 	struct llog_handle	*llh;
 	struct list_head	 list;
+	__u64			 destroyed = 0;
 	int			 rc, done = 0;
 
 	ENTRY;
@@ -1024,20 +1327,37 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		/* import can be closing, thus all commit cb's are
 		 * called we can check committness directly */
 		if (req->rq_import_generation == imp->imp_generation) {
-			rc = llog_cat_cancel_records(env, llh, 1,
-						     &body->oa.o_lcookie);
+			__u64	objs = 0;
+			int	ncookies = 1;
+
+			if (jra->jra_cookies != NULL)
+				ncookies = jra->jra_ncookies;
+			if (lustre_msg_get_opc(req->rq_reqmsg) == OST_DESTROY)
+				ncookies = osp_sync_destroy_done(req, body,
+								 &objs);
+			rc = 0;
+			if (ncookies > 0 && jra->jra_cookies != NULL)
+				rc = llog_cat_cancel_records(env, llh,
+							     ncookies,
+							     jra->jra_cookies);
+			else if (ncookies > 0)
+				rc = llog_cat_cancel_records(env, llh, 1,
+							&body->oa.o_lcookie);
 			if (rc)
 				CERROR("%s: can't cancel record: %d\n",
 				       obd->obd_name, rc);
+			destroyed += objs;
 		} else {
 			DEBUG_REQ(D_OTHER, req, "imp_committed = "LPU64,
 				  imp->imp_peer_committed_transno);
 		}
+		osp_sync_job_cookies_free(jra);
 		ptlrpc_req_finished(req);
 		done++;
 	}
 
 	llog_ctxt_put(ctxt);
+	d->opd_syn_destroyed += destroyed;
 
 	LASSERT(d->opd_syn_rpc_in_progress >= done);
 	spin_lock(&d->opd_syn_lock);
@@ -1085,6 +1405,10 @@ static int osp_sync_process_queues(const struct lu_env *env,
 
 		if (!osp_sync_running(d)) {
 			CDEBUG(D_HA, "stop llog processing\n");
+			/* gathered unlinks are processed after restart */
+			spin_lock(&d->opd_syn_lock);
+			d->opd_syn_batch_count = 0;
+			spin_unlock(&d->opd_syn_lock);
 			return LLOG_PROC_BREAK;
 		}
 
@@ -1108,13 +1432,18 @@ static int osp_sync_process_queues(const struct lu_env *env,
 			rec = NULL;
 		}
 
+		/* no more records to gather now, send what we have */
+		if (!osp_sync_can_process_new(d, rec))
+			osp_sync_batch_flush(d);
+
 		if (d->opd_syn_last_processed_id == d->opd_syn_last_used_id)
 			osp_sync_remove_from_tracker(d);
 
 		l_wait_event(d->opd_syn_waitq,
 			     !osp_sync_running(d) ||
 			     osp_sync_can_process_new(d, rec) ||
-			     !list_empty(&d->opd_syn_committed_there),
+			     !list_empty(&d->opd_syn_committed_there) ||
+			     osp_sync_batch_ready(d),
 			     &lwi);
 	} while (1);
 }
@@ -1390,6 +1719,14 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 	if (rc)
 		RETURN(rc);
 
+	OBD_ALLOC(d->opd_syn_batch,
+		  OSP_SYNC_BATCH_MAX * sizeof(*d->opd_syn_batch));
+	if (d->opd_syn_batch == NULL)
+		GOTO(err_id, rc = -ENOMEM);
+	d->opd_syn_batch_count = 0;
+	d->opd_syn_batch_max = OSP_SYNC_BATCH_DEFAULT;
+	d->opd_syn_rate_time = cfs_time_current();
+
 	/*
 	 * initialize llog storing changes
 	 */
@@ -1428,6 +1765,11 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 err_llog:
 	osp_sync_llog_fini(env, d);
 err_id:
+	if (d->opd_syn_batch != NULL) {
+		OBD_FREE(d->opd_syn_batch,
+			 OSP_SYNC_BATCH_MAX * sizeof(*d->opd_syn_batch));
+		d->opd_syn_batch = NULL;
+	}
 	osp_sync_id_traction_fini(d);
 	return rc;
 }
@@ -1457,6 +1799,12 @@ int osp_sync_fini(struct osp_device *d)
 	 */
 	osp_sync_id_traction_fini(d);
 
+	if (d->opd_syn_batch != NULL) {
+		OBD_FREE(d->opd_syn_batch,
+			 OSP_SYNC_BATCH_MAX * sizeof(*d->opd_syn_batch));
+		d->opd_syn_batch = NULL;
+	}
+
 	RETURN(0);
 }
 
@@ -194,6 +194,7 @@ struct osp_update_request *osp_update_request_create(struct dt_device *dt)
 	INIT_LIST_HEAD(&our->our_req_list);
 	INIT_LIST_HEAD(&our->our_cb_items);
 	INIT_LIST_HEAD(&our->our_list);
+	INIT_LIST_HEAD(&our->our_batch_list);
 	spin_lock_init(&our->our_list_lock);
 
 	osp_object_update_request_create(our, OUT_UPDATE_INIT_BUFFER_SIZE);
@@ -204,10 +205,20 @@ void osp_update_request_destroy(struct osp_update_request *our)
 {
 	struct osp_update_request_sub *ours;
 	struct osp_update_request_sub *tmp;
+	struct osp_update_request *next;
 
 	if (our == NULL)
 		return;
 
+	/* release the transactions sent in the same RPC, whose references
+	 * were handed over by osp_get_batch_requests() */
+	while (!list_empty(&our->our_batch_list)) {
+		next = list_entry(our->our_batch_list.next,
+				  struct osp_update_request, our_batch_list);
+		list_del_init(&next->our_batch_list);
+		osp_thandle_put(next->our_th);
+	}
+
 	list_for_each_entry_safe(ours, tmp, &our->our_req_list, ours_list) {
 		list_del(&ours->ours_list);
 		if (ours->ours_req != NULL)
@@ -245,6 +256,72 @@ object_update_request_dump(const struct object_update_request *ourq,
 	       ourq->ourq_magic, ourq->ourq_count, total_size);
 }
 
+/**
+ * Get the next update request sent in the same RPC as \a head.
+ *
+ * \param[in] head	update request leading the RPC
+ * \param[in] our	current update request, \a head or one of its batch
+ *
+ * \retval		the next update request of the RPC
+ * \retval		NULL if \a our is the last one
+ */
+static struct osp_update_request *
+osp_update_batch_next(struct osp_update_request *head,
+		      struct osp_update_request *our)
+{
+	struct list_head *next;
+
+	next = our == head ? head->our_batch_list.next :
+			     our->our_batch_list.next;
+	if (next == &head->our_batch_list)
+		return NULL;
+
+	return list_entry(next, struct osp_update_request, our_batch_list);
+}
+
+/* walk \a head, then every update request batched behind it */
+#define osp_update_batch_for_each(our, head)				\
+	for ((our) = (head); (our) != NULL;				\
+	     (our) = osp_update_batch_next((head), (our)))
+
+/**
+ * Calculate the reply buffer size needed by the updates of \a our, not
+ * including the object_update_reply header.
+ *
+ * \param[in] our	update request
+ *
+ * \retval		reply size in bytes
+ */
+static int osp_update_request_repsize(struct osp_update_request *our)
+{
+	struct osp_update_request_sub	*ours;
+	const struct object_update_request *ourq;
+	struct object_update_reply	*reply;
+	int				repsize = 0;
+	int				i;
+
+	list_for_each_entry(ours, &our->our_req_list, ours_list) {
+		ourq = ours->ours_req;
+		for (i = 0; i < ourq->ourq_count; i++) {
+			struct object_update	*update;
+			size_t			size = 0;
+
+
+			/* XXX: it's very inefficient to lookup update
+			 *	this way, iterating from the beginning
+			 *	each time */
+			update = object_update_request_get(ourq, i, &size);
+			LASSERT(update != NULL);
+
+			repsize += sizeof(reply->ourp_lens[0]);
+			repsize += sizeof(struct object_update_result);
+			repsize += update->ou_result_size;
+		}
+	}
+
+	return repsize;
+}
+
 /**
  * Prepare inline update request
  *
@@ -300,7 +377,8 @@ int osp_prep_inline_update_req(const struct lu_env *env,
  * Prepare update request.
  *
  * Prepare OUT update ptlrpc request, and the request usually includes
- * all of updates (stored in \param ureq) from one operation.
+ * all of updates (stored in \param ureq) from one operation, followed by
+ * the updates of the requests batched behind it, if any.
  *
  * \param[in] env	execution environment
  * \param[in] imp	import on which ptlrpc request will be sent
@@ -317,37 +395,24 @@ int osp_prep_update_req(const struct lu_env *env, struct obd_import *imp,
 	struct ptlrpc_request		*req;
 	struct ptlrpc_bulk_desc		*desc;
 	struct osp_update_request_sub	*ours;
-	const struct object_update_request *ourq;
+	struct osp_update_request	*tmp;
 	struct out_update_header	*ouh;
 	struct out_update_buffer	*oub;
 	__u32				buf_count = 0;
+	__u32				update_nr = 0;
 	int				repsize = 0;
 	struct object_update_reply	*reply;
-	int				rc, i;
+	int				rc;
 	int				total = 0;
 	ENTRY;
 
-	list_for_each_entry(ours, &our->our_req_list, ours_list) {
-		object_update_request_dump(ours->ours_req, D_INFO);
-
-		ourq = ours->ours_req;
-		for (i = 0; i < ourq->ourq_count; i++) {
-			struct object_update	*update;
-			size_t			size = 0;
-
-
-			/* XXX: it's very inefficient to lookup update
-			 *	this way, iterating from the beginning
-			 *	each time */
-			update = object_update_request_get(ourq, i, &size);
-			LASSERT(update != NULL);
-
-			repsize += sizeof(reply->ourp_lens[0]);
-			repsize += sizeof(struct object_update_result);
-			repsize += update->ou_result_size;
+	osp_update_batch_for_each(tmp, our) {
+		list_for_each_entry(ours, &tmp->our_req_list, ours_list) {
+			object_update_request_dump(ours->ours_req, D_INFO);
+			buf_count++;
 		}
-
-		buf_count++;
+		repsize += osp_update_request_repsize(tmp);
+		update_nr += tmp->our_update_nr;
 	}
 	repsize += sizeof(*reply);
 	repsize = (repsize + OUT_UPDATE_REPLY_SIZE - 1) &
@@ -389,9 +454,11 @@ int osp_prep_update_req(const struct lu_env *env, struct obd_import *imp,
 	ouh->ouh_inline_length = 0;
 	ouh->ouh_reply_size = repsize;
 	oub = req_capsule_client_get(&req->rq_pill, &RMF_OUT_UPDATE_BUF);
-	list_for_each_entry(ours, &our->our_req_list, ours_list) {
-		oub->oub_size = ours->ours_req_size;
-		oub++;
+	osp_update_batch_for_each(tmp, our) {
+		list_for_each_entry(ours, &tmp->our_req_list, ours_list) {
+			oub->oub_size = ours->ours_req_size;
+			oub++;
+		}
 	}
 
 	req->rq_bulk_write = 1;
@@ -403,12 +470,14 @@ int osp_prep_update_req(const struct lu_env *env, struct obd_import *imp,
 		GOTO(out_req, rc = -ENOMEM);
 
 	/* NB req now owns desc and will free it when it gets freed */
-	list_for_each_entry(ours, &our->our_req_list, ours_list) {
-		desc->bd_frag_ops->add_iov_frag(desc, ours->ours_req,
-						ours->ours_req_size);
-		total += ours->ours_req_size;
+	osp_update_batch_for_each(tmp, our) {
+		list_for_each_entry(ours, &tmp->our_req_list, ours_list) {
+			desc->bd_frag_ops->add_iov_frag(desc, ours->ours_req,
+							ours->ours_req_size);
+			total += ours->ours_req_size;
+		}
 	}
-	CDEBUG(D_OTHER, "total %d in %u\n", total, our->our_update_nr);
+	CDEBUG(D_OTHER, "total %d in %u\n", total, update_nr);
 
 	req_capsule_set_size(&req->rq_pill, &RMF_OUT_UPDATE_REPLY,
 			     RCL_SERVER, repsize);
@@ -587,11 +656,70 @@ static void osp_update_callback_fini(const struct lu_env *env,
 	OBD_FREE_PTR(ouc);
 }
 
+/**
+ * Call the registered interpreter function of every update of \a our.
+ *
+ * \param[in] env	pointer to the thread context
+ * \param[in] req	pointer to the RPC
+ * \param[in] reply	update reply of the RPC, NULL if there is none
+ * \param[in] count	number of updates handled by the peer
+ * \param[in] our	update request whose callbacks are called
+ * \param[in,out] index	index in \a reply of the first update of \a our
+ * \param[in] rc	result of the updates before the ones of \a our
+ *
+ * \retval		result of the last update of \a our
+ */
+static int osp_update_interpret_one(const struct lu_env *env,
+				    struct ptlrpc_request *req,
+				    struct object_update_reply *reply,
+				    int count, struct osp_update_request *our,
+				    int *index, int rc)
+{
+	struct osp_update_callback	*ouc;
+	struct osp_update_callback	*next;
+	int				 rc1	= 0;
+
+	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
+		list_del_init(&ouc->ouc_list);
+
+		/* The peer may only have handled some requests (indicated
+		 * by the 'count') in the packaged OUT RPC, we can only get
+		 * results for the handled part. */
+		if (*index < count && reply->ourp_lens[*index] > 0 &&
+		    rc >= 0) {
+			struct object_update_result *result;
+
+			result = object_update_result_get(reply, *index, NULL);
+			if (result == NULL)
+				rc1 = rc = -EPROTO;
+			else
+				rc1 = rc = result->our_rc;
+		} else if (rc1 >= 0) {
+			/* The peer did not handle these request, let's return
+			 * -EINVAL to update interpret for now */
+			if (rc >= 0)
+				rc1 = -EINVAL;
+			else
+				rc1 = rc;
+		}
+
+		if (ouc->ouc_interpreter != NULL)
+			ouc->ouc_interpreter(env, reply, req, ouc->ouc_obj,
+					     ouc->ouc_data, *index, rc1);
+
+		osp_update_callback_fini(env, ouc);
+		(*index)++;
+	}
+
+	return rc;
+}
+
 /**
  * Interpret the packaged OUT RPC results.
  *
  * For every packaged sub-request, call its registered interpreter function.
- * Then destroy the sub-request.
+ * Then destroy the sub-request. The update requests batched behind the
+ * first one by the sending thread are handled the same way, in order.
  *
  * \param[in] env	pointer to the thread context
  * \param[in] req	pointer to the RPC
@@ -607,12 +735,11 @@ static int osp_update_interpret(const struct lu_env *env,
 	struct object_update_reply	*reply	= NULL;
 	struct osp_update_args		*oaua	= arg;
 	struct osp_update_request	*our = oaua->oaua_update;
+	struct osp_update_request	*tmp;
 	struct osp_thandle		*oth;
-	struct osp_update_callback	*ouc;
-	struct osp_update_callback	*next;
 	int				 count	= 0;
 	int				 index  = 0;
-	int				 rc1	= 0;
+	int				 rc1;
 
 	ENTRY;
 
@@ -642,44 +769,28 @@ static int osp_update_interpret(const struct lu_env *env,
 		}
 	}
 
-	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
-		list_del_init(&ouc->ouc_list);
+	rc = osp_update_interpret_one(env, req, reply, count, our, &index, rc);
 
-		/* The peer may only have handled some requests (indicated
-		 * by the 'count') in the packaged OUT RPC, we can only get
-		 * results for the handled part. */
-		if (index < count && reply->ourp_lens[index] > 0 && rc >= 0) {
-			struct object_update_result *result;
-
-			result = object_update_result_get(reply, index, NULL);
-			if (result == NULL)
-				rc1 = rc = -EPROTO;
-			else
-				rc1 = rc = result->our_rc;
-		} else if (rc1 >= 0) {
-			/* The peer did not handle these request, let's return
-			 * -EINVAL to update interpret for now */
-			if (rc >= 0)
-				rc1 = -EINVAL;
-			else
-				rc1 = rc;
-		}
+	if (oaua->oaua_count != NULL && atomic_dec_and_test(oaua->oaua_count))
+		wake_up_all(oaua->oaua_waitq);
 
-		if (ouc->ouc_interpreter != NULL)
-			ouc->ouc_interpreter(env, reply, req, ouc->ouc_obj,
-					     ouc->ouc_data, index, rc1);
+	if (oth != NULL)
+		osp_trans_stop_cb(env, oth, rc);
 
-		osp_update_callback_fini(env, ouc);
-		index++;
+	/* an update failing in one transaction stops the peer from handling
+	 * the following ones, so rc1 carries the failure on */
+	rc1 = rc;
+	osp_update_batch_for_each(tmp, our) {
+		if (tmp == our)
+			continue;
+		rc1 = osp_update_interpret_one(env, req, reply, count, tmp,
+					       &index, rc1);
+		osp_trans_stop_cb(env, tmp->our_th, rc1);
 	}
 
-	if (oaua->oaua_count != NULL && atomic_dec_and_test(oaua->oaua_count))
-		wake_up_all(oaua->oaua_waitq);
-
 	if (oth != NULL) {
 		/* oth and osp_update_requests will be destoryed in
 		 * osp_thandle_put */
-		osp_trans_stop_cb(env, oth, rc);
 		osp_thandle_put(oth);
 	} else {
 		osp_update_request_destroy(our);
@@ -1030,6 +1141,16 @@ static void osp_request_commit_cb(struct ptlrpc_request *req)
 	    (req->rq_transno > last_committed_transno) && result == 0)
 		result = 1;
 
+	/* rq_transno is the one of the last transaction packed in the RPC,
+	 * the ones before it are committed no later */
+	if (oth->ot_our != NULL) {
+		struct osp_update_request *our;
+
+		osp_update_batch_for_each(our, oth->ot_our) {
+			if (our != oth->ot_our)
+				osp_trans_commit_cb(our->our_th, result);
+		}
+	}
 	osp_trans_commit_cb(oth, result);
 	req->rq_committed = 1;
 	osp_thandle_put(oth);
@@ -1053,8 +1174,14 @@ void osp_trans_callback(const struct lu_env *env,
 {
 	struct osp_update_callback *ouc;
 	struct osp_update_callback *next;
+	struct osp_update_request *our;
 
 	if (oth->ot_our != NULL) {
+		osp_update_batch_for_each(our, oth->ot_our) {
+			if (our != oth->ot_our)
+				osp_trans_callback(env, our->our_th, rc);
+		}
+
 		list_for_each_entry_safe(ouc, next,
 					 &oth->ot_our->our_cb_items, ouc_list) {
 			list_del_init(&ouc->ouc_list);
@@ -1317,6 +1444,115 @@ osp_get_next_request(struct osp_updates *ou, struct osp_update_request **ourp)
 	return got_req;
 }
 
+/**
+ * Set the batchid of every update of \a our.
+ *
+ * The peer handles the updates of one OUT RPC in one local transaction per
+ * batchid, see out_handle(), so the transactions packed together by
+ * osp_get_batch_requests() have to carry different batchids.
+ *
+ * \param[in] our	update request
+ * \param[in] batchid	batchid of the updates
+ */
+static void osp_update_request_set_batchid(struct osp_update_request *our,
+					   __u32 batchid)
+{
+	struct osp_update_request_sub	*ours;
+	struct object_update		*update;
+	unsigned int			 i;
+
+	our->our_batchid = batchid;
+	list_for_each_entry(ours, &our->our_req_list, ours_list) {
+		for (i = 0; i < ours->ours_req->ourq_count; i++) {
+			update = object_update_request_get(ours->ours_req, i,
+							   NULL);
+			LASSERT(update != NULL);
+			update->ou_batchid = batchid;
+		}
+	}
+}
+
+/**
+ * Get the update requests to be sent in the same RPC as \a our
+ *
+ * Take the ready update requests whose versions directly follow the one of
+ * \a our off the sending list and link them to \a our, so that
+ * osp_send_update_req() sends all of them in one OUT RPC instead of waiting
+ * for one reply per transaction. The RPC stays within one bulk transfer and
+ * the maximal reply size.
+ *
+ * The reference taken on each of them by osp_check_and_set_rpc_version() is
+ * handed over to \a our and dropped by osp_update_request_destroy().
+ *
+ * \param [in] ou	osp update structure.
+ * \param [in] our	update request leading the RPC.
+ *
+ * \retval		version of the last update request of the RPC.
+ */
+static __u64 osp_get_batch_requests(struct osp_updates *ou,
+				    struct osp_update_request *our)
+{
+	struct osp_update_request	*tmp;
+	struct osp_update_request	*next;
+	struct osp_update_request_sub	*ours;
+	__u64				 version = our->our_version;
+	size_t				 size = 0;
+	size_t				 tmp_size;
+	int				 repsize;
+	int				 tmp_repsize;
+	int				 nr = 1;
+
+	list_for_each_entry(ours, &our->our_req_list, ours_list)
+		size += ours->ours_req_size;
+	repsize = sizeof(struct object_update_reply) +
+		  osp_update_request_repsize(our);
+
+	spin_lock(&ou->ou_lock);
+	/* the sending list is sorted by version */
+	list_for_each_entry_safe(tmp, next, &ou->ou_list, our_list) {
+		if (nr >= OSP_UPDATE_BATCH_MAX ||
+		    tmp->our_version != version + 1)
+			break;
+
+		spin_lock(&tmp->our_list_lock);
+		if (!tmp->our_req_ready ||
+		    tmp->our_th->ot_super.th_result != 0) {
+			spin_unlock(&tmp->our_list_lock);
+			break;
+		}
+
+		tmp_size = 0;
+		list_for_each_entry(ours, &tmp->our_req_list, ours_list)
+			tmp_size += ours->ours_req_size;
+		tmp_repsize = osp_update_request_repsize(tmp);
+		if (size + tmp_size > MD_MAX_BRW_SIZE ||
+		    repsize + tmp_repsize > OUT_MAXREPSIZE) {
+			spin_unlock(&tmp->our_list_lock);
+			break;
+		}
+
+		list_del_init(&tmp->our_list);
+		spin_unlock(&tmp->our_list_lock);
+
+		list_add_tail(&tmp->our_batch_list, &our->our_batch_list);
+		size += tmp_size;
+		repsize += tmp_repsize;
+		version = tmp->our_version;
+		nr++;
+	}
+	spin_unlock(&ou->ou_lock);
+
+	nr = 0;
+	list_for_each_entry(tmp, &our->our_batch_list, our_batch_list)
+		osp_update_request_set_batchid(tmp, ++nr);
+
+	if (nr > 0)
+		CDEBUG(D_HA, "ou %p send versions "LPU64"-"LPU64" in one RPC\n",
+		       ou, our->our_version, version);
+
+	return version;
+}
+
 /**
  * Invalidate update request
  *
@@ -1390,6 +1626,8 @@ void osp_invalidate_request(struct osp_device *osp)
  * Create thread to send update request to other MDTs, this thread will pull
  * out update request from the list in OSP by version number, i.e. it will
  * make sure the update request with lower version number will be sent first.
+ * The update requests which are ready with the following versions are sent
+ * in the same RPC, see osp_get_batch_requests().
  *
  * \param[in] arg	hold the OSP device.
  *
@@ -1405,6 +1643,7 @@ int osp_send_update_thread(void *arg)
 	struct osp_updates	*ou = osp->opd_update;
 	struct ptlrpc_thread	*thread = &osp->opd_update_thread;
 	struct osp_update_request *our = NULL;
+	__u64			version;
 	int			rc;
 	ENTRY;
 
@@ -1433,6 +1672,7 @@ int osp_send_update_thread(void *arg)
 		}
 
 		LASSERT(our->our_th != NULL);
+		version = our->our_version;
 		if (our->our_th->ot_super.th_result != 0) {
 			osp_trans_callback(&env, our->our_th,
 				our->our_th->ot_super.th_result);
@@ -1441,13 +1681,14 @@ int osp_send_update_thread(void *arg)
 			rc = -EIO;
 			osp_trans_callback(&env, our->our_th, rc);
 		} else {
+			version = osp_get_batch_requests(ou, our);
 			rc = osp_send_update_req(&env, osp, our);
 		}
 
 		/* Update the rpc version */
 		spin_lock(&ou->ou_lock);
 		if (our->our_version == ou->ou_rpc_version)
-			ou->ou_rpc_version++;
+			ou->ou_rpc_version = version + 1;
 		spin_unlock(&ou->ou_lock);
 
 		/* If one update request fails, let's fail all of the requests
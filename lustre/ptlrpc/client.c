@@ -1100,6 +1100,8 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 		 *      no other better choice. It maybe fixed in future. */
 		for (i = 0; i < pc->pc_npartners; i++)
 			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
+	} else {
+		ptlrpcd_backlog(pc, count);
 	}
 }
 
@@ -3263,7 +3265,7 @@ struct ptlrpc_work_async_args {
 	void   *cbdata;
 };
 
-static void ptlrpcd_add_work_req(struct ptlrpc_request *req)
+static void ptlrpcd_add_work_req(struct ptlrpc_request *req, int cpt)
 {
 	/* re-initialize the req */
 	req->rq_timeout		= obd_timeout;
@@ -3275,7 +3277,7 @@ static void ptlrpcd_add_work_req(struct ptlrpc_request *req)
 	req->rq_xid		= ptlrpc_next_xid();
 	req->rq_import_generation = req->rq_import->imp_generation;
 
-	ptlrpcd_add_req(req);
+	ptlrpcd_add_req_cpt(req, cpt);
 }
 
 static int work_interpreter(const struct lu_env *env,
@@ -3293,7 +3295,7 @@ static int work_interpreter(const struct lu_env *env,
 
 	if (atomic_dec_return(&req->rq_refcount) > 1) {
 		atomic_set(&req->rq_refcount, 2);
-		ptlrpcd_add_work_req(req);
+		ptlrpcd_add_work_req(req, cfs_cpt_current(cfs_cpt_table, 1));
 	}
 	return rc;
 }
@@ -3356,6 +3358,17 @@ void ptlrpcd_destroy_work(void *handler)
 EXPORT_SYMBOL(ptlrpcd_destroy_work);
 
 int ptlrpcd_queue_work(void *handler)
+{
+	return ptlrpcd_queue_work_cpt(handler,
+				      cfs_cpt_current(cfs_cpt_table, 1));
+}
+EXPORT_SYMBOL(ptlrpcd_queue_work);
+
+/**
+ * Queue a work with a CPT affinity hint for the ptlrpcd thread running it,
+ * CFS_CPT_ANY lets ptlrpcd pick its least loaded thread.
+ */
+int ptlrpcd_queue_work_cpt(void *handler, int cpt)
 {
 	struct ptlrpc_request *req = handler;
 
@@ -3369,7 +3382,7 @@ int ptlrpcd_queue_work(void *handler)
          */
 	LASSERT(atomic_read(&req->rq_refcount) > 0);
 	if (atomic_inc_return(&req->rq_refcount) == 2)
-		ptlrpcd_add_work_req(req);
+		ptlrpcd_add_work_req(req, cpt);
 	return 0;
 }
-EXPORT_SYMBOL(ptlrpcd_queue_work);
+EXPORT_SYMBOL(ptlrpcd_queue_work_cpt);
@@ -396,6 +396,11 @@ static const struct req_msg_field *ldlm_gl_callback_server[] = {
         &RMF_DLM_LVB
 };
 
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_BL_STALE
+};
+
 static const struct req_msg_field *ldlm_intent_basic_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REQ,
@@ -605,7 +610,8 @@ static const struct req_msg_field *ost_brw_client[] = {
         &RMF_OST_BODY,
         &RMF_OBD_IOOBJ,
         &RMF_NIOBUF_REMOTE,
-        &RMF_CAPA1
+	&RMF_CAPA1,
+	&RMF_OST_OBDOS
 };
 
 static const struct req_msg_field *ost_brw_read_server[] = {
@@ -780,6 +786,7 @@ static struct req_format *req_formats[] = {
         &RQF_LDLM_CALLBACK,
         &RQF_LDLM_CP_CALLBACK,
         &RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
         &RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_DESC_CALLBACK,
         &RQF_LDLM_INTENT,
@@ -1041,6 +1048,12 @@ struct req_msg_field RMF_DLM_GL_DESC =
 		    lustre_swab_gl_desc, NULL);
 EXPORT_SYMBOL(RMF_DLM_GL_DESC);
 
+/* bitmap of the locks of a batched blocking AST the client does not know,
+ * bit i % 8 of byte i / 8 is set if lock_handle[i] is stale */
+struct req_msg_field RMF_DLM_BL_STALE =
+	DEFINE_MSGF("dlm_bl_stale", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_DLM_BL_STALE);
+
 struct req_msg_field RMF_MDT_MD =
         DEFINE_MSGF("mdt_md", RMF_F_NO_SIZE_CHECK, MIN_MD_SIZE, NULL, NULL);
 EXPORT_SYMBOL(RMF_MDT_MD);
@@ -1104,6 +1117,12 @@ struct req_msg_field RMF_NIOBUF_REMOTE =
                     dump_rniobuf);
 EXPORT_SYMBOL(RMF_NIOBUF_REMOTE);
 
+/* attributes of the objects after the first one in a multi-object BRW */
+struct req_msg_field RMF_OST_OBDOS =
+	DEFINE_MSGF("ost_obdos", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct obdo), lustre_swab_obdo, dump_obdo);
+EXPORT_SYMBOL(RMF_OST_OBDOS);
+
 struct req_msg_field RMF_RCS =
         DEFINE_MSGF("niobuf_remote", RMF_F_STRUCT_ARRAY, sizeof(__u32),
                     lustre_swab_generic_32s, dump_rcs);
@@ -1443,6 +1462,11 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
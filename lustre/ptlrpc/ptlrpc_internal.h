@@ -69,6 +69,9 @@ extern struct mutex pinger_mutex;
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
+void ptlrpcd_backlog(struct ptlrpcd_ctl *pc, int count);
+int ptlrpcd_lprocfs_init(void);
+void ptlrpcd_lprocfs_fini(void);
 
 /* client.c */
 void ptlrpc_at_adj_net_latency(struct ptlrpc_request *req,
@@ -56,6 +56,7 @@
 #define DEBUG_SUBSYSTEM S_RPC
 
 #include <linux/kthread.h>
+#include <linux/topology.h>
 #include <libcfs/libcfs.h>
 #include <lustre_net.h>
 #include <lustre_lib.h>
@@ -67,6 +68,12 @@
 
 #include "ptlrpc_internal.h"
 
+/* Another ptlrpcd CPT that idle threads of this CPT may steal work from. */
+struct ptlrpcd_peer {
+	int			pp_index;	/* index in ptlrpcds array */
+	int			pp_distance;	/* NUMA distance to the peer */
+};
+
 /* One of these per CPT. */
 struct ptlrpcd {
 	int			pd_size;
@@ -75,6 +82,9 @@ struct ptlrpcd {
 	int			pd_cursor;
 	int			pd_nthreads;
 	int			pd_groupsize;
+	/* other CPTs, nearest first */
+	int			pd_npeers;
+	struct ptlrpcd_peer	*pd_peers;
 	struct ptlrpcd_ctl	pd_threads[0];
 };
 
@@ -136,6 +146,18 @@ static char *ptlrpcd_cpts;
 CFS_MODULE_PARM(ptlrpcd_cpts, "s", charp, 0644,
 		"CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_steal_threshold: The number of queued, not yet started RPCs
+ * a ptlrpcd thread must have before idle ptlrpcd threads bound to other
+ * CPTs will take them over. The threshold is scaled by the NUMA distance
+ * between the two CPTs, so threads on a remote node only help out when
+ * the backlog is correspondingly larger. A value of 0 disables stealing
+ * across CPTs; threads then only take work from their partners.
+ */
+static int ptlrpcd_steal_threshold = 16;
+CFS_MODULE_PARM(ptlrpcd_steal_threshold, "i", int, 0644,
+		"Backlog of a ptlrpcd thread before other CPTs steal from it");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
@@ -164,22 +186,50 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
+static inline struct ptlrpcd *ptlrpcd_cpt2pd(int cpt)
+{
+	return ptlrpcds[ptlrpcds_cpt_idx == NULL ? cpt : ptlrpcds_cpt_idx[cpt]];
+}
+
+/**
+ * Number of RPCs queued to, or being processed by, a ptlrpcd thread.
+ */
+static inline int ptlrpcd_queue_len(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set *set = pc->pc_set;
+
+	if (set == NULL)
+		return 0;
+
+	return atomic_read(&set->set_new_count) +
+	       atomic_read(&set->set_remaining);
+}
+
+/**
+ * Choose the ptlrpcd thread a new request is queued to.
+ *
+ * \a cpt is an affinity hint from the caller: for a valid CPT number the
+ * request goes to one of the threads serving that CPT in round-robin
+ * order, while CFS_CPT_ANY means the caller has no preference and the
+ * least loaded thread of the current CPT is picked.
+ */
 static struct ptlrpcd_ctl *
-ptlrpcd_select_pc(struct ptlrpc_request *req)
+ptlrpcd_select_pc(struct ptlrpc_request *req, int cpt)
 {
 	struct ptlrpcd	*pd;
-	int		cpt;
+	bool		balance;
+	int		best;
+	int		len;
 	int		idx;
+	int		i;
 
 	if (req != NULL && req->rq_send_state != LUSTRE_IMP_FULL)
 		return &ptlrpcd_rcv;
 
-	cpt = cfs_cpt_current(cfs_cpt_table, 1);
-	if (ptlrpcds_cpt_idx == NULL)
-		idx = cpt;
-	else
-		idx = ptlrpcds_cpt_idx[cpt];
-	pd = ptlrpcds[idx];
+	balance = (cpt == CFS_CPT_ANY);
+	if (cpt < 0 || cpt >= cfs_cpt_number(cfs_cpt_table))
+		cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	pd = ptlrpcd_cpt2pd(cpt);
 
 	/* We do not care whether it is strict load balance. */
 	idx = pd->pd_cursor;
@@ -187,9 +237,58 @@ ptlrpcd_select_pc(struct ptlrpc_request *req)
 		idx = 0;
 	pd->pd_cursor = idx;
 
+	if (!balance)
+		return &pd->pd_threads[idx];
+
+	/* Start from the cursor so that ties are spread over all threads. */
+	best = ptlrpcd_queue_len(&pd->pd_threads[idx]);
+	for (i = 1; i < pd->pd_nthreads && best > 0; i++) {
+		int j = (pd->pd_cursor + i) % pd->pd_nthreads;
+
+		len = ptlrpcd_queue_len(&pd->pd_threads[j]);
+		if (len < best) {
+			best = len;
+			idx = j;
+		}
+	}
+
 	return &pd->pd_threads[idx];
 }
 
+/**
+ * Called when \a count requests are waiting in the queue of \a pc.
+ *
+ * Once the backlog reaches the stealing threshold, wake up a thread on
+ * the nearest other CPT so that it can take the queued requests over
+ * rather than waiting for its idle timeout to expire.
+ */
+void ptlrpcd_backlog(struct ptlrpcd_ctl *pc, int count)
+{
+	struct ptlrpcd		*pd;
+	struct ptlrpcd		*peer;
+	struct ptlrpcd_ctl	*thief;
+
+	if (ptlrpcd_steal_threshold <= 0 || count != ptlrpcd_steal_threshold)
+		return;
+
+	if (test_bit(LIOD_RECOVERY, &pc->pc_flags))
+		return;
+
+	pd = ptlrpcd_cpt2pd(pc->pc_cpt);
+	if (pd->pd_npeers == 0)
+		return;
+
+	peer = ptlrpcds[pd->pd_peers[0].pp_index];
+	if (peer == NULL)
+		return;
+
+	thief = &peer->pd_threads[peer->pd_cursor % peer->pd_nthreads];
+	spin_lock(&thief->pc_lock);
+	if (thief->pc_set != NULL)
+		wake_up(&thief->pc_set->set_waitq);
+	spin_unlock(&thief->pc_lock);
+}
+
 /**
  * Move all request from an existing request set to the ptlrpcd queue.
  * All requests from the set must be in phase RQ_PHASE_NEW.
@@ -201,7 +300,7 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	struct ptlrpc_request_set *new;
 	int count, i;
 
-	pc = ptlrpcd_select_pc(NULL);
+	pc = ptlrpcd_select_pc(NULL, cfs_cpt_current(cfs_cpt_table, 1));
 	new = pc->pc_set;
 
 	list_for_each_safe(pos, tmp, &set->set_requests) {
@@ -258,11 +357,88 @@ static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
 	return rc;
 }
 
+static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
+{
+	atomic_inc(&set->set_refcount);
+}
+
+/**
+ * Take queued RPCs over from a busy ptlrpcd thread bound to another CPT.
+ *
+ * Peer CPTs are visited nearest first. A thread is only robbed when its
+ * backlog reaches ptlrpcd_steal_threshold scaled by the NUMA distance to
+ * its CPT, so that RPCs move to a remote node only when the local one is
+ * clearly overloaded.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_steal_remote(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set	*set = pc->pc_set;
+	struct ptlrpc_request_set	*ps;
+	struct ptlrpcd_ctl		*victim;
+	struct ptlrpcd			*pd;
+	struct ptlrpcd			*peer;
+	int				threshold;
+	int				rc = 0;
+	int				i;
+	int				j;
+
+	pd = ptlrpcd_cpt2pd(pc->pc_cpt);
+	for (i = 0; i < pd->pd_npeers && rc == 0; i++) {
+		peer = ptlrpcds[pd->pd_peers[i].pp_index];
+		if (peer == NULL)
+			continue;
+
+		threshold = ptlrpcd_steal_threshold *
+			    pd->pd_peers[i].pp_distance / LOCAL_DISTANCE;
+
+		for (j = 0; j < peer->pd_nthreads && rc == 0; j++) {
+			victim = &peer->pd_threads[j];
+
+			spin_lock(&victim->pc_lock);
+			ps = victim->pc_set;
+			if (ps == NULL) {
+				spin_unlock(&victim->pc_lock);
+				continue;
+			}
+
+			ptlrpc_reqset_get(ps);
+			spin_unlock(&victim->pc_lock);
+
+			if (atomic_read(&ps->set_new_count) >= threshold) {
+				rc = ptlrpcd_steal_rqset(set, ps);
+				if (rc > 0) {
+					CDEBUG(D_RPCTRACE, "transfer %d async "
+					       "RPCs [%s->%s]\n", rc,
+					       victim->pc_name, pc->pc_name);
+					pc->pc_steals++;
+					pc->pc_remote_steals++;
+					pc->pc_stolen_rpcs += rc;
+				}
+			}
+			ptlrpc_reqset_put(ps);
+		}
+	}
+
+	return rc;
+}
+
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
  */
 void ptlrpcd_add_req(struct ptlrpc_request *req)
+{
+	ptlrpcd_add_req_cpt(req, cfs_cpt_current(cfs_cpt_table, 1));
+}
+EXPORT_SYMBOL(ptlrpcd_add_req);
+
+/**
+ * Same as ptlrpcd_add_req(), but lets the caller give a CPT affinity hint
+ * for the ptlrpcd thread that will handle \a req, see ptlrpcd_select_pc().
+ */
+void ptlrpcd_add_req_cpt(struct ptlrpc_request *req, int cpt)
 {
 	struct ptlrpcd_ctl *pc;
 
@@ -292,19 +468,14 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 		spin_unlock(&req->rq_lock);
 	}
 
-	pc = ptlrpcd_select_pc(req);
+	pc = ptlrpcd_select_pc(req, cpt);
 
 	DEBUG_REQ(D_INFO, req, "add req [%p] to pc [%s:%d]",
 		  req, pc->pc_name, pc->pc_index);
 
 	ptlrpc_set_add_new_req(pc, req);
 }
-EXPORT_SYMBOL(ptlrpcd_add_req);
-
-static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
-{
-	atomic_inc(&set->set_refcount);
-}
+EXPORT_SYMBOL(ptlrpcd_add_req_cpt);
 
 /**
  * Check if there is more work to do on ptlrpcd set.
@@ -401,15 +572,24 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 
 				if (atomic_read(&ps->set_new_count)) {
 					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
+					if (rc > 0) {
 						CDEBUG(D_RPCTRACE, "transfer %d"
 						       " async RPCs [%d->%d]\n",
 						       rc, partner->pc_index,
 						       pc->pc_index);
+						pc->pc_steals++;
+						pc->pc_stolen_rpcs += rc;
+					}
 				}
 				ptlrpc_reqset_put(ps);
 			} while (rc == 0 && pc->pc_cursor != first);
 		}
+
+		/* Partners are idle too, help out a busy thread elsewhere. */
+		if (rc == 0 && ptlrpcd_steal_threshold > 0 &&
+		    !test_bit(LIOD_RECOVERY, &pc->pc_flags) &&
+		    !test_bit(LIOD_STOP, &pc->pc_flags))
+			rc = ptlrpcd_steal_remote(pc);
 	}
 
 	RETURN(rc);
@@ -592,6 +772,49 @@ out:
 	RETURN(rc);
 }
 
+/*
+ * Build the list of other CPTs that idle threads of \a pd may steal work
+ * from, sorted by NUMA distance so that the nearest CPTs are tried first.
+ * All entries of the ptlrpcds array must be allocated.
+ */
+static int ptlrpcd_peers(struct ptlrpcd *pd)
+{
+	struct ptlrpcd_peer	peer;
+	int			node;
+	int			i;
+	int			j;
+	int			n = 0;
+	ENTRY;
+
+	if (ptlrpcds_num <= 1)
+		RETURN(0);
+
+	OBD_CPT_ALLOC(pd->pd_peers, cfs_cpt_table, pd->pd_cpt,
+		      sizeof(pd->pd_peers[0]) * (ptlrpcds_num - 1));
+	if (pd->pd_peers == NULL)
+		RETURN(-ENOMEM);
+
+	node = cfs_cpt_spread_node(cfs_cpt_table, pd->pd_cpt);
+	for (i = 0; i < ptlrpcds_num; i++) {
+		if (i == pd->pd_index)
+			continue;
+
+		peer.pp_index = i;
+		peer.pp_distance = node_distance(node,
+				cfs_cpt_spread_node(cfs_cpt_table,
+						    ptlrpcds[i]->pd_cpt));
+		/* insertion sort, the array is short */
+		for (j = n; j > 0 &&
+		     pd->pd_peers[j - 1].pp_distance > peer.pp_distance; j--)
+			pd->pd_peers[j] = pd->pd_peers[j - 1];
+		pd->pd_peers[j] = peer;
+		n++;
+	}
+	pd->pd_npeers = n;
+
+	RETURN(0);
+}
+
 int ptlrpcd_start(struct ptlrpcd_ctl *pc)
 {
 	struct task_struct	*task;
@@ -692,6 +915,9 @@ out:
         }
         pc->pc_npartners = 0;
 	pc->pc_error = 0;
+	pc->pc_steals = 0;
+	pc->pc_remote_steals = 0;
+	pc->pc_stolen_rpcs = 0;
         EXIT;
 }
 
@@ -703,13 +929,27 @@ static void ptlrpcd_fini(void)
 	ENTRY;
 
 	if (ptlrpcds != NULL) {
+		/* Threads may steal from any CPT, so stop all of them before
+		 * anything is freed. */
 		for (i = 0; i < ptlrpcds_num; i++) {
 			if (ptlrpcds[i] == NULL)
 				break;
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_stop(&ptlrpcds[i]->pd_threads[j], 0);
+		}
+		for (i = 0; i < ptlrpcds_num; i++) {
+			if (ptlrpcds[i] == NULL)
+				break;
 			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
 				ptlrpcd_free(&ptlrpcds[i]->pd_threads[j]);
+		}
+		for (i = 0; i < ptlrpcds_num; i++) {
+			if (ptlrpcds[i] == NULL)
+				break;
+			if (ptlrpcds[i]->pd_peers != NULL)
+				OBD_FREE(ptlrpcds[i]->pd_peers,
+					 sizeof(ptlrpcds[i]->pd_peers[0]) *
+					 (ptlrpcds_num - 1));
 			OBD_FREE(ptlrpcds[i], ptlrpcds[i]->pd_size);
 			ptlrpcds[i] = NULL;
 		}
@@ -791,7 +1031,6 @@ static int ptlrpcd_init(void)
 			ptlrpcds_cpt_idx[cpt] = i;
 		}
 
-		cfs_expr_list_values_free(cpts, rc);
 		ncpts = rc;
 	}
 	ptlrpcds_num = ncpts;
@@ -916,7 +1155,20 @@ static int ptlrpcd_init(void)
 			if (rc < 0)
 				GOTO(out, rc);
 		}
+	}
 
+	/*
+	 * Idle threads may steal from any other CPT, so all of them have
+	 * to be set up before the first thread is started.
+	 */
+	for (i = 0; i < ncpts; i++) {
+		rc = ptlrpcd_peers(ptlrpcds[i]);
+		if (rc < 0)
+			GOTO(out, rc);
+	}
+
+	for (i = 0; i < ncpts; i++) {
+		pd = ptlrpcds[i];
 		/* XXX: We start nthreads ptlrpc daemons on this cpt.
 		 *      Each of them can process any non-recovery
 		 *      async RPC to improve overall async RPC
@@ -936,19 +1188,86 @@ static int ptlrpcd_init(void)
 		 *      load among all the ptlrpc daemons becomes
 		 *      another trouble.
 		 */
-		for (j = 0; j < nthreads; j++) {
+		for (j = 0; j < pd->pd_nthreads; j++) {
 			rc = ptlrpcd_start(&pd->pd_threads[j]);
 			if (rc < 0)
 				GOTO(out, rc);
 		}
 	}
 out:
+	if (cpts != NULL)
+		cfs_expr_list_values_free(cpts, ncpts);
 	if (rc != 0)
 		ptlrpcd_fini();
 
 	RETURN(rc);
 }
 
+#ifdef CONFIG_PROC_FS
+static void ptlrpcd_stats_show_one(struct seq_file *m, struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set	*set = pc->pc_set;
+	int				queued = 0;
+	int				active = 0;
+
+	if (set != NULL) {
+		queued = atomic_read(&set->set_new_count);
+		active = atomic_read(&set->set_remaining);
+	}
+
+	seq_printf(m, "%-16s %4d %8d %8d %10lu %10lu %12lu\n",
+		   pc->pc_name, pc->pc_cpt, queued, active, pc->pc_steals,
+		   pc->pc_remote_steals, pc->pc_stolen_rpcs);
+}
+
+/*
+ * Per-thread queue lengths and work stealing counters, to check how well
+ * the async RPC load is balanced over the ptlrpcd threads.
+ */
+static int ptlrpcd_stats_seq_show(struct seq_file *m, void *data)
+{
+	int	i;
+	int	j;
+
+	seq_printf(m, "%-16s %4s %8s %8s %10s %10s %12s\n", "thread", "cpt",
+		   "queued", "active", "steals", "remote", "stolen_rpcs");
+
+	mutex_lock(&ptlrpcd_mutex);
+	if (ptlrpcd_users > 0) {
+		for (i = 0; i < ptlrpcds_num; i++) {
+			for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++)
+				ptlrpcd_stats_show_one(m,
+						&ptlrpcds[i]->pd_threads[j]);
+		}
+		ptlrpcd_stats_show_one(m, &ptlrpcd_rcv);
+	}
+	mutex_unlock(&ptlrpcd_mutex);
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpcd_stats);
+
+int ptlrpcd_lprocfs_init(void)
+{
+	return lprocfs_seq_create(proc_lustre_root, "ptlrpcd_stats", 0444,
+				  &ptlrpcd_stats_fops, NULL);
+}
+
+void ptlrpcd_lprocfs_fini(void)
+{
+	lprocfs_remove_proc_entry("ptlrpcd_stats", proc_lustre_root);
+}
+#else /* !CONFIG_PROC_FS */
+int ptlrpcd_lprocfs_init(void)
+{
+	return 0;
+}
+
+void ptlrpcd_lprocfs_fini(void)
+{
+}
+#endif /* CONFIG_PROC_FS */
+
 int ptlrpcd_addref(void)
 {
         int rc = 0;
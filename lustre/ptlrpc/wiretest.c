@@ -1204,6 +1204,16 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_OBDOPACK);
 	LASSERTF(OBD_CONNECT_FLAGS2 == 0x8000000000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT_FLAGS2);
+	LASSERTF(OBD_CONNECT2_MULTIOBJ_BRW == 0x0001000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_MULTIOBJ_BRW);
+	LASSERTF(OBD_CONNECT2_LOCK_CONVERT == 0x0002000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LOCK_CONVERT);
+	LASSERTF(OBD_CONNECT2_BL_AST_BATCH == 0x0004000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BL_AST_BATCH);
+	LASSERTF(OBD_CONNECT2_DESTROY_BATCH == 0x0008000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_DESTROY_BATCH);
+	LASSERTF(OBD_CONNECT2_EXTENT_NOWAIT == 0x0010000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_EXTENT_NOWAIT);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -185,6 +185,101 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/**
+ * Validate the objects of a multi-object write BRW.
+ *
+ * The first object is described by the ost_body, the following ones by an
+ * obdo each in RMF_OST_OBDOS.  Their ost_ids are checked and converted the
+ * same way as the body one and copied to the matching obd_ioobj.  All the
+ * objects share the local buffers of the request, so the pages covered by
+ * the whole niobuf array must still fit in a single bulk.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] ioo	array of obd_ioobj, one per object
+ * \param[in] obj_count	number of objects in the request
+ * \param[in] rnb	array of remote niobufs of all objects
+ *
+ * \retval		0 if the request is valid
+ * \retval		-EPROTO otherwise
+ */
+static int tgt_io_data_unpack_multi(struct tgt_session_info *tsi,
+				    struct obd_ioobj *ioo, int obj_count,
+				    struct niobuf_remote *rnb)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct lu_nodemap	*nodemap;
+	struct obdo		*oas;
+	int			 nr_nb;
+	int			 npages = 0;
+	int			 nb = 0;
+	int			 i;
+	int			 j;
+	int			 rc;
+
+	ENTRY;
+
+	if (lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) != OST_WRITE ||
+	    !exp_connect_multiobj_brw(tsi->tsi_exp) ||
+	    obj_count > OST_MAX_BRW_OBJS ||
+	    !req_capsule_field_present(pill, &RMF_OST_OBDOS, RCL_CLIENT) ||
+	    req_capsule_get_size(pill, &RMF_OST_OBDOS, RCL_CLIENT) !=
+	    (obj_count - 1) * sizeof(*oas)) {
+		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
+		       obj_count);
+		RETURN(-EPROTO);
+	}
+
+	oas = req_capsule_client_get(pill, &RMF_OST_OBDOS);
+	if (oas == NULL)
+		RETURN(-EPROTO);
+
+	nodemap = tsi->tsi_exp->exp_target_data.ted_nodemap;
+	nr_nb = req_capsule_get_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT) /
+		sizeof(*rnb);
+
+	for (i = 0; i < obj_count; i++) {
+		if (i > 0) {
+			struct obdo *oa = &oas[i - 1];
+
+			rc = tgt_validate_obdo(tsi, oa);
+			if (rc)
+				RETURN(rc);
+
+			oa->o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
+						   NODEMAP_CLIENT_TO_FS,
+						   oa->o_uid);
+			oa->o_gid = nodemap_map_id(nodemap, NODEMAP_GID,
+						   NODEMAP_CLIENT_TO_FS,
+						   oa->o_gid);
+			ioo[i].ioo_oid = oa->o_oi;
+		}
+
+		if (ioo[i].ioo_bufcnt == 0 ||
+		    ioo[i].ioo_bufcnt > nr_nb - nb) {
+			CERROR("%s: ioo %d has bad bufcnt %u\n",
+			       tgt_name(tsi->tsi_tgt), i, ioo[i].ioo_bufcnt);
+			RETURN(-EPROTO);
+		}
+
+		for (j = 0; j < ioo[i].ioo_bufcnt; j++, nb++) {
+			/* server side locking covers a single resource */
+			if (rnb[nb].rnb_flags & OBD_BRW_SRVLOCK)
+				RETURN(-EPROTO);
+			npages += ((rnb[nb].rnb_offset + rnb[nb].rnb_len +
+				    PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT) -
+				  (rnb[nb].rnb_offset >> PAGE_CACHE_SHIFT);
+		}
+	}
+
+	if (npages > PTLRPC_MAX_BRW_PAGES) {
+		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
+			  "bulk has too many pages (%d)", npages);
+		RETURN(-EPROTO);
+	}
+
+	RETURN(0);
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
@@ -218,9 +313,10 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
 	} else if (obj_count > 1) {
-		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
-		       obj_count);
-		RETURN(-EPROTO);
+		int rc = tgt_io_data_unpack_multi(tsi, ioo, obj_count, rnb);
+
+		if (rc < 0)
+			RETURN(rc);
 	}
 
 	if (ioo->ioo_bufcnt == 0) {
@@ -2066,6 +2162,138 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+/**
+ * Return the obdo of object \a idx of a write BRW: the first object uses
+ * the reply body, the others the per-object obdos of the request.
+ */
+static struct obdo *tgt_brw_obdo(struct tgt_session_info *tsi,
+				 struct obdo *oa, int idx)
+{
+	struct obdo *oas;
+
+	if (idx == 0)
+		return oa;
+
+	oas = req_capsule_client_get(tsi->tsi_pill, &RMF_OST_OBDOS);
+	LASSERT(oas != NULL); /* checked by tgt_io_data_unpack_multi() */
+	return &oas[idx - 1];
+}
+
+/**
+ * Commit the objects of a multi-object write BRW.
+ *
+ * Each object is committed by its own obd_commitrw() call with its slice of
+ * remote and local buffers.  Over-quota flags of the other objects owned by
+ * the same user or group are reported in the reply body, which is the only
+ * obdo the client gets back.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] oa	reply obdo of the first object
+ * \param[in] nr	number of objects which were prepared
+ * \param[in] ioo	array of obd_ioobj, one per object
+ * \param[in] rnb	array of remote niobufs of all objects
+ * \param[in] lnb	array of local niobufs of all objects
+ * \param[in] objpages	number of local niobufs of each object
+ * \param[in] old_rc	status of the bulk transfer
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+static int tgt_brw_write_commit(struct tgt_session_info *tsi,
+				struct obdo *oa, int nr,
+				struct obd_ioobj *ioo,
+				struct niobuf_remote *rnb,
+				struct niobuf_local *lnb, int *objpages,
+				int old_rc)
+{
+	int nb = 0;
+	int npages = 0;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	for (i = 0; i < nr; i++) {
+		struct obdo	*obj_oa = tgt_brw_obdo(tsi, oa, i);
+		int		 rc2;
+
+		rc2 = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, tsi->tsi_exp,
+				   obj_oa, 1, &ioo[i], rnb + nb, objpages[i],
+				   lnb + npages, old_rc);
+		if (rc == 0 || rc2 == -ENOTCONN)
+			rc = rc2;
+
+		if (i > 0 && (obj_oa->o_valid & OBD_MD_FLFLAGS) &&
+		    obj_oa->o_uid == oa->o_uid && obj_oa->o_gid == oa->o_gid)
+			oa->o_flags |= obj_oa->o_flags &
+				       (OBD_FL_NO_USRQUOTA |
+					OBD_FL_NO_GRPQUOTA);
+
+		nb += ioo[i].ioo_bufcnt;
+		npages += objpages[i];
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * Prepare the objects of a multi-object write BRW.
+ *
+ * Local buffers of the objects are laid out one after the other in \a lnb,
+ * in the same order as the remote buffers and the bulk.  Grant is handled
+ * with the reply body of the first object only, the other obdos do not
+ * carry OBD_MD_FLGRANT.  If an object fails, the objects prepared before it
+ * are committed with the error to release their buffers.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] oa	reply obdo of the first object
+ * \param[in] objcount	number of objects
+ * \param[in] ioo	array of obd_ioobj, one per object
+ * \param[in] rnb	array of remote niobufs of all objects
+ * \param[out] npages	total number of local niobufs
+ * \param[out] lnb	array of local niobufs of all objects
+ * \param[out] objpages	number of local niobufs of each object
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+static int tgt_brw_write_prep(struct tgt_session_info *tsi,
+			      struct obdo *oa, int objcount,
+			      struct obd_ioobj *ioo,
+			      struct niobuf_remote *rnb, int *npages,
+			      struct niobuf_local *lnb, int *objpages)
+{
+	int nb = 0;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	*npages = 0;
+	for (i = 0; i < objcount; i++) {
+		struct obdo	*obj_oa = tgt_brw_obdo(tsi, oa, i);
+		int		 nr = PTLRPC_MAX_BRW_PAGES - *npages;
+
+		if (i > 0)
+			obj_oa->o_valid &= ~OBD_MD_FLGRANT;
+
+		rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, tsi->tsi_exp,
+				obj_oa, 1, &ioo[i], rnb + nb, &nr,
+				lnb + *npages);
+		if (rc < 0)
+			break;
+
+		objpages[i] = nr;
+		*npages += nr;
+		nb += ioo[i].ioo_bufcnt;
+	}
+
+	if (rc < 0 && i > 0)
+		tgt_brw_write_commit(tsi, oa, i, ioo, rnb, lnb, objpages, rc);
+
+	RETURN(rc);
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2078,6 +2306,7 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
+	int			*objpages = NULL;
 	int			 objcount, niocount, npages;
 	int			 rc, i, j;
 	cksum_type_t		 cksum_type = OBD_CKSUM_CRC32;
@@ -2184,9 +2413,24 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
-	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb);
+	if (objcount > 1) {
+		/* every object is committed in its own transaction, each of
+		 * them needs a transno for the client commit tracking */
+		tgt_th_info(tsi->tsi_env)->tti_mult_trans = 1;
+
+		OBD_ALLOC(objpages, objcount * sizeof(*objpages));
+		if (objpages == NULL)
+			GOTO(out_lock, rc = -ENOMEM);
+
+		rc = tgt_brw_write_prep(tsi, &repbody->oa, objcount, ioo,
+					remote_nb, &npages, local_nb,
+					objpages);
+	} else {
+		npages = PTLRPC_MAX_BRW_PAGES;
+		rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				&repbody->oa, objcount, ioo, remote_nb,
+				&npages, local_nb);
+	}
 	if (rc < 0)
 		GOTO(out_lock, rc);
 
@@ -2242,8 +2486,13 @@ skip_transfer:
 	}
 
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, rc);
+	if (objcount > 1)
+		rc = tgt_brw_write_commit(tsi, &repbody->oa, objcount, ioo,
+					  remote_nb, local_nb, objpages, rc);
+	else
+		rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp,
+				  &repbody->oa, objcount, ioo, remote_nb,
+				  npages, local_nb, rc);
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2284,6 +2533,8 @@ out_lock:
 	tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PW);
 	if (desc)
 		ptlrpc_free_bulk(desc);
+	if (objpages != NULL)
+		OBD_FREE(objpages, objcount * sizeof(*objpages));
 out:
 	if (no_reply) {
 		req->rq_no_reply = 1;
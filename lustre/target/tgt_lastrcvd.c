@@ -71,12 +71,20 @@ static int tgt_bitmap_chunk_alloc(struct lu_target *lut, int chunk)
 	return 0;
 }
 
-/* Look for an available reply data slot in the bitmap
+/* Account a reply data slot which has just been taken */
+static inline void tgt_reply_slot_taken(struct lu_target *lut, int idx)
+{
+	atomic_inc(&lut->lut_reply_slots_used);
+	/* racy, but only used for statistics */
+	if (idx >= lut->lut_reply_slots_high)
+		lut->lut_reply_slots_high = idx + 1;
+}
+
+/* Look for an available reply data slot in the whole bitmap
  * of the target @lut
  * Allocate bitmap chunk when first used
- * XXX algo could be improved if this routine limits performance
  */
-static int tgt_find_free_reply_slot(struct lu_target *lut)
+static int tgt_find_free_reply_slot_any(struct lu_target *lut)
 {
 	unsigned long *bmp;
 	int chunk = 0;
@@ -107,6 +115,90 @@ static int tgt_find_free_reply_slot(struct lu_target *lut)
 	return -ENOSPC;
 }
 
+/* Take a free slot in the group @group of reply data slots
+ * Return the slot index or -ENOSPC if the group is full
+ */
+static int tgt_reply_group_get(struct lu_target *lut, int group)
+{
+	unsigned long *bmp;
+	int chunk = group / LUT_REPLY_GROUPS_PER_CHUNK;
+	int first = (group % LUT_REPLY_GROUPS_PER_CHUNK) *
+		    LUT_REPLY_SLOTS_PER_GROUP;
+	int last = first + LUT_REPLY_SLOTS_PER_GROUP;
+	int rc;
+	int b;
+
+	if (unlikely(lut->lut_reply_bitmap[chunk] == NULL)) {
+		rc = tgt_bitmap_chunk_alloc(lut, chunk);
+		if (rc != 0)
+			return rc;
+	}
+	bmp = lut->lut_reply_bitmap[chunk];
+
+	do {
+		b = find_next_zero_bit(bmp, last, first);
+		if (b >= last)
+			return -ENOSPC;
+
+		if (test_and_set_bit(b, bmp) == 0)
+			return chunk * LUT_REPLY_SLOTS_PER_CHUNK + b;
+	} while (true);
+}
+
+/* Look for an available reply data slot in the bitmap
+ * of the target @lut
+ * The groups of slots of the current CPT are searched first, starting
+ * from the lowest one which may have a free slot, so that concurrent
+ * threads on different CPTs do not contend on the same bitmap words.
+ * Once all of them are full, fall back to the whole bitmap.
+ */
+static int tgt_find_free_reply_slot(struct lu_target *lut)
+{
+	struct tgt_reply_slot_cpt *rsc;
+	int ncpt;
+	int start;
+	int group;
+	int scanned = 0;
+	int idx = -ENOSPC;
+
+	if (lut->lut_reply_slot_cpt == NULL) {
+		idx = tgt_find_free_reply_slot_any(lut);
+		goto out;
+	}
+
+	ncpt = cfs_cpt_number(cfs_cpt_table);
+	rsc = lut->lut_reply_slot_cpt[cfs_cpt_current(cfs_cpt_table, 0)];
+
+	spin_lock(&rsc->rsc_lock);
+	start = rsc->rsc_group;
+	spin_unlock(&rsc->rsc_lock);
+
+	for (group = start; group < LUT_REPLY_GROUPS_MAX; group += ncpt) {
+		scanned++;
+		idx = tgt_reply_group_get(lut, group);
+		if (idx != -ENOSPC)
+			break;
+	}
+
+	/* skip the full groups next time, unless a slot was freed in
+	 * a lower group meanwhile, see tgt_clear_reply_slot() */
+	spin_lock(&rsc->rsc_lock);
+	if (rsc->rsc_group == start && group > start)
+		rsc->rsc_group = group;
+	spin_unlock(&rsc->rsc_lock);
+
+	if (idx == -ENOSPC)
+		idx = tgt_find_free_reply_slot_any(lut);
+out:
+	if (idx >= 0) {
+		tgt_reply_slot_taken(lut, idx);
+		if (lut->lut_reply_stats != NULL)
+			lprocfs_counter_add(lut->lut_reply_stats,
+					    LUT_REPLY_STATS_SLOT_SCAN, scanned);
+	}
+	return idx;
+}
+
 /* Mark the reply data slot @idx 'used' in the corresponding bitmap chunk
  * of the target @lut
  * Allocate the bitmap chunk if necessary
@@ -136,6 +228,7 @@ static int tgt_set_reply_slot(struct lu_target *lut, int idx)
 		       tgt_name(lut), idx);
 		return -EALREADY;
 	}
+	tgt_reply_slot_taken(lut, idx);
 
 	return 0;
 }
@@ -143,10 +236,13 @@ static int tgt_set_reply_slot(struct lu_target *lut, int idx)
 
 /* Mark the reply data slot @idx 'unused' in the corresponding bitmap chunk
  * of the target @lut
+ * Let the CPT owning the group of the slot search from this group again
  */
 static int tgt_clear_reply_slot(struct lu_target *lut, int idx)
 {
+	struct tgt_reply_slot_cpt *rsc;
 	int chunk;
+	int group;
 	int b;
 
 	chunk = idx / LUT_REPLY_SLOTS_PER_CHUNK;
@@ -160,10 +256,63 @@ static int tgt_clear_reply_slot(struct lu_target *lut, int idx)
 		       tgt_name(lut), idx);
 		return -EALREADY;
 	}
+	atomic_dec(&lut->lut_reply_slots_used);
+
+	if (lut->lut_reply_slot_cpt != NULL) {
+		group = idx / LUT_REPLY_SLOTS_PER_GROUP;
+		rsc = lut->lut_reply_slot_cpt[group %
+					      cfs_cpt_number(cfs_cpt_table)];
+		spin_lock(&rsc->rsc_lock);
+		if (group < rsc->rsc_group)
+			rsc->rsc_group = group;
+		spin_unlock(&rsc->rsc_lock);
+	}
+
+	return 0;
+}
+
+/* Set up the per-CPT reply slot allocators and the statistics of @lut */
+int tgt_reply_slot_init(struct lu_target *lut)
+{
+	struct tgt_reply_slot_cpt *rsc;
+	int i;
+
+	lut->lut_reply_slot_cpt = cfs_percpt_alloc(cfs_cpt_table,
+						   sizeof(*rsc));
+	if (lut->lut_reply_slot_cpt == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(rsc, i, lut->lut_reply_slot_cpt) {
+		spin_lock_init(&rsc->rsc_lock);
+		rsc->rsc_group = i;
+	}
+	atomic_set(&lut->lut_reply_slots_used, 0);
+	lut->lut_reply_slots_high = 0;
+
+	lut->lut_reply_stats = lprocfs_alloc_stats(LUT_REPLY_STATS_LAST, 0);
+	if (lut->lut_reply_stats != NULL) {
+		lprocfs_counter_init(lut->lut_reply_stats,
+				     LUT_REPLY_STATS_SLOT_SCAN,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "slot_alloc", "groups");
+		lprocfs_counter_init(lut->lut_reply_stats,
+				     LUT_REPLY_STATS_LOOKUP,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "lookup", "replies");
+	}
 
 	return 0;
 }
 
+void tgt_reply_slot_fini(struct lu_target *lut)
+{
+	if (lut->lut_reply_slot_cpt != NULL) {
+		cfs_percpt_free(lut->lut_reply_slot_cpt);
+		lut->lut_reply_slot_cpt = NULL;
+	}
+	if (lut->lut_reply_stats != NULL)
+		lprocfs_free_stats(&lut->lut_reply_stats);
+}
 
 /* Read header of reply_data file of target @tgt into structure @lrh */
 static int tgt_reply_header_read(const struct lu_env *env,
@@ -1946,17 +2095,26 @@ out:
 struct tg_reply_data *tgt_lookup_reply_by_xid(struct tg_export_data *ted,
 					      __u64 xid)
 {
+	struct lu_target	*lut;
 	struct tg_reply_data	*found = NULL;
 	struct tg_reply_data	*reply;
+	int			 scanned = 0;
 
 	mutex_lock(&ted->ted_lcd_lock);
 	list_for_each_entry(reply, &ted->ted_reply_list, trd_list) {
+		scanned++;
 		if (reply->trd_reply.lrd_xid == xid) {
 			found = reply;
 			break;
 		}
 	}
 	mutex_unlock(&ted->ted_lcd_lock);
+
+	lut = class_exp2tgt(container_of(ted, struct obd_export,
+					 exp_target_data));
+	if (lut != NULL && lut->lut_reply_stats != NULL)
+		lprocfs_counter_add(lut->lut_reply_stats,
+				    LUT_REPLY_STATS_LOOKUP, scanned);
 	return found;
 }
 EXPORT_SYMBOL(tgt_lookup_reply_by_xid);
@@ -167,6 +167,8 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	atomic_set(&lut->lut_client_generation, 0);
 	lut->lut_reply_data = NULL;
 	lut->lut_reply_bitmap = NULL;
+	lut->lut_reply_slot_cpt = NULL;
+	lut->lut_reply_stats = NULL;
 	obd->u.obt.obt_lut = lut;
 	obd->u.obt.obt_magic = OBT_MAGIC;
 
@@ -249,6 +251,10 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	}
 	lut->lut_reply_data = o;
 
+	rc = tgt_reply_slot_init(lut);
+	if (rc < 0)
+		GOTO(out, rc);
+
 	rc = tgt_reply_data_init(env, lut);
 	if (rc < 0)
 		GOTO(out, rc);
@@ -276,6 +282,7 @@ out_put:
 		OBD_FREE(lut->lut_reply_bitmap,
 			 LUT_REPLY_SLOTS_MAX_CHUNKS * sizeof(unsigned long *));
 	lut->lut_reply_bitmap = NULL;
+	tgt_reply_slot_fini(lut);
 	return rc;
 }
 EXPORT_SYMBOL(tgt_init);
@@ -315,6 +322,7 @@ void tgt_fini(const struct lu_env *env, struct lu_target *lut)
 			 LUT_REPLY_SLOTS_MAX_CHUNKS * sizeof(unsigned long *));
 	}
 	lut->lut_reply_bitmap = NULL;
+	tgt_reply_slot_fini(lut);
 	if (lut->lut_client_bitmap) {
 		OBD_FREE(lut->lut_client_bitmap, LR_MAX_CLIENTS >> 3);
 		lut->lut_client_bitmap = NULL;
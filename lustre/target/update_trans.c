@@ -50,6 +50,7 @@
 #define DEBUG_SUBSYSTEM S_CLASS
 
 #include <linux/kthread.h>
+#include <linux/sort.h>
 #include <lu_target.h>
 #include <lustre_log.h>
 #include <lustre_update.h>
@@ -769,6 +770,32 @@ static int prepare_multiple_node_trans(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Account the latency of one phase of a distributed transaction.
+ *
+ * Add the time elapsed since \a start to the \a phase counter of the
+ * distribute transaction stats, then reset \a start to now, so the
+ * following phase is measured from the end of this one.
+ *
+ * \param[in] tmt	top multiple thandle
+ * \param[in] phase	DTX_STATS_* counter
+ * \param[in,out] start	start time of the phase
+ */
+static void top_trans_stats_add(struct top_multiple_thandle *tmt, int phase,
+				struct timeval *start)
+{
+	struct lu_target	*lut;
+	struct timeval		 now;
+
+	do_gettimeofday(&now);
+	lut = dt2lu_dev(tmt->tmt_master_sub_dt)->ld_site->ls_tgt;
+	if (lut != NULL && lut->lut_tdtd != NULL &&
+	    lut->lut_tdtd->tdtd_stats != NULL)
+		lprocfs_counter_add(lut->lut_tdtd->tdtd_stats, phase,
+				    cfs_timeval_sub(&now, start, NULL));
+	*start = now;
+}
+
 /**
  * start the top transaction.
  *
@@ -788,6 +815,7 @@ int top_trans_start(const struct lu_env *env, struct dt_device *master_dev,
 						       tt_super);
 	struct sub_thandle		*st;
 	struct top_multiple_thandle	*tmt = top_th->tt_multiple_thandle;
+	struct timeval			start;
 	int				rc = 0;
 	ENTRY;
 
@@ -802,6 +830,7 @@ int top_trans_start(const struct lu_env *env, struct dt_device *master_dev,
 		RETURN(rc);
 	}
 
+	do_gettimeofday(&start);
 	tmt = top_th->tt_multiple_thandle;
 	rc = prepare_multiple_node_trans(env, tmt);
 	if (rc < 0)
@@ -823,6 +852,7 @@ int top_trans_start(const struct lu_env *env, struct dt_device *master_dev,
 		LASSERT(st->st_started == 0);
 		st->st_started = 1;
 	}
+	top_trans_stats_add(tmt, DTX_STATS_START, &start);
 out:
 	th->th_result = rc;
 	RETURN(rc);
@@ -941,6 +971,7 @@ int top_trans_stop(const struct lu_env *env, struct dt_device *master_dev,
 	struct sub_thandle		*master_st;
 	struct top_multiple_thandle	*tmt;
 	struct thandle_update_records	*tur;
+	struct timeval			start;
 	bool				write_updates = false;
 	int			rc = 0;
 	ENTRY;
@@ -959,6 +990,7 @@ int top_trans_stop(const struct lu_env *env, struct dt_device *master_dev,
 		RETURN(rc);
 	}
 
+	do_gettimeofday(&start);
 	tmt = top_th->tt_multiple_thandle;
 	tur = tmt->tmt_update_records;
 
@@ -1005,6 +1037,7 @@ int top_trans_stop(const struct lu_env *env, struct dt_device *master_dev,
 	}
 
 stop_master_trans:
+	top_trans_stats_add(tmt, DTX_STATS_MASTER_WRITE, &start);
 	/* Step 2: Stop the transaction on the master MDT, and fill the
 	 * master transno in the update logs to other MDT. */
 	if (master_st != NULL && master_st->st_sub_th != NULL) {
@@ -1036,6 +1069,7 @@ stop_master_trans:
 						tgt_th_info(env)->tti_transno;
 		}
 	}
+	top_trans_stats_add(tmt, DTX_STATS_MASTER_STOP, &start);
 
 	/* Step 3: write updates to other MDTs */
 	if (write_updates) {
@@ -1067,6 +1101,7 @@ stop_master_trans:
 	}
 
 stop_other_trans:
+	top_trans_stats_add(tmt, DTX_STATS_REMOTE_WRITE, &start);
 	/* Step 4: Stop the transaction on other MDTs */
 	list_for_each_entry(st, &tmt->tmt_sub_thandle_list, st_sub_list) {
 		if (st == master_st || st->st_sub_th == NULL)
@@ -1085,8 +1120,10 @@ stop_other_trans:
 	}
 
 	rc = top_trans_wait_result(top_th);
+	top_trans_stats_add(tmt, DTX_STATS_REMOTE_STOP, &start);
 
 	tmt->tmt_result = rc;
+	tmt->tmt_stop_time = start;
 
 	/* Balance for the refcount in top_trans_create, Note: if it is NOT
 	 * multiple node transaction, the top transaction will be destroyed. */
@@ -1313,6 +1350,163 @@ static int distribute_txn_cancel_records(const struct lu_env *env,
 	RETURN(0);
 }
 
+/* Max number of records cancelled in one llog transaction */
+#define DTX_CANCEL_BATCH_MAX	256
+
+struct distribute_txn_cancel_ent {
+	struct dt_device	*dce_dt;
+	struct llog_cookie	*dce_cookie;
+};
+
+static int distribute_txn_cancel_cmp(const void *a, const void *b)
+{
+	const struct distribute_txn_cancel_ent *e1 = a;
+	const struct distribute_txn_cancel_ent *e2 = b;
+	int rc;
+
+	if (e1->dce_dt != e2->dce_dt)
+		return e1->dce_dt < e2->dce_dt ? -1 : 1;
+
+	rc = memcmp(&e1->dce_cookie->lgc_lgl, &e2->dce_cookie->lgc_lgl,
+		    sizeof(e1->dce_cookie->lgc_lgl));
+	if (rc != 0)
+		return rc;
+
+	if (e1->dce_cookie->lgc_index == e2->dce_cookie->lgc_index)
+		return 0;
+
+	return e1->dce_cookie->lgc_index < e2->dce_cookie->lgc_index ? -1 : 1;
+}
+
+/**
+ * Cancel update records of a set of committed distribute transactions.
+ *
+ * Cookies of all of the transactions in \a list are sorted by the sub
+ * device and the plain llog holding them, then the records of each plain
+ * llog are cancelled in one transaction by llog_cat_cancel_arr_rec(), so
+ * a commit of many cross-MDT operations costs one update RPC per remote
+ * llog instead of one per record. The transactions are released after
+ * cancellation.
+ *
+ * \param[in] env	execution environment
+ * \param[in] tdtd	distribute transaction data
+ * \param[in] list	committed top_multiple_thandle's, linked by
+ *			tmt_commit_list
+ */
+static void distribute_txn_cancel_batch(const struct lu_env *env,
+				struct target_distribute_txn_data *tdtd,
+				struct list_head *list)
+{
+	struct distribute_txn_cancel_ent *ents = NULL;
+	struct top_multiple_thandle	*tmt;
+	struct top_multiple_thandle	*tmp;
+	struct sub_thandle		*st;
+	struct sub_thandle_cookie	*stc;
+	struct timeval			 now;
+	int				*index = NULL;
+	int				 total = 0;
+	int				 i = 0;
+	int				 j;
+	ENTRY;
+
+	do_gettimeofday(&now);
+	list_for_each_entry(tmt, list, tmt_commit_list) {
+		if (tmt->tmt_result > 0)
+			continue;
+
+		if (tdtd->tdtd_stats != NULL && tmt->tmt_stop_time.tv_sec != 0)
+			lprocfs_counter_add(tdtd->tdtd_stats, DTX_STATS_COMMIT,
+				cfs_timeval_sub(&now, &tmt->tmt_stop_time,
+						NULL));
+
+		list_for_each_entry(st, &tmt->tmt_sub_thandle_list,
+				    st_sub_list)
+			list_for_each_entry(stc, &st->st_cookie_list, stc_list)
+				if (!fid_is_zero(
+					&stc->stc_cookie.lgc_lgl.lgl_oi.oi_fid))
+					total++;
+	}
+
+	if (total == 0)
+		GOTO(out, 0);
+
+	OBD_ALLOC_LARGE(ents, total * sizeof(*ents));
+	if (ents != NULL)
+		OBD_ALLOC(index, min(total, DTX_CANCEL_BATCH_MAX) *
+				 sizeof(*index));
+	if (index == NULL) {
+		/* fall back to cancel the records one by one */
+		list_for_each_entry(tmt, list, tmt_commit_list)
+			if (tmt->tmt_result <= 0)
+				distribute_txn_cancel_records(env, tmt);
+		GOTO(out, 0);
+	}
+
+	list_for_each_entry(tmt, list, tmt_commit_list) {
+		if (tmt->tmt_result > 0)
+			continue;
+
+		top_multiple_thandle_dump(tmt, D_INFO);
+		list_for_each_entry(st, &tmt->tmt_sub_thandle_list,
+				    st_sub_list) {
+			list_for_each_entry(stc, &st->st_cookie_list,
+					    stc_list) {
+				if (fid_is_zero(
+				       &stc->stc_cookie.lgc_lgl.lgl_oi.oi_fid))
+					continue;
+				ents[i].dce_dt = st->st_dt;
+				ents[i].dce_cookie = &stc->stc_cookie;
+				i++;
+			}
+		}
+	}
+	LASSERT(i == total);
+
+	sort(ents, total, sizeof(*ents), distribute_txn_cancel_cmp, NULL);
+
+	for (i = 0; i < total; i = j) {
+		struct llog_cookie	*cookie = ents[i].dce_cookie;
+		struct obd_device	*obd;
+		struct llog_ctxt	*ctxt;
+		int			 count = 0;
+		int			 rc;
+
+		for (j = i; j < total && count < DTX_CANCEL_BATCH_MAX; j++) {
+			if (ents[j].dce_dt != ents[i].dce_dt ||
+			    memcmp(&ents[j].dce_cookie->lgc_lgl,
+				   &cookie->lgc_lgl, sizeof(cookie->lgc_lgl)))
+				break;
+			index[count++] = ents[j].dce_cookie->lgc_index;
+		}
+
+		obd = ents[i].dce_dt->dd_lu_dev.ld_obd;
+		ctxt = llog_get_context(obd, LLOG_UPDATELOG_ORIG_CTXT);
+		if (ctxt == NULL)
+			continue;
+
+		rc = llog_cat_cancel_arr_rec(env, ctxt->loc_handle,
+					     &cookie->lgc_lgl, count, index);
+		CDEBUG(D_HA, "%s: cancel %d update log records in "DOSTID
+		       " : rc = %d\n", obd->obd_name, count,
+		       POSTID(&cookie->lgc_lgl.lgl_oi), rc);
+		if (tdtd->tdtd_stats != NULL)
+			lprocfs_counter_add(tdtd->tdtd_stats,
+					    DTX_STATS_CANCEL_BATCH, count);
+		llog_ctxt_put(ctxt);
+	}
+
+	OBD_FREE(index, min(total, DTX_CANCEL_BATCH_MAX) * sizeof(*index));
+out:
+	if (ents != NULL)
+		OBD_FREE_LARGE(ents, total * sizeof(*ents));
+
+	list_for_each_entry_safe(tmt, tmp, list, tmt_commit_list) {
+		list_del_init(&tmt->tmt_commit_list);
+		top_multiple_thandle_put(tmt);
+	}
+	EXIT;
+}
+
 /**
  * Check if there are committed transaction
  *
@@ -1549,6 +1743,7 @@ static int distribute_txn_commit_thread(void *_arg)
 	struct l_wait_info	 lwi = { 0 };
 	struct lu_env		 env;
 	struct list_head	 list;
+	struct list_head	 cancel;
 	int			 rc;
 	struct top_multiple_thandle *tmt;
 	struct top_multiple_thandle *tmp;
@@ -1565,6 +1760,7 @@ static int distribute_txn_commit_thread(void *_arg)
 	spin_unlock(&tdtd->tdtd_batchid_lock);
 	wake_up(&thread->t_ctl_waitq);
 	INIT_LIST_HEAD(&list);
+	INIT_LIST_HEAD(&cancel);
 
 	CDEBUG(D_HA, "%s: start commit thread committed batchid "LPU64"\n",
 	       tdtd->tdtd_lut->lut_obd->obd_name,
@@ -1631,11 +1827,10 @@ static int distribute_txn_commit_thread(void *_arg)
 		list_for_each_entry_safe(tmt, tmp, &list, tmt_commit_list) {
 			if (tmt->tmt_batchid > committed)
 				break;
-			list_del_init(&tmt->tmt_commit_list);
-			if (tmt->tmt_result <= 0)
-				distribute_txn_cancel_records(&env, tmt);
-			top_multiple_thandle_put(tmt);
+			list_move_tail(&tmt->tmt_commit_list, &cancel);
 		}
+		if (!list_empty(&cancel))
+			distribute_txn_cancel_batch(&env, tdtd, &cancel);
 
 		l_wait_event(tdtd->tdtd_commit_thread_waitq,
 			     !distribute_txn_commit_thread_running(lut) ||
@@ -1667,6 +1862,65 @@ static int distribute_txn_commit_thread(void *_arg)
 	RETURN(0);
 }
 
+static const char * const distribute_txn_stats_names[DTX_STATS_LAST] = {
+	[DTX_STATS_START]	 = "start",
+	[DTX_STATS_MASTER_WRITE] = "master_write",
+	[DTX_STATS_MASTER_STOP]	 = "master_stop",
+	[DTX_STATS_REMOTE_WRITE] = "remote_write",
+	[DTX_STATS_REMOTE_STOP]	 = "remote_stop",
+	[DTX_STATS_COMMIT]	 = "commit_cancel",
+	[DTX_STATS_CANCEL_BATCH] = "cancel_batch",
+};
+
+/**
+ * Set up the latency stats of distribute transactions.
+ *
+ * The stats are registered as "dtx_stats" under the proc directory of
+ * the target. Failure is not fatal, the stats are just not collected.
+ *
+ * \param[in] tdtd	distribute transaction data
+ */
+static void distribute_txn_stats_init(struct target_distribute_txn_data *tdtd)
+{
+	struct obd_device	*obd = tdtd->tdtd_lut->lut_obd;
+	int			 i;
+	int			 rc;
+
+	tdtd->tdtd_stats = lprocfs_alloc_stats(DTX_STATS_LAST, 0);
+	if (tdtd->tdtd_stats == NULL)
+		return;
+
+	for (i = 0; i < DTX_STATS_LAST; i++)
+		lprocfs_counter_init(tdtd->tdtd_stats, i,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     distribute_txn_stats_names[i],
+				     i == DTX_STATS_CANCEL_BATCH ?
+				     "reqs" : "usec");
+
+	if (obd->obd_proc_entry == NULL)
+		return;
+
+	rc = lprocfs_register_stats(obd->obd_proc_entry, "dtx_stats",
+				    tdtd->tdtd_stats);
+	if (rc != 0) {
+		CWARN("%s: cannot register dtx_stats: rc = %d\n",
+		      obd->obd_name, rc);
+		lprocfs_free_stats(&tdtd->tdtd_stats);
+	}
+}
+
+static void distribute_txn_stats_fini(struct target_distribute_txn_data *tdtd)
+{
+	struct obd_device *obd = tdtd->tdtd_lut->lut_obd;
+
+	if (tdtd->tdtd_stats == NULL)
+		return;
+
+	if (obd->obd_proc_entry != NULL)
+		lprocfs_remove_proc_entry("dtx_stats", obd->obd_proc_entry);
+	lprocfs_free_stats(&tdtd->tdtd_stats);
+}
+
 /**
  * Start llog cancel thread
  *
@@ -1709,10 +1963,14 @@ int distribute_txn_init(const struct lu_env *env,
 	if (rc != 0)
 		RETURN(rc);
 
+	distribute_txn_stats_init(tdtd);
+
 	task = kthread_run(distribute_txn_commit_thread, tdtd, "tdtd-%u",
 			   index);
-	if (IS_ERR(task))
+	if (IS_ERR(task)) {
+		distribute_txn_stats_fini(tdtd);
 		RETURN(PTR_ERR(task));
+	}
 
 	l_wait_event(lut->lut_tdtd_commit_thread.t_ctl_waitq,
 		     distribute_txn_commit_thread_running(lut) ||
@@ -1750,5 +2008,6 @@ void distribute_txn_fini(const struct lu_env *env,
 		lu_object_put(env, &tdtd->tdtd_batchid_obj->do_lu);
 		tdtd->tdtd_batchid_obj = NULL;
 	}
+	distribute_txn_stats_fini(tdtd);
 }
 EXPORT_SYMBOL(distribute_txn_fini);
@@ -48,6 +48,8 @@
 #include <assert.h>
 
 #include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 
 #ifdef HAVE_ENDIAN_H
 #include <endian.h>
@@ -93,7 +95,7 @@ enum iam_ioctl_cmd {
 
 static void usage(void)
 {
-        printf("usage: iam_ut [-v] [-h] file\n");
+        printf("usage: iam_ut [-v] [-h] [-N nr] [-t threads] file\n");
 }
 
 static int doop(int fd, const void *key, const void *rec,
@@ -179,7 +181,8 @@ enum op {
         OP_DELETE,
         OP_IT_START,
         OP_IT_NEXT,
-        OP_IT_STOP
+        OP_IT_STOP,
+        OP_STRESS
 };
 
 unsigned char hex2dec(unsigned char hex)
@@ -209,6 +212,75 @@ unsigned char *packdigit(unsigned char *number)
         return area;
 }
 
+/*
+ * Run @threads processes inserting and then looking up @N keys each, all
+ * in the same container, and report the rate of operations. As every
+ * operation takes the htree locks of the blocks on its path, this
+ * measures the throughput of the container lock table under contention.
+ */
+static int stress(int threads, int N, int keysize, int recsize)
+{
+        struct timeval start;
+        struct timeval end;
+        double usec;
+        char *key;
+        char *rec;
+        pid_t pid;
+        int failed = 0;
+        int status;
+        int rc;
+        int t;
+        int i;
+
+        gettimeofday(&start, NULL);
+        for (t = 0; t < threads; ++t) {
+                pid = fork();
+
+                if (pid < 0) {
+                        fprintf(stderr, "fork: %m\n");
+                        failed++;
+                        break;
+                }
+                if (pid > 0)
+                        continue;
+
+                key = calloc(keysize + 1, sizeof key[0]);
+                rec = calloc(recsize + 1, sizeof rec[0]);
+                if (key == NULL || rec == NULL)
+                        exit(1);
+                for (i = 0; i < N; ++i) {
+                        memset(key, 0, keysize + 1);
+                        memset(rec, 0, recsize + 1);
+                        snprintf(key, keysize + 1, "s%x-%x", t, i);
+                        snprintf(rec, recsize + 1, "r%x-%x", t, i);
+                        if (insert(0, key, rec) != 0)
+                                exit(1);
+                }
+                for (i = 0; i < N; ++i) {
+                        memset(key, 0, keysize + 1);
+                        snprintf(key, keysize + 1, "s%x-%x", t, i);
+                        if (lookup(0, key, rec) != 0)
+                                exit(1);
+                }
+                exit(0);
+        }
+
+        while ((rc = wait(&status)) > 0) {
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                        failed++;
+        }
+        gettimeofday(&end, NULL);
+
+        usec = (end.tv_sec - start.tv_sec) * 1000000.0 +
+               (end.tv_usec - start.tv_usec);
+        printf("threads: %i, ops: %i, usec: %.0f, ops/sec: %.0f\n",
+               threads, threads * N * 2, usec,
+               usec > 0 ? threads * N * 2 * 1000000.0 / usec : 0);
+        if (failed)
+                fprintf(stderr, "%i stress workers failed\n", failed);
+        return failed ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
         int i;
@@ -221,6 +293,7 @@ int main(int argc, char **argv)
         int doinit = 1;
         int keynul = 1;
         int recnul = 1;
+        int threads = 0;
 
         void *(*copier)(void *, void *, size_t);
 
@@ -243,7 +316,7 @@ int main(int argc, char **argv)
         op = OP_TEST;
 
         do {
-                opt = getopt(argc, argv, "vilk:K:N:r:R:dsSnP:");
+                opt = getopt(argc, argv, "vilk:K:N:r:R:dsSnP:t:");
                 switch (opt) {
                 case 'v':
                         verbose++;
@@ -259,6 +332,10 @@ int main(int argc, char **argv)
                 case 'N':
                         N = atoi(optarg);
                         break;
+                case 't':
+                        threads = atoi(optarg);
+                        op = OP_STRESS;
+                        break;
                 case 'R':
                         rec_opt = packdigit(optarg);
                         recnul = 0;
@@ -347,7 +424,10 @@ int main(int argc, char **argv)
                 rec_opt = NULL;
         }
 
-        if (op == OP_INSERT) {
+        if (op == OP_STRESS) {
+                rc = stress(threads, N, keysize, recsize);
+                goto out;
+        } else if (op == OP_INSERT) {
                 rc = doop(0, key, rec, IAM_IOC_INSERT, "IAM_IOC_INSERT");
                 goto out;
         } else if (op == OP_DELETE) {
@@ -9566,6 +9566,111 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+test_134c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	mkdir -p $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local limit=$(do_facet mds1 $LCTL get_param -n \
+			ldlm.lock_limit_per_export)
+	[ -n "$limit" ] ||
+		{ skip "no per-export lock limit on server"; return 0; }
+	local max=200
+	local nr=1000
+	local held
+	local lck_cnt
+
+	do_facet mds1 $LCTL set_param ldlm.lock_limit_per_export=$max
+	createmany -o $DIR/$tdir/f $nr
+	local rc=$?
+
+	echo "sleep 5 seconds ..."
+	sleep 5
+	lck_cnt=$($LCTL get_param -n $nsdir.lock_count)
+	held=$(do_facet mds1 $LCTL get_param -n \
+		mdt.$FSNAME-MDT0000.exports.*.lock_count |
+		awk '{ if ($2 > max) max = $2 } END { print max + 0 }')
+	do_facet mds1 $LCTL set_param ldlm.lock_limit_per_export=$limit
+	[ $rc -eq 0 ] || error "failed to create $nr files in $DIR/$tdir"
+	echo "client holds $lck_cnt locks, heaviest export $held"
+
+	[ $held -le $((max * 2)) ] ||
+		error "export holds $held locks, limit $max"
+	[ $lck_cnt -le $((max * 2)) ] ||
+		error "client holds $lck_cnt locks, limit $max"
+
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 134c "Server revokes locks of a client over lock_limit_per_export"
+
+test_134d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	local flags2=$($LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		awk '/flags2:/ { print $2; exit }')
+	[ -n "$flags2" ] && (( flags2 & 0x0004000000000000 )) ||
+		{ skip "no batched blocking AST support"; return 0; }
+	local limit=$(do_facet mds1 $LCTL get_param -n \
+			ldlm.lock_limit_per_export)
+	[ -n "$limit" ] ||
+		{ skip "no per-export lock limit on server"; return 0; }
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local batches="ldlm.namespaces.mdt-$FSNAME-MDT0000_UUID.bl_ast_batches"
+	local max=100
+	local nr=2000
+	local evict=$($LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.state |
+		grep -c EVICTED)
+	local lck_cnt
+	local fail_loc
+	local before
+	local after
+	local rc
+
+	# the second pass cancels a lock of each batch on the client
+	# just before the blocking AST reaches it, the third one keeps
+	# LRU cancel lists marked but not cancelled while ASTs arrive
+	#define OBD_FAIL_LDLM_BL_BATCH_RACE	 0x329
+	#define OBD_FAIL_LDLM_LRU_CANCEL_PAUSE	 0x32a
+	for fail_loc in 0 0x329 0x32a; do
+		mkdir -p $DIR/$tdir || error "failed to create $DIR/$tdir"
+		cancel_lru_locks mdc
+
+		[ $fail_loc == 0x32a ] &&
+			$LCTL set_param $nsdir.lru_size=$((max / 2))
+		before=$(do_facet mds1 $LCTL get_param -n $batches)
+		$LCTL set_param fail_loc=$fail_loc
+		do_facet mds1 $LCTL set_param ldlm.lock_limit_per_export=$max
+		createmany -o $DIR/$tdir/f $nr
+		rc=$?
+		sleep 5
+		lck_cnt=$($LCTL get_param -n $nsdir.lock_count)
+		after=$(do_facet mds1 $LCTL get_param -n $batches)
+		do_facet mds1 $LCTL set_param \
+			ldlm.lock_limit_per_export=$limit
+		$LCTL set_param fail_loc=0
+		[ $fail_loc == 0x32a ] && lru_resize_enable mdc
+		[ $rc -eq 0 ] ||
+			error "failed to create $nr files in $DIR/$tdir"
+		echo "fail_loc=$fail_loc: client holds $lck_cnt locks," \
+			"$((after - before)) batched blocking ASTs"
+		[ $after -gt $before ] ||
+			error "no batched blocking AST sent"
+
+		[ $lck_cnt -le $((max * 2)) ] ||
+			error "client holds $lck_cnt locks, limit $max"
+		[ $($LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.state |
+			grep -c EVICTED) -eq $evict ] ||
+			error "client evicted during batched lock revoke"
+
+		unlinkmany $DIR/$tdir/f $nr
+		rm -rf $DIR/$tdir
+	done
+}
+run_test 134d "Batched blocking AST revokes many locks of one client"
+
 test_140() { #bug-17379
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
         test_mkdir -p $DIR/$tdir || error "Creating dir $DIR/$tdir"
@@ -14435,6 +14540,826 @@ test_402() {
 }
 run_test 402 "Return ENOENT to lod_generate_and_set_lovea"
 
+test_403() {
+	local param=/sys/module/ptlrpc/parameters/ptlrpcd_steal_threshold
+	local ncpts=$($LCTL get_param -n ptlrpcd_stats |
+		awk 'NR > 1 && $1 != "ptlrpcd_rcv" { print $2 }' | sort -u |
+		wc -l)
+
+	[ $ncpts -gt 1 ] || { skip "ptlrpcd threads run in one CPT"; return; }
+	[ -w $param ] || { skip "no ptlrpcd_steal_threshold"; return; }
+	which taskset > /dev/null 2>&1 || { skip "no taskset"; return; }
+
+	local threshold=$(cat $param)
+	local before=$($LCTL get_param -n ptlrpcd_stats |
+		awk 'NR > 1 { sum += $6 } END { print sum + 0 }')
+	local after
+	local i
+
+	# queue many RPCs from one CPU, so that only one CPT gets them
+	echo 1 > $param
+	$LFS setstripe -c -1 $DIR/$tfile || error "setstripe failed"
+	for i in $(seq 8); do
+		taskset -c 0 dd if=/dev/zero of=$DIR/$tfile bs=64k count=256 \
+			seek=$((i * 256)) conv=notrunc oflag=direct &
+	done
+	wait
+	echo $threshold > $param
+	$LCTL get_param -n ptlrpcd_stats
+
+	after=$($LCTL get_param -n ptlrpcd_stats |
+		awk 'NR > 1 { sum += $6 } END { print sum + 0 }')
+	[ $after -gt $before ] ||
+		error "no RPCs stolen across CPTs: $before -> $after"
+}
+run_test 403 "idle ptlrpcd threads steal RPCs queued on another CPT"
+
+test_404() {
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 conv=fsync ||
+		error "dd to $DIR/$tfile failed"
+	clear_osc_stats
+
+	# data is already on disk, a second fsync must not need an RPC
+	$MULTIOP $DIR/$tfile oy_c || error "fsync $DIR/$tfile failed"
+	local skipped=$(calc_osc_stats skipped_sync)
+	[ $skipped -eq 1 ] || error "fsync sent OST_SYNC, skipped $skipped"
+
+	# a truncate is not tracked by transno and needs OST_SYNC again
+	$TRUNCATE $DIR/$tfile 4096 || error "truncate $DIR/$tfile failed"
+	$MULTIOP $DIR/$tfile oy_c || error "fsync $DIR/$tfile failed"
+	skipped=$(calc_osc_stats skipped_sync)
+	[ $skipped -eq 1 ] || error "fsync after truncate skipped OST_SYNC"
+
+	# a committed truncate needs no OST_SYNC, the glimpse reply brings
+	# the committed transno back to the client
+	$TRUNCATE $DIR/$tfile 8192 || error "truncate $DIR/$tfile failed"
+	do_facet ost1 "$LCTL set_param -n osd*.*OST*.force_sync=1"
+	cancel_lru_locks osc
+	stat $DIR/$tfile > /dev/null || error "stat $DIR/$tfile failed"
+	$MULTIOP $DIR/$tfile oy_c || error "fsync $DIR/$tfile failed"
+	skipped=$(calc_osc_stats skipped_sync)
+	[ $skipped -eq 2 ] || error "fsync sent OST_SYNC after commit"
+}
+run_test 404 "fsync skips OST_SYNC when all changes are committed"
+
+test_405() {
+	local param=obdfilter.$FSNAME-OST0000.object_prefetch
+	local queued
+
+	do_facet ost1 $LCTL get_param -n $param ||
+		{ skip "no object prefetch on OST" && return; }
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	queued=$(do_facet ost1 $LCTL get_param -n $param |
+		 awk '/^queued:/ { print $2 }')
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd to $DIR/$tfile failed"
+
+	local after=$(do_facet ost1 $LCTL get_param -n $param |
+		      awk '/^queued:/ { print $2 }')
+	[ $after -gt $queued ] || error "no object queued ($queued/$after)"
+
+	do_facet ost1 $LCTL set_param $param=0
+	queued=$after
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd to $DIR/$tfile failed"
+	after=$(do_facet ost1 $LCTL get_param -n $param |
+		awk '/^queued:/ { print $2 }')
+	do_facet ost1 $LCTL set_param $param=1
+	[ $after -eq $queued ] || error "object queued with prefetch disabled"
+}
+run_test 405 "OFD object prefetch on BRW arrival"
+
+test_406() {
+	local param=obdfilter.$FSNAME-OST0000
+	local shards
+	local total
+
+	do_facet ost1 $LCTL get_param -n $param.grant_shards ||
+		{ skip "no grant shards on OST" && return; }
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 ||
+		error "dd to $DIR/$tfile failed"
+	sync
+
+	# granted space is moved between shards but never lost
+	shards=$(do_facet ost1 $LCTL get_param -n $param.grant_shards |
+		 awk 'NR > 1 { sum += $3 } END { print sum }')
+	total=$(do_facet ost1 $LCTL get_param -n $param.tot_granted)
+	[ $shards -eq $total ] ||
+		error "grant shards $shards != tot_granted $total"
+	rm -f $DIR/$tfile
+}
+run_test 406 "OFD per-CPT grant shards sum to tot_granted"
+
+test_407() {
+	local mdtosc=$(get_mdtosc_proc_path mds1 $FSNAME-OST0000)
+	local param=osc.$mdtosc.prealloc_wait_stats
+	local before
+	local after
+
+	do_facet mds1 $LCTL get_param -n $param ||
+		{ skip "no precreate wait stats on MDS" && return; }
+
+	test_mkdir -c1 $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	before=$(do_facet mds1 $LCTL get_param -n $param |
+		 awk '/^reserved:/ { print $2 }')
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+	after=$(do_facet mds1 $LCTL get_param -n $param |
+		awk '/^reserved:/ { print $2 }')
+	do_facet mds1 $LCTL get_param -n $param
+
+	[ $((after - before)) -ge 1000 ] ||
+		error "only $((after - before)) objects reserved"
+	unlinkmany $DIR/$tdir/f 1000 || error "unlinkmany failed"
+}
+run_test 407 "OSP precreate rate estimation and wait stats"
+
+test_408() {
+	[ $(facet_fstype $SINGLEMDS) != ldiskfs ] &&
+		skip "ldiskfs only test" && return
+
+	local param=osd-ldiskfs.$FSNAME-MDT0000
+	local policy
+	local before
+	local after
+
+	do_facet mds1 $LCTL get_param -n $param.inode_alloc_groups ||
+		{ skip "no inode allocation groups on MDT" && return; }
+
+	policy=$(do_facet mds1 $LCTL get_param -n $param.inode_alloc_policy)
+	do_facet mds1 $LCTL set_param $param.inode_alloc_policy=1
+	before=$(do_facet mds1 $LCTL get_param -n $param.inode_alloc_groups |
+		 awk 'NR > 1 { sum += $5 } END { print sum }')
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 2000 || error "createmany failed"
+
+	after=$(do_facet mds1 $LCTL get_param -n $param.inode_alloc_groups |
+		awk 'NR > 1 { sum += $5 } END { print sum }')
+	do_facet mds1 $LCTL set_param $param.inode_alloc_policy=$policy
+	do_facet mds1 $LCTL get_param -n $param.inode_alloc_groups
+
+	[ $after -gt $before ] || error "no inodes allocated with a goal"
+	unlinkmany $DIR/$tdir/f 2000 || error "unlinkmany failed"
+}
+run_test 408 "osd-ldiskfs per-CPT inode allocation groups"
+
+test_409() {
+	local mdc=$($LCTL dl | awk '/ mdc / && /-MDT0000-/ { print $4 }')
+	local nfiles=10000
+	local rpcs
+	local count
+
+	$LCTL get_param -n mdc.$mdc.readdir_ahead ||
+		{ skip "no readdir readahead on client" && return; }
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	createmany -m $DIR/$tdir/f $nfiles || error "createmany failed"
+
+	cancel_lru_locks mdc
+	$LCTL set_param mdc.$mdc.readdir_ahead=1
+	count=$(ls -f $DIR/$tdir | wc -l)
+	$LCTL get_param mdc.$mdc.readdir_ahead
+	rpcs=$($LCTL get_param -n mdc.$mdc.readdir_ahead |
+	       awk '/rpcs:/ { print $2 }')
+
+	[ $count -eq $((nfiles + 2)) ] ||
+		error "found $count entries, expected $((nfiles + 2))"
+	[ $rpcs -gt 0 ] || error "no directory pages were read ahead"
+
+	# disabled readahead lists the same entries
+	cancel_lru_locks mdc
+	$LCTL set_param mdc.$mdc.readdir_ahead=0
+	count=$(ls -f $DIR/$tdir | wc -l)
+	$LCTL set_param mdc.$mdc.readdir_ahead=1
+	[ $count -eq $((nfiles + 2)) ] ||
+		error "found $count entries without readahead"
+
+	unlinkmany $DIR/$tdir/f $nfiles || error "unlinkmany failed"
+}
+run_test 409 "mdc readdir readahead"
+
+test_410() {
+	[ $(facet_fstype $SINGLEMDS) != ldiskfs ] &&
+		skip "ldiskfs only test" && return
+
+	local param=osd-ldiskfs.$FSNAME-MDT0000.oi_cache
+	local before
+	local after
+
+	do_facet mds1 $LCTL get_param -n $param | grep -q hits ||
+		{ skip "OI cache disabled on MDT" && return; }
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+
+	before=$(do_facet mds1 $LCTL get_param -n $param |
+		 awk 'NR > 1 { sum += $3 } END { print sum }')
+	# shrink the object cache so the FIDs are looked up in the OI again
+	cancel_lru_locks mdc
+	do_facet mds1 "echo 3 > /proc/sys/vm/drop_caches"
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	after=$(do_facet mds1 $LCTL get_param -n $param |
+		awk 'NR > 1 { sum += $3 } END { print sum }')
+	do_facet mds1 $LCTL get_param -n $param
+
+	[ $after -gt $before ] || error "no OI cache hits"
+	unlinkmany $DIR/$tdir/f 1000 || error "unlinkmany failed"
+	# the removed FIDs are not found anymore
+	$CHECKSTAT -a $DIR/$tdir/f0 || error "$DIR/$tdir/f0 still exists"
+}
+run_test 410 "osd-ldiskfs OI lookup cache"
+
+test_411() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_USERS="mdd.$MDT0.changelog_users"
+	local last
+	local fid
+	local nr
+
+	USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_register -n)
+	echo "Registered as changelog user $USER"
+	do_facet $SINGLEMDS $LCTL get_param -n $CL_USERS | grep -q $USER ||
+		error "User $USER not found in changelog_users"
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	test_mkdir -i0 -c1 $DIR/$tdir.2
+	createmany -o $DIR/$tdir/f 100 || error "createmany $tdir failed"
+	createmany -o $DIR/$tdir.2/f 100 || error "createmany $tdir.2 failed"
+	unlinkmany $DIR/$tdir/f 50 || error "unlinkmany failed"
+
+	local all=$TMP/$tfile.all
+	local want=$TMP/$tfile.want
+	local got=$TMP/$tfile.got
+
+	$LFS changelog $MDT0 > $all || error "changelog read failed"
+
+	# the filtered reads return exactly the matching records
+	awk '$2 ~ /CREAT$/' $all > $want
+	$LFS changelog --type=CREAT $MDT0 > $got
+	nr=$(wc -l < $got)
+	[ $nr -ge 200 ] || error "found $nr CREAT records, expected 200"
+	diff $want $got || error "--type=CREAT returned wrong records"
+
+	awk '$2 ~ /UNLNK$/' $all > $want
+	$LFS changelog --type=unlnk $MDT0 > $got
+	nr=$(wc -l < $got)
+	[ $nr -eq 50 ] || error "found $nr UNLNK records, expected 50"
+	diff $want $got || error "--type=unlnk returned wrong records"
+
+	fid=$($LFS path2fid $DIR/$tdir)
+	awk -v p="p=$fid" '$2 ~ /CREAT$/ && index($0, p)' $all > $want
+	$LFS changelog --type=CREAT --fid=$fid $MDT0 > $got
+	nr=$(wc -l < $got)
+	[ $nr -eq 100 ] || error "found $nr CREAT records in $fid, expected 100"
+	diff $want $got || error "--fid=$fid returned wrong records"
+
+	nr=$($LFS changelog --jobid=nosuchjob.0 $MDT0 | wc -l)
+	[ $nr -eq 0 ] || error "found $nr records of a nonexistent job"
+
+	# a later reader starts from the llog of the last record read
+	last=$(tail -1 $all | awk '{ print $1 }')
+	$LFS changelog $MDT0 $last > $got
+	tail -1 $all | diff - $got ||
+		error "reading from $last did not return only record $last"
+	rm -f $all $want $got
+
+	$LFS changelog_clear $MDT0 $USER 0
+	echo "deregistering $USER"
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER
+	rm -rf $DIR/$tdir $DIR/$tdir.2
+}
+run_test 411 "changelog readers filter records by type, FID and jobid"
+
+test_412() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_BUF="mdd.$MDT0.changelog_buffer"
+	local old
+	local nr
+	local i
+
+	old=$(do_facet $SINGLEMDS $LCTL get_param -n $CL_BUF |
+		awk '/flush_ms/ { print $2 }')
+
+	USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_register -n)
+	echo "Registered as changelog user $USER"
+	do_facet $SINGLEMDS $LCTL set_param $CL_BUF=100
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	for i in $(seq 4); do
+		createmany -o $DIR/$tdir/f$i- 200 &
+	done
+	wait
+	sleep 1
+
+	do_facet $SINGLEMDS $LCTL get_param $CL_BUF
+	nr=$($LFS changelog --type=CREAT $MDT0 | grep -c " f[0-9]-")
+	[ $nr -eq 800 ] || error "found $nr CREAT records, expected 800"
+
+	# buffered records are appended in index order
+	$LFS changelog $MDT0 | awk '{ if ($1 <= last) exit 1; last = $1 }' ||
+		error "changelog records out of order"
+
+	nr=$(do_facet $SINGLEMDS $LCTL get_param -n $CL_BUF |
+		awk '/records/ { print $2 }')
+	[ $nr -ge 800 ] || error "only $nr records went through the buffer"
+
+	# with a long flush interval the g* records stay queued, disabling
+	# buffering appends them before the h* records written directly
+	do_facet $SINGLEMDS $LCTL set_param $CL_BUF=60000
+	createmany -o $DIR/$tdir/g 10 || error "createmany g failed"
+	do_facet $SINGLEMDS $LCTL set_param $CL_BUF=0
+	createmany -o $DIR/$tdir/h 10 || error "createmany h failed"
+	nr=$($LFS changelog --type=CREAT $MDT0 | grep -c " g[0-9]")
+	[ $nr -eq 10 ] || error "found $nr CREAT records for g*, expected 10"
+	nr=$($LFS changelog --type=CREAT $MDT0 | grep -c " h[0-9]")
+	[ $nr -eq 10 ] || error "found $nr CREAT records for h*, expected 10"
+	$LFS changelog $MDT0 | awk '{ if ($1 <= last) exit 1; last = $1 }' ||
+		error "changelog records out of order after disabling buffer"
+
+	$LFS changelog_clear $MDT0 $USER 0
+	echo "deregistering $USER"
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER
+	do_facet $SINGLEMDS $LCTL set_param $CL_BUF=$old
+	rm -rf $DIR/$tdir
+}
+run_test 412 "buffered changelog records are appended in order"
+
+test_413a() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local mdtosc=$(get_mdtosc_proc_path $SINGLEMDS $FSNAME-OST0000)
+	local stats="osc.$mdtosc.destroy_stats"
+	local before
+	local after
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/f 500 || error "createmany failed"
+	sync
+
+	before=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/batch_rpcs/ { print $2 }')
+	rm -rf $DIR/$tdir
+	wait_delete_completed
+
+	do_facet $SINGLEMDS $LCTL get_param $stats
+	after=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/batch_rpcs/ { print $2 }')
+	[ $after -gt $before ] ||
+		error "no batched destroy RPCs sent ($before -> $after)"
+}
+run_test 413a "OSP destroys adjacent objects with batched RPCs"
+
+test_413b() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+
+	local mdtosc=$(get_mdtosc_proc_path $SINGLEMDS $FSNAME-OST0000)
+	local stats="osc.$mdtosc.destroy_stats"
+	local before
+	local after
+	local changes
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/f 500 || error "createmany failed"
+	sync
+
+	before=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/batch_rpcs/ { print $2 }')
+	# batched destroys find some of their objects gone already
+	#define OBD_FAIL_OST_DESTROY_ENOENT	 0x235
+	do_facet ost1 $LCTL set_param fail_loc=0x235
+	rm -rf $DIR/$tdir
+	wait_delete_completed
+	do_facet ost1 $LCTL set_param fail_loc=0
+
+	do_facet $SINGLEMDS $LCTL get_param $stats
+	after=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/batch_rpcs/ { print $2 }')
+	[ $after -gt $before ] ||
+		error "no batched destroy RPCs sent ($before -> $after)"
+
+	changes=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		osc.$mdtosc.sync_changes osc.$mdtosc.sync_in_flight \
+		osc.$mdtosc.sync_in_progress | calc_sum)
+	[ $changes -eq 0 ] || error "$changes destroys not cancelled"
+}
+run_test 413b "partly failed batched destroys cancel their llog records"
+
+test_413c() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+
+	local mdtosc=$(get_mdtosc_proc_path $SINGLEMDS $FSNAME-OST0000)
+	local stats="osc.$mdtosc.destroy_stats"
+	local before
+	local after
+	local kept
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/f 500 || error "createmany failed"
+	sync
+
+	before=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/^destroyed/ { print $2 }')
+	# a batched destroy fails in the middle of its range
+	#define OBD_FAIL_OST_DESTROY_PARTIAL	 0x236
+	do_facet ost1 $LCTL set_param fail_loc=0x80000236
+	rm -rf $DIR/$tdir
+	wait_delete_completed
+	do_facet ost1 $LCTL set_param fail_loc=0
+
+	do_facet $SINGLEMDS $LCTL get_param $stats
+	after=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/^destroyed/ { print $2 }')
+	kept=$((500 - (after - before)))
+	[ $kept -gt 0 ] || error "records of failed objects were cancelled"
+
+	# the kept records are processed again after restart
+	fail $SINGLEMDS
+	wait_delete_completed
+	do_facet $SINGLEMDS $LCTL get_param $stats
+	after=$(do_facet $SINGLEMDS $LCTL get_param -n $stats |
+		awk '/^destroyed/ { print $2 }')
+	[ $after -ge $kept ] ||
+		error "only $after of $kept kept destroys done after restart"
+}
+run_test 413c "failed batched destroys keep records of undestroyed objects"
+
+test_414() {
+	[[ $MDSCOUNT -lt 2 ]] && skip "needs >= 2 MDTs" && return
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local stats="mdt.$FSNAME-MDT0000.dtx_stats"
+	local samples
+	local i
+
+	do_facet mds1 $LCTL set_param $stats=clear ||
+		error "cannot clear $stats"
+
+	mkdir -p $DIR/$tdir
+	for i in $(seq 20); do
+		$LFS mkdir -i 1 $DIR/$tdir/remote_dir_$i ||
+			error "create remote dir $i failed"
+	done
+
+	samples=$(do_facet mds1 $LCTL get_param -n $stats |
+		awk '/^remote_stop/ { print $2 }')
+	[ -n "$samples" ] && [ $samples -ge 20 ] ||
+		error "remote_stop not accounted: '$samples'"
+
+	# update logs are cancelled after the batch is committed everywhere
+	do_facet mds1 "lctl set_param -n osd*.*MDT*.force_sync 1"
+	do_facet mds2 "lctl set_param -n osd*.*MDT*.force_sync 1"
+	for i in $(seq 30); do
+		samples=$(do_facet mds1 $LCTL get_param -n $stats |
+			awk '/^cancel_batch/ { print $2 }')
+		[ -n "$samples" ] && break
+		sleep 1
+	done
+	do_facet mds1 $LCTL get_param $stats
+	[ -n "$samples" ] || error "update logs were not cancelled"
+
+	rm -rf $DIR/$tdir || error "rm failed"
+}
+run_test 414 "DNE transaction phase stats and batched log cancel"
+
+test_415() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local param="lod.$FSNAME-MDT0000-mdtlov.qos_bench"
+	local linear
+	local tree
+
+	do_facet $SINGLEMDS $LCTL set_param $param=\"2 4 1\" &&
+		error "more stripes than OSTs should fail"
+	do_facet $SINGLEMDS $LCTL set_param $param=\"65536 2000 100000\" &&
+		error "unbounded benchmark run should fail"
+
+	do_facet $SINGLEMDS $LCTL set_param $param=\"2000 64 50\" ||
+		error "benchmark failed"
+	do_facet $SINGLEMDS $LCTL get_param $param
+
+	[ $(do_facet $SINGLEMDS $LCTL get_param -n $param |
+		awk '/^osts:/ { print $2 }') -eq 2000 ] ||
+		error "benchmark result not saved"
+
+	linear=$(do_facet $SINGLEMDS $LCTL get_param -n $param |
+		awk '/^linear_usec:/ { print $2 }')
+	tree=$(do_facet $SINGLEMDS $LCTL get_param -n $param |
+		awk '/^tree_usec:/ { print $2 }')
+	[ $tree -lt $linear ] ||
+		error "tree selection $tree usec not faster than $linear usec"
+}
+run_test 415 "LOD QoS weighted selection benchmark"
+
+test_416() {
+	local param=mdt.$FSNAME-MDT0000.reply_data_stats
+	local nr=200
+	local used
+	local allocs
+
+	do_facet $SINGLEMDS $LCTL get_param $param ||
+		{ skip "no reply data stats" && return; }
+	do_facet $SINGLEMDS $LCTL set_param $param=clear
+
+	test_mkdir -p $DIR/$tdir
+	for i in $(seq 4); do
+		createmany -o $DIR/$tdir/f$i- $nr > /dev/null &
+	done
+	wait
+	unlinkmany $DIR/$tdir/f1- $nr > /dev/null ||
+		error "unlinkmany failed"
+	do_facet $SINGLEMDS $LCTL get_param $param
+
+	allocs=$(do_facet $SINGLEMDS $LCTL get_param -n $param |
+		awk '/^slot_alloc:/ { print $2 }')
+	[ $allocs -ge $((nr * 4)) ] ||
+		error "only $allocs reply slots allocated for $((nr * 4)) RPCs"
+	used=$(do_facet $SINGLEMDS $LCTL get_param -n $param |
+		awk '/^slots_used:/ { print $2 }')
+	# the last reply of each client tag stays until the next RPC
+	[ $used -gt 0 ] || error "no reply slot in use ($used)"
+	do_facet $SINGLEMDS $LCTL get_param -n $param | grep -q "^lookup:" ||
+		error "missing reply lookup stats"
+}
+run_test 416 "reply data slot allocation stats"
+
+test_417() {
+	local src=$TMP/$tfile.src
+	local inflight
+
+	# a stripe spans several RPCs, so its chunks overlap
+	$LFS setstripe -c -1 -S 16M $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$src bs=1M count=64 ||
+		error "cannot create $src"
+	$LCTL set_param -n llite.*.stats=clear
+
+	dd if=$src of=$DIR/$tfile bs=16M oflag=direct ||
+		error "direct write failed"
+	cancel_lru_locks osc
+	cmp $src $DIR/$tfile || error "direct write data mismatch"
+
+	dd if=$DIR/$tfile of=$TMP/$tfile.dst bs=16M iflag=direct ||
+		error "direct read failed"
+	cmp $src $TMP/$tfile.dst || error "direct read data mismatch"
+
+	$LCTL get_param llite.*.stats | grep dio_
+	[ -n "$($LCTL get_param -n llite.*.stats | grep dio_write)" ] ||
+		error "no direct write stats"
+	[ -n "$($LCTL get_param -n llite.*.stats | grep dio_read)" ] ||
+		error "no direct read stats"
+	inflight=$($LCTL get_param -n llite.*.stats |
+		   awk '/^dio_inflight/ { print $6 }')
+	[ -n "$inflight" ] && [ $inflight -gt 1 ] ||
+		error "direct IO chunks were not pipelined: '$inflight'"
+	rm -f $src $TMP/$tfile.dst
+}
+run_test 417 "pipelined direct IO data and stats"
+
+test_418() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local rc=0
+	local rmmod_local=0
+	local id
+	local pages
+
+	if ! module_loaded obdecho; then
+		load_module obdecho/obdecho
+		rmmod_local=1
+	fi
+
+	local osc=$($LCTL dl | grep -v mdt | awk '$3 == "osc" {print $4; exit}')
+	local host=$(lctl get_param -n osc.$osc.import |
+			     awk '/current_connection:/ {print $2}' )
+	local target=$(lctl get_param -n osc.$osc.import |
+			     awk '/target:/ {print $2}' )
+	target=${target%_UUID}
+
+	[[ -n $target ]] && { setup_obdecho_osc $host $target || rc=1; } || rc=1
+	[ $rc -eq 0 ] && { $LCTL attach echo_client ec ec_uuid || rc=2; }
+	[ $rc -eq 0 ] && { $LCTL --device ec setup ${target}_osc || rc=3; }
+	if [ $rc -eq 0 ]; then
+		id=$($LCTL --device ec create 1 | awk '/object id/ {print $6}')
+		[ -n "$id" ] || rc=4
+	fi
+	[ $rc -eq 0 ] && { $LCTL --device ec test_brw 10 w v 256 $id ||
+			   rc=5; }
+	if [ $rc -eq 0 ]; then
+		$LCTL get_param echo_client.ec.page_stats
+		pages=$($LCTL get_param -n echo_client.ec.page_stats |
+			awk '/^pages/ { print $7 }')
+		[ "$pages" == "2560" ] || rc=6
+		$LCTL get_param -n echo_client.ec.page_stats |
+			grep -q page_setup || rc=7
+		$LCTL --device ec destroy $id 1
+	fi
+	$LCTL --device ec cleanup
+	$LCTL --device ec detach
+	[[ -n $target ]] && cleanup_obdecho_osc $target
+	[ $rmmod_local -eq 1 ] && rmmod obdecho
+	[ $rc -eq 0 ] || error "echo client page stats failed: $rc"
+}
+run_test 418 "CLIO per-page cost through the echo client"
+
+test_419() {
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs" && return
+
+	local file=$DIR/$tfile
+	local saved=$($LCTL get_param -n lov.*-clilov-*.io_fanout | head -n1)
+	local stripes
+
+	$SETSTRIPE -c -1 -S 64k $file || error "setstripe $file failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=8 ||
+		error "dd to $TMP/$tfile failed"
+
+	$LCTL set_param lov.*-clilov-*.io_fanout=2 ||
+		error "set io_fanout failed"
+	# the workers are started once io_fanout is enabled
+	ps -eo comm | grep -q "^lov_io" || error "no lov_io threads"
+	$LCTL set_param lov.*-clilov-*.io_fanout=1 &&
+		error "io_fanout=1 should be rejected"
+
+	dd if=$TMP/$tfile of=$file bs=1M oflag=direct ||
+		error "direct write failed"
+	cancel_lru_locks osc
+	cmp $TMP/$tfile $file || error "data mismatch after direct write"
+	dd if=$file of=/dev/null bs=1M iflag=direct ||
+		error "direct read failed"
+
+	# readahead windows span several stripes and are fanned out
+	$LCTL set_param -n lov.*-clilov-*.io_stats=clear
+	cancel_lru_locks osc
+	cmp $TMP/$tfile $file || error "data mismatch after readahead"
+	$LCTL get_param lov.*-clilov-*.io_stats
+	stripes=$($LCTL get_param -n lov.*-clilov-*.io_stats |
+		  awk '/^submit_fanout/ { sum += $2 } END { print sum + 0 }')
+
+	$LCTL set_param lov.*-clilov-*.io_fanout=$saved
+	rm -f $file $TMP/$tfile
+	[ $stripes -gt 0 ] || error "no readahead submission was fanned out"
+}
+run_test 419 "lov parallel per-stripe submission keeps data intact"
+
+test_420() {
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs" && return
+
+	local file=$DIR/$tfile
+	local saved=$($LCTL get_param -n lov.*-clilov-*.io_fanout | head -n1)
+	local count
+
+	$SETSTRIPE -c -1 -S 64k $file || error "setstripe $file failed"
+	$LCTL set_param lov.*-clilov-*.io_fanout=2 ||
+		error "set io_fanout failed"
+	$LCTL set_param -n lov.*-clilov-*.lock_stats=clear
+
+	cancel_lru_locks osc
+	dd if=/dev/zero of=$file bs=1M count=4 || error "write failed"
+	$LCTL get_param lov.*-clilov-*.lock_stats
+	count=$($LCTL get_param -n lov.*-clilov-*.lock_stats |
+		awk '/^lock_fanout/ { sum += $2 } END { print sum + 0 }')
+	[ $count -gt 0 ] || error "no sub-locks enqueued in parallel"
+
+	# conflicting writers must not deadlock
+	cancel_lru_locks osc
+	dd if=/dev/zero of=$file bs=64k count=64 conv=notrunc &
+	local pid=$!
+	dd if=/dev/zero of=$file bs=64k count=64 conv=notrunc ||
+		error "second writer failed"
+	wait $pid || error "first writer failed"
+
+	$LCTL set_param lov.*-clilov-*.io_fanout=$saved
+	rm -f $file
+}
+run_test 420 "lov parallel sub-lock enqueue"
+
+cleanup_421() {
+	$LCTL set_param -n llite.*.max_cached_mb $CACHE_MAX
+	rm -f $DIR/$tfile.*
+	trap 0
+}
+
+test_421() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	local cache_limit=32
+	local nfiles=4
+	local shrunk
+	local pids=""
+	local pid
+	local i
+
+	$LCTL set_param -n osc.*-osc-[^mM]*.lru_stats=clear
+	trap cleanup_421 EXIT
+	$LCTL set_param -n llite.*.max_cached_mb $cache_limit
+
+	# several writers overrunning the cache from different CPUs
+	for i in $(seq $nfiles); do
+		dd if=/dev/zero of=$DIR/$tfile.$i bs=1M \
+			count=$((cache_limit * 2)) &
+		pids="$pids $!"
+	done
+	for pid in $pids; do
+		wait $pid || error "writer $pid failed"
+	done
+
+	$LCTL get_param osc.*-osc-[^mM]*.lru_stats
+	shrunk=$($LCTL get_param -n osc.*-osc-[^mM]*.lru_stats |
+		 awk '/^async_shrink/ { sum += $7 } END { print sum + 0 }')
+	cleanup_421
+	[ $shrunk -gt 0 ] || error "no pages freed by background LRU work"
+}
+run_test 421 "per-CPT osc LRU with background reclaim"
+
+test_422() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	local nfiles=32
+	local flags2
+	local before
+	local after
+	local i
+
+	flags2=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		 awk '/flags2:/ { print $2 }')
+	[ -n "$flags2" ] && (( flags2 & 0x0001000000000000 )) ||
+		{ skip "server does not support multi-object BRW"; return; }
+
+	test_mkdir $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=4k count=1 ||
+		error "dd to $TMP/$tfile failed"
+
+	sync
+	before=$(count_ost_writes)
+	for i in $(seq $nfiles); do
+		cp $TMP/$tfile $DIR/$tdir/$tfile.$i || error "cp $i failed"
+	done
+	sync
+	after=$(count_ost_writes)
+	echo "$nfiles small files written with $((after - before)) BRWs"
+
+	cancel_lru_locks osc
+	for i in $(seq $nfiles); do
+		cmp $TMP/$tfile $DIR/$tdir/$tfile.$i ||
+			error "$tfile.$i corrupted"
+	done
+	rm -f $TMP/$tfile
+
+	[ $((after - before)) -lt $nfiles ] ||
+		error "$nfiles files needed $((after - before)) write RPCs"
+}
+run_test 422 "small files to one OST share write RPCs"
+
+test_423() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	local nsdir="ldlm.namespaces.$FSNAME-OST0000-osc-[^mM]*"
+	local nr=64
+	local unused
+	local cpt_unused
+	local scans
+
+	cancel_lru_locks osc
+	$LCTL set_param -n $nsdir.lru_stats=clear
+
+	test_mkdir $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+	cat $DIR/$tdir/f* > /dev/null
+
+	# the per-CPT LRUs add up to the namespace count
+	unused=$($LCTL get_param -n $nsdir.lock_unused_count)
+	cpt_unused=$($LCTL get_param -n $nsdir.lru_stats |
+		     awk '/^cpt .* unused locks:/ { sum += $5 }
+			  END { print sum + 0 }')
+	$LCTL get_param $nsdir.lru_stats
+	[ $unused -gt 0 ] || error "no unused locks cached"
+	[ $cpt_unused -eq $unused ] ||
+		error "per-CPT LRUs hold $cpt_unused, namespace $unused"
+
+	$LCTL set_param -n $nsdir.lru_size=clear
+	$LCTL get_param $nsdir.lru_stats
+	scans=$($LCTL get_param -n $nsdir.lru_stats |
+		awk '/^locks scanned/ { on = 1; next }
+		     /^$/ { on = 0 }
+		     on && /^[0-9]+:/ { sum += $2 }
+		     END { print sum + 0 }')
+	unlinkmany $DIR/$tdir/f $nr
+	[ $scans -gt 0 ] || error "LRU scans were not accounted"
+}
+run_test 423 "per-CPT ldlm LRU and LRU stats"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
@@ -3567,6 +3567,154 @@ test_92() {
 }
 run_test 92 "create remote directory under orphan directory"
 
+test_93() {
+	local flags2
+	local name
+	local ns
+	local count
+	local sum1
+	local sum2
+
+	flags2=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		 awk '/flags2:/ { print $2; exit }')
+	[ -n "$flags2" ] && (( flags2 & 0x0002000000000000 )) ||
+		{ skip "server does not support extent lock downgrade"; return; }
+
+	name=$($LFS getname $MOUNT1 | cut -d' ' -f1)
+	ns=ldlm.namespaces.$FSNAME-OST0000-osc-${name#$FSNAME-}
+
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+	dd if=/dev/urandom of=$DIR1/$tfile bs=1M count=4 conv=notrunc ||
+		error "dd on $DIR1 failed"
+	count=$($LCTL get_param -n $ns.lock_count)
+	[ $count -eq 1 ] || error "writer holds $count locks, expected 1"
+
+	# the reader only needs the writer to give up write access
+	sum2=$(md5sum < $DIR2/$tfile)
+	count=$($LCTL get_param -n $ns.lock_count)
+	[ $count -eq 1 ] || error "writer lock was cancelled, not downgraded"
+	sum1=$(md5sum < $DIR1/$tfile)
+	[ "$sum1" == "$sum2" ] || error "clients see different data"
+
+	# the downgraded lock must be called back for the next write
+	dd if=/dev/urandom of=$DIR2/$tfile bs=1M count=1 conv=notrunc ||
+		error "dd on $DIR2 failed"
+	sum2=$(md5sum < $DIR2/$tfile)
+	sum1=$(md5sum < $DIR1/$tfile)
+	[ "$sum1" == "$sum2" ] || error "stale data after write on $DIR2"
+}
+run_test 93 "writer lock is downgraded for a reader on another client"
+
+test_94() {
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs" && return
+
+	local saved=$($LCTL get_param -n lov.*-clilov-*.io_fanout | head -n1)
+	local flags2
+	local gen1
+	local gen2
+	local pid1
+	local pid2
+	local timeout
+	local elapsed
+	local i
+
+	flags2=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		 awk '/flags2:/ { print $2; exit }')
+	[ -n "$flags2" ] && (( flags2 & 0x0010000000000000 )) ||
+		{ skip "server does not fail non-blocking enqueues"; return; }
+
+	$LFS setstripe -c -1 -S 64k $DIR1/$tfile || error "setstripe failed"
+	$LCTL set_param lov.*-clilov-*.io_fanout=2 ||
+		error "set io_fanout failed"
+
+	gen1=$($LCTL get_param -n osc.*-osc-[^mM]*.import |
+	       awk '/generation/ { print $2 }')
+	timeout=$(do_facet ost1 $LCTL get_param -n timeout)
+
+	# each writer takes all the stripes of the file at once, in parallel,
+	# while the other one holds some of them
+	for i in $(seq 10); do
+		dd if=/dev/zero of=$DIR1/$tfile bs=1M count=4 conv=notrunc \
+			2>/dev/null &
+		pid1=$!
+		dd if=/dev/zero of=$DIR2/$tfile bs=1M count=4 conv=notrunc \
+			2>/dev/null &
+		pid2=$!
+		elapsed=0
+		while kill -0 $pid1 2>/dev/null || kill -0 $pid2 2>/dev/null; do
+			[ $elapsed -lt $((timeout * 3)) ] ||
+				error "writers deadlocked in round $i"
+			sleep 1
+			elapsed=$((elapsed + 1))
+		done
+		wait $pid1 || error "writer on $DIR1 failed in round $i"
+		wait $pid2 || error "writer on $DIR2 failed in round $i"
+	done
+	$LCTL get_param lov.*-clilov-*.lock_stats
+
+	gen2=$($LCTL get_param -n osc.*-osc-[^mM]*.import |
+	       awk '/generation/ { print $2 }')
+	$LCTL set_param lov.*-clilov-*.io_fanout=$saved
+	[ "$gen1" == "$gen2" ] || error "a client was evicted"
+	rm -f $DIR1/$tfile
+}
+run_test 94 "conflicting parallel sub-lock enqueues do not deadlock"
+
+test_95() {
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+
+	local debug_saved=$(do_facet ost1 $LCTL get_param -n debug)
+	local flags2
+	local nfiles=8
+	local nres
+	local pid
+	local i
+
+	flags2=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		 awk '/flags2:/ { print $2; exit }')
+	[ -n "$flags2" ] && (( flags2 & 0x0001000000000000 )) ||
+		{ skip "server does not support multi-object BRW"; return; }
+
+	mkdir -p $DIR1/$tdir || error "mkdir $DIR1/$tdir failed"
+	$LFS setstripe -c 1 -i 0 $DIR1/$tdir || error "setstripe failed"
+	for i in $(seq $nfiles); do
+		touch $DIR1/$tdir/f$i || error "touch f$i failed"
+	done
+	sync
+	cancel_lru_locks osc
+
+	do_facet ost1 $LCTL set_param debug=+dlmtrace
+	do_facet ost1 $LCTL clear
+	for i in $(seq $nfiles); do
+		dd if=/dev/zero of=$DIR1/$tdir/f$i bs=4k count=1 2>/dev/null ||
+			error "write to f$i failed"
+	done
+
+	# hold the multi-object write on the OST while the other client
+	# reads every file, so the locks of all its objects get revoked
+	#define OBD_FAIL_OST_BRW_PAUSE_BULK	 0x214
+	do_facet ost1 $LCTL set_param fail_val=5 fail_loc=0x80000214
+	sync &
+	pid=$!
+	sleep 1
+	for i in $(seq $nfiles); do
+		cat $DIR2/$tdir/f$i > /dev/null &
+	done
+	wait $pid || error "sync failed"
+	wait
+	do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0
+
+	nres=$(do_facet ost1 $LCTL dk | awk '/refreshed for req/' |
+	       grep -o "res: \[[^]]*\]" | sort -u | wc -l)
+	do_facet ost1 $LCTL set_param debug=\"$debug_saved\"
+	echo "locks of $nres objects prolonged by the write"
+	[ $nres -gt 1 ] ||
+		error "only the first object of the write prolonged its locks"
+	rm -rf $DIR1/$tdir
+}
+run_test 95 "revoked locks of every object of a multi-object BRW are prolonged"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
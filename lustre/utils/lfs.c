@@ -303,8 +303,12 @@ command_t cmdlist[] = {
          "Remote user list directory contents.\n"
          "usage: ls [OPTION]... [FILE]..."},
         {"changelog", lfs_changelog, 0,
-         "Show the metadata changes on an MDT."
-         "\nusage: changelog <mdtname> [startrec [endrec]]"},
+	 "Show the metadata changes on an MDT."
+	 "\nusage: changelog [--type|-t <type>[,...]] [--fid|-F <fid>]\n"
+	 "                 [--jobid|-j <jobid>] <mdtname> [startrec [endrec]]\n"
+	 "\ttype:  only show records of these types, e.g. CREAT,UNLNK\n"
+	 "\tfid:   only show records for this FID or entries of this directory\n"
+	 "\tjobid: only show records of this job"},
         {"changelog_clear", lfs_changelog_clear, 0,
          "Indicate that old changelog records up to <endrec> are no longer of "
          "interest to consumer <id>, allowing the system to free up space.\n"
@@ -3379,17 +3383,43 @@ static int lfs_ls(int argc, char **argv)
         return(llapi_ls(argc, argv));
 }
 
+/* parse a comma separated list of changelog record type names */
+static int lfs_changelog_type_mask(char *types, __u32 *mask)
+{
+	char *type;
+	int i;
+
+	while ((type = strsep(&types, ",")) != NULL) {
+		for (i = 0; i < CL_LAST; i++) {
+			if (strcasecmp(type, changelog_type2str(i)) == 0)
+				break;
+		}
+		if (i == CL_LAST) {
+			fprintf(stderr, "error: unknown changelog type '%s'\n",
+				type);
+			return -EINVAL;
+		}
+		*mask |= 1 << i;
+	}
+
+	return 0;
+}
+
 static int lfs_changelog(int argc, char **argv)
 {
         void *changelog_priv;
 	struct changelog_rec *rec;
+	struct changelog_filter filter = { 0 };
         long long startrec = 0, endrec = 0;
         char *mdd;
         struct option long_opts[] = {
                 {"follow", no_argument, 0, 'f'},
+		{"fid", required_argument, 0, 'F'},
+		{"jobid", required_argument, 0, 'j'},
+		{"type", required_argument, 0, 't'},
                 {0, 0, 0, 0}
         };
-        char short_opts[] = "f";
+	char short_opts[] = "fF:j:t:";
         int rc, follow = 0;
 
         while ((rc = getopt_long(argc, argv, short_opts,
@@ -3398,6 +3428,30 @@ static int lfs_changelog(int argc, char **argv)
                 case 'f':
                         follow++;
                         break;
+		case 'F':
+			if (*optarg == '[')
+				optarg++;
+			if (sscanf(optarg, SFID, RFID(&filter.cf_fid)) != 3 ||
+			    fid_is_zero(&filter.cf_fid)) {
+				fprintf(stderr, "error: %s: bad FID '%s'\n",
+					argv[0], optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'j':
+			if (strlen(optarg) >= sizeof(filter.cf_jobid)) {
+				fprintf(stderr, "error: %s: jobid too long\n",
+					argv[0]);
+				return CMD_HELP;
+			}
+			strncpy(filter.cf_jobid, optarg,
+				sizeof(filter.cf_jobid));
+			break;
+		case 't':
+			if (lfs_changelog_type_mask(optarg,
+						    &filter.cf_mask) != 0)
+				return CMD_HELP;
+			break;
                 case '?':
                         return CMD_HELP;
                 default:
@@ -3415,11 +3469,11 @@ static int lfs_changelog(int argc, char **argv)
         if (argc > optind)
                 endrec = strtoll(argv[optind++], NULL, 10);
 
-	rc = llapi_changelog_start(&changelog_priv,
-				   CHANGELOG_FLAG_BLOCK |
-				   CHANGELOG_FLAG_JOBID |
-				   (follow ? CHANGELOG_FLAG_FOLLOW : 0),
-				   mdd, startrec);
+	rc = llapi_changelog_start_filter(&changelog_priv,
+					  CHANGELOG_FLAG_BLOCK |
+					  CHANGELOG_FLAG_JOBID |
+					  (follow ? CHANGELOG_FLAG_FOLLOW : 0),
+					  mdd, startrec, &filter);
 	if (rc < 0) {
 		fprintf(stderr, "Can't start changelog: %s\n",
 			strerror(errno = -rc));
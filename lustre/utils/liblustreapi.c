@@ -3899,24 +3899,40 @@ int root_ioctl(const char *mdtname, int opc, void *data, int *mdtidxp,
 /****** Changelog API ********/
 
 static int changelog_ioctl(const char *mdtname, int opc, int id,
-                           long long recno, int flags)
+			   long long recno, int flags,
+			   const struct changelog_filter *filter)
 {
-        struct ioc_changelog data;
-        int *idx;
-
-        data.icc_id = id;
-        data.icc_recno = recno;
-        data.icc_flags = flags;
-        idx = (int *)(&data.icc_mdtindex);
+	struct ioc_changelog_filter data;
+	int *idx;
+
+	memset(&data, 0, sizeof(data));
+	data.icf_icc.icc_id = id;
+	data.icf_icc.icc_recno = recno;
+	data.icf_icc.icc_flags = flags;
+	idx = (int *)(&data.icf_icc.icc_mdtindex);
+
+	/* only filtered reads need the new ioctl, so that unfiltered ones
+	 * still work with older clients */
+	if (filter != NULL && opc == OBD_IOC_CHANGELOG_SEND) {
+		data.icf_filter = *filter;
+		opc = OBD_IOC_CHANGELOG_SEND_FILTER;
+	}
 
-        return root_ioctl(mdtname, opc, &data, idx, WANT_ERROR);
+	return root_ioctl(mdtname, opc, &data, idx, WANT_ERROR);
 }
 
+/* records are read from the kernel in chunks of this size */
+#define CHANGELOG_PRIV_BUF_SIZE (64 << 10)
+
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
 struct changelog_private {
 	int				magic;
 	enum changelog_send_flag	flags;
 	struct lustre_kernelcomm	kuc;
+	/* records read from the kernel, [buf_pos, buf_len) not returned */
+	char				*buf;
+	size_t				buf_pos;
+	size_t				buf_len;
 };
 
 /** Start reading from a changelog
@@ -3928,6 +3944,24 @@ struct changelog_private {
  */
 int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 			  const char *device, long long startrec)
+{
+	return llapi_changelog_start_filter(priv, flags, device, startrec,
+					    NULL);
+}
+
+/** Start reading the changelog records matching a filter
+ * @param priv Opaque private control structure
+ * @param flags Start flags (e.g. CHANGELOG_FLAG_BLOCK)
+ * @param device Report changes recorded on this MDT
+ * @param startrec Report changes beginning with this record number
+ * @param filter Only report the records matching this, NULL for all
+ *
+ * The filter is applied before the records are sent to userspace, but
+ * the records filtered out still have to be cleared by the consumer.
+ */
+int llapi_changelog_start_filter(void **priv, enum changelog_send_flag flags,
+				 const char *device, long long startrec,
+				 const struct changelog_filter *filter)
 {
 	struct changelog_private	*cp;
 	static bool			 warned;
@@ -3941,6 +3975,12 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 	cp->magic = CHANGELOG_PRIV_MAGIC;
 	cp->flags = flags;
 
+	cp->buf = malloc(CHANGELOG_PRIV_BUF_SIZE);
+	if (cp->buf == NULL) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
 	/* Set up the receiver */
 	rc = libcfs_ukuc_start(&cp->kuc, 0 /* no group registration */, 0);
 	if (rc < 0)
@@ -3958,7 +3998,7 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 
 	/* Tell the kernel to start sending */
 	rc = changelog_ioctl(device, OBD_IOC_CHANGELOG_SEND, cp->kuc.lk_wfd,
-			     startrec, flags);
+			     startrec, flags, filter);
 	/* Only the kernel reference keeps the write side open */
 	close(cp->kuc.lk_wfd);
 	cp->kuc.lk_wfd = LK_NOFD;
@@ -3971,6 +4011,7 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 	return 0;
 
 out_free:
+	free(cp->buf);
 	free(cp);
 	return rc;
 }
@@ -3984,6 +4025,7 @@ int llapi_changelog_fini(void **priv)
                 return -EINVAL;
 
         libcfs_ukuc_stop(&cp->kuc);
+	free(cp->buf);
         free(cp);
         *priv = NULL;
         return 0;
@@ -3998,6 +4040,60 @@ int llapi_changelog_fini(void **priv)
  *             properly handle the final format.
  * \return 1 if anything changed. 0 otherwise.
  */
+/**
+ * Get the next message sent by the kernel
+ *
+ * The kernel sends the records in batches, read as much as is available
+ * instead of reading each message header and payload separately.
+ *
+ * \param cp	changelog reader
+ * \param kuch	buffer of KUC_CHANGELOG_MSG_MAXSIZE bytes for the message
+ *
+ * \retval 0 on success, negative errno on failure
+ */
+static int changelog_msg_get(struct changelog_private *cp,
+			     struct kuc_hdr *kuch)
+{
+	struct kuc_hdr	*hdr;
+	ssize_t		 rc;
+
+	while (1) {
+		hdr = (struct kuc_hdr *)(cp->buf + cp->buf_pos);
+		if (cp->buf_len - cp->buf_pos >= sizeof(*hdr)) {
+			if (hdr->kuc_magic != KUC_MAGIC) {
+				llapi_err_noerrno(LLAPI_MSG_ERROR,
+						  "bad message magic %x != %x\n",
+						  hdr->kuc_magic, KUC_MAGIC);
+				return -EPROTO;
+			}
+
+			if (hdr->kuc_msglen < sizeof(*hdr) ||
+			    hdr->kuc_msglen > KUC_CHANGELOG_MSG_MAXSIZE)
+				return -EMSGSIZE;
+
+			if (cp->buf_len - cp->buf_pos >= hdr->kuc_msglen) {
+				memcpy(kuch, hdr, hdr->kuc_msglen);
+				cp->buf_pos += hdr->kuc_msglen;
+				return 0;
+			}
+		}
+
+		/* keep the partial message and read the rest */
+		memmove(cp->buf, cp->buf + cp->buf_pos,
+			cp->buf_len - cp->buf_pos);
+		cp->buf_len -= cp->buf_pos;
+		cp->buf_pos = 0;
+
+		rc = read(cp->kuc.lk_rfd, cp->buf + cp->buf_len,
+			  CHANGELOG_PRIV_BUF_SIZE - cp->buf_len);
+		if (rc < 0)
+			return -errno;
+		if (rc == 0)
+			return -EPIPE;
+		cp->buf_len += rc;
+	}
+}
+
 /** Read the next changelog entry
  * @param priv Opaque private control structure
  * @param rech Changelog record handle; record will be allocated here
@@ -4025,9 +4121,7 @@ int llapi_changelog_recv(void *priv, struct changelog_rec **rech)
 		rec_fmt |= CLF_JOBID;
 
 repeat:
-	rc = libcfs_ukuc_msg_get(&cp->kuc, (char *)kuch,
-				 KUC_CHANGELOG_MSG_MAXSIZE,
-				 KUC_TRANSPORT_CHANGELOG);
+	rc = changelog_msg_get(cp, kuch);
 	if (rc < 0)
 		goto out_free;
 
@@ -4100,7 +4194,8 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
                 return -EINVAL;
         }
 
-        return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0);
+	return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0,
+			       NULL);
 }
 
 int llapi_fid2path(const char *device, const char *fidstr, char *buf,
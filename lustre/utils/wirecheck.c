@@ -536,6 +536,11 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_BULK_MBITS);
 	CHECK_DEFINE_64X(OBD_CONNECT_OBDOPACK);
 	CHECK_DEFINE_64X(OBD_CONNECT_FLAGS2);
+	CHECK_DEFINE_64X(OBD_CONNECT2_MULTIOBJ_BRW);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LOCK_CONVERT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BL_AST_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_DESTROY_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_EXTENT_NOWAIT);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);